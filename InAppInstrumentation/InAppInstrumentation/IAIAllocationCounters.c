@@ -0,0 +1,447 @@
+//
+//  IAIAllocationCounters.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#if !defined(__APPLE__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "IAIAllocationCounters.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__APPLE__)
+#include <libkern/OSAtomic.h>
+#include <mach/mach.h>
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#include <stddef.h>
+#define OSAtomicAdd64Barrier(amount, value) __sync_add_and_fetch((value), (amount))
+#endif
+
+typedef struct {
+    unsigned numberOfEvents;
+    IAIAllocationCounts counts;
+    int64_t numberOfThreadAllocations;  // Never flushed.
+} IAIAllocationThreadCounters;
+
+static volatile int sInstalled = 0;
+static IAIAllocationCounts sTotals;
+
+static pthread_key_t sThreadCountersKey;
+static pthread_once_t sThreadCountersKeyOnce = PTHREAD_ONCE_INIT;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAIAllocationCountersFlush(IAIAllocationThreadCounters* counters) {
+    IAIAllocationCounts* counts = &counters->counts;
+    OSAtomicAdd64Barrier(counts->numberOfAllocations, &sTotals.numberOfAllocations);
+    OSAtomicAdd64Barrier(counts->numberOfFrees, &sTotals.numberOfFrees);
+    OSAtomicAdd64Barrier(counts->bytesAllocated, &sTotals.bytesAllocated);
+    OSAtomicAdd64Barrier(counts->bytesFreed, &sTotals.bytesFreed);
+    for (unsigned ix = 0; ix < IAIAllocationNumberOfSizeClasses; ++ix) {
+        if (0 != counts->numberOfAllocationsBySizeClass[ix]) {
+            OSAtomicAdd64Barrier(counts->numberOfAllocationsBySizeClass[ix],
+                                 &sTotals.numberOfAllocationsBySizeClass[ix]);
+        }
+    }
+    memset(counts, 0, sizeof(*counts));
+    counters->numberOfEvents = 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static unsigned IAIAllocationSizeClass(size_t size) {
+    if (size <= 16) {
+        return 0;
+    }
+    // The number of bits of size - 1 is the base 2 logarithm of size, rounded up.
+    unsigned bits = (unsigned)(sizeof(unsigned long) * 8
+                               - __builtin_clzl((unsigned long)size - 1));
+    unsigned sizeClass = bits - 4;
+    return (sizeClass < IAIAllocationNumberOfSizeClasses)
+            ? sizeClass : IAIAllocationNumberOfSizeClasses - 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+uint64_t IAIAllocationSizeClassLimit(unsigned sizeClass) {
+    if (sizeClass >= IAIAllocationNumberOfSizeClasses - 1) {
+        return UINT64_MAX;
+    }
+    return (uint64_t)16 << sizeClass;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIAllocationCountersRead(IAIAllocationCounts* counts) {
+    counts->numberOfAllocations = OSAtomicAdd64Barrier(0, &sTotals.numberOfAllocations);
+    counts->numberOfFrees = OSAtomicAdd64Barrier(0, &sTotals.numberOfFrees);
+    counts->bytesAllocated = OSAtomicAdd64Barrier(0, &sTotals.bytesAllocated);
+    counts->bytesFreed = OSAtomicAdd64Barrier(0, &sTotals.bytesFreed);
+    for (unsigned ix = 0; ix < IAIAllocationNumberOfSizeClasses; ++ix) {
+        counts->numberOfAllocationsBySizeClass[ix] =
+        OSAtomicAdd64Barrier(0, &sTotals.numberOfAllocationsBySizeClass[ix]);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAIAllocationCountersAreInstalled(void) {
+    return sInstalled;
+}
+
+
+static IAIAllocationThreadCounters* IAIAllocationThreadCountersGet(void);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int64_t IAIAllocationCountersCurrentThreadAllocations(void) {
+    if (!sInstalled) {
+        return 0;
+    }
+    IAIAllocationThreadCounters* counters = IAIAllocationThreadCountersGet();
+    return (NULL != counters) ? counters->numberOfThreadAllocations : 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAIAllocationCountersCountAllocation(size_t size) {
+    IAIAllocationThreadCounters* counters = IAIAllocationThreadCountersGet();
+    if (NULL != counters) {
+        ++counters->counts.numberOfAllocations;
+        ++counters->numberOfThreadAllocations;
+        counters->counts.bytesAllocated += size;
+        ++counters->counts.numberOfAllocationsBySizeClass[IAIAllocationSizeClass(size)];
+        if (++counters->numberOfEvents >= IAIAllocationFlushInterval) {
+            IAIAllocationCountersFlush(counters);
+        }
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAIAllocationCountersCountFree(size_t size) {
+    IAIAllocationThreadCounters* counters = IAIAllocationThreadCountersGet();
+    if (NULL != counters) {
+        ++counters->counts.numberOfFrees;
+        counters->counts.bytesFreed += size;
+        if (++counters->numberOfEvents >= IAIAllocationFlushInterval) {
+            IAIAllocationCountersFlush(counters);
+        }
+    }
+}
+
+
+#if defined(__APPLE__)
+
+static malloc_zone_t* sZone = NULL;
+static malloc_zone_t sOriginalZone;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The counters of a thread are allocated with the original zone so that they aren't counted.
+static void IAIAllocationThreadCountersDestroy(void* value) {
+    IAIAllocationThreadCounters* counters = value;
+    IAIAllocationCountersFlush(counters);
+    sOriginalZone.free(sZone, counters);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAIAllocationCountersCreateKey(void) {
+    pthread_key_create(&sThreadCountersKey, IAIAllocationThreadCountersDestroy);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static IAIAllocationThreadCounters* IAIAllocationThreadCountersGet(void) {
+    IAIAllocationThreadCounters* counters = pthread_getspecific(sThreadCountersKey);
+    if (NULL == counters) {
+        counters = sOriginalZone.calloc(sZone, 1, sizeof(IAIAllocationThreadCounters));
+        pthread_setspecific(sThreadCountersKey, counters);
+    }
+    return counters;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void* IAIZoneMalloc(malloc_zone_t* zone, size_t size) {
+    void* pointer = sOriginalZone.malloc(zone, size);
+    if (NULL != pointer) {
+        IAIAllocationCountersCountAllocation(sOriginalZone.size(zone, pointer));
+    }
+    return pointer;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void* IAIZoneCalloc(malloc_zone_t* zone, size_t count, size_t size) {
+    void* pointer = sOriginalZone.calloc(zone, count, size);
+    if (NULL != pointer) {
+        IAIAllocationCountersCountAllocation(sOriginalZone.size(zone, pointer));
+    }
+    return pointer;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void* IAIZoneValloc(malloc_zone_t* zone, size_t size) {
+    void* pointer = sOriginalZone.valloc(zone, size);
+    if (NULL != pointer) {
+        IAIAllocationCountersCountAllocation(sOriginalZone.size(zone, pointer));
+    }
+    return pointer;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void* IAIZoneMemalign(malloc_zone_t* zone, size_t alignment, size_t size) {
+    void* pointer = sOriginalZone.memalign(zone, alignment, size);
+    if (NULL != pointer) {
+        IAIAllocationCountersCountAllocation(sOriginalZone.size(zone, pointer));
+    }
+    return pointer;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void* IAIZoneRealloc(malloc_zone_t* zone, void* pointer, size_t size) {
+    size_t oldSize = (NULL != pointer) ? sOriginalZone.size(zone, pointer) : 0;
+    void* newPointer = sOriginalZone.realloc(zone, pointer, size);
+    if (NULL != newPointer) {
+        if (NULL != pointer) {
+            IAIAllocationCountersCountFree(oldSize);
+        }
+        IAIAllocationCountersCountAllocation(sOriginalZone.size(zone, newPointer));
+    }
+    return newPointer;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAIZoneFree(malloc_zone_t* zone, void* pointer) {
+    if (NULL != pointer) {
+        IAIAllocationCountersCountFree(sOriginalZone.size(zone, pointer));
+    }
+    sOriginalZone.free(zone, pointer);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAIZoneFreeDefiniteSize(malloc_zone_t* zone, void* pointer, size_t size) {
+    IAIAllocationCountersCountFree(size);
+    sOriginalZone.free_definite_size(zone, pointer, size);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Newer zones are kept in read-only memory between calls to the allocator.
+static void IAIAllocationCountersSetZoneWritable(int writable) {
+    if (sZone->version >= 8) {
+        vm_protect(mach_task_self(), (vm_address_t)sZone, sizeof(malloc_zone_t), 0,
+                   writable ? (VM_PROT_READ | VM_PROT_WRITE) : VM_PROT_READ);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAIAllocationCountersInstall(void) {
+    if (sInstalled) {
+        return 1;
+    }
+    if (NULL == sZone) {
+        sZone = malloc_default_zone();
+        if (NULL == sZone) {
+            return 0;
+        }
+        sOriginalZone = *sZone;
+    }
+    pthread_once(&sThreadCountersKeyOnce, IAIAllocationCountersCreateKey);
+
+    // Batch allocations are rare and left uncounted.
+    IAIAllocationCountersSetZoneWritable(1);
+    sZone->malloc = IAIZoneMalloc;
+    sZone->calloc = IAIZoneCalloc;
+    sZone->valloc = IAIZoneValloc;
+    sZone->realloc = IAIZoneRealloc;
+    sZone->free = IAIZoneFree;
+    if (sZone->version >= 5 && NULL != sOriginalZone.memalign) {
+        sZone->memalign = IAIZoneMemalign;
+    }
+    if (sZone->version >= 6 && NULL != sOriginalZone.free_definite_size) {
+        sZone->free_definite_size = IAIZoneFreeDefiniteSize;
+    }
+    IAIAllocationCountersSetZoneWritable(0);
+
+    sInstalled = 1;
+    return 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIAllocationCountersUninstall(void) {
+    if (!sInstalled) {
+        return;
+    }
+    // Calls that are already in the replacements keep using the saved originals.
+    IAIAllocationCountersSetZoneWritable(1);
+    sZone->malloc = sOriginalZone.malloc;
+    sZone->calloc = sOriginalZone.calloc;
+    sZone->valloc = sOriginalZone.valloc;
+    sZone->realloc = sOriginalZone.realloc;
+    sZone->free = sOriginalZone.free;
+    if (sZone->version >= 5) {
+        sZone->memalign = sOriginalZone.memalign;
+    }
+    if (sZone->version >= 6) {
+        sZone->free_definite_size = sOriginalZone.free_definite_size;
+    }
+    IAIAllocationCountersSetZoneWritable(0);
+    sInstalled = 0;
+}
+
+
+#else
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* pointer, size_t size);
+extern void* __libc_memalign(size_t alignment, size_t size);
+extern void* __libc_valloc(size_t size);
+extern void __libc_free(void* pointer);
+
+// Thread-local storage never allocates, so the counters can't recurse into malloc.
+static __thread IAIAllocationThreadCounters sThreadCounters;
+static __thread int sThreadCountersRegistered = 0;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAIAllocationThreadCountersDestroy(void* value) {
+    IAIAllocationCountersFlush(value);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAIAllocationCountersCreateKey(void) {
+    pthread_key_create(&sThreadCountersKey, IAIAllocationThreadCountersDestroy);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static IAIAllocationThreadCounters* IAIAllocationThreadCountersGet(void) {
+    if (!sThreadCountersRegistered) {
+        // Registering may allocate, which comes back here once the flag is set.
+        sThreadCountersRegistered = 1;
+        pthread_setspecific(sThreadCountersKey, &sThreadCounters);
+    }
+    return &sThreadCounters;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAIAllocationCountersInstall(void) {
+    pthread_once(&sThreadCountersKeyOnce, IAIAllocationCountersCreateKey);
+    sInstalled = 1;
+    return 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIAllocationCountersUninstall(void) {
+    sInstalled = 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void* malloc(size_t size) {
+    void* pointer = __libc_malloc(size);
+    if (sInstalled && NULL != pointer) {
+        IAIAllocationCountersCountAllocation(malloc_usable_size(pointer));
+    }
+    return pointer;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void* calloc(size_t count, size_t size) {
+    void* pointer = __libc_calloc(count, size);
+    if (sInstalled && NULL != pointer) {
+        IAIAllocationCountersCountAllocation(malloc_usable_size(pointer));
+    }
+    return pointer;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void* realloc(void* pointer, size_t size) {
+    size_t oldSize = (NULL != pointer) ? malloc_usable_size(pointer) : 0;
+    void* newPointer = __libc_realloc(pointer, size);
+    if (sInstalled) {
+        if (NULL != pointer && (NULL != newPointer || 0 == size)) {
+            IAIAllocationCountersCountFree(oldSize);
+        }
+        if (NULL != newPointer) {
+            IAIAllocationCountersCountAllocation(malloc_usable_size(newPointer));
+        }
+    }
+    return newPointer;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void* memalign(size_t alignment, size_t size) {
+    void* pointer = __libc_memalign(alignment, size);
+    if (sInstalled && NULL != pointer) {
+        IAIAllocationCountersCountAllocation(malloc_usable_size(pointer));
+    }
+    return pointer;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void* aligned_alloc(size_t alignment, size_t size) {
+    return memalign(alignment, size);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int posix_memalign(void** pointer, size_t alignment, size_t size) {
+    if (0 == alignment || 0 != (alignment & (alignment - 1)) || 0 != alignment % sizeof(void *)) {
+        return EINVAL;
+    }
+    void* newPointer = memalign(alignment, size);
+    if (NULL == newPointer) {
+        return ENOMEM;
+    }
+    *pointer = newPointer;
+    return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void* valloc(size_t size) {
+    void* pointer = __libc_valloc(size);
+    if (sInstalled && NULL != pointer) {
+        IAIAllocationCountersCountAllocation(malloc_usable_size(pointer));
+    }
+    return pointer;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void free(void* pointer) {
+    if (sInstalled && NULL != pointer) {
+        IAIAllocationCountersCountFree(malloc_usable_size(pointer));
+    }
+    __libc_free(pointer);
+}
+
+#endif
@@ -0,0 +1,78 @@
+//
+//  IAIAllocationCounters.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#ifndef InAppInstrumentation_IAIAllocationCounters_h
+#define InAppInstrumentation_IAIAllocationCounters_h
+
+#include <stdint.h>
+
+/**
+ * Counts the heap allocations of the process.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * On Apple platforms the counters replace the functions of the default malloc zone with
+ * functions that count each call and then call the originals. Elsewhere the counters define
+ * malloc, free and their relatives, which take the place of the C library's functions in any
+ * program they are linked into, and count only while they are installed.
+ *
+ * Each thread counts into counters of its own and adds them to the shared totals once every
+ * IAIAllocationFlushInterval allocations and frees, and when it exits, so the totals lag each
+ * thread by at most that many calls. Sizes are the sizes of the blocks that the allocator
+ * handed out, which may be larger than the sizes that were asked for.
+ *
+ * Blocks that were allocated before the counters were installed are still counted when they
+ * are freed, so the net number of bytes allocated can fall below zero.
+ */
+
+#define IAIAllocationFlushInterval 256
+
+// Blocks of up to 16 bytes, up to 32 bytes, ..., up to 32 KB, and larger.
+#define IAIAllocationNumberOfSizeClasses 13
+
+typedef struct {
+    int64_t numberOfAllocations;
+    int64_t numberOfFrees;
+    int64_t bytesAllocated;
+    int64_t bytesFreed;
+    int64_t numberOfAllocationsBySizeClass[IAIAllocationNumberOfSizeClasses];
+} IAIAllocationCounts;
+
+/**
+ * Starts counting. Returns 0 if the allocator can't be hooked.
+ */
+int IAIAllocationCountersInstall(void);
+
+/**
+ * Stops counting. The totals are kept.
+ */
+void IAIAllocationCountersUninstall(void);
+
+int IAIAllocationCountersAreInstalled(void);
+
+/**
+ * Reads the totals that the threads have added so far.
+ */
+void IAIAllocationCountersRead(IAIAllocationCounts* counts);
+
+/**
+ * The number of allocations that the calling thread has made while the counters were
+ * installed, or 0 when they aren't installed.
+ *
+ * The count is the thread's own and is never flushed or reset, so unlike the totals it is
+ * exact, and the difference between two reads on the same thread is the number of allocations
+ * that the thread made in between.
+ */
+int64_t IAIAllocationCountersCurrentThreadAllocations(void);
+
+/**
+ * The largest block in a size class, or UINT64_MAX for the last class.
+ */
+uint64_t IAIAllocationSizeClassLimit(unsigned sizeClass);
+
+#endif
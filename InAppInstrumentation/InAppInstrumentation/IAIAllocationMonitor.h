@@ -0,0 +1,111 @@
+//
+//  IAIAllocationMonitor.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "IAIAllocationCounters.h"
+
+@class IAILogger;
+
+// The metrics that the allocation monitor adds to its logger.
+extern NSString* const IAIMetricAllocationsPerSecond;
+extern NSString* const IAIMetricBytesAllocatedPerSecond;
+extern NSString* const IAIMetricBytesOfLiveHeap;
+
+/**
+ * Measures the app's own heap allocations.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * The free memory of the device also moves with every other process, so it can't tell the
+ * app's allocation churn apart from the system's. While the monitor is started, every malloc
+ * and free of the process is counted (see IAIAllocationCounters.h), and once per heartbeat the
+ * monitor turns the counts into rates and adds them to the logger as the metrics
+ * IAIMetricAllocationsPerSecond, IAIMetricBytesAllocatedPerSecond and IAIMetricBytesOfLiveHeap.
+ *
+ * Counting costs a few nanoseconds for every allocation of every thread, so the monitor is off
+ * until it is started.
+ */
+@interface IAIAllocationMonitor : NSObject {
+@private
+    __weak IAILogger* _logger;
+
+    NSTimeInterval _lastUpdateTime;
+    IAIAllocationCounts _counts;
+    IAIAllocationCounts _countsAtStart;
+    double _allocationsPerSecond;
+    double _bytesAllocatedPerSecond;
+}
+
+#pragma mark Creating a Monitor /** @name Creating a Monitor */
+
+/**
+ * Designated initializer.
+ *
+ * The logger is not retained.
+ */
+- (id)initWithLogger:(IAILogger *)logger;
+
+
+#pragma mark Counting Allocations /** @name Counting Allocations */
+
+/**
+ * Starts counting allocations. Returns NO if the allocator can't be hooked.
+ */
+- (BOOL)start;
+
+/**
+ * Stops counting allocations.
+ */
+- (void)stop;
+
+@property (nonatomic, readonly, assign, getter=isRunning) BOOL running;
+
+/**
+ * Reads the counts and adds the metrics to the logger.
+ *
+ * Call this from the main thread once per heartbeat. Does nothing while the monitor is
+ * stopped.
+ */
+- (void)update;
+
+
+#pragma mark Reading Counts /** @name Reading Counts */
+
+/**
+ * The number of allocations per second between the last two updates.
+ */
+@property (nonatomic, readonly, assign) double allocationsPerSecond;
+
+/**
+ * The number of bytes allocated per second between the last two updates.
+ */
+@property (nonatomic, readonly, assign) double bytesAllocatedPerSecond;
+
+/**
+ * The number of bytes allocated and not yet freed since the monitor was first started.
+ *
+ * Blocks that were allocated before then are subtracted when they are freed, so this is the
+ * growth of the heap since the start rather than its size, and may be negative.
+ */
+@property (nonatomic, readonly, assign) long long bytesOfLiveHeap;
+
+/**
+ * The number of allocations since the monitor was first started.
+ */
+@property (nonatomic, readonly, assign) unsigned long long numberOfAllocations;
+
+/**
+ * The number of allocations in a size class since the monitor was first started.
+ *
+ * Size class n holds the blocks of up to IAIAllocationSizeClassLimit(n) bytes that don't fit
+ * in class n - 1.
+ */
+- (unsigned long long)numberOfAllocationsInSizeClass:(NSUInteger)sizeClass;
+
+@end
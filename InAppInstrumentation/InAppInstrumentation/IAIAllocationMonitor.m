@@ -0,0 +1,120 @@
+//
+//  IAIAllocationMonitor.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAIAllocationMonitor.h"
+
+#import "IAILogger.h"
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+NSString* const IAIMetricAllocationsPerSecond = @"allocationsPerSecond";
+NSString* const IAIMetricBytesAllocatedPerSecond = @"bytesAllocatedPerSecond";
+NSString* const IAIMetricBytesOfLiveHeap = @"bytesOfLiveHeap";
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIAllocationMonitor
+
+@synthesize allocationsPerSecond = _allocationsPerSecond;
+@synthesize bytesAllocatedPerSecond = _bytesAllocatedPerSecond;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithLogger:(IAILogger *)logger {
+    if ((self = [super init])) {
+        _logger = logger;
+
+        // The counters may have been installed by an earlier monitor.
+        IAIAllocationCountersRead(&_countsAtStart);
+        _counts = _countsAtStart;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)start {
+    if (!IAIAllocationCountersInstall()) {
+        return NO;
+    }
+    _lastUpdateTime = 0;
+    return YES;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)stop {
+    IAIAllocationCountersUninstall();
+    _allocationsPerSecond = 0;
+    _bytesAllocatedPerSecond = 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)isRunning {
+    return IAIAllocationCountersAreInstalled();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)update {
+    if (!self.isRunning) {
+        return;
+    }
+
+    IAIAllocationCounts counts;
+    IAIAllocationCountersRead(&counts);
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+
+    // The first update after a start only sets the baseline of the rates.
+    if (_lastUpdateTime > 0 && now > _lastUpdateTime) {
+        NSTimeInterval elapsed = now - _lastUpdateTime;
+        _allocationsPerSecond = ((double)(counts.numberOfAllocations - _counts.numberOfAllocations)
+                                 / elapsed);
+        _bytesAllocatedPerSecond = ((double)(counts.bytesAllocated - _counts.bytesAllocated)
+                                    / elapsed);
+
+        IAILogger* logger = _logger;
+        [logger addMetricValue:_allocationsPerSecond forName:IAIMetricAllocationsPerSecond];
+        [logger addMetricValue:_bytesAllocatedPerSecond forName:IAIMetricBytesAllocatedPerSecond];
+    }
+    _counts = counts;
+    _lastUpdateTime = now;
+
+    [_logger addMetricValue:(double)self.bytesOfLiveHeap forName:IAIMetricBytesOfLiveHeap];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (long long)bytesOfLiveHeap {
+    return ((_counts.bytesAllocated - _countsAtStart.bytesAllocated)
+            - (_counts.bytesFreed - _countsAtStart.bytesFreed));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (unsigned long long)numberOfAllocations {
+    return (unsigned long long)(_counts.numberOfAllocations - _countsAtStart.numberOfAllocations);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (unsigned long long)numberOfAllocationsInSizeClass:(NSUInteger)sizeClass {
+    if (sizeClass >= IAIAllocationNumberOfSizeClasses) {
+        return 0;
+    }
+    return (unsigned long long)(_counts.numberOfAllocationsBySizeClass[sizeClass]
+                                - _countsAtStart.numberOfAllocationsBySizeClass[sizeClass]);
+}
+
+
+@end
@@ -0,0 +1,217 @@
+//
+//  IAIBudget.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#include "IAIBudget.h"
+
+#include "IAIAllocationCounters.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#if defined(__APPLE__)
+#include <libkern/OSAtomic.h>
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#define OSMemoryBarrier() __sync_synchronize()
+#endif
+
+static pthread_mutex_t sMutex = PTHREAD_MUTEX_INITIALIZER;
+static IAIBudgetSiteStatistics* sStatistics[IAIBudgetMaxSites];
+static volatile unsigned sNumberOfSites = 0;
+
+// The pending violations, a ring of which sFirstViolation is the oldest.
+static IAIBudgetViolation sViolations[IAIBudgetMaxPendingViolations];
+static unsigned sFirstViolation = 0;
+static unsigned sNumberOfViolations = 0;
+static unsigned sNumberOfDroppedViolations = 0;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The raw clock, which on Apple platforms counts ticks of the timebase rather than nanoseconds.
+static uint64_t IAIBudgetNow(void) {
+#if defined(__APPLE__)
+    return mach_absolute_time();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static uint64_t IAIBudgetTicksFromNanoseconds(uint64_t nanoseconds) {
+#if defined(__APPLE__)
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    return nanoseconds * timebase.denom / timebase.numer;
+#else
+    return nanoseconds;
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static uint64_t IAIBudgetNanosecondsFromTicks(uint64_t ticks) {
+#if defined(__APPLE__)
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    return ticks * timebase.numer / timebase.denom;
+#else
+    return ticks;
+#endif
+}
+
+
+#pragma mark - Sites
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Numbers a site on its first use. Sites beyond IAIBudgetMaxSites get IAIBudgetMaxSites and
+// are still checked, but their violations are neither counted nor queued.
+static void IAIBudgetSiteRegister(IAIBudgetSite* site) {
+    pthread_mutex_lock(&sMutex);
+    if (site->index < 0) {
+        site->maximumTicks = IAIBudgetTicksFromNanoseconds(site->maximumDuration);
+        int32_t index = IAIBudgetMaxSites;
+        if (sNumberOfSites < IAIBudgetMaxSites) {
+            IAIBudgetSiteStatistics* statistics = calloc(1, sizeof(IAIBudgetSiteStatistics));
+            if (NULL != statistics) {
+                statistics->name = site->name;
+                statistics->maximumDuration = site->maximumDuration;
+                statistics->maximumNumberOfAllocations = site->maximumNumberOfAllocations;
+                index = (int32_t)sNumberOfSites;
+                sStatistics[index] = statistics;
+                sNumberOfSites = (unsigned)index + 1;
+            }
+        }
+        // Publish the index only once the ticks and the site's statistics are in place.
+        OSMemoryBarrier();
+        site->index = index;
+    }
+    pthread_mutex_unlock(&sMutex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned IAIBudgetNumberOfSites(void) {
+    return sNumberOfSites;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAIBudgetReadSite(unsigned index, IAIBudgetSiteStatistics* statistics) {
+    int found = 0;
+    pthread_mutex_lock(&sMutex);
+    if (index < sNumberOfSites) {
+        memcpy(statistics, sStatistics[index], sizeof(*statistics));
+        found = 1;
+    }
+    pthread_mutex_unlock(&sMutex);
+    return found;
+}
+
+
+#pragma mark - Violations
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAIBudgetRecordViolation(IAIBudgetSite* site, uint64_t ticks,
+                                     int64_t numberOfAllocations) {
+    uint32_t index = (uint32_t)site->index;
+    if (index >= IAIBudgetMaxSites) {
+        return;
+    }
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    uint64_t duration = IAIBudgetNanosecondsFromTicks(ticks);
+
+    pthread_mutex_lock(&sMutex);
+    IAIBudgetSiteStatistics* statistics = sStatistics[index];
+    ++statistics->numberOfViolations;
+    if (duration > statistics->worstDuration) {
+        statistics->worstDuration = duration;
+    }
+    if (numberOfAllocations > statistics->worstNumberOfAllocations) {
+        statistics->worstNumberOfAllocations = numberOfAllocations;
+    }
+
+    if (sNumberOfViolations < IAIBudgetMaxPendingViolations) {
+        unsigned slot = (sFirstViolation + sNumberOfViolations) % IAIBudgetMaxPendingViolations;
+        IAIBudgetViolation* violation = &sViolations[slot];
+        violation->siteIndex = index;
+        violation->duration = duration;
+        violation->numberOfAllocations = numberOfAllocations;
+        violation->endTime = (double)now.tv_sec + (double)now.tv_usec / 1000000.0;
+        ++sNumberOfViolations;
+    } else {
+        ++sNumberOfDroppedViolations;
+    }
+    pthread_mutex_unlock(&sMutex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned IAIBudgetTakeViolations(IAIBudgetViolation* violations, unsigned capacity,
+                                 unsigned* numberOfDroppedViolations) {
+    pthread_mutex_lock(&sMutex);
+    unsigned count = (sNumberOfViolations < capacity) ? sNumberOfViolations : capacity;
+    for (unsigned ix = 0; ix < count; ++ix) {
+        violations[ix] = sViolations[(sFirstViolation + ix) % IAIBudgetMaxPendingViolations];
+    }
+    sFirstViolation = (sFirstViolation + count) % IAIBudgetMaxPendingViolations;
+    sNumberOfViolations -= count;
+    if (NULL != numberOfDroppedViolations) {
+        *numberOfDroppedViolations = sNumberOfDroppedViolations;
+        sNumberOfDroppedViolations = 0;
+    }
+    pthread_mutex_unlock(&sMutex);
+    return count;
+}
+
+
+#pragma mark - Scopes
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIBudgetBegin(IAIBudgetScope* scope, IAIBudgetSite* site) {
+    if (site->index < 0) {
+        IAIBudgetSiteRegister(site);
+    }
+    scope->site = site;
+    scope->startNumberOfAllocations = (site->maximumNumberOfAllocations >= 0)
+                                      ? IAIAllocationCountersCurrentThreadAllocations() : 0;
+    // Last, so that reading the allocation count isn't charged to the scope.
+    scope->startTime = IAIBudgetNow();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIBudgetEnd(IAIBudgetScope* scope) {
+    uint64_t ticks = IAIBudgetNow() - scope->startTime;
+    IAIBudgetSite* site = scope->site;
+
+    int64_t numberOfAllocations = 0;
+    int isOverBudget = ticks > site->maximumTicks;
+    if (site->maximumNumberOfAllocations >= 0) {
+        numberOfAllocations = (IAIAllocationCountersCurrentThreadAllocations()
+                               - scope->startNumberOfAllocations);
+        // The counters were uninstalled during the scope.
+        if (numberOfAllocations < 0) {
+            numberOfAllocations = 0;
+        }
+        isOverBudget = isOverBudget || numberOfAllocations > site->maximumNumberOfAllocations;
+    }
+
+    if (isOverBudget) {
+        IAIBudgetRecordViolation(site, ticks, numberOfAllocations);
+    }
+}
@@ -0,0 +1,118 @@
+//
+//  IAIBudget.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#ifndef InAppInstrumentation_IAIBudget_h
+#define InAppInstrumentation_IAIBudget_h
+
+#include <stdint.h>
+
+/**
+ * Scopes that state how long they may take and how many allocations they may make.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * Each budget is an IAIBudgetSite, usually a static variable next to the code that it covers,
+ * and every run of that code is an IAIBudgetScope on the stack:
+ *
+ * @code
+ *  // Under 2 ms and no more than 10 allocations.
+ *  static IAIBudgetSite sLayoutSite = IAIBudgetSiteMake("cell layout", 2000000, 10);
+ *  IAIBudgetScope scope;
+ *  IAIBudgetBegin(&scope, &sLayoutSite);
+ *  ...
+ *  IAIBudgetEnd(&scope);
+ * @endcode
+ *
+ * A scope that stays within its budget reads the clock when it begins and when it ends, and
+ * compares the elapsed ticks with the budget, which is converted to ticks once when the site
+ * is first used. Sites that budget allocations also read the calling thread's allocation count
+ * at both ends (see IAIAllocationCountersCurrentThreadAllocations), which counts nothing unless
+ * IAIAllocationCountersInstall has been called. Nothing is shared between threads and nothing
+ * is written on this path.
+ *
+ * Only a scope that exceeds its budget takes the budgets' mutex, to count the violation
+ * against its site and to queue it for IAIBudgetMonitor, which adds it to the logger. Up to
+ * IAIBudgetMaxPendingViolations violations are queued between two reads of the queue, and
+ * later ones are counted against their sites but dropped from the queue.
+ */
+
+#define IAIBudgetMaxSites 128
+#define IAIBudgetMaxPendingViolations 64
+
+// The maximum number of allocations of a site that doesn't budget its allocations.
+#define IAIBudgetUnlimited (-1)
+
+typedef struct {
+    const char* name;
+    uint64_t maximumDuration;               // In nanoseconds.
+    int64_t maximumNumberOfAllocations;     // Or IAIBudgetUnlimited.
+    uint64_t maximumTicks;                  // maximumDuration in ticks of the clock.
+    volatile int32_t index;                 // -1 until the site is first used.
+} IAIBudgetSite;
+
+// Initializes a site with a name that must outlive it, usually a string literal.
+#define IAIBudgetSiteMake(name, maximumDuration, maximumNumberOfAllocations) \
+    { (name), (maximumDuration), (maximumNumberOfAllocations), 0, -1 }
+
+// One run of the code of a site. Lives on the stack of the thread that runs it.
+typedef struct {
+    IAIBudgetSite* site;
+    uint64_t startTime;
+    int64_t startNumberOfAllocations;
+} IAIBudgetScope;
+
+typedef struct {
+    const char* name;
+    uint64_t maximumDuration;
+    int64_t maximumNumberOfAllocations;
+    uint64_t numberOfViolations;
+    uint64_t worstDuration;                 // In nanoseconds, of the violations.
+    int64_t worstNumberOfAllocations;       // Of the violations, 0 if allocations are unlimited.
+} IAIBudgetSiteStatistics;
+
+// A scope that exceeded its budget.
+typedef struct {
+    uint32_t siteIndex;
+    uint64_t duration;                      // In nanoseconds.
+    int64_t numberOfAllocations;            // 0 if the site's allocations are unlimited.
+    double endTime;                         // Seconds since 1970.
+} IAIBudgetViolation;
+
+
+#pragma mark Scopes /** @name Scopes */
+
+void IAIBudgetBegin(IAIBudgetScope* scope, IAIBudgetSite* site);
+
+/**
+ * Ends a scope on the thread that began it, and records a violation if it was over budget.
+ */
+void IAIBudgetEnd(IAIBudgetScope* scope);
+
+
+#pragma mark Reading Sites /** @name Reading Sites */
+
+/**
+ * The number of sites that have been used so far. Sites are numbered in the order of their
+ * first use, and no more than IAIBudgetMaxSites are recorded.
+ */
+unsigned IAIBudgetNumberOfSites(void);
+
+/**
+ * Copies the statistics of a site. Returns 0 if there is no site with the index.
+ */
+int IAIBudgetReadSite(unsigned index, IAIBudgetSiteStatistics* statistics);
+
+/**
+ * Removes up to capacity violations from the queue, the oldest first, and returns how many
+ * were removed. numberOfDroppedViolations, if not NULL, is set to the number of violations
+ * that didn't fit in the queue since the last call.
+ */
+unsigned IAIBudgetTakeViolations(IAIBudgetViolation* violations, unsigned capacity,
+                                 unsigned* numberOfDroppedViolations);
+
+#endif
@@ -0,0 +1,169 @@
+//
+//  IAIBudgetMonitor.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "IAIBudget.h"
+#import "IAILogger.h"
+
+/**
+ * A scope that exceeded its budget, logged as an IAIEventBudgetWasExceeded event whose value is
+ * the number of seconds that the scope took.
+ *
+ *      @ingroup Overview-Logger-Entries
+ *
+ * Times are in seconds.
+ */
+@interface IAIBudgetViolationLogEntry : IAIEventLogEntry {
+@private
+    NSString* _name;
+    NSTimeInterval _maximumDuration;
+    long long _maximumNumberOfAllocations;
+    long long _numberOfAllocations;
+    NSArray* _consoleLogs;
+}
+
+/**
+ * The name of the budget's site.
+ */
+@property (nonatomic, readonly, copy) NSString* name;
+
+@property (nonatomic, readonly, assign) NSTimeInterval duration;
+@property (nonatomic, readonly, assign) NSTimeInterval maximumDuration;
+
+/**
+ * The number of allocations of the scope, or 0 if the site doesn't budget its allocations.
+ */
+@property (nonatomic, readonly, assign) long long numberOfAllocations;
+
+/**
+ * IAIBudgetUnlimited if the site doesn't budget its allocations.
+ */
+@property (nonatomic, readonly, assign) long long maximumNumberOfAllocations;
+
+/**
+ * The console logs that were logged around the end of the scope, as IAIConsoleLogEntry
+ * objects, oldest first.
+ */
+@property (nonatomic, readonly, copy) NSArray* consoleLogs;
+
+@end
+
+
+/**
+ * The violations of one budget since the app started.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * Times are in seconds.
+ */
+@interface IAIBudgetSiteSummary : NSObject {
+@private
+    NSString* _name;
+    NSTimeInterval _maximumDuration;
+    long long _maximumNumberOfAllocations;
+    unsigned long long _numberOfViolations;
+    NSTimeInterval _worstDuration;
+    long long _worstNumberOfAllocations;
+    IAIBudgetViolationLogEntry* _lastViolation;
+}
+
+@property (nonatomic, readonly, copy) NSString* name;
+@property (nonatomic, readonly, assign) NSTimeInterval maximumDuration;
+
+/**
+ * IAIBudgetUnlimited if the site doesn't budget its allocations.
+ */
+@property (nonatomic, readonly, assign) long long maximumNumberOfAllocations;
+
+@property (nonatomic, readonly, assign) unsigned long long numberOfViolations;
+
+/**
+ * The longest duration of the violations, which may be within the budget when only the
+ * allocations were over.
+ */
+@property (nonatomic, readonly, assign) NSTimeInterval worstDuration;
+
+@property (nonatomic, readonly, assign) long long worstNumberOfAllocations;
+
+/**
+ * The latest violation that the monitor logged, or nil.
+ */
+@property (nonatomic, readonly, IAI_STRONG) IAIBudgetViolationLogEntry* lastViolation;
+
+@end
+
+
+/**
+ * Logs the violations of the budgets of IAIBudget.h.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * Budgets check themselves, so there is nothing to start: a scope that stays within its budget
+ * costs two reads of the clock and never reaches the monitor. Once per heartbeat the monitor
+ * takes the violations that the scopes queued, adds each to the logger as an
+ * IAIBudgetViolationLogEntry with the console logs around it, and reads the sites' counts and
+ * worst cases.
+ *
+ * Violations are queued with the wall-clock time at which the scope ended, so the monitor
+ * should log to a logger that uses the wall clock. Violations that don't fit in the queue are
+ * counted as dropped records of the instrumentation (see IAIOverheadCountDroppedRecords).
+ */
+@interface IAIBudgetMonitor : NSObject {
+@private
+    __weak IAILogger* _logger;
+
+    NSTimeInterval _consoleContextInterval;
+    NSUInteger _maximumNumberOfConsoleLogs;
+    NSMutableDictionary* _lastViolations;
+    NSArray* _siteSummaries;
+}
+
+#pragma mark Creating a Monitor /** @name Creating a Monitor */
+
+/**
+ * Designated initializer.
+ *
+ * The logger is not retained.
+ */
+- (id)initWithLogger:(IAILogger *)logger;
+
+
+#pragma mark Console Context /** @name Console Context */
+
+/**
+ * How many seconds of console logs on either side of the end of a scope are kept with its
+ * violation.
+ *
+ * By default this is 2 seconds.
+ */
+@property (nonatomic, readwrite, assign) NSTimeInterval consoleContextInterval;
+
+/**
+ * The most console logs that are kept with a violation, those nearest to the end of the scope.
+ *
+ * By default this is 20.
+ */
+@property (nonatomic, readwrite, assign) NSUInteger maximumNumberOfConsoleLogs;
+
+
+#pragma mark Reading Sites /** @name Reading Sites */
+
+/**
+ * Logs the queued violations and reads the sites.
+ *
+ * Call this from the main thread once per heartbeat.
+ */
+- (void)update;
+
+/**
+ * The summaries of all sites as of the last update, the most violated first.
+ */
+@property (nonatomic, readonly, copy) NSArray* siteSummaries;
+
+@end
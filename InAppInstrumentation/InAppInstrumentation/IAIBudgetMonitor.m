@@ -0,0 +1,252 @@
+//
+//  IAIBudgetMonitor.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAIBudgetMonitor.h"
+
+#import "IAIDataStructures.h"
+#import "IAIOverhead.h"
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static NSTimeInterval IAISecondsFromNanoseconds(uint64_t nanoseconds) {
+    return (NSTimeInterval)nanoseconds / NSEC_PER_SEC;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The logs of the range that are nearest to the date, at most maximumCount of them.
+static NSArray* IAIConsoleLogsNearestToDate(IAIHistoryRange* range, NSDate* date,
+                                            NSUInteger maximumCount) {
+    NSArray* logs = [range allObjects];
+    NSUInteger count = [logs count];
+    if (count <= maximumCount) {
+        return logs;
+    }
+    // The first log after the date, with the window centered on it where the range allows.
+    NSUInteger split = 0;
+    while (split < count
+           && [[[logs objectAtIndex:split] timestamp] compare:date] != NSOrderedDescending) {
+        ++split;
+    }
+    NSUInteger start = (split > maximumCount / 2) ? split - maximumCount / 2 : 0;
+    start = MIN(start, count - maximumCount);
+    return [logs subarrayWithRange:NSMakeRange(start, maximumCount)];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@interface IAIBudgetViolationLogEntry()
+
+- (id)initWithViolation: (const IAIBudgetViolation *)violation
+             statistics: (const IAIBudgetSiteStatistics *)statistics;
+
+@property (nonatomic, readwrite, copy) NSArray* consoleLogs;
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIBudgetViolationLogEntry
+
+@synthesize name = _name;
+@synthesize maximumDuration = _maximumDuration;
+@synthesize maximumNumberOfAllocations = _maximumNumberOfAllocations;
+@synthesize numberOfAllocations = _numberOfAllocations;
+@synthesize consoleLogs = _consoleLogs;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithViolation: (const IAIBudgetViolation *)violation
+             statistics: (const IAIBudgetSiteStatistics *)statistics {
+    if ((self = [super initWithType: IAIEventBudgetWasExceeded
+                              value: IAISecondsFromNanoseconds(violation->duration)])) {
+        self.timestamp = [NSDate dateWithTimeIntervalSince1970:violation->endTime];
+        _name = [[NSString alloc] initWithUTF8String:statistics->name];
+        _maximumDuration = IAISecondsFromNanoseconds(statistics->maximumDuration);
+        _maximumNumberOfAllocations = statistics->maximumNumberOfAllocations;
+        _numberOfAllocations = violation->numberOfAllocations;
+        _consoleLogs = [NSArray array];
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@ %@ %.6fs/%.6fs, %lld/%lld allocations>",
+            NSStringFromClass([self class]), _name, self.duration, _maximumDuration,
+            _numberOfAllocations, _maximumNumberOfAllocations];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSTimeInterval)duration {
+    return self.value;
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@interface IAIBudgetSiteSummary()
+
+- (id)initWithStatistics: (const IAIBudgetSiteStatistics *)statistics
+           lastViolation: (IAIBudgetViolationLogEntry *)lastViolation;
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIBudgetSiteSummary
+
+@synthesize name = _name;
+@synthesize maximumDuration = _maximumDuration;
+@synthesize maximumNumberOfAllocations = _maximumNumberOfAllocations;
+@synthesize numberOfViolations = _numberOfViolations;
+@synthesize worstDuration = _worstDuration;
+@synthesize worstNumberOfAllocations = _worstNumberOfAllocations;
+@synthesize lastViolation = _lastViolation;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithStatistics: (const IAIBudgetSiteStatistics *)statistics
+           lastViolation: (IAIBudgetViolationLogEntry *)lastViolation {
+    if ((self = [super init])) {
+        _name = [[NSString alloc] initWithUTF8String:statistics->name];
+        _maximumDuration = IAISecondsFromNanoseconds(statistics->maximumDuration);
+        _maximumNumberOfAllocations = statistics->maximumNumberOfAllocations;
+        _numberOfViolations = statistics->numberOfViolations;
+        _worstDuration = IAISecondsFromNanoseconds(statistics->worstDuration);
+        _worstNumberOfAllocations = statistics->worstNumberOfAllocations;
+        _lastViolation = lastViolation;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@ %@ %llu violations, worst %.6fs/%.6fs>",
+            NSStringFromClass([self class]), _name, _numberOfViolations, _worstDuration,
+            _maximumDuration];
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@interface IAIBudgetMonitor()
+
+- (void)logViolations;
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIBudgetMonitor
+
+@synthesize consoleContextInterval = _consoleContextInterval;
+@synthesize maximumNumberOfConsoleLogs = _maximumNumberOfConsoleLogs;
+@synthesize siteSummaries = _siteSummaries;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithLogger:(IAILogger *)logger {
+    if ((self = [super init])) {
+        _logger = logger;
+        _consoleContextInterval = 2;
+        _maximumNumberOfConsoleLogs = 20;
+        _lastViolations = [[NSMutableDictionary alloc] init];
+        _siteSummaries = [NSArray array];
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)logViolations {
+    IAILogger* logger = _logger;
+    IAIBudgetViolation violations[IAIBudgetMaxPendingViolations];
+    unsigned numberOfDroppedViolations = 0;
+    unsigned count = IAIBudgetTakeViolations(violations, IAIBudgetMaxPendingViolations,
+                                             &numberOfDroppedViolations);
+    if (numberOfDroppedViolations > 0) {
+        IAIOverheadCountDroppedRecords(numberOfDroppedViolations);
+    }
+
+    for (unsigned ix = 0; ix < count; ++ix) {
+        IAIBudgetSiteStatistics statistics;
+        if (!IAIBudgetReadSite(violations[ix].siteIndex, &statistics)) {
+            continue;
+        }
+        IAIBudgetViolationLogEntry* violation =
+        [[IAIBudgetViolationLogEntry alloc] initWithViolation: &violations[ix]
+                                                   statistics: &statistics];
+        // The logs after the scope are those that were logged before this heartbeat.
+        IAIHistoryRange* range = [logger consoleLogsAroundEntry: violation
+                                                   timeInterval: _consoleContextInterval];
+        violation.consoleLogs = IAIConsoleLogsNearestToDate(range, violation.timestamp,
+                                                            _maximumNumberOfConsoleLogs);
+        [logger addEventLog:violation];
+        [_lastViolations setObject: violation
+                            forKey: [NSNumber numberWithUnsignedInt:violations[ix].siteIndex]];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)update {
+    [self logViolations];
+
+    unsigned numberOfSites = IAIBudgetNumberOfSites();
+    NSMutableArray* summaries = [NSMutableArray arrayWithCapacity:numberOfSites];
+    for (unsigned ix = 0; ix < numberOfSites; ++ix) {
+        IAIBudgetSiteStatistics statistics;
+        if (IAIBudgetReadSite(ix, &statistics)) {
+            IAIBudgetViolationLogEntry* lastViolation =
+            [_lastViolations objectForKey:[NSNumber numberWithUnsignedInt:ix]];
+            [summaries addObject:[[IAIBudgetSiteSummary alloc] initWithStatistics: &statistics
+                                                                    lastViolation: lastViolation]];
+        }
+    }
+
+    [summaries sortUsingComparator:^NSComparisonResult(IAIBudgetSiteSummary* summary1,
+                                                       IAIBudgetSiteSummary* summary2) {
+        if (summary1.numberOfViolations != summary2.numberOfViolations) {
+            return (summary1.numberOfViolations > summary2.numberOfViolations
+                    ? NSOrderedAscending : NSOrderedDescending);
+        }
+        if (summary1.worstDuration != summary2.worstDuration) {
+            return (summary1.worstDuration > summary2.worstDuration
+                    ? NSOrderedAscending : NSOrderedDescending);
+        }
+        return [summary1.name compare:summary2.name];
+    }];
+    _siteSummaries = [summaries copy];
+}
+
+
+@end
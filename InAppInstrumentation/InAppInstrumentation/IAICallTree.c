@@ -0,0 +1,121 @@
+//
+//  IAICallTree.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#include "IAICallTree.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAICallTreeInit(IAICallTree* tree, uint32_t capacity) {
+    memset(tree, 0, sizeof(*tree));
+    if (capacity < 1) {
+        return 0;
+    }
+    tree->nodes = calloc(capacity, sizeof(IAICallTreeNode));
+    if (NULL == tree->nodes) {
+        return 0;
+    }
+    tree->capacity = capacity;
+    tree->count = 1;
+    return 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAICallTreeDestroy(IAICallTree* tree) {
+    free(tree->nodes);
+    memset(tree, 0, sizeof(*tree));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAICallTreeReset(IAICallTree* tree) {
+    memset(&tree->nodes[0], 0, sizeof(IAICallTreeNode));
+    tree->count = 1;
+    tree->numberOfSamples = 0;
+    tree->numberOfTruncatedSamples = 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The child of a node with the given address, moved to the front of its siblings. 0 if the node
+// has no such child.
+static uint32_t IAICallTreeFindChild(IAICallTree* tree, uint32_t parent, uintptr_t address) {
+    IAICallTreeNode* nodes = tree->nodes;
+    uint32_t previous = 0;
+    for (uint32_t child = nodes[parent].firstChild; 0 != child;
+         child = nodes[child].nextSibling) {
+        if (nodes[child].address == address) {
+            if (0 != previous) {
+                nodes[previous].nextSibling = nodes[child].nextSibling;
+                nodes[child].nextSibling = nodes[parent].firstChild;
+                nodes[parent].firstChild = child;
+            }
+            return child;
+        }
+        previous = child;
+    }
+    return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAICallTreeAddStack(IAICallTree* tree, const uintptr_t* frames, unsigned depth) {
+    IAICallTreeNode* nodes = tree->nodes;
+    if (depth > IAICallTreeMaxDepth) {
+        depth = IAICallTreeMaxDepth;
+    }
+
+    uint32_t node = 0;
+    ++nodes[0].totalCount;
+    for (unsigned ix = depth; ix > 0; --ix) {
+        uintptr_t address = frames[ix - 1];
+        uint32_t child = IAICallTreeFindChild(tree, node, address);
+        if (0 == child) {
+            if (tree->count == tree->capacity) {
+                ++tree->numberOfTruncatedSamples;
+                break;
+            }
+            child = tree->count++;
+            nodes[child].address = address;
+            nodes[child].parent = node;
+            nodes[child].firstChild = 0;
+            nodes[child].nextSibling = nodes[node].firstChild;
+            nodes[child].selfCount = 0;
+            nodes[child].totalCount = 0;
+            nodes[node].firstChild = child;
+        }
+        node = child;
+        ++nodes[node].totalCount;
+    }
+    ++nodes[node].selfCount;
+    ++tree->numberOfSamples;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAICallTreeEnumerateStacks(const IAICallTree* tree, IAICallTreeStackFunction function,
+                                void* context) {
+    uintptr_t frames[IAICallTreeMaxDepth];
+    const IAICallTreeNode* nodes = tree->nodes;
+    for (uint32_t ix = 1; ix < tree->count; ++ix) {
+        if (0 == nodes[ix].selfCount) {
+            continue;
+        }
+        // Walk up to the root, filling the frames from the end so that they end up root first.
+        unsigned depth = 0;
+        for (uint32_t node = ix; 0 != node && depth < IAICallTreeMaxDepth;
+             node = nodes[node].parent) {
+            frames[IAICallTreeMaxDepth - 1 - depth] = nodes[node].address;
+            ++depth;
+        }
+        function(&frames[IAICallTreeMaxDepth - depth], depth, nodes[ix].selfCount, context);
+    }
+}
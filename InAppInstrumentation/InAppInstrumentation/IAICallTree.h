@@ -0,0 +1,83 @@
+//
+//  IAICallTree.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#ifndef InAppInstrumentation_IAICallTree_h
+#define InAppInstrumentation_IAICallTree_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * An aggregated call tree of sampled stacks in a fixed arena of nodes.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * The tree is a trie of return addresses from the root of the stack to the leaf. Every
+ * sampled stack adds one to the total count of each node on its path and one to the self count
+ * of its leaf, so a stack that is sampled again allocates nothing. Children are kept in a list
+ * that moves the most recently used child to the front, which keeps the hot paths quick to
+ * follow.
+ *
+ * Addresses are stored raw and symbolized only when the tree is read.
+ *
+ * The arena never grows. When it is full, a stack that needs a new node is counted against the
+ * deepest node that already exists on its path and the sample is marked as truncated.
+ *
+ * A tree is not thread safe.
+ */
+
+#define IAICallTreeMaxDepth 256
+
+typedef struct {
+    uintptr_t address;
+    uint32_t parent;
+    uint32_t firstChild;    // 0 if the node has no children.
+    uint32_t nextSibling;   // 0 if the node is the last child of its parent.
+    uint32_t selfCount;
+    uint32_t totalCount;
+} IAICallTreeNode;
+
+typedef struct {
+    IAICallTreeNode* nodes;     // nodes[0] is the root, which has no address.
+    uint32_t capacity;
+    uint32_t count;
+    uint64_t numberOfSamples;
+    uint64_t numberOfTruncatedSamples;
+} IAICallTree;
+
+/**
+ * Allocates the arena. Returns 0 if it could not be allocated.
+ */
+int IAICallTreeInit(IAICallTree* tree, uint32_t capacity);
+
+void IAICallTreeDestroy(IAICallTree* tree);
+
+/**
+ * Removes every sample without freeing the arena.
+ */
+void IAICallTreeReset(IAICallTree* tree);
+
+/**
+ * Adds a sampled stack.
+ *
+ *      @param frames  The return addresses of the stack, leaf first. At most IAICallTreeMaxDepth
+ *                     frames nearest the root are used.
+ */
+void IAICallTreeAddStack(IAICallTree* tree, const uintptr_t* frames, unsigned depth);
+
+typedef void (*IAICallTreeStackFunction)(const uintptr_t* frames, unsigned depth,
+                                         uint32_t count, void* context);
+
+/**
+ * Calls the function once for every distinct stack that was sampled at least once, with its
+ * frames root first and the number of times it was sampled.
+ */
+void IAICallTreeEnumerateStacks(const IAICallTree* tree, IAICallTreeStackFunction function,
+                                void* context);
+
+#endif
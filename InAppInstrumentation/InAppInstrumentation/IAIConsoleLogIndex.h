@@ -0,0 +1,135 @@
+//
+//  IAIConsoleLogIndex.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "IAIDataStructures.h"
+#import "IAILogger.h"
+
+/**
+ * A search of the console logs.
+ *
+ *      @ingroup Overview-Logger
+ */
+@interface IAIConsoleLogQuery : NSObject <NSCopying> {
+@private
+    NSString* _substring;
+    IAIConsoleLogLevel _minimumLevel;
+    NSString* _tag;
+}
+
+/**
+ * Parses a filter typed by the user.
+ *
+ * The terms "level:<level>" and "tag:<tag>" set the minimumLevel and tag. Everything else is
+ * the substring. For example, "level:warn tag:network timed out" finds the warnings and errors
+ * tagged [Network] that contain "timed out".
+ */
++ (id)queryWithFilterString:(NSString *)filterString;
+
+/**
+ * Text that must appear in the log, ignoring case. nil matches every entry.
+ */
+@property (nonatomic, readwrite, copy) NSString* substring;
+
+/**
+ * The lowest level of entry that matches. By default this is IAIConsoleLogLevelDebug.
+ */
+@property (nonatomic, readwrite, assign) IAIConsoleLogLevel minimumLevel;
+
+/**
+ * The tag that the entry must have, ignoring case. nil matches every entry.
+ */
+@property (nonatomic, readwrite, copy) NSString* tag;
+
+/**
+ * Whether the query has no conditions.
+ */
+- (BOOL)isEmpty;
+
+/**
+ * Checks a single entry against the query without using an index.
+ */
+- (BOOL)matchesEntry:(IAIConsoleLogEntry *)entry;
+
+@end
+
+
+/**
+ * An incremental inverted index of console log entries.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * Each entry is given a line id when it is added. Line ids increase by one with each entry
+ * and are never reused.
+ *
+ * The log text is lowercased and split into alphanumeric tokens, and the index keeps a sorted
+ * list of line ids for every token, tag and level. A substring query uses the token lists to
+ * find the few candidate lines that could contain the substring and then confirms each one:
+ *
+ * - A token in the middle of the substring must be a whole token of the line, so it is looked
+ *   up directly.
+ * - Otherwise the longest token of the substring must appear inside a token of the line, so
+ *   the matching tokens are found by scanning the vocabulary rather than every line.
+ *
+ * Entries are removed from the front of the index in the order they were added, which only
+ * ever trims the front of the lists they appear in.
+ *
+ * An index is not thread safe. IAILogger only uses its index on a private serial queue.
+ */
+@interface IAIConsoleLogIndex : NSObject {
+@private
+    IAIHistoryList* _lines;
+    NSMutableDictionary* _postingsByToken;
+    NSMutableDictionary* _postingsByTag;
+    NSArray* _postingsByLevel;
+}
+
+#pragma mark Modifying the Index /** @name Modifying the Index */
+
+/**
+ * Indexes an entry.
+ *
+ *      @returns The line id of the entry.
+ */
+- (NSUInteger)addEntry:(IAIConsoleLogEntry *)entry;
+
+/**
+ * Removes the oldest entries from the index until the first entry is at or after the given
+ * date.
+ */
+- (void)removeEntriesBeforeDate:(NSDate *)date;
+
+/**
+ * Removes the oldest entries from the index until it holds at most the given number.
+ */
+- (void)removeEntriesBeyondCount:(NSUInteger)count;
+
+#pragma mark Searching the Index /** @name Searching the Index */
+
+/**
+ * The line ids of every entry in the index that matches the query, in increasing order.
+ */
+- (NSIndexSet *)lineIdsMatchingQuery:(IAIConsoleLogQuery *)query;
+
+/**
+ * The entry with the given line id, or nil if it has been removed from the index.
+ */
+- (IAIConsoleLogEntry *)entryWithLineId:(NSUInteger)lineId;
+
+/**
+ * The number of entries in the index.
+ */
+@property (nonatomic, readonly, assign) NSUInteger count;
+
+/**
+ * The number of distinct tokens in the index.
+ */
+@property (nonatomic, readonly, assign) NSUInteger numberOfTokens;
+
+@end
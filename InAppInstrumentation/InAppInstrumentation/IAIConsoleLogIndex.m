@@ -0,0 +1,455 @@
+//
+//  IAIConsoleLogIndex.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAIConsoleLogIndex.h"
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+static const NSUInteger kNumberOfConsoleLogLevels = IAIConsoleLogLevelError + 1;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Splits lowercased text into runs of ASCII letters and digits. Non-ASCII characters are kept
+// within tokens so that words in other scripts are still indexed.
+static NSArray* IAITokensFromText(NSString* text) {
+    NSUInteger length = [text length];
+    NSMutableArray* tokens = [[NSMutableArray alloc] init];
+    if (0 == length) {
+        return tokens;
+    }
+
+    unichar stackBuffer[256];
+    unichar* characters = (length <= 256) ? stackBuffer : malloc(length * sizeof(unichar));
+    [text getCharacters:characters range:NSMakeRange(0, length)];
+
+    NSUInteger tokenStart = NSNotFound;
+    for (NSUInteger ix = 0; ix <= length; ++ix) {
+        unichar c = (ix < length) ? characters[ix] : ' ';
+        BOOL isTokenCharacter = (c >= 128
+                                 || (c >= 'a' && c <= 'z')
+                                 || (c >= 'A' && c <= 'Z')
+                                 || (c >= '0' && c <= '9'));
+        if (isTokenCharacter && NSNotFound == tokenStart) {
+            tokenStart = ix;
+
+        } else if (!isTokenCharacter && NSNotFound != tokenStart) {
+            [tokens addObject:[NSString stringWithCharacters: characters + tokenStart
+                                                      length: ix - tokenStart]];
+            tokenStart = NSNotFound;
+        }
+    }
+
+    if (characters != stackBuffer) {
+        free(characters);
+    }
+    return tokens;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static NSInteger IAIConsoleLogLevelFromString(NSString* string) {
+    NSString* lowercaseString = [string lowercaseString];
+    if ([lowercaseString hasPrefix:@"err"]) {
+        return IAIConsoleLogLevelError;
+
+    } else if ([lowercaseString hasPrefix:@"warn"]) {
+        return IAIConsoleLogLevelWarning;
+
+    } else if ([lowercaseString hasPrefix:@"info"]) {
+        return IAIConsoleLogLevelInfo;
+
+    } else if ([lowercaseString hasPrefix:@"debug"]) {
+        return IAIConsoleLogLevelDebug;
+    }
+    return NSNotFound;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIConsoleLogQuery
+
+@synthesize substring = _substring;
+@synthesize minimumLevel = _minimumLevel;
+@synthesize tag = _tag;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (id)queryWithFilterString:(NSString *)filterString {
+    IAIConsoleLogQuery* query = [[[self class] alloc] init];
+    NSMutableArray* substringTerms = [[NSMutableArray alloc] init];
+
+    NSCharacterSet* whitespace = [NSCharacterSet whitespaceCharacterSet];
+    for (NSString* term in [filterString componentsSeparatedByCharactersInSet:whitespace]) {
+        NSString* lowercaseTerm = [term lowercaseString];
+        if ([lowercaseTerm hasPrefix:@"level:"]) {
+            NSInteger level = IAIConsoleLogLevelFromString([term substringFromIndex:6]);
+            if (NSNotFound != level) {
+                query.minimumLevel = (IAIConsoleLogLevel)level;
+                continue;
+            }
+
+        } else if ([lowercaseTerm hasPrefix:@"tag:"] && [term length] > 4) {
+            query.tag = [term substringFromIndex:4];
+            continue;
+        }
+        if ([term length] > 0) {
+            [substringTerms addObject:term];
+        }
+    }
+
+    if ([substringTerms count] > 0) {
+        query.substring = [substringTerms componentsJoinedByString:@" "];
+    }
+    return query;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)copyWithZone:(NSZone *)zone {
+    IAIConsoleLogQuery* query = [[[self class] allocWithZone:zone] init];
+    query.substring = _substring;
+    query.minimumLevel = _minimumLevel;
+    query.tag = _tag;
+    return query;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)isEmpty {
+    return ([_substring length] == 0
+            && IAIConsoleLogLevelDebug == _minimumLevel
+            && [_tag length] == 0);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)matchesEntry:(IAIConsoleLogEntry *)entry {
+    if (entry.level < _minimumLevel) {
+        return NO;
+    }
+    if ([_tag length] > 0
+        && (nil == entry.tag || [entry.tag caseInsensitiveCompare:_tag] != NSOrderedSame)) {
+        return NO;
+    }
+    if ([_substring length] > 0
+        && [entry.log rangeOfString: _substring
+                            options: NSCaseInsensitiveSearch].location == NSNotFound) {
+        return NO;
+    }
+    return YES;
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @internal
+ *
+ * An increasing list of line ids that is appended to at the back and trimmed from the front.
+ */
+@interface IAIPostingList : NSObject {
+@public
+    NSUInteger* _lineIds;
+    NSUInteger _head;
+    NSUInteger _tail;
+    NSUInteger _capacity;
+}
+
+- (void)addLineId:(NSUInteger)lineId;
+- (void)removeLineId:(NSUInteger)lineId;
+- (NSUInteger)count;
+- (void)addLineIdsToIndexSet:(NSMutableIndexSet *)indexSet;
+
+@end
+
+
+@implementation IAIPostingList
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)dealloc {
+    free(_lineIds);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)addLineId:(NSUInteger)lineId {
+    // A token that appears more than once in a line is only listed once.
+    if (_tail > _head && _lineIds[_tail - 1] == lineId) {
+        return;
+    }
+
+    if (_tail == _capacity) {
+        if (_head > 0) {
+            // Reclaim the space of the ids that have been trimmed from the front.
+            memmove(_lineIds, _lineIds + _head, (_tail - _head) * sizeof(NSUInteger));
+            _tail -= _head;
+            _head = 0;
+        }
+        if (_tail == _capacity) {
+            _capacity = MAX(_capacity * 2, 4);
+            _lineIds = realloc(_lineIds, _capacity * sizeof(NSUInteger));
+        }
+    }
+    _lineIds[_tail++] = lineId;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)removeLineId:(NSUInteger)lineId {
+    // Lines are removed oldest first, so a removed line is always at the front.
+    if (_head < _tail && _lineIds[_head] == lineId) {
+        ++_head;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSUInteger)count {
+    return _tail - _head;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)addLineIdsToIndexSet:(NSMutableIndexSet *)indexSet {
+    for (NSUInteger ix = _head; ix < _tail; ++ix) {
+        [indexSet addIndex:_lineIds[ix]];
+    }
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIConsoleLogIndex
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)init {
+    if ((self = [super init])) {
+        _lines = [[IAIHistoryList alloc] init];
+        _postingsByToken = [[NSMutableDictionary alloc] init];
+        _postingsByTag = [[NSMutableDictionary alloc] init];
+
+        NSMutableArray* postingsByLevel = [[NSMutableArray alloc] init];
+        for (NSUInteger ix = 0; ix < kNumberOfConsoleLogLevels; ++ix) {
+            [postingsByLevel addObject:[[IAIPostingList alloc] init]];
+        }
+        _postingsByLevel = [postingsByLevel copy];
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSUInteger)count {
+    return [_lines count];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSUInteger)numberOfTokens {
+    return [_postingsByToken count];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAIConsoleLogEntry *)entryWithLineId:(NSUInteger)lineId {
+    return [_lines objectAtSequence:lineId];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Modifying the Index
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)addLineId: (NSUInteger)lineId
+       toPostings: (NSMutableDictionary *)postings
+           forKey: (NSString *)key {
+    IAIPostingList* list = [postings objectForKey:key];
+    if (nil == list) {
+        list = [[IAIPostingList alloc] init];
+        [postings setObject:list forKey:key];
+    }
+    [list addLineId:lineId];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)removeLineId: (NSUInteger)lineId
+        fromPostings: (NSMutableDictionary *)postings
+              forKey: (NSString *)key {
+    IAIPostingList* list = [postings objectForKey:key];
+    [list removeLineId:lineId];
+    if (nil != list && [list count] == 0) {
+        // Drop the token so that the vocabulary shrinks along with the log.
+        [postings removeObjectForKey:key];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSUInteger)addEntry:(IAIConsoleLogEntry *)entry {
+    NSUInteger lineId = (NSUInteger)_lines.endSequence;
+    [_lines addObject:entry];
+
+    for (NSString* token in IAITokensFromText([entry.log lowercaseString])) {
+        [self addLineId:lineId toPostings:_postingsByToken forKey:token];
+    }
+    if (nil != entry.tag) {
+        [self addLineId:lineId toPostings:_postingsByTag forKey:[entry.tag lowercaseString]];
+    }
+    [[_postingsByLevel objectAtIndex:entry.level] addLineId:lineId];
+
+    return lineId;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)removeFirstEntry {
+    IAIConsoleLogEntry* entry = [_lines firstObject];
+    NSUInteger lineId = (NSUInteger)_lines.firstSequence;
+
+    for (NSString* token in IAITokensFromText([entry.log lowercaseString])) {
+        [self removeLineId:lineId fromPostings:_postingsByToken forKey:token];
+    }
+    if (nil != entry.tag) {
+        [self removeLineId: lineId
+              fromPostings: _postingsByTag
+                    forKey: [entry.tag lowercaseString]];
+    }
+    [[_postingsByLevel objectAtIndex:entry.level] removeLineId:lineId];
+
+    [_lines removeFirstObject];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)removeEntriesBeforeDate:(NSDate *)date {
+    IAIConsoleLogEntry* entry = [_lines firstObject];
+    while (nil != entry && [entry.timestamp compare:date] == NSOrderedAscending) {
+        [self removeFirstEntry];
+        entry = [_lines firstObject];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)removeEntriesBeyondCount:(NSUInteger)count {
+    while ([_lines count] > count) {
+        [self removeFirstEntry];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Searching the Index
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The lines that could contain the substring, or nil if every line could.
+- (NSIndexSet *)candidateLineIdsForSubstring:(NSString *)substring {
+    NSArray* tokens = IAITokensFromText([substring lowercaseString]);
+    if ([tokens count] == 0) {
+        return nil;
+    }
+
+    NSMutableIndexSet* candidates = [[NSMutableIndexSet alloc] init];
+
+    if ([tokens count] >= 3) {
+        // Interior tokens are bounded by separators on both sides, so they must be whole
+        // tokens of any matching line.
+        NSString* longestToken = nil;
+        for (NSUInteger ix = 1; ix < [tokens count] - 1; ++ix) {
+            NSString* token = [tokens objectAtIndex:ix];
+            if ([token length] > [longestToken length]) {
+                longestToken = token;
+            }
+        }
+        [[_postingsByToken objectForKey:longestToken] addLineIdsToIndexSet:candidates];
+        return candidates;
+    }
+
+    NSString* longestToken = nil;
+    for (NSString* token in tokens) {
+        if ([token length] > [longestToken length]) {
+            longestToken = token;
+        }
+    }
+
+    IAIPostingList* exactList = [_postingsByToken objectForKey:longestToken];
+    [exactList addLineIdsToIndexSet:candidates];
+
+    // The longest token may be cut off at either end of the substring, so it may be part of a
+    // longer token in the line.
+    [_postingsByToken enumerateKeysAndObjectsUsingBlock:
+     ^(NSString* token, IAIPostingList* list, BOOL* stop) {
+         if (list != exactList && [token rangeOfString:longestToken].location != NSNotFound) {
+             [list addLineIdsToIndexSet:candidates];
+         }
+     }];
+    return candidates;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The lines that could match the level and tag conditions, or nil if every line could.
+- (NSIndexSet *)candidateLineIdsForLevel:(IAIConsoleLogLevel)level tag:(NSString *)tag {
+    NSMutableIndexSet* candidates = [[NSMutableIndexSet alloc] init];
+    if ([tag length] > 0) {
+        [[_postingsByTag objectForKey:[tag lowercaseString]] addLineIdsToIndexSet:candidates];
+        return candidates;
+    }
+    if (IAIConsoleLogLevelDebug == level) {
+        return nil;
+    }
+    for (NSUInteger ix = level; ix < kNumberOfConsoleLogLevels; ++ix) {
+        [[_postingsByLevel objectAtIndex:ix] addLineIdsToIndexSet:candidates];
+    }
+    return candidates;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSIndexSet *)lineIdsMatchingQuery:(IAIConsoleLogQuery *)query {
+    NSIndexSet* candidates = nil;
+    if ([query.substring length] > 0) {
+        candidates = [self candidateLineIdsForSubstring:query.substring];
+    }
+    if (nil == candidates) {
+        candidates = [self candidateLineIdsForLevel:query.minimumLevel tag:query.tag];
+    }
+    if (nil == candidates) {
+        NSUInteger firstLineId = (NSUInteger)_lines.firstSequence;
+        candidates = [NSIndexSet indexSetWithIndexesInRange:
+                      NSMakeRange(firstLineId, (NSUInteger)_lines.endSequence - firstLineId)];
+    }
+
+    // Confirm each candidate against the full query.
+    return [candidates indexesPassingTest:^BOOL(NSUInteger lineId, BOOL* stop) {
+        IAIConsoleLogEntry* entry = [_lines objectAtSequence:lineId];
+        return nil != entry && [query matchesEntry:entry];
+    }];
+}
+
+
+@end
@@ -0,0 +1,137 @@
+//
+//  IAIConsoleLogThrottle.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import <pthread.h>
+
+@class IAIConsoleLogEntry;
+
+typedef enum {
+    // The log is new and should be written.
+    IAIConsoleLogCaptureWrite,
+
+    // The log repeats the last log written by this thread and has been counted on its entry.
+    IAIConsoleLogCaptureRepeat,
+
+    // The log's call site is over its rate limit and should be dropped.
+    IAIConsoleLogCaptureSuppress,
+} IAIConsoleLogCaptureAction;
+
+/**
+ * Decides which NSLog messages are worth the cost of capturing.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * A log storm, the same line written thousands of times a second, would otherwise cost a
+ * string, an entry, an index update, a notification and a write to stderr for every line.
+ * The throttle looks only at the raw C string of each log, so a log that is dropped costs a
+ * hash and a table lookup.
+ *
+ * <h2>Repeated Logs</h2>
+ *
+ * A log that is identical to the last log written by the same thread is counted on the entry
+ * of that log (see IAIConsoleLogEntry::repeatCount) instead of being written. When the thread
+ * writes a different log, a "Last message repeated N times" summary is written first, or by
+ * takeStaleSummaries once the thread has stopped repeating it for a second.
+ *
+ * <h2>Rate Limits</h2>
+ *
+ * NSLog does not tell us where it was called from, so the call site of a log is approximated
+ * by its text with every run of digits ignored: "Request 12 failed" and "Request 13 failed"
+ * come from the same site. Each thread counts the logs of up to 64 sites per one second window.
+ * Once a site goes over its limit the rest of its logs in the window are dropped, and a
+ * "Suppressed N logs like ..." summary is written the next time the site logs after the window
+ * ends, or by takeStaleSummaries if the site doesn't log again.
+ *
+ * The sites are kept in sets of four by their hash. A site whose set is full takes the place
+ * of a site whose window has ended or that is under its limit, never of one that is being
+ * suppressed, and is written without being counted if all four are being suppressed.
+ *
+ * The default limit applies to every site. Logs that start with a given prefix, such as a tag,
+ * may be given their own limit.
+ *
+ * The throttle is thread safe. Each thread keeps its own state behind a lock of its own, which
+ * is only ever contended by takeStaleSummaries.
+ */
+@interface IAIConsoleLogThrottle : NSObject {
+@private
+    pthread_key_t _stateKey;
+
+    BOOL _collapsesRepeatedLogs;
+    NSUInteger _maximumLogsPerSecond;
+
+    // Guards _prefixLimits. Threads copy the limits when _limitsGeneration changes.
+    pthread_mutex_t _limitsMutex;
+    NSDictionary* _prefixLimits;
+    volatile int32_t _limitsGeneration;
+
+    // Guards _threadStates, the state of every thread that has logged.
+    pthread_mutex_t _threadStatesMutex;
+    NSMutableArray* _threadStates;
+}
+
+#pragma mark Configuring the Throttle /** @name Configuring the Throttle */
+
+/**
+ * Whether repeats of a log are counted on its entry instead of being written.
+ *
+ * By default this is YES.
+ */
+@property (nonatomic, readwrite, assign) BOOL collapsesRepeatedLogs;
+
+/**
+ * The number of logs that each call site may write per second. 0 means no limit.
+ *
+ * By default this is 0.
+ */
+@property (nonatomic, readwrite, assign) NSUInteger maximumLogsPerSecond;
+
+/**
+ * Sets the number of logs per second that each call site whose logs start with the given prefix
+ * may write, instead of maximumLogsPerSecond. 0 means no limit.
+ *
+ * If several prefixes match a log, the longest one is used.
+ */
+- (void)setMaximumLogsPerSecond: (NSUInteger)maximumLogsPerSecond
+              forLogsWithPrefix: (NSString *)prefix;
+
+/**
+ * Removes the limit for logs that start with the given prefix.
+ */
+- (void)removeMaximumLogsPerSecondForLogsWithPrefix:(NSString *)prefix;
+
+
+#pragma mark Capturing Logs /** @name Capturing Logs */
+
+/**
+ * Decides what to do with a log that the calling thread is about to write.
+ *
+ * If summaries of earlier repeats or suppressed logs are due, they are returned in summaries
+ * and should be written before the log. Otherwise summaries is set to nil.
+ */
+- (IAIConsoleLogCaptureAction)actionForLog: (const char *)message
+                                    length: (NSUInteger)length
+                                 summaries: (NSArray **)summaries;
+
+/**
+ * Tells the throttle the entry that was written for the last log it told the calling thread to
+ * write. Repeats of the log are counted on this entry.
+ */
+- (void)didWriteEntry:(IAIConsoleLogEntry *)entry;
+
+/**
+ * The summaries that are due for the threads that have gone quiet: repeats that ended over a
+ * second ago, and suppressed logs of windows that have ended. Each summary is returned once.
+ *
+ * A thread's summaries are otherwise only written when it logs again, which it may never do.
+ * Call this periodically, e.g. from the heartbeat, and write the summaries that it returns.
+ */
+- (NSArray *)takeStaleSummaries;
+
+@end
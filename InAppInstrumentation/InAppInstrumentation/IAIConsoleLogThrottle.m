@@ -0,0 +1,420 @@
+//
+//  IAIConsoleLogThrottle.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAIConsoleLogThrottle.h"
+
+#import "IAILogger.h"
+#import "IAIOverhead.h"
+
+#import <libkern/OSAtomic.h>
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+// Must be a power of two.
+static const NSUInteger kNumberOfCallSiteSets = 16;
+static const NSUInteger kCallSitesPerSet = 4;
+static const NSUInteger kNumberOfCallSites = kNumberOfCallSiteSets * kCallSitesPerSet;
+static const NSTimeInterval kRateLimitWindow = 1;
+static const NSUInteger kCallSitePreviewLength = 48;
+
+// The rate limit state of one call site. The site whose hash is 0 and whose window started at
+// 0 is unused.
+typedef struct {
+    uint64_t hash;
+    NSTimeInterval windowStart;
+    NSUInteger limit;
+    NSUInteger count;
+    NSUInteger suppressedCount;
+    char preview[kCallSitePreviewLength];
+} IAICallSite;
+
+// The state of a single thread. The thread holds the mutex while it captures a log, and the
+// throttle while it takes the thread's stale summaries.
+@interface IAIConsoleLogThreadState : NSObject {
+@public
+    pthread_mutex_t _mutex;
+    volatile int32_t _isFinished;
+
+    // The last log that was written, for finding repeats.
+    uint64_t _lastHash;
+    NSUInteger _lastLength;
+    char* _lastMessage;
+    NSUInteger _lastMessageCapacity;
+    IAIConsoleLogEntry* _lastEntry;
+
+    IAICallSite _callSites[kNumberOfCallSites];
+
+    // This thread's copy of the prefix limits.
+    int32_t _limitsGeneration;
+    NSArray* _prefixes;
+    NSArray* _prefixLimits;
+}
+@end
+
+@implementation IAIConsoleLogThreadState
+
+- (void)dealloc {
+    free(_lastMessage);
+    pthread_mutex_destroy(&_mutex);
+}
+
+- (id)init {
+    if ((self = [super init])) {
+        pthread_mutex_init(&_mutex, NULL);
+    }
+    return self;
+}
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The throttle keeps the state until its summaries have been taken.
+static void IAIConsoleLogThreadDidExit(void* value) {
+    IAIConsoleLogThreadState* state = CFBridgingRelease(value);
+    OSAtomicIncrement32Barrier(&state->_isFinished);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// FNV-1a over the whole message, and over the message with each run of digits read as a single
+// '#' for the call site.
+static void IAIHashLog(const char* message, NSUInteger length,
+                       uint64_t* messageHash, uint64_t* callSiteHash) {
+    static const uint64_t kOffsetBasis = 14695981039346656037ULL;
+    static const uint64_t kPrime = 1099511628211ULL;
+
+    uint64_t hash = kOffsetBasis;
+    uint64_t siteHash = kOffsetBasis;
+    BOOL isInNumber = NO;
+    for (NSUInteger ix = 0; ix < length; ++ix) {
+        unsigned char c = (unsigned char)message[ix];
+        hash = (hash ^ c) * kPrime;
+
+        BOOL isDigit = (c >= '0' && c <= '9');
+        if (!isDigit || !isInNumber) {
+            siteHash = (siteHash ^ (isDigit ? '#' : c)) * kPrime;
+        }
+        isInNumber = isDigit;
+    }
+    *messageHash = hash;
+    *callSiteHash = siteHash;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The site of the hash, or the site that it should take the place of. Sites are kept in sets of
+// kCallSitesPerSet by their hash. A site that isn't in its set replaces one whose window has
+// ended, or else the one with the fewest logs that isn't being suppressed, so that a site that
+// is being suppressed keeps its window until it ends. Returns NULL if every site in the set is
+// being suppressed.
+static IAICallSite* IAICallSiteForHash(IAICallSite* sites, uint64_t siteHash, NSTimeInterval now) {
+    IAICallSite* set = &sites[(siteHash & (kNumberOfCallSiteSets - 1)) * kCallSitesPerSet];
+    IAICallSite* replacedSite = NULL;
+    for (NSUInteger ix = 0; ix < kCallSitesPerSet; ++ix) {
+        IAICallSite* site = &set[ix];
+        if (site->hash == siteHash) {
+            return site;
+        }
+        if (now - site->windowStart >= kRateLimitWindow) {
+            if (NULL == replacedSite || now - replacedSite->windowStart < kRateLimitWindow) {
+                replacedSite = site;
+            }
+        } else if (0 == site->suppressedCount
+                   && (NULL == replacedSite
+                       || (now - replacedSite->windowStart < kRateLimitWindow
+                           && site->count < replacedSite->count))) {
+            replacedSite = site;
+        }
+    }
+    return replacedSite;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIConsoleLogThrottle
+
+@synthesize collapsesRepeatedLogs = _collapsesRepeatedLogs;
+@synthesize maximumLogsPerSecond = _maximumLogsPerSecond;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)dealloc {
+    pthread_key_delete(_stateKey);
+    pthread_mutex_destroy(&_limitsMutex);
+    pthread_mutex_destroy(&_threadStatesMutex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)init {
+    if ((self = [super init])) {
+        pthread_key_create(&_stateKey, IAIConsoleLogThreadDidExit);
+        pthread_mutex_init(&_limitsMutex, NULL);
+        pthread_mutex_init(&_threadStatesMutex, NULL);
+        _prefixLimits = [[NSDictionary alloc] init];
+        _threadStates = [[NSMutableArray alloc] init];
+        _collapsesRepeatedLogs = YES;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Configuring the Throttle
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)setLimit:(NSNumber *)limit forPrefix:(NSString *)prefix {
+    pthread_mutex_lock(&_limitsMutex);
+    NSMutableDictionary* prefixLimits = [_prefixLimits mutableCopy];
+    if (nil != limit) {
+        [prefixLimits setObject:limit forKey:prefix];
+
+    } else {
+        [prefixLimits removeObjectForKey:prefix];
+    }
+    _prefixLimits = [prefixLimits copy];
+    OSAtomicIncrement32Barrier(&_limitsGeneration);
+    pthread_mutex_unlock(&_limitsMutex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)setMaximumLogsPerSecond: (NSUInteger)maximumLogsPerSecond
+              forLogsWithPrefix: (NSString *)prefix {
+    [self setLimit:[NSNumber numberWithUnsignedInteger:maximumLogsPerSecond] forPrefix:prefix];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)removeMaximumLogsPerSecondForLogsWithPrefix:(NSString *)prefix {
+    [self setLimit:nil forPrefix:prefix];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Capturing Logs
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAIConsoleLogThreadState *)stateOfCurrentThread {
+    void* value = pthread_getspecific(_stateKey);
+    if (NULL == value) {
+        IAIConsoleLogThreadState* state = [[IAIConsoleLogThreadState alloc] init];
+        pthread_mutex_lock(&_threadStatesMutex);
+        [_threadStates addObject:state];
+        pthread_mutex_unlock(&_threadStatesMutex);
+
+        value = (__bridge_retained void *)state;
+        pthread_setspecific(_stateKey, value);
+    }
+    return (__bridge IAIConsoleLogThreadState *)value;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSUInteger)limitForLog: (const char *)message
+                   length: (NSUInteger)length
+                    state: (IAIConsoleLogThreadState *)state {
+    if (state->_limitsGeneration != _limitsGeneration) {
+        pthread_mutex_lock(&_limitsMutex);
+        NSMutableArray* prefixes = [NSMutableArray arrayWithCapacity:[_prefixLimits count]];
+        NSMutableArray* limits = [NSMutableArray arrayWithCapacity:[_prefixLimits count]];
+        for (NSString* prefix in _prefixLimits) {
+            [prefixes addObject:[prefix dataUsingEncoding:NSUTF8StringEncoding]];
+            [limits addObject:[_prefixLimits objectForKey:prefix]];
+        }
+        state->_prefixes = prefixes;
+        state->_prefixLimits = limits;
+        state->_limitsGeneration = _limitsGeneration;
+        pthread_mutex_unlock(&_limitsMutex);
+    }
+
+    NSUInteger limit = _maximumLogsPerSecond;
+    NSUInteger longestPrefixLength = 0;
+    for (NSUInteger ix = 0; ix < [state->_prefixes count]; ++ix) {
+        NSData* prefix = [state->_prefixes objectAtIndex:ix];
+        NSUInteger prefixLength = [prefix length];
+        if (prefixLength <= length && prefixLength >= longestPrefixLength
+            && 0 == memcmp([prefix bytes], message, prefixLength)) {
+            limit = [[state->_prefixLimits objectAtIndex:ix] unsignedIntegerValue];
+            longestPrefixLength = prefixLength;
+        }
+    }
+    return limit;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSString *)summaryOfCallSite:(IAICallSite *)site {
+    return [NSString stringWithFormat:@"Suppressed %lu logs like \"%s\"",
+            (unsigned long)site->suppressedCount, site->preview];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSString *)summaryOfRepeatsOfEntry:(IAIConsoleLogEntry *)entry {
+    return [NSString stringWithFormat:@"Last message repeated %lu times",
+            (unsigned long)(entry.repeatCount - 1)];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Must be called with the state's mutex held.
+- (IAIConsoleLogCaptureAction)actionForLog: (const char *)message
+                                    length: (NSUInteger)length
+                                     state: (IAIConsoleLogThreadState *)state
+                                 summaries: (NSArray **)summaries {
+    NSMutableArray* dueSummaries = nil;
+    *summaries = nil;
+
+    uint64_t hash = 0;
+    uint64_t siteHash = 0;
+    IAIHashLog(message, length, &hash, &siteHash);
+    NSTimeInterval now = CFAbsoluteTimeGetCurrent();
+
+    if (_collapsesRepeatedLogs && nil != state->_lastEntry) {
+        if (hash == state->_lastHash && length == state->_lastLength
+            && 0 == memcmp(message, state->_lastMessage, length)) {
+            [state->_lastEntry addRepeatAtTime:now];
+            return IAIConsoleLogCaptureRepeat;
+        }
+
+        // The run of repeats is over.
+        if (state->_lastEntry.repeatCount > 1) {
+            dueSummaries = [NSMutableArray array];
+            [dueSummaries addObject:[self summaryOfRepeatsOfEntry:state->_lastEntry]];
+        }
+        state->_lastEntry = nil;
+    }
+
+    IAICallSite* site = IAICallSiteForHash(state->_callSites, siteHash, now);
+    if (NULL != site && (site->hash != siteHash || now - site->windowStart >= kRateLimitWindow)) {
+        if (site->suppressedCount > 0) {
+            if (nil == dueSummaries) {
+                dueSummaries = [NSMutableArray array];
+            }
+            [dueSummaries addObject:[self summaryOfCallSite:site]];
+        }
+        site->hash = siteHash;
+        site->windowStart = now;
+        site->limit = [self limitForLog:message length:length state:state];
+        site->count = 0;
+        site->suppressedCount = 0;
+    }
+
+    *summaries = dueSummaries;
+
+    // A site that found no room in its set is written without being counted.
+    if (NULL != site) {
+        ++site->count;
+        if (site->limit > 0 && site->count > site->limit) {
+            if (0 == site->suppressedCount) {
+                NSUInteger previewLength = MIN(length, kCallSitePreviewLength - 1);
+                memcpy(site->preview, message, previewLength);
+                site->preview[previewLength] = '\0';
+            }
+            ++site->suppressedCount;
+            IAIOverheadCountDroppedRecords(1);
+            return IAIConsoleLogCaptureSuppress;
+        }
+    }
+
+    if (_collapsesRepeatedLogs) {
+        if (length > state->_lastMessageCapacity) {
+            state->_lastMessage = realloc(state->_lastMessage, length);
+            state->_lastMessageCapacity = length;
+        }
+        memcpy(state->_lastMessage, message, length);
+        state->_lastHash = hash;
+        state->_lastLength = length;
+    }
+    return IAIConsoleLogCaptureWrite;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAIConsoleLogCaptureAction)actionForLog: (const char *)message
+                                    length: (NSUInteger)length
+                                 summaries: (NSArray **)summaries {
+    IAIConsoleLogThreadState* state = [self stateOfCurrentThread];
+    pthread_mutex_lock(&state->_mutex);
+    IAIConsoleLogCaptureAction action = [self actionForLog: message
+                                                    length: length
+                                                     state: state
+                                                 summaries: summaries];
+    pthread_mutex_unlock(&state->_mutex);
+    return action;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)didWriteEntry:(IAIConsoleLogEntry *)entry {
+    if (_collapsesRepeatedLogs) {
+        IAIConsoleLogThreadState* state = [self stateOfCurrentThread];
+        pthread_mutex_lock(&state->_mutex);
+        state->_lastEntry = entry;
+        pthread_mutex_unlock(&state->_mutex);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSArray *)takeStaleSummaries {
+    NSMutableArray* summaries = [NSMutableArray array];
+    NSTimeInterval now = CFAbsoluteTimeGetCurrent();
+
+    pthread_mutex_lock(&_threadStatesMutex);
+    NSArray* states = [_threadStates copy];
+    pthread_mutex_unlock(&_threadStatesMutex);
+
+    for (IAIConsoleLogThreadState* state in states) {
+        // A thread that exited has nothing more to say, so everything it left is stale.
+        BOOL isFinished = (0 != state->_isFinished);
+        pthread_mutex_lock(&state->_mutex);
+
+        IAIConsoleLogEntry* lastEntry = state->_lastEntry;
+        if (nil != lastEntry && lastEntry.repeatCount > 1
+            && (isFinished || now - [lastEntry.lastTimestamp timeIntervalSinceReferenceDate]
+                >= kRateLimitWindow)) {
+            [summaries addObject:[self summaryOfRepeatsOfEntry:lastEntry]];
+            // The next log starts a new run, even if it is the same message.
+            state->_lastEntry = nil;
+        }
+
+        for (NSUInteger ix = 0; ix < kNumberOfCallSites; ++ix) {
+            IAICallSite* site = &state->_callSites[ix];
+            if (site->suppressedCount > 0
+                && (isFinished || now - site->windowStart >= kRateLimitWindow)) {
+                [summaries addObject:[self summaryOfCallSite:site]];
+                site->suppressedCount = 0;
+            }
+        }
+
+        pthread_mutex_unlock(&state->_mutex);
+
+        if (isFinished) {
+            pthread_mutex_lock(&_threadStatesMutex);
+            [_threadStates removeObjectIdenticalTo:state];
+            pthread_mutex_unlock(&_threadStatesMutex);
+        }
+    }
+    return summaries;
+}
+
+
+@end
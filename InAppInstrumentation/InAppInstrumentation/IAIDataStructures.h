@@ -16,6 +16,8 @@
 
 #import <Foundation/Foundation.h>
 
+#import "IAISeqLock.h"
+
 /**
  * For classic computer science data structures.
  *
@@ -68,6 +70,22 @@
 
 @class IAILinkedListNode;
 
+/**
+ * The read-only interface shared by the collections that hold log history.
+ *
+ * Objects are always in increasing chronological order.
+ */
+@protocol IAILogCollection <NSObject>
+
+- (NSUInteger)count;
+
+- (id)firstObject;
+- (id)lastObject;
+
+- (NSEnumerator *)objectEnumerator;
+
+@end
+
 @interface IAILinkedListLocation : NSObject
 @end
 
@@ -106,7 +124,7 @@
  * structure we could easily run into an O(N^2) exponential-time operation which is
  * absolutely unacceptable.
  */
-@interface IAILinkedList : NSObject <NSCopying, NSCoding, NSFastEnumeration>
+@interface IAILinkedList : NSObject <NSCopying, NSCoding, NSFastEnumeration, IAILogCollection>
 
 - (NSUInteger)count;
 
@@ -149,6 +167,160 @@
 @end
 
 
+@class IAIHistoryRange;
+
+/**
+ * An append-only list that is trimmed from the front and supports random access.
+ *
+ * Objects are stored in fixed-size chunks. Appending and removing the first object are
+ * constant time, and every object is addressable by a sequence number that is assigned when
+ * it is appended and never changes, even as older objects are removed.
+ *
+ * <h2>Snapshots</h2>
+ *
+ * One thread may modify the list while any number of other threads read it. Readers call
+ * snapshot to get an immutable IAIHistoryRange of the objects in the list at that moment.
+ * Taking a snapshot copies no objects, never blocks the writer, and the snapshot stays valid
+ * however the list changes afterward.
+ *
+ * The writer publishes its changes through an IAISeqLock. A chunk is written once and never
+ * modified, so a snapshot only needs to hold on to the chunks it spans.
+ *
+ * Memory is released a chunk at a time, so up to one chunk of removed objects may remain
+ * alive until the rest of their chunk has been removed or the last snapshot of it is released.
+ */
+@interface IAIHistoryList : NSObject <NSFastEnumeration, IAILogCollection> {
+@private
+    IAISeqLock _lock;
+    NSArray* _chunks;
+    unsigned long long _chunkBaseSequence;
+    unsigned long long _firstSequence;
+    unsigned long long _endSequence;
+    unsigned long _modificationNumber;
+
+    // Chunk arrays that have been replaced but may still be being read by a snapshot.
+    NSMutableArray* _retiredChunks;
+}
+
+#pragma mark Reading the List
+
+/**
+ * An immutable view of the objects that are in the list. Safe to call from any thread.
+ *
+ *      Run-time: O(1)
+ */
+- (IAIHistoryRange *)snapshot;
+
+/**
+ * The following methods are safe to call from any thread.
+ */
+- (NSUInteger)count;
+
+- (id)firstObject;
+- (id)lastObject;
+
+- (id)objectAtIndex:(NSUInteger)index;
+
+/**
+ * Enumerates a snapshot of the list.
+ */
+- (NSEnumerator *)objectEnumerator;
+
+/**
+ * The sequence number of the first object, or endSequence if the list is empty.
+ */
+@property (nonatomic, readonly, assign) unsigned long long firstSequence;
+
+/**
+ * The sequence number that will be assigned to the next object that is appended.
+ */
+@property (nonatomic, readonly, assign) unsigned long long endSequence;
+
+/**
+ * The object with the given sequence number, or nil if it has been removed or not yet added.
+ */
+- (id)objectAtSequence:(unsigned long long)sequence;
+
+#pragma mark Mutable Operations
+
+/**
+ * The following methods, and fast enumeration of the list itself, must only be used from the
+ * thread that modifies the list.
+ */
+- (void)addObject:(id)object;
+
+- (void)removeAllObjects;
+- (void)removeFirstObject;
+
+/**
+ * Removes the objects with sequence numbers before the given one in a single change.
+ */
+- (void)removeObjectsBeforeSequence:(unsigned long long)sequence;
+
+@end
+
+
+/**
+ * An immutable, contiguous run of objects from an IAIHistoryList or an array.
+ *
+ * Creating a range does not copy the objects, and a range is not affected by later changes to
+ * the list it was taken from.
+ */
+@interface IAIHistoryRange : NSObject <NSFastEnumeration, IAILogCollection> {
+@private
+    NSArray* _chunks;
+    unsigned long long _chunkBaseSequence;
+    unsigned long long _firstSequence;
+    unsigned long long _endSequence;
+    NSArray* _array;
+}
+
+/**
+ * A range that holds the given objects.
+ */
+- (id)initWithArray:(NSArray *)array;
+
+- (NSUInteger)count;
+
+- (id)firstObject;
+- (id)lastObject;
+
+- (id)objectAtIndex:(NSUInteger)index;
+
+- (NSEnumerator *)objectEnumerator;
+
+- (NSArray *)allObjects;
+
+/**
+ * The sequence numbers of the objects in the list the range was taken from. A range created
+ * from an array numbers its objects from zero.
+ */
+@property (nonatomic, readonly, assign) unsigned long long firstSequence;
+@property (nonatomic, readonly, assign) unsigned long long endSequence;
+
+/**
+ * Binary searches for the first object that does not pass the test.
+ *
+ * The range must be partitioned by the predicate: every object that passes the test must come
+ * before every object that does not. For example, log entries in chronological order are
+ * partitioned by whether they are older than a given date.
+ *
+ *      Run-time: O(log(count))
+ *
+ *      @returns The index of the first object that does not pass the test, or count if every
+ *               object passes.
+ */
+- (NSUInteger)indexOfFirstObjectNotPassingTest:(BOOL (^)(id object))predicate;
+
+/**
+ * A range of a subset of this range's objects.
+ *
+ *      Run-time: O(1)
+ */
+- (IAIHistoryRange *)subrangeWithRange:(NSRange)range;
+
+@end
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 /**@}*/// End of Data Structures //////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
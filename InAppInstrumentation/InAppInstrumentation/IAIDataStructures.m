@@ -499,3 +499,521 @@
 
 @end
 
+
+
+#pragma mark -
+
+
+// The number of objects held by each chunk of an IAIHistoryList.
+static const NSUInteger kHistoryChunkSize = 64;
+
+// Immutable ranges report no mutations to fast enumeration.
+static unsigned long sHistoryRangeMutations = 0;
+
+// A fixed-size block of strong references. Slots are written once and never modified.
+@interface IAIHistoryChunk : NSObject {
+@public
+    __strong id* _objects;
+}
+@end
+
+@implementation IAIHistoryChunk
+
+- (id)init {
+    if ((self = [super init])) {
+        _objects = (__strong id *)calloc(kHistoryChunkSize, sizeof(id));
+    }
+    return self;
+}
+
+- (void)dealloc {
+    for (NSUInteger ix = 0; ix < kHistoryChunkSize; ++ix) {
+        _objects[ix] = nil;
+    }
+    free(_objects);
+}
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Returns the slot that holds the given sequence number. The sequence must be in the chunks.
+static __strong id* IAIHistorySlot(NSArray* chunks,
+                                   unsigned long long chunkBaseSequence,
+                                   unsigned long long sequence) {
+    unsigned long long offset = sequence - chunkBaseSequence;
+    IAIHistoryChunk* chunk = [chunks objectAtIndex:(NSUInteger)(offset / kHistoryChunkSize)];
+    return &chunk->_objects[offset % kHistoryChunkSize];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Points itemsPtr directly at the chunk slots rather than copying the objects.
+static NSUInteger IAIHistoryEnumerate(NSFastEnumerationState* state,
+                                      NSArray* chunks,
+                                      unsigned long long chunkBaseSequence,
+                                      unsigned long long firstSequence,
+                                      unsigned long long endSequence,
+                                      unsigned long* mutationsPtr) {
+    if (0 == state->state) {
+        state->mutationsPtr = mutationsPtr;
+        state->extra[0] = (unsigned long)(firstSequence - chunkBaseSequence);
+        state->state = 1;
+    }
+    unsigned long long sequence = chunkBaseSequence + state->extra[0];
+    if (sequence >= endSequence) {
+        return 0;
+    }
+    NSUInteger slot = (NSUInteger)((sequence - chunkBaseSequence) % kHistoryChunkSize);
+    NSUInteger count = (NSUInteger)MIN((unsigned long long)(kHistoryChunkSize - slot),
+                                       endSequence - sequence);
+    state->itemsPtr =
+    (__unsafe_unretained id *)(void *)IAIHistorySlot(chunks, chunkBaseSequence, sequence);
+    state->extra[0] += count;
+    return count;
+}
+
+
+// The published state of an IAIHistoryList, copied under its sequence lock.
+typedef struct {
+    __unsafe_unretained NSArray* chunks;
+    unsigned long long chunkBaseSequence;
+    unsigned long long firstSequence;
+    unsigned long long endSequence;
+} IAIHistoryListState;
+
+@interface IAIHistoryRange()
+- (id)initWithChunks: (NSArray *)chunks
+   chunkBaseSequence: (unsigned long long)chunkBaseSequence
+       firstSequence: (unsigned long long)firstSequence
+         endSequence: (unsigned long long)endSequence;
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @internal
+ *
+ * Enumerates an IAIHistoryRange.
+ */
+@interface IAIHistoryRangeEnumerator : NSEnumerator {
+@private
+    IAIHistoryRange* _range;
+    NSUInteger _index;
+}
+
+- (id)initWithRange:(IAIHistoryRange *)range;
+
+@end
+
+
+@implementation IAIHistoryRangeEnumerator
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithRange:(IAIHistoryRange *)range {
+    if ((self = [super init])) {
+        _range = range;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)nextObject {
+    id object = [_range objectAtIndex:_index];
+    if (nil == object) {
+        _range = nil;
+
+    } else {
+        ++_index;
+    }
+    return object;
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIHistoryList
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)init {
+    if ((self = [super init])) {
+        _chunks = [[NSArray alloc] init];
+        _retiredChunks = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Private Methods
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Copies a consistent view of the published state. Anything retained from the state must be
+// retained before exitReader is called.
+- (IAIHistoryListState)enterReader {
+    IAISeqLockEnterReader(&_lock);
+    IAIHistoryListState state;
+    int32_t sequence;
+    do {
+        sequence = IAISeqLockReadBegin(&_lock);
+        state.chunks = _chunks;
+        state.chunkBaseSequence = _chunkBaseSequence;
+        state.firstSequence = _firstSequence;
+        state.endSequence = _endSequence;
+    } while (IAISeqLockReadRetry(&_lock, sequence));
+    return state;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)exitReader {
+    IAISeqLockExitReader(&_lock);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Must be called between IAISeqLockBeginWrite and IAISeqLockEndWrite.
+- (void)replaceChunks:(NSArray *)chunks {
+    // A reader may have copied the old pointer without retaining it yet.
+    [_retiredChunks addObject:_chunks];
+    _chunks = chunks;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)endWrite {
+    ++_modificationNumber;
+    IAISeqLockEndWrite(&_lock);
+
+    if ([_retiredChunks count] > 0 && !IAISeqLockHasReaders(&_lock)) {
+        [_retiredChunks removeAllObjects];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark NSFastEnumeration
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state
+                                  objects:(__unsafe_unretained id *)stackbuf
+                                    count:(NSUInteger)len {
+    // Only the writing thread enumerates the list directly, so the ivars can be read as is.
+    return IAIHistoryEnumerate(state, _chunks, _chunkBaseSequence,
+                               _firstSequence, _endSequence, &_modificationNumber);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Public Methods
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAIHistoryRange *)snapshot {
+    IAIHistoryListState state = [self enterReader];
+    IAIHistoryRange* range = [[IAIHistoryRange alloc] initWithChunks: state.chunks
+                                                   chunkBaseSequence: state.chunkBaseSequence
+                                                       firstSequence: state.firstSequence
+                                                         endSequence: state.endSequence];
+    [self exitReader];
+    return range;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSUInteger)count {
+    IAIHistoryListState state = [self enterReader];
+    [self exitReader];
+    return (NSUInteger)(state.endSequence - state.firstSequence);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (unsigned long long)firstSequence {
+    IAIHistoryListState state = [self enterReader];
+    [self exitReader];
+    return state.firstSequence;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (unsigned long long)endSequence {
+    IAIHistoryListState state = [self enterReader];
+    [self exitReader];
+    return state.endSequence;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)objectAtSequence:(unsigned long long)sequence {
+    IAIHistoryListState state = [self enterReader];
+    id object = nil;
+    if (sequence >= state.firstSequence && sequence < state.endSequence) {
+        object = *IAIHistorySlot(state.chunks, state.chunkBaseSequence, sequence);
+    }
+    [self exitReader];
+    return object;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)objectAtIndex:(NSUInteger)index {
+    IAIHistoryListState state = [self enterReader];
+    id object = nil;
+    if (index < state.endSequence - state.firstSequence) {
+        object = *IAIHistorySlot(state.chunks, state.chunkBaseSequence,
+                                 state.firstSequence + index);
+    }
+    [self exitReader];
+    return object;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)firstObject {
+    return [self objectAtIndex:0];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)lastObject {
+    return [[self snapshot] lastObject];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSEnumerator *)objectEnumerator {
+    return [[self snapshot] objectEnumerator];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Mutable Methods
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)addObject:(id)object {
+    // nil objects can not be added to a history list.
+    IAIDASSERT(nil != object);
+    if (nil == object) {
+        return;
+    }
+
+    // The slot is filled before the new end is published, so readers never see an empty slot.
+    NSArray* chunks = _chunks;
+    if ((_endSequence - _chunkBaseSequence) / kHistoryChunkSize >= [chunks count]) {
+        chunks = [chunks arrayByAddingObject:[[IAIHistoryChunk alloc] init]];
+    }
+    *IAIHistorySlot(chunks, _chunkBaseSequence, _endSequence) = object;
+
+    IAISeqLockBeginWrite(&_lock);
+    if (chunks != _chunks) {
+        [self replaceChunks:chunks];
+    }
+    ++_endSequence;
+    [self endWrite];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)removeAllObjects {
+    IAISeqLockBeginWrite(&_lock);
+    [self replaceChunks:[NSArray array]];
+    _chunkBaseSequence = _endSequence;
+    _firstSequence = _endSequence;
+    [self endWrite];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)removeFirstObject {
+    if (_firstSequence >= _endSequence) {
+        return;
+    }
+
+    IAISeqLockBeginWrite(&_lock);
+    ++_firstSequence;
+
+    // Release the first chunk once none of its objects are in the list anymore.
+    if (_firstSequence - _chunkBaseSequence >= kHistoryChunkSize) {
+        [self replaceChunks:[_chunks subarrayWithRange:NSMakeRange(1, [_chunks count] - 1)]];
+        _chunkBaseSequence += kHistoryChunkSize;
+    }
+    [self endWrite];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)removeObjectsBeforeSequence:(unsigned long long)sequence {
+    sequence = MIN(sequence, _endSequence);
+    if (_firstSequence >= sequence) {
+        return;
+    }
+
+    IAISeqLockBeginWrite(&_lock);
+    _firstSequence = sequence;
+
+    // Release the chunks that none of the remaining objects are in.
+    NSUInteger numberOfEmptyChunks = (NSUInteger)((_firstSequence - _chunkBaseSequence)
+                                                  / kHistoryChunkSize);
+    if (numberOfEmptyChunks > 0) {
+        [self replaceChunks:[_chunks subarrayWithRange:
+                             NSMakeRange(numberOfEmptyChunks,
+                                         [_chunks count] - numberOfEmptyChunks)]];
+        _chunkBaseSequence += numberOfEmptyChunks * kHistoryChunkSize;
+    }
+    [self endWrite];
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIHistoryRange
+
+@synthesize firstSequence = _firstSequence;
+@synthesize endSequence = _endSequence;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithChunks: (NSArray *)chunks
+   chunkBaseSequence: (unsigned long long)chunkBaseSequence
+       firstSequence: (unsigned long long)firstSequence
+         endSequence: (unsigned long long)endSequence {
+    if ((self = [super init])) {
+        _chunks = chunks;
+        _chunkBaseSequence = chunkBaseSequence;
+        _firstSequence = firstSequence;
+        _endSequence = MAX(firstSequence, endSequence);
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithArray:(NSArray *)array {
+    if ((self = [super init])) {
+        _array = [array copy];
+        _endSequence = [_array count];
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state
+                                  objects:(__unsafe_unretained id *)stackbuf
+                                    count:(NSUInteger)len {
+    if (nil != _array) {
+        return [_array countByEnumeratingWithState:state objects:stackbuf count:len];
+    }
+    return IAIHistoryEnumerate(state, _chunks, _chunkBaseSequence,
+                               _firstSequence, _endSequence, &sHistoryRangeMutations);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSUInteger)count {
+    return (NSUInteger)(_endSequence - _firstSequence);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)firstObject {
+    return [self objectAtIndex:0];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)lastObject {
+    NSUInteger count = [self count];
+    return (count > 0) ? [self objectAtIndex:count - 1] : nil;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)objectAtIndex:(NSUInteger)index {
+    if (index >= [self count]) {
+        return nil;
+    }
+    if (nil != _array) {
+        return [_array objectAtIndex:index];
+    }
+    return *IAIHistorySlot(_chunks, _chunkBaseSequence, _firstSequence + index);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSEnumerator *)objectEnumerator {
+    if (nil != _array) {
+        return [_array objectEnumerator];
+    }
+    return [[IAIHistoryRangeEnumerator alloc] initWithRange:self];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSArray *)allObjects {
+    if (nil != _array) {
+        return _array;
+    }
+    NSMutableArray* objects = [[NSMutableArray alloc] initWithCapacity:[self count]];
+    for (id object in self) {
+        [objects addObject:object];
+    }
+    return [objects copy];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSUInteger)indexOfFirstObjectNotPassingTest:(BOOL (^)(id object))predicate {
+    NSUInteger low = 0;
+    NSUInteger high = [self count];
+    while (low < high) {
+        NSUInteger middle = low + (high - low) / 2;
+        if (predicate([self objectAtIndex:middle])) {
+            low = middle + 1;
+
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAIHistoryRange *)subrangeWithRange:(NSRange)range {
+    NSUInteger count = [self count];
+    NSUInteger location = MIN(range.location, count);
+    NSUInteger length = MIN(range.length, count - location);
+    if (nil != _array) {
+        return [[IAIHistoryRange alloc] initWithArray:
+                [_array subarrayWithRange:NSMakeRange(location, length)]];
+    }
+    return [[IAIHistoryRange alloc] initWithChunks: _chunks
+                                 chunkBaseSequence: _chunkBaseSequence
+                                     firstSequence: _firstSequence + location
+                                       endSequence: _firstSequence + location + length];
+}
+
+
+@end
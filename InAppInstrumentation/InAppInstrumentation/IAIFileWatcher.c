@@ -0,0 +1,167 @@
+//
+//  IAIFileWatcher.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#include "IAIFileWatcher.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#include <sys/event.h>
+#include <sys/time.h>
+#else
+#include <sys/inotify.h>
+#endif
+
+#define IAIFileWatcherReadSize 4096
+#define IAIFileWatcherNumberOfEvents 64
+
+struct IAIFileWatcher {
+    int fd;
+};
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+IAIFileWatcher* IAIFileWatcherCreate(void) {
+    IAIFileWatcher* watcher = calloc(1, sizeof(IAIFileWatcher));
+    if (NULL == watcher) {
+        return NULL;
+    }
+#if defined(__APPLE__)
+    watcher->fd = kqueue();
+#else
+    watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+    if (watcher->fd < 0) {
+        free(watcher);
+        return NULL;
+    }
+    return watcher;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIFileWatcherDestroy(IAIFileWatcher* watcher) {
+    close(watcher->fd);
+    free(watcher);
+}
+
+
+#if defined(__APPLE__)
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The watch number is the descriptor of the directory or file, which keeps it watched while
+// it's open.
+static int IAIFileWatcherAddPath(IAIFileWatcher* watcher, const char* path, int flags) {
+    int fd = open(path, O_EVTONLY | flags);
+    if (fd < 0) {
+        return -1;
+    }
+    struct kevent change;
+    EV_SET(&change, fd, EVFILT_VNODE, EV_ADD | EV_CLEAR,
+           NOTE_WRITE | NOTE_EXTEND | NOTE_DELETE | NOTE_RENAME, 0, NULL);
+    if (kevent(watcher->fd, &change, 1, NULL, 0, NULL) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAIFileWatcherAddDirectory(IAIFileWatcher* watcher, const char* path) {
+    return IAIFileWatcherAddPath(watcher, path, O_DIRECTORY);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAIFileWatcherAddFile(IAIFileWatcher* watcher, const char* path) {
+    return IAIFileWatcherAddPath(watcher, path, O_NOFOLLOW);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIFileWatcherRemoveWatch(IAIFileWatcher* watcher, int watch) {
+    (void)watcher;
+    close(watch);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAIFileWatcherReadChanges(IAIFileWatcher* watcher,
+                              void (*callback)(int watch, void* context), void* context) {
+    static const struct timespec kNoWait = { 0, 0 };
+    struct kevent events[IAIFileWatcherNumberOfEvents];
+    int numberOfCalls = 0;
+    int count;
+    do {
+        count = kevent(watcher->fd, NULL, 0, events, IAIFileWatcherNumberOfEvents, &kNoWait);
+        for (int ix = 0; ix < count; ++ix) {
+            callback((int)events[ix].ident, context);
+            ++numberOfCalls;
+        }
+    } while (IAIFileWatcherNumberOfEvents == count);
+    return numberOfCalls;
+}
+
+
+#else
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAIFileWatcherAddDirectory(IAIFileWatcher* watcher, const char* path) {
+    return inotify_add_watch(watcher->fd, path,
+                             IN_CREATE | IN_DELETE | IN_MODIFY | IN_MOVED_FROM | IN_MOVED_TO
+                             | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAIFileWatcherAddFile(IAIFileWatcher* watcher, const char* path) {
+    return inotify_add_watch(watcher->fd, path,
+                             IN_MODIFY | IN_DELETE_SELF | IN_MOVE_SELF | IN_DONT_FOLLOW);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIFileWatcherRemoveWatch(IAIFileWatcher* watcher, int watch) {
+    // Fails harmlessly when the directory is gone and its watch was already removed.
+    inotify_rm_watch(watcher->fd, watch);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAIFileWatcherReadChanges(IAIFileWatcher* watcher,
+                              void (*callback)(int watch, void* context), void* context) {
+    char buffer[IAIFileWatcherReadSize]
+    __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    int numberOfCalls = 0;
+    int didOverflow = 0;
+    for (;;) {
+        ssize_t length = read(watcher->fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+        for (char* next = buffer; next < buffer + length; ) {
+            const struct inotify_event* event = (const struct inotify_event *)next;
+            if (event->mask & IN_Q_OVERFLOW) {
+                didOverflow = 1;
+            } else if (!(event->mask & IN_IGNORED)) {
+                callback(event->wd, context);
+                ++numberOfCalls;
+            }
+            next += sizeof(struct inotify_event) + event->len;
+        }
+    }
+    return didOverflow ? IAIFileWatcherOverflow : numberOfCalls;
+}
+
+
+#endif
@@ -0,0 +1,83 @@
+//
+//  IAIFileWatcher.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#ifndef InAppInstrumentation_IAIFileWatcher_h
+#define InAppInstrumentation_IAIFileWatcher_h
+
+/**
+ * Reports which directories have changed.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * Each watched directory gets a watch number, and reading the changes reports the numbers of
+ * the directories that changed since the last read. Nothing is reported about what changed:
+ * the reader is expected to list the directory again.
+ *
+ * On Apple platforms every watched directory is opened for events only and registered with a
+ * kqueue, which reports entries that are added, removed or renamed, but not files that grow in
+ * place. Files that matter can be watched on their own with IAIFileWatcherAddFile, at the cost
+ * of a descriptor each. Elsewhere the watcher is an inotify instance, which also reports files
+ * in the directory that are written (see IAIFileWatcherReportsFileWrites). Neither watches
+ * subdirectories: each must be watched on its own.
+ *
+ * The watcher never blocks. It isn't thread safe; a watcher must only be used from one thread
+ * at a time.
+ */
+
+typedef struct IAIFileWatcher IAIFileWatcher;
+
+// IAIFileWatcherReadChanges returns this when changes were lost and every directory must be
+// listed again.
+#define IAIFileWatcherOverflow (-1)
+
+// 1 if the watch of a directory also reports the files in it that are written in place.
+#if defined(__APPLE__)
+#define IAIFileWatcherReportsFileWrites 0
+#else
+#define IAIFileWatcherReportsFileWrites 1
+#endif
+
+/**
+ * Returns NULL if the system has no watcher to spare.
+ */
+IAIFileWatcher* IAIFileWatcherCreate(void);
+
+/**
+ * Directories and files that are still watched must be removed first.
+ */
+void IAIFileWatcherDestroy(IAIFileWatcher* watcher);
+
+/**
+ * Starts watching a directory. Returns its watch number, or -1 if it can't be watched.
+ */
+int IAIFileWatcherAddDirectory(IAIFileWatcher* watcher, const char* path);
+
+/**
+ * Starts watching a file for writes and for being removed or renamed. Returns its watch
+ * number, or -1 if it can't be watched.
+ *
+ * On Apple platforms the file stays open until its watch is removed, so the storage of a file
+ * that is deleted is only freed then.
+ */
+int IAIFileWatcherAddFile(IAIFileWatcher* watcher, const char* path);
+
+/**
+ * Stops watching a directory or file, which may already have been removed.
+ */
+void IAIFileWatcherRemoveWatch(IAIFileWatcher* watcher, int watch);
+
+/**
+ * Calls the callback with the watch number of each directory or file that changed since the
+ * last read,
+ * possibly more than once for the same directory. Returns the number of calls, or
+ * IAIFileWatcherOverflow.
+ */
+int IAIFileWatcherReadChanges(IAIFileWatcher* watcher,
+                              void (*callback)(int watch, void* context), void* context);
+
+#endif
@@ -0,0 +1,134 @@
+//
+//  IAIFrameQueue.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#include "IAIFrameQueue.h"
+
+#include <stdlib.h>
+
+#if defined(__APPLE__)
+#include <libkern/OSAtomic.h>
+#else
+#define OSAtomicCompareAndSwap32Barrier(oldValue, newValue, value) \
+    __sync_bool_compare_and_swap((value), (oldValue), (newValue))
+#define OSMemoryBarrier() __sync_synchronize()
+#endif
+
+// Each slot starts with its sequence number and the length of its frame.
+typedef struct {
+    volatile int32_t sequence;
+    uint32_t length;
+} IAIFrameQueueSlot;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static IAIFrameQueueSlot* IAIFrameQueueSlotAt(IAIFrameQueue* queue, int32_t position) {
+    return (IAIFrameQueueSlot *)(queue->slots
+                                 + ((uint32_t)position & queue->mask) * queue->slotStride);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAIFrameQueueInit(IAIFrameQueue* queue, uint32_t capacity, size_t maxFrameLength) {
+    uint32_t roundedCapacity = 2;
+    while (roundedCapacity < capacity) {
+        roundedCapacity *= 2;
+    }
+
+    // Keep the slots aligned for their sequence numbers.
+    size_t stride = sizeof(IAIFrameQueueSlot) + maxFrameLength;
+    stride = (stride + 7) & ~(size_t)7;
+
+    queue->slots = malloc(stride * roundedCapacity);
+    if (NULL == queue->slots) {
+        return 0;
+    }
+    queue->slotStride = stride;
+    queue->maxFrameLength = maxFrameLength;
+    queue->mask = roundedCapacity - 1;
+    queue->enqueuePosition = 0;
+    queue->dequeuePosition = 0;
+
+    for (uint32_t ix = 0; ix < roundedCapacity; ++ix) {
+        IAIFrameQueueSlot* slot = IAIFrameQueueSlotAt(queue, (int32_t)ix);
+        slot->sequence = (int32_t)ix;
+        slot->length = 0;
+    }
+    OSMemoryBarrier();
+    return 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIFrameQueueDestroy(IAIFrameQueue* queue) {
+    free(queue->slots);
+    queue->slots = NULL;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+uint8_t* IAIFrameQueueReserve(IAIFrameQueue* queue, int32_t* ticket) {
+    int32_t position = queue->enqueuePosition;
+    for (;;) {
+        IAIFrameQueueSlot* slot = IAIFrameQueueSlotAt(queue, position);
+        int32_t sequence = slot->sequence;
+        OSMemoryBarrier();
+
+        // Positions wrap around, so compare them by their difference.
+        int32_t difference = (int32_t)((uint32_t)sequence - (uint32_t)position);
+        if (0 == difference) {
+            if (OSAtomicCompareAndSwap32Barrier(position, (int32_t)((uint32_t)position + 1),
+                                                &queue->enqueuePosition)) {
+                *ticket = position;
+                return (uint8_t *)(slot + 1);
+            }
+            position = queue->enqueuePosition;
+
+        } else if (difference < 0) {
+            // The consumer has not yet freed this slot: the queue is full.
+            return NULL;
+
+        } else {
+            // Another producer claimed this slot first.
+            position = queue->enqueuePosition;
+        }
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIFrameQueueCommit(IAIFrameQueue* queue, int32_t ticket, size_t length) {
+    IAIFrameQueueSlot* slot = IAIFrameQueueSlotAt(queue, ticket);
+    slot->length = (uint32_t)length;
+    OSMemoryBarrier();
+    slot->sequence = (int32_t)((uint32_t)ticket + 1);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+const uint8_t* IAIFrameQueuePeek(IAIFrameQueue* queue, size_t* length) {
+    int32_t position = queue->dequeuePosition;
+    IAIFrameQueueSlot* slot = IAIFrameQueueSlotAt(queue, position);
+    int32_t sequence = slot->sequence;
+    OSMemoryBarrier();
+    if (sequence != (int32_t)((uint32_t)position + 1)) {
+        // Empty, or the producer that claimed the slot has not published it yet.
+        return NULL;
+    }
+    *length = slot->length;
+    return (const uint8_t *)(slot + 1);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIFrameQueuePop(IAIFrameQueue* queue) {
+    int32_t position = queue->dequeuePosition;
+    IAIFrameQueueSlot* slot = IAIFrameQueueSlotAt(queue, position);
+    OSMemoryBarrier();
+    slot->sequence = (int32_t)((uint32_t)position + queue->mask + 1);
+    queue->dequeuePosition = (int32_t)((uint32_t)position + 1);
+}
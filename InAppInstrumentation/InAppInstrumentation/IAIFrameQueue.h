@@ -0,0 +1,74 @@
+//
+//  IAIFrameQueue.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#ifndef InAppInstrumentation_IAIFrameQueue_h
+#define InAppInstrumentation_IAIFrameQueue_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A bounded queue of byte frames with any number of producers and a single consumer.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * The queue is a ring of fixed size slots. A producer claims a slot with a single compare and
+ * swap, writes its frame straight into the slot and then publishes it, so producers never wait
+ * for each other or for the consumer. When every slot is taken IAIFrameQueueReserve fails
+ * immediately and the producer drops its frame.
+ *
+ * This is the bounded queue described by Dmitry Vyukov: each slot has a sequence number that
+ * tells producers and the consumer whose turn it is to use the slot.
+ */
+typedef struct {
+    uint8_t* slots;
+    size_t slotStride;
+    size_t maxFrameLength;
+    uint32_t mask;
+
+    volatile int32_t enqueuePosition;
+    int32_t dequeuePosition;
+} IAIFrameQueue;
+
+/**
+ * Prepares a queue. The capacity is rounded up to a power of two. Returns 0 if memory could
+ * not be allocated.
+ */
+int IAIFrameQueueInit(IAIFrameQueue* queue, uint32_t capacity, size_t maxFrameLength);
+
+/**
+ * Frees the memory held by a queue.
+ */
+void IAIFrameQueueDestroy(IAIFrameQueue* queue);
+
+/**
+ * Claims a slot for a frame of up to maxFrameLength bytes.
+ *
+ *      @returns The bytes of the slot, or NULL if the queue is full. The ticket must be passed
+ *               to IAIFrameQueueCommit once the frame has been written.
+ */
+uint8_t* IAIFrameQueueReserve(IAIFrameQueue* queue, int32_t* ticket);
+
+/**
+ * Publishes a frame to the consumer. A length of 0 gives the slot back without a frame.
+ */
+void IAIFrameQueueCommit(IAIFrameQueue* queue, int32_t ticket, size_t length);
+
+/**
+ * The oldest published frame, or NULL if there isn't one. Only the consumer may call this.
+ *
+ * A frame of length 0 is an abandoned slot and must still be popped.
+ */
+const uint8_t* IAIFrameQueuePeek(IAIFrameQueue* queue, size_t* length);
+
+/**
+ * Gives the slot of the frame returned by IAIFrameQueuePeek back to the producers.
+ */
+void IAIFrameQueuePop(IAIFrameQueue* queue);
+
+#endif
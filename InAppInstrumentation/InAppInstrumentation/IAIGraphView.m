@@ -7,6 +7,7 @@
 //
 
 #import "IAIGraphView.h"
+#import "IAIOverhead.h"
 #import <QuartzCore/QuartzCore.h>
 
 #if !defined(__has_feature) || !__has_feature(objc_arc)
@@ -80,6 +81,9 @@
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 - (void)drawRect:(CGRect)rect {
+    IAIOverheadSection section;
+    IAIOverheadBeginSection(&section, IAIOverheadDrawing);
+    
 	CGContextRef context = UIGraphicsGetCurrentContext();
     
     CGRect bounds = self.bounds;
@@ -114,6 +118,8 @@
     colorspace = nil;
     
     UIGraphicsPopContext();
+    
+    IAIOverheadEndSection(&section);
 }
 
 @end
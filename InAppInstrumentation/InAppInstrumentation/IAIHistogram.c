@@ -0,0 +1,106 @@
+//
+//  IAIHistogram.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#include "IAIHistogram.h"
+
+#include <math.h>
+#include <string.h>
+
+// Each power of two above the linear range is split into this many buckets.
+static const unsigned kSubBucketBits = 4;
+static const uint64_t kLinearLimit = 32;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static unsigned IAIHistogramBucketOfValue(uint64_t value) {
+    if (value < kLinearLimit) {
+        return (unsigned)value;
+    }
+    // Keep the leading bit and the kSubBucketBits below it.
+    unsigned shift = (unsigned)(63 - __builtin_clzll(value)) - kSubBucketBits;
+    return (shift << kSubBucketBits) + (unsigned)(value >> shift);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static uint64_t IAIHistogramHighestValueInBucket(unsigned bucket) {
+    if (bucket < kLinearLimit) {
+        return bucket;
+    }
+    unsigned shift = (bucket >> kSubBucketBits) - 1;
+    uint64_t subBucket = (bucket & ((1 << kSubBucketBits) - 1)) + (1 << kSubBucketBits);
+    return ((subBucket + 1) << shift) - 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIHistogramReset(IAIHistogram* histogram) {
+    memset(histogram, 0, sizeof(*histogram));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIHistogramRecord(IAIHistogram* histogram, uint64_t value) {
+    if (value > IAIHistogramMaxValue) {
+        value = IAIHistogramMaxValue;
+    }
+    ++histogram->counts[IAIHistogramBucketOfValue(value)];
+    ++histogram->count;
+    histogram->sum += value;
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIHistogramAdd(IAIHistogram* histogram, const IAIHistogram* other) {
+    if (0 == other->count) {
+        return;
+    }
+    for (unsigned ix = 0; ix < IAIHistogramNumberOfBuckets; ++ix) {
+        histogram->counts[ix] += other->counts[ix];
+    }
+    histogram->count += other->count;
+    histogram->sum += other->sum;
+    if (other->max > histogram->max) {
+        histogram->max = other->max;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+uint64_t IAIHistogramValueAtPercentile(const IAIHistogram* histogram, double percentile) {
+    if (0 == histogram->count) {
+        return 0;
+    }
+    percentile = fmin(fmax(percentile, 0), 100);
+    uint64_t rank = (uint64_t)ceil(percentile / 100 * (double)histogram->count);
+    if (rank < 1) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (unsigned ix = 0; ix < IAIHistogramNumberOfBuckets; ++ix) {
+        seen += histogram->counts[ix];
+        if (seen >= rank) {
+            uint64_t value = IAIHistogramHighestValueInBucket(ix);
+            return (value < histogram->max) ? value : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+double IAIHistogramMean(const IAIHistogram* histogram) {
+    if (0 == histogram->count) {
+        return 0;
+    }
+    return (double)histogram->sum / (double)histogram->count;
+}
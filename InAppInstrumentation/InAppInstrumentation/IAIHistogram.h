@@ -0,0 +1,60 @@
+//
+//  IAIHistogram.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#ifndef InAppInstrumentation_IAIHistogram_h
+#define InAppInstrumentation_IAIHistogram_h
+
+#include <stdint.h>
+
+/**
+ * A histogram of durations with a fixed relative precision, after HdrHistogram.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * Values below 32 each have a bucket of their own. Above that, every power of two is split
+ * into 16 buckets, so any recorded value is known to within 1/16 of itself while the whole
+ * range up to IAIHistogramMaxValue fits in a few hundred buckets. Recording is a count of
+ * leading zeros and an increment, and histograms of the same shape are merged by adding their
+ * buckets.
+ *
+ * Values above IAIHistogramMaxValue are recorded as IAIHistogramMaxValue. A histogram is not
+ * thread safe.
+ */
+
+// Just under 2^40 nanoseconds, which is a little over 18 minutes.
+#define IAIHistogramMaxValue (((uint64_t)1 << 40) - 1)
+#define IAIHistogramNumberOfBuckets 592
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t counts[IAIHistogramNumberOfBuckets];
+} IAIHistogram;
+
+void IAIHistogramReset(IAIHistogram* histogram);
+
+void IAIHistogramRecord(IAIHistogram* histogram, uint64_t value);
+
+/**
+ * Adds every value of one histogram to another.
+ */
+void IAIHistogramAdd(IAIHistogram* histogram, const IAIHistogram* other);
+
+/**
+ * The largest value that may have been recorded at or below the given percentile, from 0 to
+ * 100. Returns 0 if the histogram is empty.
+ */
+uint64_t IAIHistogramValueAtPercentile(const IAIHistogram* histogram, double percentile);
+
+/**
+ * The mean of the recorded values. Returns 0 if the histogram is empty.
+ */
+double IAIHistogramMean(const IAIHistogram* histogram);
+
+#endif
@@ -0,0 +1,325 @@
+//
+//  IAIInstanceCounters.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#if !defined(__APPLE__) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "IAIInstanceCounters.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#if defined(__APPLE__)
+#include <libkern/OSAtomic.h>
+#else
+#define OSAtomicAdd64Barrier(amount, value) __sync_add_and_fetch((value), (amount))
+#define OSMemoryBarrier() __sync_synchronize()
+#endif
+
+#define IAIInstanceCacheLineSize 64
+
+typedef struct {
+    volatile int64_t numberOfAllocations;
+    volatile int64_t numberOfDeallocations;
+    char padding[IAIInstanceCacheLineSize - 2 * sizeof(int64_t)];
+} IAIInstanceShard;
+
+typedef struct {
+    IAIInstanceShard shards[IAIInstanceNumberOfShards];
+    const char* name;
+} IAIInstanceTypeCounters;
+
+// An open addressed table with linear probing, kept at most three quarters full.
+#define IAIInstanceObjectMinimumCapacity 64
+
+typedef struct {
+    const void* object;         // NULL for an empty slot.
+    IAIInstanceType* type;
+} IAIInstanceObject;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    volatile uint32_t count;
+    uint32_t capacity;
+    IAIInstanceObject* objects;
+} __attribute__((aligned(IAIInstanceCacheLineSize))) IAIInstanceObjectStripe;
+
+static pthread_mutex_t sMutex = PTHREAD_MUTEX_INITIALIZER;
+static IAIInstanceTypeCounters* sCounters[IAIInstanceMaxTypes];
+static volatile unsigned sNumberOfTypes = 0;
+
+static pthread_once_t sObjectStripesOnce = PTHREAD_ONCE_INIT;
+static IAIInstanceObjectStripe sObjectStripes[IAIInstanceNumberOfObjectStripes];
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Numbers a type on its first count. Types beyond IAIInstanceMaxTypes get IAIInstanceMaxTypes
+// and are never counted.
+static uint32_t IAIInstanceTypeRegister(IAIInstanceType* type) {
+    pthread_mutex_lock(&sMutex);
+    if (type->index < 0) {
+        int32_t index = IAIInstanceMaxTypes;
+        if (sNumberOfTypes < IAIInstanceMaxTypes) {
+            // Aligned so that each shard fills a cache line of its own.
+            void* memory = NULL;
+            if (0 == posix_memalign(&memory, IAIInstanceCacheLineSize,
+                                    sizeof(IAIInstanceTypeCounters))) {
+                IAIInstanceTypeCounters* counters = memory;
+                for (unsigned ix = 0; ix < IAIInstanceNumberOfShards; ++ix) {
+                    counters->shards[ix].numberOfAllocations = 0;
+                    counters->shards[ix].numberOfDeallocations = 0;
+                }
+                counters->name = type->name;
+                index = (int32_t)sNumberOfTypes;
+                sCounters[index] = counters;
+                OSMemoryBarrier();
+                sNumberOfTypes = (unsigned)index + 1;
+            }
+        }
+        // Publish the index only once the type's counters are in place.
+        OSMemoryBarrier();
+        type->index = index;
+    }
+    pthread_mutex_unlock(&sMutex);
+    return (uint32_t)type->index;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The shard of the calling thread. Threads are spread over the shards by a Fibonacci hash of
+// their pthread handle, which is the same for the whole life of the thread.
+static IAIInstanceShard* IAIInstanceShardOfType(IAIInstanceType* type) {
+    int32_t index = type->index;
+    if (index < 0) {
+        index = (int32_t)IAIInstanceTypeRegister(type);
+    }
+    if (index >= IAIInstanceMaxTypes) {
+        return NULL;
+    }
+    uint64_t thread = (uint64_t)(uintptr_t)pthread_self();
+    unsigned shard = ((unsigned)((thread * 0x9E3779B97F4A7C15ull) >> 32)
+                      % IAIInstanceNumberOfShards);
+    return &sCounters[index]->shards[shard];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIInstanceCountAllocation(IAIInstanceType* type) {
+    IAIInstanceShard* shard = IAIInstanceShardOfType(type);
+    if (NULL != shard) {
+        OSAtomicAdd64Barrier(1, &shard->numberOfAllocations);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIInstanceCountDeallocation(IAIInstanceType* type) {
+    IAIInstanceShard* shard = IAIInstanceShardOfType(type);
+    if (NULL != shard) {
+        OSAtomicAdd64Barrier(1, &shard->numberOfDeallocations);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark - Objects
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAIInstanceObjectStripesInit(void) {
+    for (unsigned ix = 0; ix < IAIInstanceNumberOfObjectStripes; ++ix) {
+        pthread_mutex_init(&sObjectStripes[ix].mutex, NULL);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Objects are aligned, so the low bits of their addresses say nothing. The top bits of the hash
+// pick the stripe and the middle bits the slot.
+static uint64_t IAIInstanceHashObject(const void* object) {
+    return (uint64_t)(uintptr_t)object * 0x9E3779B97F4A7C15ull;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static IAIInstanceObjectStripe* IAIInstanceStripeOfObject(const void* object) {
+    return &sObjectStripes[IAIInstanceHashObject(object) >> 58];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static uint32_t IAIInstanceHomeOfObject(const void* object, uint32_t capacity) {
+    return (uint32_t)(IAIInstanceHashObject(object) >> 24) & (capacity - 1);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Returns the slot of the object, or of the empty slot that ends its probe sequence.
+static uint32_t IAIInstanceFindObject(const IAIInstanceObject* objects, uint32_t capacity,
+                                      const void* object) {
+    uint32_t slot = IAIInstanceHomeOfObject(object, capacity);
+    while (NULL != objects[slot].object && object != objects[slot].object) {
+        slot = (slot + 1) & (capacity - 1);
+    }
+    return slot;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Called with the stripe's lock held. Nothing here may allocate an Objective-C object, since
+// the tracker calls this from its allocation hook.
+static int IAIInstanceGrowStripe(IAIInstanceObjectStripe* stripe) {
+    uint32_t capacity = (0 == stripe->capacity) ? IAIInstanceObjectMinimumCapacity
+                                                : stripe->capacity * 2;
+    IAIInstanceObject* objects = calloc(capacity, sizeof(IAIInstanceObject));
+    if (NULL == objects) {
+        return 0;
+    }
+    for (uint32_t ix = 0; ix < stripe->capacity; ++ix) {
+        const IAIInstanceObject* object = &stripe->objects[ix];
+        if (NULL != object->object) {
+            objects[IAIInstanceFindObject(objects, capacity, object->object)] = *object;
+        }
+    }
+    free(stripe->objects);
+    stripe->capacity = capacity;
+    stripe->objects = objects;
+    return 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Called with the stripe's lock held. Moves the objects that follow the slot back into the gap,
+// so that no probe sequence is broken by it.
+static void IAIInstanceRemoveSlot(IAIInstanceObjectStripe* stripe, uint32_t slot) {
+    uint32_t mask = stripe->capacity - 1;
+    uint32_t gap = slot;
+    for (uint32_t next = (gap + 1) & mask; NULL != stripe->objects[next].object;
+         next = (next + 1) & mask) {
+        // An object can fill the gap if its home is not cyclically within (gap, next].
+        uint32_t home = IAIInstanceHomeOfObject(stripe->objects[next].object, stripe->capacity);
+        if (((next - home) & mask) >= ((next - gap) & mask)) {
+            stripe->objects[gap] = stripe->objects[next];
+            gap = next;
+        }
+    }
+    stripe->objects[gap].object = NULL;
+    stripe->objects[gap].type = NULL;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAIInstanceCountObjectAllocation(IAIInstanceType* type, const void* object) {
+    pthread_once(&sObjectStripesOnce, IAIInstanceObjectStripesInit);
+    IAIInstanceObjectStripe* stripe = IAIInstanceStripeOfObject(object);
+    IAIInstanceType* uncountedType = NULL;
+
+    pthread_mutex_lock(&stripe->mutex);
+    if ((stripe->count + 1) * 4 > stripe->capacity * 3 && !IAIInstanceGrowStripe(stripe)) {
+        pthread_mutex_unlock(&stripe->mutex);
+        return 0;
+    }
+    IAIInstanceObject* slot = &stripe->objects[IAIInstanceFindObject(stripe->objects,
+                                                                     stripe->capacity, object)];
+    if (NULL != slot->object) {
+        uncountedType = slot->type;
+    } else {
+        slot->object = object;
+        ++stripe->count;
+    }
+    slot->type = type;
+    pthread_mutex_unlock(&stripe->mutex);
+
+    if (NULL != uncountedType) {
+        IAIInstanceCountDeallocation(uncountedType);
+    }
+    IAIInstanceCountAllocation(type);
+    return 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAIInstanceCountObjectDeallocation(const void* object) {
+    IAIInstanceObjectStripe* stripe = IAIInstanceStripeOfObject(object);
+
+    // The allocation of an object that is counted happened before the object could be handed
+    // to this thread, so an empty stripe can't hold it.
+    if (0 == stripe->count) {
+        return 0;
+    }
+
+    IAIInstanceType* type = NULL;
+    pthread_mutex_lock(&stripe->mutex);
+    uint32_t slot = IAIInstanceFindObject(stripe->objects, stripe->capacity, object);
+    if (NULL != stripe->objects[slot].object) {
+        type = stripe->objects[slot].type;
+        IAIInstanceRemoveSlot(stripe, slot);
+        --stripe->count;
+    }
+    pthread_mutex_unlock(&stripe->mutex);
+
+    if (NULL == type) {
+        return 0;
+    }
+    IAIInstanceCountDeallocation(type);
+    return 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIInstanceForgetObjects(void) {
+    pthread_once(&sObjectStripesOnce, IAIInstanceObjectStripesInit);
+    for (unsigned ix = 0; ix < IAIInstanceNumberOfObjectStripes; ++ix) {
+        IAIInstanceObjectStripe* stripe = &sObjectStripes[ix];
+        pthread_mutex_lock(&stripe->mutex);
+        for (uint32_t slot = 0; slot < stripe->capacity; ++slot) {
+            IAIInstanceObject* object = &stripe->objects[slot];
+            if (NULL != object->object) {
+                IAIInstanceCountDeallocation(object->type);
+                object->object = NULL;
+                object->type = NULL;
+            }
+        }
+        stripe->count = 0;
+        pthread_mutex_unlock(&stripe->mutex);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark - Reading Counts
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned IAIInstanceCountersNumberOfTypes(void) {
+    return sNumberOfTypes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAIInstanceCountersReadType(unsigned index, IAIInstanceCounts* counts) {
+    if (index >= sNumberOfTypes) {
+        return 0;
+    }
+    OSMemoryBarrier();
+    IAIInstanceTypeCounters* counters = sCounters[index];
+    counts->name = counters->name;
+    counts->numberOfAllocations = 0;
+    counts->numberOfDeallocations = 0;
+    for (unsigned ix = 0; ix < IAIInstanceNumberOfShards; ++ix) {
+        // Deallocations first, so that an instance that is freed during the read is never
+        // counted as freed without also being counted as allocated.
+        IAIInstanceShard* shard = &counters->shards[ix];
+        counts->numberOfDeallocations += OSAtomicAdd64Barrier(0, &shard->numberOfDeallocations);
+        counts->numberOfAllocations += OSAtomicAdd64Barrier(0, &shard->numberOfAllocations);
+    }
+    return 1;
+}
@@ -0,0 +1,147 @@
+//
+//  IAIInstanceCounters.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#ifndef InAppInstrumentation_IAIInstanceCounters_h
+#define InAppInstrumentation_IAIInstanceCounters_h
+
+#include <stdint.h>
+
+/**
+ * Counts the live instances of types.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * Each counted type is an IAIInstanceType, usually a static variable next to the code that
+ * creates and destroys its instances. Its constructors call IAIInstanceCountAllocation and its
+ * destructor IAIInstanceCountDeallocation:
+ *
+ * @code
+ *  static IAIInstanceType sTileType = IAIInstanceTypeMake("Tile");
+ *  ...
+ *  IAIInstanceCountAllocation(&sTileType);
+ * @endcode
+ *
+ * C++ classes get both calls by deriving from IAICountedInstance, see below. Objective-C
+ * classes are counted by IAIInstanceTracker, which registers a type for each class it tracks.
+ *
+ * The class of an Objective-C object may change while it lives, for instance when it is
+ * observed with key-value observing, and objects that were allocated before the tracker started
+ * die like any other. So the tracker counts objects with IAIInstanceCountObjectAllocation,
+ * which remembers the type of each object in a table keyed by its address, and
+ * IAIInstanceCountObjectDeallocation charges the object to that type, or ignores it if its
+ * allocation wasn't counted. The tracker hooks the dealloc of the tracked classes only, so the
+ * table is only looked up when an instance of one of those classes or of their subclasses
+ * dies. The table is split into IAIInstanceNumberOfObjectStripes stripes, each with a lock of
+ * its own, and a deallocation looks no further than its stripe's count while the stripe is
+ * empty.
+ *
+ * A type's counts are spread over IAIInstanceNumberOfShards counters, each on a cache line of
+ * its own, and a thread always adds to the same shard, so threads that create instances of the
+ * same type at once rarely share a line. Counting is an atomic add on that line. Reading sums
+ * the shards, so a read may miss counts that are being added at the same time but never
+ * loses them.
+ */
+
+#define IAIInstanceMaxTypes 1024
+#define IAIInstanceNumberOfShards 8
+#define IAIInstanceNumberOfObjectStripes 64
+
+typedef struct {
+    const char* name;
+    volatile int32_t index;     // -1 until the type is first counted.
+} IAIInstanceType;
+
+// Initializes a type with a name that must outlive it, usually a string literal.
+#define IAIInstanceTypeMake(name) { (name), -1 }
+
+typedef struct {
+    const char* name;
+    int64_t numberOfAllocations;
+    int64_t numberOfDeallocations;
+} IAIInstanceCounts;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void IAIInstanceCountAllocation(IAIInstanceType* type);
+void IAIInstanceCountDeallocation(IAIInstanceType* type);
+
+/**
+ * Counts the allocation of an object and remembers its type. An object that is still
+ * remembered at the same address must have been freed without being counted, and is counted
+ * as deallocated first.
+ *
+ *      @returns 0 if the table can't grow, in which case the object isn't counted.
+ */
+int IAIInstanceCountObjectAllocation(IAIInstanceType* type, const void* object);
+
+/**
+ * Counts the deallocation of an object against the type it was allocated as, and forgets it.
+ *
+ *      @returns 0 if the object's allocation wasn't counted, in which case nothing is counted.
+ */
+int IAIInstanceCountObjectDeallocation(const void* object);
+
+/**
+ * Forgets every remembered object, counting each as deallocated from the type it was allocated
+ * as. Used when the deallocations of the objects can no longer be seen.
+ */
+void IAIInstanceForgetObjects(void);
+
+/**
+ * The number of types that have been counted so far. Types are numbered in the order in which
+ * they were first counted, and no more than IAIInstanceMaxTypes are counted.
+ */
+unsigned IAIInstanceCountersNumberOfTypes(void);
+
+/**
+ * Sums the shards of a type. Returns 0 if there is no type with the index.
+ */
+int IAIInstanceCountersReadType(unsigned index, IAIInstanceCounts* counts);
+
+#ifdef __cplusplus
+}
+
+/**
+ * Counts the instances of a C++ class, whether on the stack, on the heap or inside other
+ * objects. The class derives from the template with itself as the argument and names itself:
+ *
+ * @code
+ *  class Tile : IAICountedInstance<Tile> {
+ *  public:
+ *    static const char* IAIInstanceTypeName() { return "Tile"; }
+ *    ...
+ *  };
+ * @endcode
+ */
+template <typename T>
+class IAICountedInstance {
+protected:
+    IAICountedInstance() {
+        IAIInstanceCountAllocation(Type());
+    }
+
+    IAICountedInstance(const IAICountedInstance&) {
+        IAIInstanceCountAllocation(Type());
+    }
+
+    ~IAICountedInstance() {
+        IAIInstanceCountDeallocation(Type());
+    }
+
+private:
+    static IAIInstanceType* Type() {
+        static IAIInstanceType type = IAIInstanceTypeMake(T::IAIInstanceTypeName());
+        return &type;
+    }
+};
+
+#endif
+
+#endif
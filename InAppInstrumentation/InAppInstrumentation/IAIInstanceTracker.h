@@ -0,0 +1,160 @@
+//
+//  IAIInstanceTracker.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "IAIInstanceCounters.h"
+
+@class IAILogger;
+
+// The live instances of each type are added to the logger as the metric with this prefix and
+// the name of the type, e.g. "liveInstances.IAIConsoleLogEntry".
+extern NSString* const IAIMetricLiveInstancesPrefix;
+
+/**
+ * The live instances of one type and how fast they grew.
+ *
+ *      @ingroup Overview-Logger
+ */
+@interface IAIInstanceTypeSummary : NSObject {
+@private
+    NSString* _name;
+    long long _numberOfLiveInstances;
+    unsigned long long _numberOfAllocations;
+    double _growthPerSecond;
+}
+
+@property (nonatomic, readonly, copy) NSString* name;
+
+/**
+ * The number of instances allocated and not yet deallocated.
+ *
+ * For Objective-C classes only the instances that were allocated while the tracker was started
+ * are counted.
+ */
+@property (nonatomic, readonly, assign) long long numberOfLiveInstances;
+
+@property (nonatomic, readonly, assign) unsigned long long numberOfAllocations;
+
+/**
+ * The change in the number of live instances per second, from the oldest snapshot in the
+ * logger to the newest.
+ */
+@property (nonatomic, readonly, assign) double growthPerSecond;
+
+@end
+
+
+/**
+ * Counts the live instances of Objective-C classes and C++ types, to find what is growing.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * The memory graphs show that the app grows but not what it is made of. The tracker counts the
+ * allocations and deallocations of each tracked type (see IAIInstanceCounters.h), and every
+ * snapshotInterval seconds adds the number of live instances of each type to the logger, as
+ * a metric named with IAIMetricLiveInstancesPrefix. The snapshots are kept and rolled up like
+ * every other metric, and the growth of each type is measured over the snapshots that the
+ * logger still has, so a type that keeps growing through a long soak test stands out from one
+ * that grew once and then stayed put.
+ *
+ * C++ types count themselves, see IAICountedInstance. Objective-C classes are only counted
+ * while the tracker is started, and only the classes that are tracked by name or prefix:
+ *
+ * @code
+ *  IAIInstanceTracker* tracker = [IAInstrumentation instanceTracker];
+ *  [tracker trackClassesWithPrefix:@"MY"];
+ *  [tracker trackClass:[UIImageView class]];
+ *  [tracker start];
+ * @endcode
+ *
+ * Starting the tracker replaces +[NSObject allocWithZone:], so every allocation of every class,
+ * tracked or not, pays for a lookup in a table of classes. The first time a tracked class is
+ * allocated, the tracker hooks the dealloc of that class alone, so the deallocations of other
+ * classes cost nothing. Classes are counted by their exact class at allocation: tracking a
+ * class does not track its subclasses. Each counted instance is remembered by its address until
+ * it is deallocated (see IAIInstanceCountObjectAllocation), so an instance is uncounted from
+ * the type it was allocated as even when key-value observing has since changed its class, and
+ * instances that were never counted are ignored.
+ *
+ * Objects that are not allocated through NSObject, such as the toll-free bridged Core
+ * Foundation types, are not counted, and neither are classes whose allocWithZone: returns an
+ * instance of another class, such as the class clusters of Foundation.
+ */
+@interface IAIInstanceTracker : NSObject {
+@private
+    __weak IAILogger* _logger;
+
+    NSTimeInterval _snapshotInterval;
+    NSTimeInterval _lastSnapshotTime;
+    NSMutableArray* _metricNames;
+    NSArray* _typeSummaries;
+}
+
+#pragma mark Creating a Tracker /** @name Creating a Tracker */
+
+/**
+ * Designated initializer.
+ *
+ * The logger is not retained.
+ */
+- (id)initWithLogger:(IAILogger *)logger;
+
+
+#pragma mark Tracking Classes /** @name Tracking Classes */
+
+/**
+ * Counts the instances of a class from now on.
+ */
+- (void)trackClass:(Class)aClass;
+
+/**
+ * Counts the instances of every class whose name starts with the prefix from now on.
+ */
+- (void)trackClassesWithPrefix:(NSString *)prefix;
+
+/**
+ * Starts counting the instances of the tracked classes. Returns NO if NSObject can't be hooked.
+ */
+- (BOOL)start;
+
+/**
+ * Stops counting the instances of the tracked classes, and restores the dealloc of each class
+ * that implements one. A class that inherited dealloc keeps the method the tracker added, which
+ * then only calls the superclass's dealloc.
+ *
+ * The number of allocations is kept. The instances that are still alive are counted as
+ * deallocated, since the tracker will no longer see them die.
+ */
+- (void)stop;
+
+@property (nonatomic, readonly, assign, getter=isRunning) BOOL running;
+
+
+#pragma mark Taking Snapshots /** @name Taking Snapshots */
+
+/**
+ * The number of seconds between snapshots.
+ *
+ * By default this is 10 seconds.
+ */
+@property (nonatomic, readwrite, assign) NSTimeInterval snapshotInterval;
+
+/**
+ * Adds a snapshot to the logger when one is due, and measures the growth of each type.
+ *
+ * Call this from the main thread once per heartbeat.
+ */
+- (void)update;
+
+/**
+ * The summaries of all counted types as of the last snapshot, the fastest growing first.
+ */
+@property (nonatomic, readonly, copy) NSArray* typeSummaries;
+
+@end
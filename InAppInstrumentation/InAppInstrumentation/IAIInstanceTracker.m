@@ -0,0 +1,486 @@
+//
+//  IAIInstanceTracker.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAIInstanceTracker.h"
+
+#import "IAILogger.h"
+
+#import <libkern/OSAtomic.h>
+#import <objc/runtime.h>
+#import <pthread.h>
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+NSString* const IAIMetricLiveInstancesPrefix = @"liveInstances.";
+
+// Every class that is allocated while the tracker is started takes a slot, tracked or not, so
+// that the next allocation of the class finds it without taking the lock.
+#define IAIClassTableSize 8192
+#define IAIMaxTrackingRules 64
+
+typedef struct {
+    volatile uintptr_t key;             // The class, or 0 for an empty slot.
+    const char* name;
+    IAIInstanceType* volatile type;     // NULL if the class isn't tracked.
+
+    // The dealloc hook of a tracked class, made the first time the class is allocated while
+    // the tracker is started. The hook counts only while the class is counting.
+    IMP deallocHook;
+    IMP originalDealloc;                // NULL if the class inherits dealloc.
+    int deallocHookIsInstalled;
+    volatile int isCounting;
+} IAIClassSlot;
+
+typedef struct {
+    char* name;
+    size_t length;
+    int isPrefix;
+} IAITrackingRule;
+
+static pthread_mutex_t sMutex = PTHREAD_MUTEX_INITIALIZER;
+static IAIClassSlot sClassTable[IAIClassTableSize];
+static volatile int sClassTableIsFull = 0;
+static IAITrackingRule sRules[IAIMaxTrackingRules];
+static unsigned sNumberOfRules = 0;
+
+static volatile int sInstalled = 0;
+static IMP sOriginalAllocWithZone = NULL;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static unsigned IAISlotOfKey(uintptr_t key) {
+    // Classes are aligned, so the low bits say nothing.
+    return (unsigned)(((uint64_t)key * 0x9E3779B97F4A7C15ull) >> 40) & (IAIClassTableSize - 1);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static int IAIRuleMatchesName(const IAITrackingRule* rule, const char* name) {
+    return (rule->isPrefix
+            ? (0 == strncmp(name, rule->name, rule->length))
+            : (0 == strcmp(name, rule->name)));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Called with the lock held. Nothing here may allocate an Objective-C object, which would come
+// straight back into the hook.
+static IAIInstanceType* IAINewTypeForName(const char* name) {
+    for (unsigned ix = 0; ix < sNumberOfRules; ++ix) {
+        if (IAIRuleMatchesName(&sRules[ix], name)) {
+            IAIInstanceType* type = malloc(sizeof(IAIInstanceType));
+            if (NULL != type) {
+                type->name = name;
+                type->index = -1;
+            }
+            return type;
+        }
+    }
+    return NULL;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The slow path of IAISlotOfClass: adds the class to the table.
+static IAIClassSlot* IAIAddClass(Class aClass, uintptr_t key) {
+    IAIClassSlot* classSlot = NULL;
+    pthread_mutex_lock(&sMutex);
+
+    unsigned slot = IAISlotOfKey(key);
+    for (unsigned probe = 0; probe < IAIClassTableSize; ++probe) {
+        if (sClassTable[slot].key == key) {
+            // Another thread added the class first.
+            classSlot = &sClassTable[slot];
+            break;
+        }
+        if (0 == sClassTable[slot].key) {
+            classSlot = &sClassTable[slot];
+            const char* name = class_getName(aClass);
+            classSlot->name = name;
+            classSlot->type = IAINewTypeForName(name);
+            // Publish the key only once the slot is filled in.
+            OSMemoryBarrier();
+            classSlot->key = key;
+            break;
+        }
+        slot = (slot + 1) & (IAIClassTableSize - 1);
+        if (probe == IAIClassTableSize - 1) {
+            sClassTableIsFull = 1;
+        }
+    }
+
+    pthread_mutex_unlock(&sMutex);
+    return classSlot;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// NULL if the table is full.
+static IAIClassSlot* IAISlotOfClass(Class aClass) {
+    uintptr_t key = (uintptr_t)(__bridge const void *)aClass;
+    unsigned slot = IAISlotOfKey(key);
+    for (unsigned probe = 0; probe < IAIClassTableSize; ++probe) {
+        uintptr_t slotKey = sClassTable[slot].key;
+        if (slotKey == key) {
+            OSMemoryBarrier();
+            return &sClassTable[slot];
+        }
+        if (0 == slotKey) {
+            break;
+        }
+        slot = (slot + 1) & (IAIClassTableSize - 1);
+    }
+    return sClassTableIsFull ? NULL : IAIAddClass(aClass, key);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Makes the dealloc hook of a tracked class. Each class gets a hook of its own, so that the hook
+// knows which class's dealloc to go on to, however deep in a chain of [super dealloc] calls it
+// runs. Only the tracked classes, their subclasses and the key-value observing subclasses made
+// of them ever run a hook.
+static IMP IAIMakeDeallocHook(IAIClassSlot* classSlot, Class aClass) {
+    SEL deallocSelector = sel_registerName("dealloc");
+    Class superclass = class_getSuperclass(aClass);
+    return imp_implementationWithBlock(^(__unsafe_unretained id object) {
+        if (classSlot->isCounting) {
+            IAIInstanceCountObjectDeallocation((__bridge const void *)object);
+        }
+        IMP dealloc = classSlot->originalDealloc;
+        if (NULL == dealloc) {
+            dealloc = class_getMethodImplementation(superclass, deallocSelector);
+        }
+        ((void (*)(__unsafe_unretained id, SEL))dealloc)(object, deallocSelector);
+    });
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Installs the dealloc hook of a tracked class, if need be, and starts counting the class.
+static void IAIStartCountingClass(IAIClassSlot* classSlot, Class aClass) {
+    pthread_mutex_lock(&sMutex);
+    if (sInstalled && !classSlot->isCounting) {
+        SEL deallocSelector = sel_registerName("dealloc");
+        if (NULL == classSlot->deallocHook) {
+            classSlot->deallocHook = IAIMakeDeallocHook(classSlot, aClass);
+        }
+        if (!classSlot->deallocHookIsInstalled) {
+            Method method = class_getInstanceMethod(aClass, deallocSelector);
+            if (method != class_getInstanceMethod(class_getSuperclass(aClass), deallocSelector)) {
+                // The class implements dealloc. The hook must find the original before it can
+                // be called.
+                classSlot->originalDealloc = method_getImplementation(method);
+                OSMemoryBarrier();
+                method_setImplementation(method, classSlot->deallocHook);
+
+            } else if (NULL == classSlot->originalDealloc) {
+                // The hook goes on to the superclass's dealloc. Methods can't be removed again,
+                // so once added the hook stays, and only forwards while the class isn't counting.
+                class_addMethod(aClass, deallocSelector, classSlot->deallocHook,
+                                method_getTypeEncoding(method));
+            }
+            classSlot->deallocHookIsInstalled = 1;
+        }
+        // Deallocations are counted before allocations are, so that no instance is counted as
+        // allocated without its deallocation being counted too.
+        OSMemoryBarrier();
+        classSlot->isCounting = 1;
+    }
+    pthread_mutex_unlock(&sMutex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Restores the dealloc of every class whose dealloc was replaced, and stops the hooks that were
+// added from counting.
+static void IAIStopCountingClasses(void) {
+    pthread_mutex_lock(&sMutex);
+    SEL deallocSelector = sel_registerName("dealloc");
+    for (unsigned ix = 0; ix < IAIClassTableSize; ++ix) {
+        IAIClassSlot* classSlot = &sClassTable[ix];
+        if (0 == classSlot->key || !classSlot->isCounting) {
+            continue;
+        }
+        classSlot->isCounting = 0;
+        if (NULL != classSlot->originalDealloc) {
+            Class aClass = (__bridge Class)(const void *)classSlot->key;
+            method_setImplementation(class_getInstanceMethod(aClass, deallocSelector),
+                                     classSlot->originalDealloc);
+            classSlot->deallocHookIsInstalled = 0;
+        }
+    }
+    pthread_mutex_unlock(&sMutex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Applies a new rule to the classes that are already in the table.
+static void IAIAddRule(const char* name, int isPrefix) {
+    pthread_mutex_lock(&sMutex);
+    if (sNumberOfRules < IAIMaxTrackingRules) {
+        IAITrackingRule* rule = &sRules[sNumberOfRules];
+        rule->name = strdup(name);
+        rule->length = strlen(name);
+        rule->isPrefix = isPrefix;
+        if (NULL != rule->name) {
+            ++sNumberOfRules;
+
+            for (unsigned ix = 0; ix < IAIClassTableSize; ++ix) {
+                IAIClassSlot* classSlot = &sClassTable[ix];
+                if (0 != classSlot->key && NULL == classSlot->type
+                    && IAIRuleMatchesName(rule, classSlot->name)) {
+                    classSlot->type = IAINewTypeForName(classSlot->name);
+                }
+            }
+        }
+    }
+    pthread_mutex_unlock(&sMutex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// +[NSObject allocWithZone:]. The object is returned retained, so it is passed through as a
+// plain pointer to keep ARC from balancing it.
+//
+// The object is remembered with the type it was allocated as, so that the dealloc hook charges
+// it to that type even when key-value observing has since changed its class, and ignores the
+// instances that were allocated before the tracker started. An allocation that returns an
+// instance of another class, such as the placeholder of a class cluster, is never deallocated
+// through the class's hook, so it isn't counted.
+static void* IAIAllocWithZone(__unsafe_unretained Class self, SEL _cmd, NSZone* zone) {
+    void* object = ((void* (*)(__unsafe_unretained Class, SEL, NSZone*))sOriginalAllocWithZone)
+                   (self, _cmd, zone);
+    if (NULL != object) {
+        IAIClassSlot* classSlot = IAISlotOfClass(self);
+        if (NULL != classSlot && NULL != classSlot->type
+            && object_getClass((__bridge id)object) == self) {
+            if (!classSlot->isCounting) {
+                IAIStartCountingClass(classSlot, self);
+            }
+            if (classSlot->isCounting) {
+                IAIInstanceCountObjectAllocation(classSlot->type, object);
+            }
+        }
+    }
+    return object;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@interface IAIInstanceTypeSummary()
+
+- (id)initWithName: (NSString *)name
+            counts: (const IAIInstanceCounts *)counts
+   growthPerSecond: (double)growthPerSecond;
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIInstanceTypeSummary
+
+@synthesize name = _name;
+@synthesize numberOfLiveInstances = _numberOfLiveInstances;
+@synthesize numberOfAllocations = _numberOfAllocations;
+@synthesize growthPerSecond = _growthPerSecond;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithName: (NSString *)name
+            counts: (const IAIInstanceCounts *)counts
+   growthPerSecond: (double)growthPerSecond {
+    if ((self = [super init])) {
+        _name = [name copy];
+        _numberOfLiveInstances = counts->numberOfAllocations - counts->numberOfDeallocations;
+        _numberOfAllocations = (unsigned long long)counts->numberOfAllocations;
+        _growthPerSecond = growthPerSecond;
+    }
+    return self;
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@interface IAIInstanceTracker()
+
+- (NSDictionary *)growthOfMetrics;
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIInstanceTracker
+
+@synthesize snapshotInterval = _snapshotInterval;
+@synthesize typeSummaries = _typeSummaries;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithLogger:(IAILogger *)logger {
+    if ((self = [super init])) {
+        _logger = logger;
+        _snapshotInterval = 10;
+        _metricNames = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)trackClass:(Class)aClass {
+    IAIAddRule(class_getName(aClass), 0);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)trackClassesWithPrefix:(NSString *)prefix {
+    IAIAddRule([prefix UTF8String], 1);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)start {
+    if (sInstalled) {
+        return YES;
+    }
+    Method allocMethod = class_getClassMethod([NSObject class], @selector(allocWithZone:));
+    if (NULL == allocMethod) {
+        return NO;
+    }
+
+    // The dealloc hooks of the tracked classes are installed as the classes are allocated.
+    sInstalled = 1;
+    OSMemoryBarrier();
+    sOriginalAllocWithZone = method_setImplementation(allocMethod, (IMP)IAIAllocWithZone);
+    return YES;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)stop {
+    if (!sInstalled) {
+        return;
+    }
+    method_setImplementation(class_getClassMethod([NSObject class], @selector(allocWithZone:)),
+                             sOriginalAllocWithZone);
+    sInstalled = 0;
+    IAIStopCountingClasses();
+
+    // The tracker won't see the remaining instances die, so they no longer count as live.
+    IAIInstanceForgetObjects();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)isRunning {
+    return sInstalled;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The growth per second of each live instance metric over the snapshots in the logger.
+- (NSDictionary *)growthOfMetrics {
+    NSMutableDictionary* firstEntries = [NSMutableDictionary dictionary];
+    NSMutableDictionary* lastEntries = [NSMutableDictionary dictionary];
+
+    NSEnumerator* enumerator = [[_logger metricLogs] objectEnumerator];
+    IAIMetricLogEntry* entry = nil;
+    while (nil != (entry = [enumerator nextObject])) {
+        if (![entry.name hasPrefix:IAIMetricLiveInstancesPrefix]) {
+            continue;
+        }
+        if (nil == [firstEntries objectForKey:entry.name]) {
+            [firstEntries setObject:entry forKey:entry.name];
+        }
+        [lastEntries setObject:entry forKey:entry.name];
+    }
+
+    NSMutableDictionary* growths = [NSMutableDictionary dictionary];
+    for (NSString* name in lastEntries) {
+        IAIMetricLogEntry* firstEntry = [firstEntries objectForKey:name];
+        IAIMetricLogEntry* lastEntry = [lastEntries objectForKey:name];
+        NSTimeInterval interval = [lastEntry.timestamp timeIntervalSinceDate:firstEntry.timestamp];
+        double growth = (interval > 0) ? (lastEntry.value - firstEntry.value) / interval : 0;
+        [growths setObject:[NSNumber numberWithDouble:growth] forKey:name];
+    }
+    return growths;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)update {
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    if (now - _lastSnapshotTime < _snapshotInterval) {
+        return;
+    }
+    _lastSnapshotTime = now;
+
+    unsigned numberOfTypes = IAIInstanceCountersNumberOfTypes();
+    if (0 == numberOfTypes) {
+        return;
+    }
+
+    IAILogger* logger = _logger;
+    IAIInstanceCounts* counts = calloc(numberOfTypes, sizeof(IAIInstanceCounts));
+    if (NULL == counts) {
+        return;
+    }
+    for (unsigned ix = 0; ix < numberOfTypes; ++ix) {
+        IAIInstanceCountersReadType(ix, &counts[ix]);
+
+        // Types keep their index, so their metric names are only made once.
+        if (ix >= [_metricNames count]) {
+            NSString* name = [NSString stringWithUTF8String:counts[ix].name];
+            [_metricNames addObject:[IAIMetricLiveInstancesPrefix stringByAppendingString:
+                                     (nil != name) ? name : @"?"]];
+        }
+        [logger addMetricValue: (double)(counts[ix].numberOfAllocations
+                                         - counts[ix].numberOfDeallocations)
+                       forName: [_metricNames objectAtIndex:ix]];
+    }
+
+    NSDictionary* growths = [self growthOfMetrics];
+    NSMutableArray* summaries = [NSMutableArray arrayWithCapacity:numberOfTypes];
+    for (unsigned ix = 0; ix < numberOfTypes; ++ix) {
+        NSString* metricName = [_metricNames objectAtIndex:ix];
+        NSString* name = [metricName substringFromIndex:[IAIMetricLiveInstancesPrefix length]];
+        double growth = [[growths objectForKey:metricName] doubleValue];
+        [summaries addObject:[[IAIInstanceTypeSummary alloc] initWithName: name
+                                                                   counts: &counts[ix]
+                                                          growthPerSecond: growth]];
+    }
+    free(counts);
+
+    [summaries sortUsingComparator:
+     ^NSComparisonResult(IAIInstanceTypeSummary* summary1, IAIInstanceTypeSummary* summary2) {
+         if (summary1.growthPerSecond != summary2.growthPerSecond) {
+             return (summary1.growthPerSecond > summary2.growthPerSecond
+                     ? NSOrderedAscending : NSOrderedDescending);
+         }
+         return (summary1.numberOfLiveInstances > summary2.numberOfLiveInstances
+                 ? NSOrderedAscending
+                 : (summary1.numberOfLiveInstances < summary2.numberOfLiveInstances
+                    ? NSOrderedDescending : NSOrderedSame));
+     }];
+    _typeSummaries = [summaries copy];
+}
+
+
+@end
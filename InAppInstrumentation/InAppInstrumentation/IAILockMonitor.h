@@ -0,0 +1,152 @@
+//
+//  IAILockMonitor.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "IAILockProfiler.h"
+
+@class IAILogger;
+
+// The metrics that the lock monitor adds to its logger.
+extern NSString* const IAIMetricLockContentionsPerSecond;
+extern NSString* const IAIMetricLockWaitTimePerSecond;
+
+/**
+ * Runs a block while holding a recursive lock for an object, like @synchronized, and charges
+ * the hold to a site (see IAILockProfiler.h).
+ *
+ *      @ingroup Overview-Logger
+ *
+ * Every object gets a lock of its own for as long as any thread is using it, so two objects
+ * never share a lock and can't deadlock on each other. A `return` in the block only leaves the
+ * block.
+ */
+void IAISynchronizedAtSite(id object, IAILockSite* site, void (^block)(void));
+
+/**
+ * IAISynchronizedAtSite with a site of its own, named by a string literal:
+ *
+ * @code
+ *  IAISynchronized(self, "cache eviction", ^{
+ *    [_cache removeAllObjects];
+ *  });
+ * @endcode
+ */
+#define IAISynchronized(object, name, ...) \
+    do { \
+        static IAILockSite IAISynchronizedSite = IAILockSiteMake(name); \
+        IAISynchronizedAtSite((object), &IAISynchronizedSite, __VA_ARGS__); \
+    } while (0)
+
+
+/**
+ * The measurements of one lock site since the app started.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * Times are in seconds.
+ */
+@interface IAILockSiteSummary : NSObject {
+@private
+    NSString* _name;
+    unsigned long long _numberOfAcquisitions;
+    unsigned long long _numberOfContentions;
+    NSTimeInterval _totalWaitTime;
+    NSTimeInterval _medianWaitTime;
+    NSTimeInterval _p99WaitTime;
+    NSTimeInterval _maximumWaitTime;
+    NSTimeInterval _medianHoldTime;
+    NSTimeInterval _p99HoldTime;
+    NSTimeInterval _maximumHoldTime;
+}
+
+@property (nonatomic, readonly, copy) NSString* name;
+@property (nonatomic, readonly, assign) unsigned long long numberOfAcquisitions;
+@property (nonatomic, readonly, assign) unsigned long long numberOfContentions;
+
+/**
+ * The share of the acquisitions that had to wait for another thread.
+ */
+@property (nonatomic, readonly, assign) double contentionRate;
+
+/**
+ * The time that all threads together spent waiting for the site's locks.
+ */
+@property (nonatomic, readonly, assign) NSTimeInterval totalWaitTime;
+
+@property (nonatomic, readonly, assign) NSTimeInterval medianWaitTime;
+@property (nonatomic, readonly, assign) NSTimeInterval p99WaitTime;
+@property (nonatomic, readonly, assign) NSTimeInterval maximumWaitTime;
+@property (nonatomic, readonly, assign) NSTimeInterval medianHoldTime;
+@property (nonatomic, readonly, assign) NSTimeInterval p99HoldTime;
+@property (nonatomic, readonly, assign) NSTimeInterval maximumHoldTime;
+
+@end
+
+
+/**
+ * Gathers the measurements of the instrumented locks.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * The locks of IAILockProfiler.h and IAISynchronized measure themselves, so there is nothing to
+ * start: only code that uses them pays for the measurements. Once per heartbeat the monitor
+ * reads every site, keeps a summary of each and adds the number of contentions per second and
+ * the time spent waiting per second, summed over all threads and sites, to the logger as the
+ * metrics IAIMetricLockContentionsPerSecond and IAIMetricLockWaitTimePerSecond.
+ *
+ * Measurements reach the sites in batches from each thread, so the monitor lags the threads by
+ * up to IAILockFlushInterval.
+ */
+@interface IAILockMonitor : NSObject {
+@private
+    __weak IAILogger* _logger;
+
+    NSArray* _siteSummaries;
+    NSTimeInterval _lastUpdateTime;
+    unsigned long long _lastNumberOfContentions;
+    NSTimeInterval _lastTotalWaitTime;
+    double _contentionsPerSecond;
+    double _waitTimePerSecond;
+}
+
+#pragma mark Creating a Monitor /** @name Creating a Monitor */
+
+/**
+ * Designated initializer.
+ *
+ * The logger is not retained.
+ */
+- (id)initWithLogger:(IAILogger *)logger;
+
+
+#pragma mark Reading Sites /** @name Reading Sites */
+
+/**
+ * Reads the sites and adds the metrics to the logger.
+ *
+ * Call this from the main thread once per heartbeat.
+ */
+- (void)update;
+
+/**
+ * The summaries of all sites as of the last update, the longest waited for first.
+ */
+@property (nonatomic, readonly, copy) NSArray* siteSummaries;
+
+/**
+ * The number of contentions per second between the last two updates.
+ */
+@property (nonatomic, readonly, assign) double contentionsPerSecond;
+
+/**
+ * The seconds spent waiting for locks per second between the last two updates.
+ */
+@property (nonatomic, readonly, assign) double waitTimePerSecond;
+
+@end
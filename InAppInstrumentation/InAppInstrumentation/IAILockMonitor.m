@@ -0,0 +1,261 @@
+//
+//  IAILockMonitor.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAILockMonitor.h"
+
+#import "IAILogger.h"
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+NSString* const IAIMetricLockContentionsPerSecond = @"lockContentionsPerSecond";
+NSString* const IAIMetricLockWaitTimePerSecond = @"lockWaitTimePerSecond";
+
+static const NSUInteger kNumberOfSyncBuckets = 64;
+
+// The lock of an object in use by IAISynchronizedAtSite. Nodes are kept once allocated and
+// reused for another object once no thread is using them, like the locks of @synchronized.
+typedef struct IAISyncNode {
+    struct IAISyncNode* next;
+    uintptr_t object;
+    unsigned useCount;
+    IAIMutex mutex;
+} IAISyncNode;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    IAISyncNode* nodes;
+} IAISyncBucket;
+
+static IAISyncBucket sSyncBuckets[kNumberOfSyncBuckets];
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static IAISyncNode* IAISyncNodeAcquire(uintptr_t object) {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        for (NSUInteger ix = 0; ix < kNumberOfSyncBuckets; ++ix) {
+            pthread_mutex_init(&sSyncBuckets[ix].mutex, NULL);
+        }
+    });
+
+    IAISyncBucket* bucket = &sSyncBuckets[(object >> 4) % kNumberOfSyncBuckets];
+    pthread_mutex_lock(&bucket->mutex);
+
+    IAISyncNode* node = bucket->nodes;
+    IAISyncNode* unusedNode = NULL;
+    for (; NULL != node; node = node->next) {
+        if (node->useCount > 0 && node->object == object) {
+            break;
+        }
+        if (0 == node->useCount && NULL == unusedNode) {
+            unusedNode = node;
+        }
+    }
+    if (NULL == node) {
+        node = unusedNode;
+        if (NULL == node) {
+            node = calloc(1, sizeof(IAISyncNode));
+            if (NULL != node && 0 == IAIMutexInitRecursive(&node->mutex, NULL)) {
+                node->next = bucket->nodes;
+                bucket->nodes = node;
+            } else {
+                free(node);
+                node = NULL;
+            }
+        }
+        if (NULL != node) {
+            node->object = object;
+        }
+    }
+    if (NULL != node) {
+        ++node->useCount;
+    }
+
+    pthread_mutex_unlock(&bucket->mutex);
+    return node;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAISyncNodeRelease(IAISyncNode* node) {
+    IAISyncBucket* bucket = &sSyncBuckets[(node->object >> 4) % kNumberOfSyncBuckets];
+    pthread_mutex_lock(&bucket->mutex);
+    --node->useCount;
+    pthread_mutex_unlock(&bucket->mutex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAISynchronizedAtSite(id object, IAILockSite* site, void (^block)(void)) {
+    IAISyncNode* node = IAISyncNodeAcquire((uintptr_t)(__bridge void *)object);
+    if (NULL == node) {
+        // Out of memory for a lock of our own; @synchronized still works, just not measured.
+        @synchronized(object) {
+            block();
+        }
+        return;
+    }
+
+    IAIMutexLockAtSite(&node->mutex, site);
+    @try {
+        block();
+    }
+    @finally {
+        IAIMutexUnlock(&node->mutex);
+        IAISyncNodeRelease(node);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static NSTimeInterval IAISecondsFromNanoseconds(uint64_t nanoseconds) {
+    return (NSTimeInterval)nanoseconds / NSEC_PER_SEC;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@interface IAILockSiteSummary()
+
+- (id)initWithStatistics:(const IAILockSiteStatistics *)statistics;
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAILockSiteSummary
+
+@synthesize name = _name;
+@synthesize numberOfAcquisitions = _numberOfAcquisitions;
+@synthesize numberOfContentions = _numberOfContentions;
+@synthesize totalWaitTime = _totalWaitTime;
+@synthesize medianWaitTime = _medianWaitTime;
+@synthesize p99WaitTime = _p99WaitTime;
+@synthesize maximumWaitTime = _maximumWaitTime;
+@synthesize medianHoldTime = _medianHoldTime;
+@synthesize p99HoldTime = _p99HoldTime;
+@synthesize maximumHoldTime = _maximumHoldTime;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithStatistics:(const IAILockSiteStatistics *)statistics {
+    if ((self = [super init])) {
+        _name = [[NSString alloc] initWithUTF8String:statistics->name];
+        _numberOfAcquisitions = statistics->numberOfAcquisitions;
+        _numberOfContentions = statistics->numberOfContentions;
+
+        const IAIHistogram* waitTimes = &statistics->waitTimes;
+        const IAIHistogram* holdTimes = &statistics->holdTimes;
+        _totalWaitTime = IAISecondsFromNanoseconds(waitTimes->sum);
+        _medianWaitTime = IAISecondsFromNanoseconds(IAIHistogramValueAtPercentile(waitTimes, 50));
+        _p99WaitTime = IAISecondsFromNanoseconds(IAIHistogramValueAtPercentile(waitTimes, 99));
+        _maximumWaitTime = IAISecondsFromNanoseconds(waitTimes->max);
+        _medianHoldTime = IAISecondsFromNanoseconds(IAIHistogramValueAtPercentile(holdTimes, 50));
+        _p99HoldTime = IAISecondsFromNanoseconds(IAIHistogramValueAtPercentile(holdTimes, 99));
+        _maximumHoldTime = IAISecondsFromNanoseconds(holdTimes->max);
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@ %@ %llu/%llu contended, %.6fs waited>",
+            NSStringFromClass([self class]), _name, _numberOfContentions, _numberOfAcquisitions,
+            _totalWaitTime];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (double)contentionRate {
+    return ((0 == _numberOfAcquisitions)
+            ? 0
+            : (double)_numberOfContentions / (double)_numberOfAcquisitions);
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAILockMonitor
+
+@synthesize siteSummaries = _siteSummaries;
+@synthesize contentionsPerSecond = _contentionsPerSecond;
+@synthesize waitTimePerSecond = _waitTimePerSecond;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithLogger:(IAILogger *)logger {
+    if ((self = [super init])) {
+        _logger = logger;
+        _siteSummaries = [NSArray array];
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)update {
+    // The main thread's own measurements would otherwise wait for its next lock.
+    IAILockProfilerFlushCurrentThread();
+
+    unsigned numberOfSites = IAILockProfilerNumberOfSites();
+    NSMutableArray* summaries = [NSMutableArray arrayWithCapacity:numberOfSites];
+    unsigned long long numberOfContentions = 0;
+    NSTimeInterval totalWaitTime = 0;
+    for (unsigned ix = 0; ix < numberOfSites; ++ix) {
+        IAILockSiteStatistics statistics;
+        if (IAILockProfilerReadSite(ix, &statistics)) {
+            IAILockSiteSummary* summary =
+            [[IAILockSiteSummary alloc] initWithStatistics:&statistics];
+            [summaries addObject:summary];
+            numberOfContentions += summary.numberOfContentions;
+            totalWaitTime += summary.totalWaitTime;
+        }
+    }
+    [summaries sortUsingComparator:^NSComparisonResult(IAILockSiteSummary* summary1,
+                                                       IAILockSiteSummary* summary2) {
+        if (summary1.totalWaitTime != summary2.totalWaitTime) {
+            return (summary1.totalWaitTime > summary2.totalWaitTime
+                    ? NSOrderedAscending : NSOrderedDescending);
+        }
+        if (summary1.numberOfContentions != summary2.numberOfContentions) {
+            return (summary1.numberOfContentions > summary2.numberOfContentions
+                    ? NSOrderedAscending : NSOrderedDescending);
+        }
+        return [summary1.name compare:summary2.name];
+    }];
+    _siteSummaries = [summaries copy];
+
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+
+    // The first update only sets the baseline of the rates.
+    if (_lastUpdateTime > 0 && now > _lastUpdateTime) {
+        NSTimeInterval elapsed = now - _lastUpdateTime;
+        _contentionsPerSecond = (double)(numberOfContentions - _lastNumberOfContentions) / elapsed;
+        _waitTimePerSecond = (totalWaitTime - _lastTotalWaitTime) / elapsed;
+
+        IAILogger* logger = _logger;
+        [logger addMetricValue:_contentionsPerSecond forName:IAIMetricLockContentionsPerSecond];
+        [logger addMetricValue:_waitTimePerSecond forName:IAIMetricLockWaitTimePerSecond];
+    }
+    _lastUpdateTime = now;
+    _lastNumberOfContentions = numberOfContentions;
+    _lastTotalWaitTime = totalWaitTime;
+}
+
+
+@end
@@ -0,0 +1,407 @@
+//
+//  IAILockProfiler.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#include "IAILockProfiler.h"
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__APPLE__)
+#include <libkern/OSAtomic.h>
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#define OSSpinLockTry(lock) (0 == __sync_lock_test_and_set((lock), 1))
+#define OSSpinLockUnlock(lock) __sync_lock_release(lock)
+#define OSMemoryBarrier() __sync_synchronize()
+#endif
+
+// Flags of a measurement.
+enum {
+    IAILockEventWasContended = 1 << 0,
+    IAILockEventHasHoldTime  = 1 << 1,
+};
+
+typedef struct {
+    uint32_t siteIndex;
+    uint32_t flags;
+    uint64_t waitTime;
+    uint64_t holdTime;
+} IAILockEvent;
+
+typedef struct {
+    unsigned count;
+    uint64_t firstEventTime;
+    IAILockEvent events[IAILockEventBufferSize];
+} IAILockThreadBuffer;
+
+static pthread_mutex_t sMutex = PTHREAD_MUTEX_INITIALIZER;
+static IAILockSiteStatistics* sStatistics[IAILockMaxSites];
+static volatile unsigned sNumberOfSites = 0;
+
+static pthread_key_t sThreadBufferKey;
+static pthread_once_t sThreadBufferKeyOnce = PTHREAD_ONCE_INIT;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static uint64_t IAILockNow(void) {
+#if defined(__APPLE__)
+    static mach_timebase_info_data_t sTimebase;
+    if (0 == sTimebase.denom) {
+        mach_timebase_info(&sTimebase);
+    }
+    return mach_absolute_time() * sTimebase.numer / sTimebase.denom;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+#endif
+}
+
+
+#pragma mark - Sites
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Numbers a site on its first use. Sites beyond IAILockMaxSites get IAILockMaxSites and are
+// never recorded.
+static uint32_t IAILockSiteRegister(IAILockSite* site) {
+    pthread_mutex_lock(&sMutex);
+    if (site->index < 0) {
+        int32_t index = IAILockMaxSites;
+        if (sNumberOfSites < IAILockMaxSites) {
+            IAILockSiteStatistics* statistics = calloc(1, sizeof(IAILockSiteStatistics));
+            if (NULL != statistics) {
+                statistics->name = site->name;
+                index = (int32_t)sNumberOfSites;
+                sStatistics[index] = statistics;
+                sNumberOfSites = (unsigned)index + 1;
+            }
+        }
+        // Publish the index only once the site's statistics are in place.
+        OSMemoryBarrier();
+        site->index = index;
+    }
+    pthread_mutex_unlock(&sMutex);
+    return (uint32_t)site->index;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned IAILockProfilerNumberOfSites(void) {
+    return sNumberOfSites;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAILockProfilerReadSite(unsigned index, IAILockSiteStatistics* statistics) {
+    int found = 0;
+    pthread_mutex_lock(&sMutex);
+    if (index < sNumberOfSites) {
+        memcpy(statistics, sStatistics[index], sizeof(*statistics));
+        found = 1;
+    }
+    pthread_mutex_unlock(&sMutex);
+    return found;
+}
+
+
+#pragma mark - Thread Buffers
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAILockThreadBufferFlush(IAILockThreadBuffer* buffer) {
+    if (0 == buffer->count) {
+        return;
+    }
+    pthread_mutex_lock(&sMutex);
+    for (unsigned ix = 0; ix < buffer->count; ++ix) {
+        const IAILockEvent* event = &buffer->events[ix];
+        if (event->siteIndex >= sNumberOfSites) {
+            continue;
+        }
+        IAILockSiteStatistics* statistics = sStatistics[event->siteIndex];
+        ++statistics->numberOfAcquisitions;
+        if (event->flags & IAILockEventWasContended) {
+            ++statistics->numberOfContentions;
+        }
+        IAIHistogramRecord(&statistics->waitTimes, event->waitTime);
+        if (event->flags & IAILockEventHasHoldTime) {
+            IAIHistogramRecord(&statistics->holdTimes, event->holdTime);
+        }
+    }
+    pthread_mutex_unlock(&sMutex);
+    buffer->count = 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAILockThreadBufferDestroy(void* value) {
+    IAILockThreadBuffer* buffer = value;
+    IAILockThreadBufferFlush(buffer);
+    free(buffer);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAILockThreadBufferCreateKey(void) {
+    pthread_key_create(&sThreadBufferKey, IAILockThreadBufferDestroy);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static IAILockThreadBuffer* IAILockThreadBufferGet(void) {
+    pthread_once(&sThreadBufferKeyOnce, IAILockThreadBufferCreateKey);
+    IAILockThreadBuffer* buffer = pthread_getspecific(sThreadBufferKey);
+    if (NULL == buffer) {
+        buffer = calloc(1, sizeof(IAILockThreadBuffer));
+        if (NULL != buffer) {
+            pthread_setspecific(sThreadBufferKey, buffer);
+        }
+    }
+    return buffer;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAILockProfilerFlushCurrentThread(void) {
+    IAILockThreadBuffer* buffer = IAILockThreadBufferGet();
+    if (NULL != buffer) {
+        IAILockThreadBufferFlush(buffer);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Call with no lock held, so that a flush never lengthens a hold.
+static void IAILockRecord(IAILockSite* site, uint32_t flags, uint64_t waitTime,
+                          uint64_t holdTime, uint64_t now) {
+    if (NULL == site) {
+        return;
+    }
+    int32_t index = site->index;
+    if (index < 0) {
+        index = (int32_t)IAILockSiteRegister(site);
+    }
+    if (index >= IAILockMaxSites) {
+        return;
+    }
+
+    IAILockThreadBuffer* buffer = IAILockThreadBufferGet();
+    if (NULL == buffer) {
+        return;
+    }
+    if (0 == buffer->count) {
+        buffer->firstEventTime = now;
+    }
+    IAILockEvent* event = &buffer->events[buffer->count++];
+    event->siteIndex = (uint32_t)index;
+    event->flags = flags;
+    event->waitTime = waitTime;
+    event->holdTime = holdTime;
+
+    if (buffer->count == IAILockEventBufferSize
+        || now - buffer->firstEventTime >= IAILockFlushInterval) {
+        IAILockThreadBufferFlush(buffer);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAILockBeginHold(IAILockHold* hold, IAILockSite* site, uint64_t now,
+                             uint64_t waitTime, int wasContended) {
+    hold->site = site;
+    hold->acquireTime = now;
+    hold->waitTime = waitTime;
+    hold->wasContended = wasContended;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Takes a copy of the hold, which belongs to the next holder as soon as the lock is released.
+static void IAILockRecordHold(IAILockHold hold, uint64_t now) {
+    uint32_t flags = (IAILockEventHasHoldTime
+                      | (hold.wasContended ? (uint32_t)IAILockEventWasContended : 0));
+    IAILockRecord(hold.site, flags, hold.waitTime, now - hold.acquireTime, now);
+}
+
+
+#pragma mark - Mutexes
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static int IAIMutexInitWithType(IAIMutex* mutex, IAILockSite* site, int type) {
+    memset(mutex, 0, sizeof(*mutex));
+    mutex->site = site;
+
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_settype(&attributes, type);
+    int error = pthread_mutex_init(&mutex->mutex, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+    return error;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAIMutexInit(IAIMutex* mutex, IAILockSite* site) {
+    return IAIMutexInitWithType(mutex, site, PTHREAD_MUTEX_NORMAL);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAIMutexInitRecursive(IAIMutex* mutex, IAILockSite* site) {
+    return IAIMutexInitWithType(mutex, site, PTHREAD_MUTEX_RECURSIVE);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIMutexDestroy(IAIMutex* mutex) {
+    pthread_mutex_destroy(&mutex->mutex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIMutexLockAtSite(IAIMutex* mutex, IAILockSite* site) {
+    uint64_t waitTime = 0;
+    int wasContended = (0 != pthread_mutex_trylock(&mutex->mutex));
+    uint64_t now = IAILockNow();
+    if (wasContended) {
+        pthread_mutex_lock(&mutex->mutex);
+        uint64_t startTime = now;
+        now = IAILockNow();
+        waitTime = now - startTime;
+    }
+    if (++mutex->depth == 1) {
+        IAILockBeginHold(&mutex->hold, site, now, waitTime, wasContended);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIMutexLock(IAIMutex* mutex) {
+    IAIMutexLockAtSite(mutex, mutex->site);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAIMutexTryLock(IAIMutex* mutex) {
+    if (0 != pthread_mutex_trylock(&mutex->mutex)) {
+        return 0;
+    }
+    if (++mutex->depth == 1) {
+        IAILockBeginHold(&mutex->hold, mutex->site, IAILockNow(), 0, 0);
+    }
+    return 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIMutexUnlock(IAIMutex* mutex) {
+    if (--mutex->depth > 0) {
+        pthread_mutex_unlock(&mutex->mutex);
+        return;
+    }
+    uint64_t now = IAILockNow();
+    IAILockHold hold = mutex->hold;
+    pthread_mutex_unlock(&mutex->mutex);
+    IAILockRecordHold(hold, now);
+}
+
+
+#pragma mark - Read-Write Locks
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAIRWLockInit(IAIRWLock* lock, IAILockSite* site) {
+    memset(lock, 0, sizeof(*lock));
+    lock->site = site;
+    return pthread_rwlock_init(&lock->rwlock, NULL);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIRWLockDestroy(IAIRWLock* lock) {
+    pthread_rwlock_destroy(&lock->rwlock);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Readers are recorded as soon as they have the lock, since their holds aren't timed.
+void IAIRWLockReadLock(IAIRWLock* lock) {
+    if (0 == pthread_rwlock_tryrdlock(&lock->rwlock)) {
+        IAILockRecord(lock->site, 0, 0, 0, IAILockNow());
+        return;
+    }
+    uint64_t startTime = IAILockNow();
+    pthread_rwlock_rdlock(&lock->rwlock);
+    uint64_t now = IAILockNow();
+    IAILockRecord(lock->site, IAILockEventWasContended, now - startTime, 0, now);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIRWLockWriteLock(IAIRWLock* lock) {
+    uint64_t waitTime = 0;
+    int wasContended = (0 != pthread_rwlock_trywrlock(&lock->rwlock));
+    uint64_t now = IAILockNow();
+    if (wasContended) {
+        pthread_rwlock_wrlock(&lock->rwlock);
+        uint64_t startTime = now;
+        now = IAILockNow();
+        waitTime = now - startTime;
+    }
+    IAILockBeginHold(&lock->hold, lock->site, now, waitTime, wasContended);
+    lock->isWriteLocked = 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// While a writer holds the lock no reader can, so a thread that finds the lock write-locked
+// must be the writer.
+void IAIRWLockUnlock(IAIRWLock* lock) {
+    if (!lock->isWriteLocked) {
+        pthread_rwlock_unlock(&lock->rwlock);
+        return;
+    }
+    lock->isWriteLocked = 0;
+    uint64_t now = IAILockNow();
+    IAILockHold hold = lock->hold;
+    pthread_rwlock_unlock(&lock->rwlock);
+    IAILockRecordHold(hold, now);
+}
+
+
+#pragma mark - Spin Locks
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAISpinLockLock(IAISpinLock* lock) {
+    uint64_t waitTime = 0;
+    int wasContended = !OSSpinLockTry(&lock->lock);
+    uint64_t now = IAILockNow();
+    if (wasContended) {
+        while (!OSSpinLockTry(&lock->lock)) {
+            sched_yield();
+        }
+        uint64_t startTime = now;
+        now = IAILockNow();
+        waitTime = now - startTime;
+    }
+    IAILockBeginHold(&lock->hold, lock->site, now, waitTime, wasContended);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAISpinLockUnlock(IAISpinLock* lock) {
+    uint64_t now = IAILockNow();
+    IAILockHold hold = lock->hold;
+    OSSpinLockUnlock(&lock->lock);
+    IAILockRecordHold(hold, now);
+}
@@ -0,0 +1,175 @@
+//
+//  IAILockProfiler.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#ifndef InAppInstrumentation_IAILockProfiler_h
+#define InAppInstrumentation_IAILockProfiler_h
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "IAIHistogram.h"
+
+/**
+ * Locks that measure how long they are waited for and held.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * IAIMutex, IAIRWLock and IAISpinLock wrap the raw locks of the same kind and charge every
+ * acquisition to a named IAILockSite, which is usually a static variable next to the code that
+ * takes the lock:
+ *
+ * @code
+ *  static IAILockSite sCacheSite = IAILockSiteMake("image cache");
+ *  static IAIMutex sCacheMutex;
+ *  IAIMutexInit(&sCacheMutex, &sCacheSite);
+ *  ...
+ *  IAIMutexLock(&sCacheMutex);
+ *  ...
+ *  IAIMutexUnlock(&sCacheMutex);
+ * @endcode
+ *
+ * Every lock first tries to take the raw lock without blocking. When that succeeds the
+ * acquisition is uncontended and costs a read of the clock on top of the raw lock. Only when
+ * it fails is the clock read again to time the wait. Unlocking reads the clock once more for
+ * the hold time. Nothing is shared between threads on either path: each thread appends its
+ * measurements to a buffer of its own, and adds the buffer to the sites' histograms under a
+ * mutex of the profiler once it holds IAILockEventBufferSize measurements, once it is
+ * IAILockFlushInterval nanoseconds old, and when the thread exits. A thread that stops taking
+ * locks keeps its last measurements to itself until it takes another lock or exits.
+ *
+ * Hold times are measured for exclusive holds only; the readers of an IAIRWLock record their
+ * waits but not how long they read.
+ */
+
+#define IAILockMaxSites 128
+#define IAILockEventBufferSize 128
+
+// Measurements are added to the sites at least this often by a thread that keeps taking locks.
+#define IAILockFlushInterval 100000000ull
+
+typedef struct {
+    const char* name;
+    volatile int32_t index;     // -1 until the site is first used.
+} IAILockSite;
+
+// Initializes a site with a name that must outlive it, usually a string literal.
+#define IAILockSiteMake(name) { (name), -1 }
+
+typedef struct {
+    const char* name;
+    uint64_t numberOfAcquisitions;
+    uint64_t numberOfContentions;   // Acquisitions that had to wait for another thread.
+    IAIHistogram waitTimes;         // In nanoseconds, 0 for uncontended acquisitions.
+    IAIHistogram holdTimes;         // In nanoseconds.
+} IAILockSiteStatistics;
+
+
+// The measurements of the current exclusive hold of a lock. Written by the holder only.
+typedef struct {
+    IAILockSite* site;
+    uint64_t acquireTime;
+    uint64_t waitTime;
+    int wasContended;
+} IAILockHold;
+
+
+#pragma mark Mutexes /** @name Mutexes */
+
+typedef struct {
+    pthread_mutex_t mutex;
+    IAILockSite* site;
+    IAILockHold hold;
+    unsigned depth;             // Greater than 1 while a recursive mutex is held recursively.
+} IAIMutex;
+
+/**
+ * Returns the error of pthread_mutex_init, or 0.
+ */
+int IAIMutexInit(IAIMutex* mutex, IAILockSite* site);
+
+/**
+ * Like IAIMutexInit, but the holder may take the mutex again. Only the outermost hold is timed.
+ */
+int IAIMutexInitRecursive(IAIMutex* mutex, IAILockSite* site);
+
+void IAIMutexDestroy(IAIMutex* mutex);
+
+void IAIMutexLock(IAIMutex* mutex);
+
+/**
+ * Returns 1 if the mutex was taken. A failed attempt is not counted.
+ */
+int IAIMutexTryLock(IAIMutex* mutex);
+
+void IAIMutexUnlock(IAIMutex* mutex);
+
+/**
+ * Locks a mutex that is shared between sites, charging the hold to the given site instead of
+ * the mutex's own. The hold ends with IAIMutexUnlock as usual.
+ */
+void IAIMutexLockAtSite(IAIMutex* mutex, IAILockSite* site);
+
+
+#pragma mark Read-Write Locks /** @name Read-Write Locks */
+
+typedef struct {
+    pthread_rwlock_t rwlock;
+    IAILockSite* site;
+    IAILockHold hold;
+    volatile int isWriteLocked;
+} IAIRWLock;
+
+/**
+ * Returns the error of pthread_rwlock_init, or 0.
+ */
+int IAIRWLockInit(IAIRWLock* lock, IAILockSite* site);
+
+void IAIRWLockDestroy(IAIRWLock* lock);
+
+void IAIRWLockReadLock(IAIRWLock* lock);
+void IAIRWLockWriteLock(IAIRWLock* lock);
+
+/**
+ * Releases a read or write hold, whichever the calling thread has.
+ */
+void IAIRWLockUnlock(IAIRWLock* lock);
+
+
+#pragma mark Spin Locks /** @name Spin Locks */
+
+typedef struct {
+    volatile int32_t lock;
+    IAILockSite* site;
+    IAILockHold hold;
+} IAISpinLock;
+
+#define IAISpinLockMake(site) { 0, (site), { NULL, 0, 0, 0 } }
+
+void IAISpinLockLock(IAISpinLock* lock);
+void IAISpinLockUnlock(IAISpinLock* lock);
+
+
+#pragma mark Reading Sites /** @name Reading Sites */
+
+/**
+ * The number of sites that have been used so far. Sites are numbered in the order of their
+ * first use, and no more than IAILockMaxSites are recorded.
+ */
+unsigned IAILockProfilerNumberOfSites(void);
+
+/**
+ * Copies the statistics of a site. Returns 0 if there is no site with the index.
+ */
+int IAILockProfilerReadSite(unsigned index, IAILockSiteStatistics* statistics);
+
+/**
+ * Adds the calling thread's buffered measurements to the sites.
+ */
+void IAILockProfilerFlushCurrentThread(void);
+
+#endif
@@ -9,13 +9,74 @@
 #import <Foundation/Foundation.h>
 #import <UIKit/UIKit.h>
 #import "IAIDataStructures.h"
+#import "IAIMetricRollup.h"
+#import "IAIShardedLog.h"
+
+#import <pthread.h>
 
 @class IAIDeviceLogEntry;
 @class IAIConsoleLogEntry;
 @class IAIEventLogEntry;
+@class IAIMetricLogEntry;
+@class IAIMetricRollup;
+@class IAIDeviceLogBlockStore;
+@class IAIConsoleLogIndex;
+@class IAILogEntry;
+@class IAILogSnapshot;
 
+/**
+ * Posted on the main thread after a batch of console logs is added and indexed. The object is
+ * the logger, the entries are under the "entries" key of the userInfo, oldest first, and the
+ * line id of the first of them in consoleLogIndex under the "firstLineId" key. The entries of a
+ * batch have consecutive line ids.
+ */
 extern NSString* const IAILoggerDidAddConsoleLog;
 
+/**
+ * Posted on the main thread after a snapshot has recorded the entries after its trigger. The
+ * IAILogSnapshot is under the "snapshot" key of the userInfo.
+ */
+extern NSString* const IAILoggerDidCaptureSnapshot;
+
+/**
+ * The names of the metrics that are rolled up from device log entries.
+ */
+extern NSString* const IAIMetricBytesOfFreeMemory;
+extern NSString* const IAIMetricBytesOfTotalMemory;
+extern NSString* const IAIMetricBytesOfFreeDiskSpace;
+extern NSString* const IAIMetricBytesOfTotalDiskSpace;
+extern NSString* const IAIMetricBatteryLevel;
+
+/**
+ * The name of the rollup that the metrics beyond maximumNumberOfRollups are folded into.
+ */
+extern NSString* const IAIMetricRollupOverflow;
+
+/**
+ * An object that every entry added to a logger is handed to, such as IAITelemetryExporter.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * These methods are called on the thread that added the entry, so they must be quick and must
+ * never block.
+ */
+@protocol IAILogExporter <NSObject>
+- (void)exportDeviceLog:(IAIDeviceLogEntry *)logEntry;
+- (void)exportConsoleLog:(IAIConsoleLogEntry *)logEntry;
+- (void)exportEventLog:(IAIEventLogEntry *)logEntry;
+- (void)exportMetricLog:(IAIMetricLogEntry *)logEntry;
+@end
+
+/**
+ * A source of the current time for a logger, such as the virtual clock of a replay (see
+ * IAIReplaySource).
+ *
+ *      @ingroup Overview-Logger
+ */
+@protocol IAIClock <NSObject>
+- (NSDate *)now;
+@end
+
 /**
  * The Overview logger.
  *
@@ -25,13 +86,75 @@ extern NSString* const IAILoggerDidAddConsoleLog;
  * Overview memory and disk pages, as well as the console log page.
  *
  * The primary log should be accessed by calling [IAI @link IAI::logger logger@endlink].
+ *
+ * <h2>Rollups</h2>
+ *
+ * Raw device and metric entries are only kept for oldestLogAge seconds. As each raw entry is
+ * pruned its values are folded into a set of rollup tiers, each of which keeps the min, max,
+ * mean and last value of a metric over fixed intervals in a ring that grows with the samples.
+ * By default the tiers keep 1 second aggregates for an hour and 1 minute aggregates for a day,
+ * which allows hours of history to be graphed in at most a few hundred kilobytes per metric.
+ * Only the first maximumNumberOfRollups metrics get rollups of their own; the samples of any
+ * other metric are folded into a single IAIMetricRollupOverflow rollup, so the rollups fit a
+ * fixed budget however many metrics the app logs.
+ *
+ * <h2>Compressed Device Logs</h2>
+ *
+ * When compressesDeviceLogs is enabled, device log entries are encoded into sealed blocks of
+ * bit-packed samples (see IAISampleBlockStore) rather than kept as objects. Entries are then
+ * materialized only while deviceLogs is being enumerated.
+ *
+ * <h2>Logging From Multiple Threads</h2>
+ *
+ * Console logs, events and metric samples may be added from any thread. Each thread appends
+ * to its own shard of the log (see IAIShardedLog), so threads never wait on each other to
+ * log. Device logs are only added by the device sampling timer on the main thread.
+ *
+ * <h2>Reading Logs</h2>
+ *
+ * The logs may be read from any thread while entries are being added. objectEnumerator and the
+ * time-range queries return consistent snapshots: they never block the thread adding entries,
+ * never copy the history, and are unaffected by entries that are added or pruned afterward.
+ *
+ * <h2>Triggers</h2>
+ *
+ * Each IAITriggerRule in triggerRules watches a metric or a type of event. When a rule fires,
+ * the logger copies the entries of the preceding preTriggerInterval seconds into a new
+ * IAILogSnapshot, and adds the entries of the following postTriggerInterval seconds on the
+ * first heartbeat or device log after that time. Snapshots are kept regardless of
+ * oldestLogAge, so a spike on a device that has been running for hours can still be looked at
+ * and exported. By default a snapshot is captured around every memory warning.
  */
 @interface IAILogger : NSObject {
 @private
-    IAILinkedList* _deviceLogs;
-    IAILinkedList* _consoleLogs;
-    IAILinkedList* _eventLogs;
+    IAIHistoryList* _deviceLogs;
+    IAIDeviceLogBlockStore* _compressedDeviceLogs;
+    IAIShardedLog* _consoleLogs;
+    IAIShardedLog* _eventLogs;
+    IAIShardedLog* _metricLogs;
     NSTimeInterval _oldestLogAge;
+    NSTimeInterval _oldestConsoleLogAge;
+    IAIConsoleLogIndex* _consoleLogIndex;
+    dispatch_queue_t _consoleLogIndexQueue;
+    pthread_mutex_t _pendingConsoleLogsMutex;
+    NSMutableArray* _pendingConsoleLogs;
+    NSUInteger _maximumNumberOfIndexedConsoleLogs;
+    // Guards _exporters, _triggerRules and _triggerRulesBySeries, which are replaced, never
+    // modified, so that entries can be added from any thread while they are set.
+    pthread_mutex_t _configurationMutex;
+    NSArray* _exporters;
+    id<IAIClock> _clock;
+    volatile int64_t _bytesOfConsoleLogs;
+
+    NSArray* _triggerRules;
+    NSDictionary* _triggerRulesBySeries;
+    NSMutableArray* _snapshots;
+    NSUInteger _maximumNumberOfSnapshots;
+
+    NSArray* _rollupTiers;
+    NSTimeInterval _minimumRollupResolution;
+    NSUInteger _maximumNumberOfRollups;
+    NSMutableDictionary* _rollups;
 }
 
 #pragma mark Configuration Settings /** @name Configuration Settings */
@@ -45,6 +168,124 @@ extern NSString* const IAILoggerDidAddConsoleLog;
  */
 @property (nonatomic, readwrite, assign) NSTimeInterval oldestLogAge;
 
+/**
+ * The oldest age of a console log entry, or 0 to keep every console log.
+ *
+ * Entries are removed from consoleLogs and from consoleLogIndex as they expire.
+ *
+ * By default this is 0.
+ */
+@property (nonatomic, readwrite, assign) NSTimeInterval oldestConsoleLogAge;
+
+/**
+ * The number of console logs that consoleLogIndex keeps, the newest ones.
+ *
+ * The index holds several times the memory of the logs themselves, so it is bounded even when
+ * oldestConsoleLogAge keeps every console log.
+ *
+ * By default this is 10000.
+ */
+@property (nonatomic, readwrite, assign) NSUInteger maximumNumberOfIndexedConsoleLogs;
+
+/**
+ * The rollup tiers that pruned device and metric entries are aggregated into.
+ *
+ * An array of IAIRollupTier objects sorted from the finest resolution to the coarsest. The
+ * tiers are used as templates and are copied for each metric, so changing this only affects
+ * metrics that have not been logged yet.
+ *
+ * By default this is 1 second aggregates for 1 hour and 1 minute aggregates for 24 hours.
+ */
+@property (nonatomic, readwrite, copy) NSArray* rollupTiers;
+
+/**
+ * The finest resolution of the rollup tiers that are kept.
+ *
+ * Raising this frees the finer tiers of every metric, keeping at least the coarsest tier, and
+ * lowering it again gives every metric empty tiers to fill. Used to shed memory under pressure
+ * (see IAIMemoryPressureMonitor).
+ *
+ * By default this is 0, which keeps every tier.
+ */
+@property (nonatomic, readwrite, assign) NSTimeInterval minimumRollupResolution;
+
+/**
+ * The number of metrics that are rolled up on their own.
+ *
+ * The samples of the metrics that are first pruned once this many have rollups are folded into
+ * the IAIMetricRollupOverflow rollup. The device metrics always get rollups of their own, even
+ * beyond this number. Lowering this doesn't free the rollups that exist.
+ *
+ * By default this is 32.
+ */
+@property (nonatomic, readwrite, assign) NSUInteger maximumNumberOfRollups;
+
+/**
+ * Whether device log entries are stored in compressed blocks.
+ *
+ * Compressed entries are pruned a block of 120 samples at a time, so up to a block's worth
+ * of entries may be kept beyond oldestLogAge: a minute at the fastest sampling rate, which at
+ * the default oldestLogAge is about twice the history asked for, and longer once the sampling
+ * has backed off.
+ *
+ * Changing this converts the existing device logs. By default this is NO.
+ */
+@property (nonatomic, readwrite, assign) BOOL compressesDeviceLogs;
+
+/**
+ * The IAILogExporter objects that every added entry is also handed to.
+ *
+ * May be set while entries are being added from other threads. An entry that is being added
+ * while this is set is handed to either the old or the new exporters. By default this is nil.
+ */
+@property (nonatomic, readwrite, copy) NSArray* exporters;
+
+/**
+ * The clock that entries are aged by and metric samples are stamped with, or nil for the
+ * system clock.
+ *
+ * Set this before entries are added. By default this is nil.
+ */
+@property (nonatomic, readwrite, IAI_STRONG) id<IAIClock> clock;
+
+
+#pragma mark Triggers /** @name Triggers */
+
+/**
+ * The IAITriggerRule objects that are evaluated as entries are added.
+ *
+ * May be set while entries are being added from other threads, which evaluate either the old
+ * or the new rules. By default this is a rule for IAIEventDidReceiveMemoryWarning.
+ */
+@property (nonatomic, readwrite, copy) NSArray* triggerRules;
+
+/**
+ * The snapshots that have been captured, oldest first. The most recent ones may not be
+ * complete yet.
+ */
+@property (nonatomic, readonly, copy) NSArray* snapshots;
+
+/**
+ * The number of snapshots to keep. The oldest snapshot is discarded when a new one would
+ * exceed this number.
+ *
+ * By default this is 10.
+ */
+@property (nonatomic, readwrite, assign) NSUInteger maximumNumberOfSnapshots;
+
+/**
+ * Discards every snapshot.
+ */
+- (void)removeAllSnapshots;
+
+/**
+ * Adds the rest of their entries to the snapshots whose postTriggerInterval has passed by the
+ * date, and posts IAILoggerDidCaptureSnapshot for each of them.
+ *
+ * Call this from the main thread once per heartbeat with the current date.
+ */
+- (void)completeSnapshotsAtDate:(NSDate *)date;
+
 
 #pragma mark Adding Log Entries /** @name Adding Log Entries */
 
@@ -58,7 +299,8 @@ extern NSString* const IAILoggerDidAddConsoleLog;
 /**
  * Add a console log.
  *
- * This method will not prune console log entries.
+ * This method will first prune console log entries older than oldestConsoleLogAge and then
+ * add the new entry to the log. The entry is indexed on the main thread.
  */
 - (void)addConsoleLog:(IAIConsoleLogEntry *)logEntry;
 
@@ -69,29 +311,167 @@ extern NSString* const IAILoggerDidAddConsoleLog;
  */
 - (void)addEventLog:(IAIEventLogEntry *)logEntry;
 
+/**
+ * Add a sample of a custom metric.
+ *
+ * This method will first prune expired entries and then add the new entry to the log. Pruned
+ * samples are aggregated into the metric's rollup.
+ */
+- (void)addMetricValue:(double)value forName:(NSString *)name;
+
+/**
+ * Prunes the entries of every log that are older than their retention now, rather than when
+ * the next entry is added.
+ *
+ * Call this from the main thread after lowering oldestLogAge or oldestConsoleLogAge.
+ */
+- (void)pruneExpiredEntries;
+
 
 #pragma mark Accessing Logs /** @name Accessing Logs */
 
 /**
- * The linked list of device logs.
+ * The device logs.
+ *
+ * Either an IAIHistoryList or, when compressesDeviceLogs is enabled, an IAIDeviceLogBlockStore.
+ * Use objectEnumerator to read a snapshot of every entry.
+ *
+ * Log entries are in increasing chronological order.
+ */
+@property (nonatomic, readonly, IAI_STRONG) id<IAILogCollection> deviceLogs;
+
+/**
+ * The console logs.
  *
  * Log entries are in increasing chronological order.
  */
-@property (nonatomic, readonly, IAI_STRONG) IAILinkedList* deviceLogs;
+@property (nonatomic, readonly, IAI_STRONG) IAIShardedLog* consoleLogs;
 
 /**
- * The linked list of console logs.
+ * The events.
  *
  * Log entries are in increasing chronological order.
  */
-@property (nonatomic, readonly, IAI_STRONG) IAILinkedList* consoleLogs;
+@property (nonatomic, readonly, IAI_STRONG) IAIShardedLog* eventLogs;
 
 /**
- * The linked list of events.
+ * The raw custom metric samples.
  *
  * Log entries are in increasing chronological order.
  */
-@property (nonatomic, readonly, IAI_STRONG) IAILinkedList* eventLogs;
+@property (nonatomic, readonly, IAI_STRONG) IAIShardedLog* metricLogs;
+
+
+/**
+ * The approximate number of bytes held by the console log entries, including their text.
+ */
+@property (nonatomic, readonly, assign) unsigned long long bytesOfConsoleLogs;
+
+
+#pragma mark Querying Logs by Time /** @name Querying Logs by Time */
+
+/**
+ * The device logs with timestamps in [fromDate, toDate].
+ *
+ * Entries are appended in chronological order, so the range is found with a binary search.
+ *
+ *      Run-time: O(log(count) + number of entries in the range)
+ */
+- (IAIHistoryRange *)deviceLogsFromDate:(NSDate *)fromDate toDate:(NSDate *)toDate;
+
+/**
+ * The console logs with timestamps in [fromDate, toDate].
+ *
+ *      Run-time: O(log(count))
+ */
+- (IAIHistoryRange *)consoleLogsFromDate:(NSDate *)fromDate toDate:(NSDate *)toDate;
+
+/**
+ * The events with timestamps in [fromDate, toDate].
+ *
+ *      Run-time: O(log(count))
+ */
+- (IAIHistoryRange *)eventLogsFromDate:(NSDate *)fromDate toDate:(NSDate *)toDate;
+
+/**
+ * The raw custom metric samples with timestamps in [fromDate, toDate].
+ *
+ *      Run-time: O(log(count))
+ */
+- (IAIHistoryRange *)metricLogsFromDate:(NSDate *)fromDate toDate:(NSDate *)toDate;
+
+/**
+ * The raw samples of one metric with timestamps in [fromDate, toDate], oldest first.
+ *
+ * The range is found with a binary search and then filtered by name, so graphs that only
+ * need the samples since the last time they asked stay cheap as the log grows.
+ *
+ *      Run-time: O(log(count) + number of entries in the range)
+ */
+- (NSArray *)metricLogsNamed: (NSString *)name
+                    fromDate: (NSDate *)fromDate
+                      toDate: (NSDate *)toDate;
+
+/**
+ * The console logs within the given number of seconds on either side of an entry.
+ *
+ * For example, the console lines around a memory warning event:
+ *
+ * @code
+ *  IAIHistoryRange* lines = [logger consoleLogsAroundEntry:memoryWarning timeInterval:2];
+ * @endcode
+ */
+- (IAIHistoryRange *)consoleLogsAroundEntry: (IAILogEntry *)logEntry
+                               timeInterval: (NSTimeInterval)timeInterval;
+
+#pragma mark Searching Console Logs /** @name Searching Console Logs */
+
+/**
+ * A full-text index of the console logs.
+ *
+ * Entries are indexed in batches on a private serial queue, so indexing never slows down the
+ * thread that is logging, and a burst of logging costs one hop to that queue and one
+ * IAILoggerDidAddConsoleLog notification on the main thread. Entries are removed from the index
+ * as they expire and beyond maximumNumberOfIndexedConsoleLogs. The index must only be used
+ * from readConsoleLogIndexUsingBlock:.
+ */
+@property (nonatomic, readonly, IAI_STRONG) IAIConsoleLogIndex* consoleLogIndex;
+
+/**
+ * Calls the block with consoleLogIndex on the queue that indexes the console logs, and waits
+ * for it to return.
+ */
+- (void)readConsoleLogIndexUsingBlock:(void (^)(IAIConsoleLogIndex* index))block;
+
+#pragma mark Accessing Rollups /** @name Accessing Rollups */
+
+/**
+ * The aggregated history of the metric with the given name, or nil if no samples of the
+ * metric have been pruned yet.
+ *
+ * Rollups are updated by whichever thread prunes entries. Use
+ * enumerateRollupForMetric:fromDate:toDate:usingBlock: to read them safely from any thread.
+ */
+- (IAIMetricRollup *)rollupForMetric:(NSString *)name;
+
+/**
+ * The number of bytes held by the rollups of every metric.
+ */
+@property (nonatomic, readonly, assign) unsigned long long bytesOfRollups;
+
+/**
+ * Enumerates the aggregated history of a metric between two dates.
+ *
+ * The finest rollup tier that still reaches back to fromDate is used, so short spans are
+ * returned at a high resolution and long spans at a low resolution. Buckets are enumerated in
+ * increasing chronological order. Entries that are still in the raw logs are not included.
+ *
+ * The block is called while the rollups are locked, so it should not log.
+ */
+- (void)enumerateRollupForMetric: (NSString *)name
+                        fromDate: (NSDate *)fromDate
+                          toDate: (NSDate *)toDate
+                      usingBlock: (void (^)(IAIRollupBucket bucket, BOOL* stop))block;
 
 @end
 
@@ -131,8 +511,18 @@ extern NSString* const IAILoggerDidAddConsoleLog;
  *
  *      @ingroup Overview-Logger-Entries
  */
+typedef enum {
+    IAIDeviceMetricFreeMemory = 1 << 0,
+    IAIDeviceMetricTotalMemory = 1 << 1,
+    IAIDeviceMetricFreeDiskSpace = 1 << 2,
+    IAIDeviceMetricTotalDiskSpace = 1 << 3,
+    IAIDeviceMetricBattery = 1 << 4,
+    IAIDeviceMetricAll = (1 << 5) - 1,
+} IAIDeviceMetrics;
+
 @interface IAIDeviceLogEntry : IAILogEntry {
 @private
+    IAIDeviceMetrics _sampledMetrics;
     unsigned long long _bytesOfFreeMemory;
     unsigned long long _bytesOfTotalMemory;
     unsigned long long _bytesOfTotalDiskSpace;
@@ -174,23 +564,53 @@ extern NSString* const IAILoggerDidAddConsoleLog;
  */
 @property (nonatomic, readwrite, assign) UIDeviceBatteryState batteryState;
 
+/**
+ * The metrics that were read for this entry. The others were carried forward from an earlier
+ * entry (see IAISamplingScheduler), so they are drawn but neither rolled up nor evaluated by
+ * trigger rules a second time.
+ *
+ * By default this is IAIDeviceMetricAll.
+ */
+@property (nonatomic, readwrite, assign) IAIDeviceMetrics sampledMetrics;
+
 @end
 
 
+typedef enum {
+    IAIConsoleLogLevelDebug,
+    IAIConsoleLogLevelInfo,
+    IAIConsoleLogLevelWarning,
+    IAIConsoleLogLevelError,
+} IAIConsoleLogLevel;
+
 /**
  * A console log entry.
  *
  *      @ingroup Overview-Logger-Entries
+ *
+ * The level and tag of an entry are read from the conventional prefixes of the log text:
+ *
+ * @code
+ *  NSLog(@"[Network] Error: request %@ timed out", requestId);   // tag "Network", error
+ *  NSLog(@"WARN: cache is %d%% full", percent);                    // no tag, warning
+ *  NSLog(@"Loaded %d items", count);                               // no tag, info
+ * @endcode
  */
 @interface IAIConsoleLogEntry : IAILogEntry {
 @private
     NSString* _log;
+    IAIConsoleLogLevel _level;
+    NSString* _tag;
+    NSUInteger _repeatCount;
+    NSTimeInterval _lastTimeInterval;
 }
 
 #pragma mark Creating an Entry /** @name Creating an Entry */
 
 /**
  * Designated initializer.
+ *
+ * The level and tag are parsed from the log text.
  */
 - (id)initWithLog:(NSString *)log;
 
@@ -202,11 +622,60 @@ extern NSString* const IAILoggerDidAddConsoleLog;
  */
 @property (nonatomic, readwrite, copy) NSString* log;
 
+/**
+ * The severity of the entry. IAIConsoleLogLevelInfo if the log text does not specify one.
+ */
+@property (nonatomic, readwrite, assign) IAIConsoleLogLevel level;
+
+/**
+ * The bracketed tag at the start of the log text, or nil if there isn't one.
+ */
+@property (nonatomic, readwrite, copy) NSString* tag;
+
+
+#pragma mark Repeated Logs /** @name Repeated Logs */
+
+/**
+ * The number of consecutive times this log was written. 1 unless the log was repeated.
+ *
+ * Repeats of a log are counted on its entry rather than added as new entries. The entry's
+ * timestamp is the time the log was first written and lastTimestamp the time of the most recent
+ * repeat.
+ */
+@property (nonatomic, readonly, assign) NSUInteger repeatCount;
+
+/**
+ * The time at which the log was most recently repeated.
+ */
+@property (nonatomic, readonly, IAI_STRONG) NSDate* lastTimestamp;
+
+/**
+ * Counts another repeat of the log at the given time.
+ *
+ * Only the thread that wrote the log repeats it. Readers on other threads may see a count that
+ * is a few repeats behind.
+ */
+- (void)addRepeatAtTime:(NSTimeInterval)timeIntervalSinceReferenceDate;
+
 @end
 
 
 typedef enum {
     IAIEventDidReceiveMemoryWarning,
+
+    // The phases of the launch, logged once the first frame has been drawn.
+    IAIEventProcessDidStart,        // The kernel started the process.
+    IAIEventDidReachMain,           // The static initializers ran, just before main.
+    IAIEventDidFinishLaunching,     // IAInstrumentation::applicationDidFinishLaunching.
+    IAIEventDidDrawFirstFrame,      // The first frame was committed.
+
+    IAIEventQueueDidSaturate,       // Work piled up on a queue (see IAIQueueMonitor).
+
+    // The logger's histories under memory pressure (see IAIMemoryPressureMonitor).
+    IAIEventDidShedMemory,          // The value is the number of bytes freed.
+    IAIEventDidRestoreMemory,       // The value is the number of bytes shed since the pressure.
+
+    IAIEventBudgetWasExceeded,      // An IAIBudgetViolationLogEntry (see IAIBudgetMonitor).
 } IAIEventType;
 
 /**
@@ -217,6 +686,7 @@ typedef enum {
 @interface IAIEventLogEntry : IAILogEntry {
 @private
     NSInteger _eventType;
+    double _value;
 }
 
 #pragma mark Creating an Entry /** @name Creating an Entry */
@@ -224,6 +694,11 @@ typedef enum {
 /**
  * Designated initializer.
  */
+- (id)initWithType:(NSInteger)type value:(double)value;
+
+/**
+ * An event without a value.
+ */
 - (id)initWithType:(NSInteger)type;
 
 
@@ -234,4 +709,44 @@ typedef enum {
  */
 @property (nonatomic, readwrite, assign) NSInteger type;
 
+/**
+ * A measurement that goes with the event, such as the number of bytes shed. Most events have
+ * none and leave it 0.
+ */
+@property (nonatomic, readwrite, assign) double value;
+
+@end
+
+
+/**
+ * A sample of a custom metric.
+ *
+ *      @ingroup Overview-Logger-Entries
+ */
+@interface IAIMetricLogEntry : IAILogEntry {
+@private
+    NSString* _name;
+    double _value;
+}
+
+#pragma mark Creating an Entry /** @name Creating an Entry */
+
+/**
+ * Designated initializer.
+ */
+- (id)initWithName:(NSString *)name value:(double)value;
+
+
+#pragma mark Entry Information /** @name Entry Information */
+
+/**
+ * The name of the metric.
+ */
+@property (nonatomic, readwrite, copy) NSString* name;
+
+/**
+ * The value of the metric.
+ */
+@property (nonatomic, readwrite, assign) double value;
+
 @end
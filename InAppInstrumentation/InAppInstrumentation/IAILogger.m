@@ -8,11 +8,45 @@
 
 #import "IAILogger.h"
 
+#import "IAISampleBlockStore.h"
+#import "IAIConsoleLogIndex.h"
+#import "IAIOverhead.h"
+#import "IAITriggerRule.h"
+
+#import <libkern/OSAtomic.h>
+#import <objc/runtime.h>
+
 #if !defined(__has_feature) || !__has_feature(objc_arc)
 #error "Nimbus requires ARC support."
 #endif
 
 NSString* const IAILoggerDidAddConsoleLog = @"IAIOverviewLoggerDidAddConsoleLog";
+NSString* const IAILoggerDidCaptureSnapshot = @"IAIOverviewLoggerDidCaptureSnapshot";
+
+NSString* const IAIMetricBytesOfFreeMemory = @"bytesOfFreeMemory";
+NSString* const IAIMetricBytesOfTotalMemory = @"bytesOfTotalMemory";
+NSString* const IAIMetricBytesOfFreeDiskSpace = @"bytesOfFreeDiskSpace";
+NSString* const IAIMetricBytesOfTotalDiskSpace = @"bytesOfTotalDiskSpace";
+NSString* const IAIMetricBatteryLevel = @"batteryLevel";
+NSString* const IAIMetricRollupOverflow = @"(other metrics)";
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static BOOL IAIIsDeviceMetric(NSString* name) {
+    return ([name isEqualToString:IAIMetricBytesOfFreeMemory]
+            || [name isEqualToString:IAIMetricBytesOfTotalMemory]
+            || [name isEqualToString:IAIMetricBytesOfFreeDiskSpace]
+            || [name isEqualToString:IAIMetricBytesOfTotalDiskSpace]
+            || [name isEqualToString:IAIMetricBatteryLevel]);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The entry, its timestamp and its text.
+static int64_t IAIBytesOfConsoleLogEntry(IAIConsoleLogEntry* entry) {
+    return (int64_t)(class_getInstanceSize([IAIConsoleLogEntry class]) + 16
+                     + 16 + [entry.log length] * sizeof(unichar));
+}
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -20,58 +54,742 @@ NSString* const IAILoggerDidAddConsoleLog = @"IAIOverviewLoggerDidAddConsoleLog"
 @implementation IAILogger
 
 @synthesize oldestLogAge = _oldestLogAge;
-@synthesize deviceLogs = _deviceLogs;
+@synthesize oldestConsoleLogAge = _oldestConsoleLogAge;
+@synthesize consoleLogIndex = _consoleLogIndex;
+@synthesize maximumNumberOfIndexedConsoleLogs = _maximumNumberOfIndexedConsoleLogs;
+@synthesize exporters = _exporters;
+@synthesize clock = _clock;
 @synthesize consoleLogs = _consoleLogs;
 @synthesize eventLogs = _eventLogs;
+@synthesize metricLogs = _metricLogs;
+@synthesize rollupTiers = _rollupTiers;
+@synthesize minimumRollupResolution = _minimumRollupResolution;
+@synthesize maximumNumberOfRollups = _maximumNumberOfRollups;
+@synthesize triggerRules = _triggerRules;
+@synthesize maximumNumberOfSnapshots = _maximumNumberOfSnapshots;
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 - (id)init {
     if ((self = [super init])) {
-        _deviceLogs = [[IAILinkedList alloc] init];
-        _consoleLogs = [[IAILinkedList alloc] init];
-        _eventLogs = [[IAILinkedList alloc] init];
+        _deviceLogs = [[IAIHistoryList alloc] init];
+        _consoleLogs = [[IAIShardedLog alloc] init];
+        _eventLogs = [[IAIShardedLog alloc] init];
+        _metricLogs = [[IAIShardedLog alloc] init];
+        _consoleLogIndex = [[IAIConsoleLogIndex alloc] init];
+        _consoleLogIndexQueue = dispatch_queue_create("com.overview.consoleLogIndex",
+                                                      DISPATCH_QUEUE_SERIAL);
+        pthread_mutex_init(&_pendingConsoleLogsMutex, NULL);
+        pthread_mutex_init(&_configurationMutex, NULL);
+        _pendingConsoleLogs = [[NSMutableArray alloc] init];
+        _maximumNumberOfIndexedConsoleLogs = 10000;
         
         _oldestLogAge = 60;
+        
+        _rollupTiers = [NSArray arrayWithObjects:
+                        [[IAIRollupTier alloc] initWithResolution:1 retention:60 * 60],
+                        [[IAIRollupTier alloc] initWithResolution:60 retention:24 * 60 * 60],
+                        nil];
+        _maximumNumberOfRollups = 32;
+        _rollups = [[NSMutableDictionary alloc] init];
+        
+        _snapshots = [[NSMutableArray alloc] init];
+        _maximumNumberOfSnapshots = 10;
+        self.triggerRules = [NSArray arrayWithObject:
+                             [IAITriggerRule ruleWithEventType:IAIEventDidReceiveMemoryWarning]];
     }
     return self;
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-- (void)pruneEntriesFromLinkedList:(IAILinkedList *)ll {
-    NSDate* cutoffDate = [NSDate dateWithTimeIntervalSinceNow:-_oldestLogAge];
+- (void)dealloc {
+    pthread_mutex_destroy(&_pendingConsoleLogsMutex);
+    pthread_mutex_destroy(&_configurationMutex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSArray *)exporters {
+    pthread_mutex_lock(&_configurationMutex);
+    NSArray* exporters = _exporters;
+    pthread_mutex_unlock(&_configurationMutex);
+    return exporters;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)setExporters:(NSArray *)exporters {
+    NSArray* copiedExporters = [exporters copy];
+    pthread_mutex_lock(&_configurationMutex);
+    _exporters = copiedExporters;
+    pthread_mutex_unlock(&_configurationMutex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSDate *)dateWithTimeIntervalSinceNow:(NSTimeInterval)interval {
+    return ((nil != _clock)
+            ? [[_clock now] dateByAddingTimeInterval:interval]
+            : [NSDate dateWithTimeIntervalSinceNow:interval]);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The rollup tiers no finer than minimumRollupResolution. Call with the rollups locked.
+- (NSArray *)keptRollupTiers {
+    NSMutableArray* tiers = [NSMutableArray arrayWithCapacity:[_rollupTiers count]];
+    for (IAIRollupTier* tier in _rollupTiers) {
+        if (tier.resolution >= _minimumRollupResolution) {
+            [tiers addObject:tier];
+        }
+    }
+    if (0 == [tiers count] && nil != [_rollupTiers lastObject]) {
+        [tiers addObject:[_rollupTiers lastObject]];
+    }
+    return tiers;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)setMinimumRollupResolution:(NSTimeInterval)minimumRollupResolution {
+    @synchronized(_rollups) {
+        _minimumRollupResolution = minimumRollupResolution;
+        
+        NSArray* tiers = [self keptRollupTiers];
+        for (IAIMetricRollup* rollup in [_rollups objectEnumerator]) {
+            rollup.tiers = tiers;
+        }
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)rollUpValue:(double)value forMetric:(NSString *)name atTime:(NSTimeInterval)time {
+    // Entries are pruned by whichever thread logs next, so the rollups are shared between
+    // threads. This lock is only taken once per entry, when it expires.
+    @synchronized(_rollups) {
+        IAIMetricRollup* rollup = [_rollups objectForKey:name];
+        if (nil == rollup) {
+            // The device metrics are graphed by the Overview, so they never overflow.
+            NSUInteger numberOfRollups = [_rollups count];
+            if (nil != [_rollups objectForKey:IAIMetricRollupOverflow]) {
+                --numberOfRollups;
+            }
+            if (numberOfRollups >= _maximumNumberOfRollups && !IAIIsDeviceMetric(name)) {
+                name = IAIMetricRollupOverflow;
+                rollup = [_rollups objectForKey:name];
+            }
+        }
+        if (nil == rollup) {
+            rollup = [[IAIMetricRollup alloc] initWithTiers:[self keptRollupTiers]];
+            [_rollups setObject:rollup forKey:name];
+        }
+        [rollup addValue:value atTime:time];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)rollUpEntry:(IAILogEntry *)entry {
+    NSTimeInterval time = [entry.timestamp timeIntervalSinceReferenceDate];
+    
+    if ([entry isKindOfClass:[IAIDeviceLogEntry class]]) {
+        // Values that were carried forward were rolled up with the entry that read them.
+        IAIDeviceLogEntry* deviceEntry = (IAIDeviceLogEntry *)entry;
+        IAIDeviceMetrics sampledMetrics = deviceEntry.sampledMetrics;
+        if (sampledMetrics & IAIDeviceMetricFreeMemory) {
+            [self rollUpValue: (double)deviceEntry.bytesOfFreeMemory
+                    forMetric: IAIMetricBytesOfFreeMemory
+                       atTime: time];
+        }
+        if (sampledMetrics & IAIDeviceMetricTotalMemory) {
+            [self rollUpValue: (double)deviceEntry.bytesOfTotalMemory
+                    forMetric: IAIMetricBytesOfTotalMemory
+                       atTime: time];
+        }
+        if (sampledMetrics & IAIDeviceMetricFreeDiskSpace) {
+            [self rollUpValue: (double)deviceEntry.bytesOfFreeDiskSpace
+                    forMetric: IAIMetricBytesOfFreeDiskSpace
+                       atTime: time];
+        }
+        if (sampledMetrics & IAIDeviceMetricTotalDiskSpace) {
+            [self rollUpValue: (double)deviceEntry.bytesOfTotalDiskSpace
+                    forMetric: IAIMetricBytesOfTotalDiskSpace
+                       atTime: time];
+        }
+        if (sampledMetrics & IAIDeviceMetricBattery) {
+            [self rollUpValue: (double)deviceEntry.batteryLevel
+                    forMetric: IAIMetricBatteryLevel
+                       atTime: time];
+        }
+        
+    } else if ([entry isKindOfClass:[IAIMetricLogEntry class]]) {
+        IAIMetricLogEntry* metricEntry = (IAIMetricLogEntry *)entry;
+        [self rollUpValue:metricEntry.value forMetric:metricEntry.name atTime:time];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)pruneEntriesFromList:(IAIHistoryList *)ll {
+    IAIOverheadSection section;
+    IAIOverheadBeginSection(&section, IAIOverheadPruning);
+    
+    NSDate* cutoffDate = [self dateWithTimeIntervalSinceNow:-_oldestLogAge];
     while ([[((IAILogEntry *)[ll firstObject])
              timestamp] compare:cutoffDate] == NSOrderedAscending) {
+        [self rollUpEntry:[ll firstObject]];
         [ll removeFirstObject];
     }
+    
+    IAIOverheadEndSection(&section);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)pruneEntriesFromShardedLog:(IAIShardedLog *)log {
+    IAIOverheadSection section;
+    IAIOverheadBeginSection(&section, IAIOverheadPruning);
+    
+    [log removeEntriesBeforeDate: [self dateWithTimeIntervalSinceNow:-_oldestLogAge]
+                      usingBlock: ^(IAILogEntry* prunedEntry) {
+                          [self rollUpEntry:prunedEntry];
+                      }];
+    
+    IAIOverheadEndSection(&section);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)pruneDeviceLogs {
+    if (nil != _compressedDeviceLogs) {
+        IAIOverheadSection section;
+        IAIOverheadBeginSection(&section, IAIOverheadPruning);
+        [_compressedDeviceLogs removeEntriesBeforeDate: [self dateWithTimeIntervalSinceNow:
+                                                         -_oldestLogAge]
+                                            usingBlock: ^(IAIDeviceLogEntry* prunedEntry) {
+                                                [self rollUpEntry:prunedEntry];
+                                            }];
+        IAIOverheadEndSection(&section);
+        
+    } else {
+        [self pruneEntriesFromList:_deviceLogs];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)pruneConsoleLogs {
+    if (_oldestConsoleLogAge <= 0) {
+        return;
+    }
+    IAIOverheadSection section;
+    IAIOverheadBeginSection(&section, IAIOverheadPruning);
+    [_consoleLogs removeEntriesBeforeDate: [self dateWithTimeIntervalSinceNow:
+                                            -_oldestConsoleLogAge]
+                               usingBlock: ^(IAILogEntry* prunedEntry) {
+                                   OSAtomicAdd64Barrier(-IAIBytesOfConsoleLogEntry(
+                                                         (IAIConsoleLogEntry *)prunedEntry),
+                                                        &_bytesOfConsoleLogs);
+                               }];
+    IAIOverheadEndSection(&section);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)pruneExpiredEntries {
+    [self pruneDeviceLogs];
+    [self pruneConsoleLogs];
+    [self pruneEntriesFromShardedLog:_eventLogs];
+    [self pruneEntriesFromShardedLog:_metricLogs];
+    
+    if (_oldestConsoleLogAge > 0) {
+        dispatch_async(_consoleLogIndexQueue, ^{
+            [self trimConsoleLogIndex];
+        });
+    }
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 - (void)addDeviceLog:(IAIDeviceLogEntry *)logEntry {
-    [self pruneEntriesFromLinkedList:_deviceLogs];
+    IAIOverheadSection section;
+    IAIOverheadBeginSection(&section, IAIOverheadLogging);
+    
+    for (id<IAILogExporter> exporter in self.exporters) {
+        [exporter exportDeviceLog:logEntry];
+    }
+    
+    [self pruneDeviceLogs];
+    if (nil != _compressedDeviceLogs) {
+        [_compressedDeviceLogs addDeviceLog:logEntry];
+        
+    } else {
+        [_deviceLogs addObject:logEntry];
+    }
+    
+    NSDictionary* triggerRulesBySeries = [self triggerRulesBySeries];
+    if (nil != triggerRulesBySeries) {
+        // A carried forward value would count as another sample of the same reading.
+        NSDate* date = logEntry.timestamp;
+        IAIDeviceMetrics sampledMetrics = logEntry.sampledMetrics;
+        if (sampledMetrics & IAIDeviceMetricFreeMemory) {
+            [self evaluateTriggersForSeries: IAIMetricBytesOfFreeMemory
+                                      value: (double)logEntry.bytesOfFreeMemory
+                                     atDate: date];
+        }
+        if (sampledMetrics & IAIDeviceMetricTotalMemory) {
+            [self evaluateTriggersForSeries: IAIMetricBytesOfTotalMemory
+                                      value: (double)logEntry.bytesOfTotalMemory
+                                     atDate: date];
+        }
+        if (sampledMetrics & IAIDeviceMetricFreeDiskSpace) {
+            [self evaluateTriggersForSeries: IAIMetricBytesOfFreeDiskSpace
+                                      value: (double)logEntry.bytesOfFreeDiskSpace
+                                     atDate: date];
+        }
+        if (sampledMetrics & IAIDeviceMetricTotalDiskSpace) {
+            [self evaluateTriggersForSeries: IAIMetricBytesOfTotalDiskSpace
+                                      value: (double)logEntry.bytesOfTotalDiskSpace
+                                     atDate: date];
+        }
+        if (sampledMetrics & IAIDeviceMetricBattery) {
+            [self evaluateTriggersForSeries: IAIMetricBatteryLevel
+                                      value: (double)logEntry.batteryLevel
+                                     atDate: date];
+        }
+    }
+    // The sampling timer backs off with the overhead, so the heartbeat finishes snapshots too.
+    [self completeSnapshotsAtDate:logEntry.timestamp];
+    
+    IAIOverheadEndSection(&section);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id<IAILogCollection>)deviceLogs {
+    return (nil != _compressedDeviceLogs) ? _compressedDeviceLogs : _deviceLogs;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)compressesDeviceLogs {
+    return (nil != _compressedDeviceLogs);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)setCompressesDeviceLogs:(BOOL)compressesDeviceLogs {
+    if (compressesDeviceLogs == self.compressesDeviceLogs) {
+        return;
+    }
     
-    [_deviceLogs addObject:logEntry];
+    if (compressesDeviceLogs) {
+        // One block per minute of heartbeats.
+        _compressedDeviceLogs = [[IAIDeviceLogBlockStore alloc] initWithSamplesPerBlock:120];
+        for (IAIDeviceLogEntry* entry in _deviceLogs) {
+            [_compressedDeviceLogs addDeviceLog:entry];
+        }
+        [_deviceLogs removeAllObjects];
+        
+    } else {
+        for (IAIDeviceLogEntry* entry in [_compressedDeviceLogs objectEnumerator]) {
+            [_deviceLogs addObject:entry];
+        }
+        _compressedDeviceLogs = nil;
+    }
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 - (void)addConsoleLog:(IAIConsoleLogEntry *)logEntry {
-    [_consoleLogs addObject:logEntry];
+    IAIOverheadSection section;
+    IAIOverheadBeginSection(&section, IAIOverheadLogging);
+    
+    [self pruneConsoleLogs];
+    [_consoleLogs addEntry:logEntry];
+    OSAtomicAdd64Barrier(IAIBytesOfConsoleLogEntry(logEntry), &_bytesOfConsoleLogs);
+    for (id<IAILogExporter> exporter in self.exporters) {
+        [exporter exportConsoleLog:logEntry];
+    }
+    
+    // Only the first entry of a batch schedules the indexing, so the threads that are logging
+    // don't each pay for a hop to the index queue.
+    pthread_mutex_lock(&_pendingConsoleLogsMutex);
+    BOOL isFirstOfBatch = (0 == [_pendingConsoleLogs count]);
+    [_pendingConsoleLogs addObject:logEntry];
+    pthread_mutex_unlock(&_pendingConsoleLogsMutex);
     
-    [[NSNotificationCenter defaultCenter] postNotificationName: IAILoggerDidAddConsoleLog
-                                                        object: nil
-                                                      userInfo:
-     [NSDictionary dictionaryWithObject:logEntry forKey:@"entry"]];
+    if (isFirstOfBatch) {
+        dispatch_async(_consoleLogIndexQueue, ^{
+            [self indexPendingConsoleLogs];
+        });
+    }
+    
+    IAIOverheadEndSection(&section);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Call on _consoleLogIndexQueue.
+- (void)trimConsoleLogIndex {
+    if (_oldestConsoleLogAge > 0) {
+        [_consoleLogIndex removeEntriesBeforeDate:
+         [self dateWithTimeIntervalSinceNow:-_oldestConsoleLogAge]];
+    }
+    [_consoleLogIndex removeEntriesBeyondCount:_maximumNumberOfIndexedConsoleLogs];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Call on _consoleLogIndexQueue.
+- (void)indexPendingConsoleLogs {
+    IAIOverheadSection section;
+    IAIOverheadBeginSection(&section, IAIOverheadLogging);
+    
+    pthread_mutex_lock(&_pendingConsoleLogsMutex);
+    NSArray* entries = _pendingConsoleLogs;
+    _pendingConsoleLogs = [[NSMutableArray alloc] init];
+    pthread_mutex_unlock(&_pendingConsoleLogsMutex);
+    
+    NSUInteger firstLineId = NSNotFound;
+    for (IAIConsoleLogEntry* entry in entries) {
+        NSUInteger lineId = [_consoleLogIndex addEntry:entry];
+        if (NSNotFound == firstLineId) {
+            firstLineId = lineId;
+        }
+    }
+    [self trimConsoleLogIndex];
+    
+    IAIOverheadEndSection(&section);
+    
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [[NSNotificationCenter defaultCenter] postNotificationName: IAILoggerDidAddConsoleLog
+                                                            object: self
+                                                          userInfo:
+         [NSDictionary dictionaryWithObjectsAndKeys:
+          entries, @"entries",
+          [NSNumber numberWithUnsignedInteger:firstLineId], @"firstLineId",
+          nil]];
+    });
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)readConsoleLogIndexUsingBlock:(void (^)(IAIConsoleLogIndex* index))block {
+    dispatch_sync(_consoleLogIndexQueue, ^{
+        block(_consoleLogIndex);
+    });
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (unsigned long long)bytesOfConsoleLogs {
+    return (unsigned long long)OSAtomicAdd64Barrier(0, &_bytesOfConsoleLogs);
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 - (void)addEventLog:(IAIEventLogEntry *)logEntry {
-    [self pruneEntriesFromLinkedList:_eventLogs];
+    IAIOverheadSection section;
+    IAIOverheadBeginSection(&section, IAIOverheadLogging);
+    
+    [self pruneEntriesFromShardedLog:_eventLogs];
+    
+    [_eventLogs addEntry:logEntry];
+    for (id<IAILogExporter> exporter in self.exporters) {
+        [exporter exportEventLog:logEntry];
+    }
+    [self evaluateTriggersForSeries: [NSNumber numberWithInteger:logEntry.type]
+                              value: (double)logEntry.type
+                             atDate: logEntry.timestamp];
+    
+    IAIOverheadEndSection(&section);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)addMetricValue:(double)value forName:(NSString *)name {
+    IAIOverheadSection section;
+    IAIOverheadBeginSection(&section, IAIOverheadLogging);
+    
+    [self pruneEntriesFromShardedLog:_metricLogs];
+    
+    IAIMetricLogEntry* logEntry = [[IAIMetricLogEntry alloc] initWithName:name value:value];
+    if (nil != _clock) {
+        logEntry.timestamp = [_clock now];
+    }
+    [_metricLogs addEntry:logEntry];
+    for (id<IAILogExporter> exporter in self.exporters) {
+        [exporter exportMetricLog:logEntry];
+    }
+    [self evaluateTriggersForSeries:name value:value atDate:logEntry.timestamp];
+    
+    IAIOverheadEndSection(&section);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Triggers
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSArray *)triggerRules {
+    pthread_mutex_lock(&_configurationMutex);
+    NSArray* triggerRules = _triggerRules;
+    pthread_mutex_unlock(&_configurationMutex);
+    return triggerRules;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSDictionary *)triggerRulesBySeries {
+    pthread_mutex_lock(&_configurationMutex);
+    NSDictionary* triggerRulesBySeries = _triggerRulesBySeries;
+    pthread_mutex_unlock(&_configurationMutex);
+    return triggerRulesBySeries;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)setTriggerRules:(NSArray *)triggerRules {
+    NSArray* copiedRules = [triggerRules copy];
+    
+    // Rules are looked up by the metric name or the NSNumber event type that they watch.
+    NSMutableDictionary* rulesBySeries = [NSMutableDictionary dictionary];
+    for (IAITriggerRule* rule in copiedRules) {
+        id series = ((IAITriggerEvent == rule.kind)
+                     ? [NSNumber numberWithInteger:rule.eventType]
+                     : rule.metricName);
+        NSArray* rules = [rulesBySeries objectForKey:series];
+        [rulesBySeries setObject: (nil != rules
+                                   ? [rules arrayByAddingObject:rule]
+                                   : [NSArray arrayWithObject:rule])
+                          forKey: series];
+    }
+    NSDictionary* copiedRulesBySeries = ([rulesBySeries count] > 0) ? [rulesBySeries copy] : nil;
+    
+    pthread_mutex_lock(&_configurationMutex);
+    _triggerRules = copiedRules;
+    _triggerRulesBySeries = copiedRulesBySeries;
+    pthread_mutex_unlock(&_configurationMutex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)evaluateTriggersForSeries:(id)series value:(double)value atDate:(NSDate *)date {
+    NSArray* rules = [[self triggerRulesBySeries] objectForKey:series];
+    for (IAITriggerRule* rule in rules) {
+        // Metrics may be added from any thread.
+        BOOL fires = NO;
+        @synchronized(rule) {
+            fires = [rule shouldFireForValue:value atTime:[date timeIntervalSinceReferenceDate]];
+        }
+        if (fires) {
+            [self captureSnapshotForRule:rule value:value atDate:date];
+        }
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)captureSnapshotForRule:(IAITriggerRule *)rule value:(double)value atDate:(NSDate *)date {
+    IAILogSnapshot* snapshot = [[IAILogSnapshot alloc] initWithRule: rule
+                                                        triggerDate: date
+                                                              value: value];
+    NSDate* fromDate = snapshot.fromDate;
+    snapshot.deviceLogs = [[self deviceLogsFromDate:fromDate toDate:date] allObjects];
+    snapshot.consoleLogs = [[self consoleLogsFromDate:fromDate toDate:date] allObjects];
+    snapshot.eventLogs = [[self eventLogsFromDate:fromDate toDate:date] allObjects];
+    snapshot.metricLogs = [[self metricLogsFromDate:fromDate toDate:date] allObjects];
     
-    [_eventLogs addObject:logEntry];
+    @synchronized(_snapshots) {
+        [_snapshots addObject:snapshot];
+        while ([_snapshots count] > _maximumNumberOfSnapshots) {
+            [_snapshots removeObjectAtIndex:0];
+        }
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The entries of a range that are after the given date.
+static NSArray* IAIEntriesAfterDate(IAIHistoryRange* range, NSDate* date) {
+    NSMutableArray* entries = [NSMutableArray array];
+    for (IAILogEntry* entry in [range objectEnumerator]) {
+        if ([entry.timestamp compare:date] == NSOrderedDescending) {
+            [entries addObject:entry];
+        }
+    }
+    return entries;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)completeSnapshotsAtDate:(NSDate *)date {
+    NSMutableArray* completedSnapshots = nil;
+    @synchronized(_snapshots) {
+        for (IAILogSnapshot* snapshot in _snapshots) {
+            NSDate* toDate = snapshot.toDate;
+            if (snapshot.isComplete || [date compare:toDate] == NSOrderedAscending) {
+                continue;
+            }
+            NSDate* triggerDate = snapshot.triggerDate;
+            snapshot.deviceLogs = [snapshot.deviceLogs arrayByAddingObjectsFromArray:
+                                   IAIEntriesAfterDate([self deviceLogsFromDate: triggerDate
+                                                                         toDate: toDate],
+                                                       triggerDate)];
+            snapshot.consoleLogs = [snapshot.consoleLogs arrayByAddingObjectsFromArray:
+                                    IAIEntriesAfterDate([self consoleLogsFromDate: triggerDate
+                                                                           toDate: toDate],
+                                                        triggerDate)];
+            snapshot.eventLogs = [snapshot.eventLogs arrayByAddingObjectsFromArray:
+                                  IAIEntriesAfterDate([self eventLogsFromDate: triggerDate
+                                                                       toDate: toDate],
+                                                      triggerDate)];
+            snapshot.metricLogs = [snapshot.metricLogs arrayByAddingObjectsFromArray:
+                                   IAIEntriesAfterDate([self metricLogsFromDate: triggerDate
+                                                                         toDate: toDate],
+                                                       triggerDate)];
+            snapshot.complete = YES;
+            
+            if (nil == completedSnapshots) {
+                completedSnapshots = [NSMutableArray array];
+            }
+            [completedSnapshots addObject:snapshot];
+        }
+    }
+    
+    for (IAILogSnapshot* snapshot in completedSnapshots) {
+        void (^notify)(void) = ^{
+            [[NSNotificationCenter defaultCenter]
+             postNotificationName: IAILoggerDidCaptureSnapshot
+                           object: nil
+                         userInfo: [NSDictionary dictionaryWithObject:snapshot
+                                                               forKey:@"snapshot"]];
+        };
+        if ([NSThread isMainThread]) {
+            notify();
+            
+        } else {
+            dispatch_async(dispatch_get_main_queue(), notify);
+        }
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSArray *)snapshots {
+    @synchronized(_snapshots) {
+        return [_snapshots copy];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)removeAllSnapshots {
+    @synchronized(_snapshots) {
+        [_snapshots removeAllObjects];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Querying Logs by Time
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAIHistoryRange *)deviceLogsFromDate:(NSDate *)fromDate toDate:(NSDate *)toDate {
+    if (nil != _compressedDeviceLogs) {
+        return [[IAIHistoryRange alloc] initWithArray:
+                [_compressedDeviceLogs entriesFromDate:fromDate toDate:toDate]];
+    }
+    return [IAIShardedLog entriesInRange: [_deviceLogs snapshot]
+                                fromDate: fromDate
+                                  toDate: toDate];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAIHistoryRange *)consoleLogsFromDate:(NSDate *)fromDate toDate:(NSDate *)toDate {
+    return [_consoleLogs entriesFromDate:fromDate toDate:toDate];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAIHistoryRange *)eventLogsFromDate:(NSDate *)fromDate toDate:(NSDate *)toDate {
+    return [_eventLogs entriesFromDate:fromDate toDate:toDate];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAIHistoryRange *)metricLogsFromDate:(NSDate *)fromDate toDate:(NSDate *)toDate {
+    return [_metricLogs entriesFromDate:fromDate toDate:toDate];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSArray *)metricLogsNamed: (NSString *)name
+                    fromDate: (NSDate *)fromDate
+                      toDate: (NSDate *)toDate {
+    NSMutableArray* entries = [NSMutableArray array];
+    for (IAIMetricLogEntry* entry in [[self metricLogsFromDate:fromDate toDate:toDate]
+                                      objectEnumerator]) {
+        if ([entry.name isEqualToString:name]) {
+            [entries addObject:entry];
+        }
+    }
+    return entries;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAIHistoryRange *)consoleLogsAroundEntry: (IAILogEntry *)logEntry
+                               timeInterval: (NSTimeInterval)timeInterval {
+    return [self consoleLogsFromDate: [logEntry.timestamp dateByAddingTimeInterval:-timeInterval]
+                              toDate: [logEntry.timestamp dateByAddingTimeInterval:timeInterval]];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAIMetricRollup *)rollupForMetric:(NSString *)name {
+    @synchronized(_rollups) {
+        return [_rollups objectForKey:name];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (unsigned long long)bytesOfRollups {
+    unsigned long long bytes = 0;
+    @synchronized(_rollups) {
+        for (IAIMetricRollup* rollup in [_rollups objectEnumerator]) {
+            bytes += rollup.bytesOfStorage;
+        }
+    }
+    return bytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)enumerateRollupForMetric: (NSString *)name
+                        fromDate: (NSDate *)fromDate
+                          toDate: (NSDate *)toDate
+                      usingBlock: (void (^)(IAIRollupBucket bucket, BOOL* stop))block {
+    @synchronized(_rollups) {
+        IAIMetricRollup* rollup = [_rollups objectForKey:name];
+        NSTimeInterval fromTime = [fromDate timeIntervalSinceReferenceDate];
+        NSTimeInterval now = [[self dateWithTimeIntervalSinceNow:0] timeIntervalSinceReferenceDate];
+        IAIRollupTier* tier = [rollup tierReachingBackToTime:fromTime now:now];
+        [tier enumerateBucketsFromTime: fromTime
+                                toTime: [toDate timeIntervalSinceReferenceDate]
+                            usingBlock: block];
+    }
 }
 
 
@@ -90,6 +808,9 @@ NSString* const IAILoggerDidAddConsoleLog = @"IAIOverviewLoggerDidAddConsoleLog"
 - (id)initWithTimestamp:(NSDate *)timestamp {
     if ((self = [super init])) {
         _timestamp = timestamp;
+        
+        // The entry and its timestamp.
+        IAIOverheadCountAllocations(2);
     }
     return self;
 }
@@ -109,6 +830,17 @@ NSString* const IAILoggerDidAddConsoleLog = @"IAIOverviewLoggerDidAddConsoleLog"
 @synthesize bytesOfFreeDiskSpace = _bytesOfFreeDiskSpace;
 @synthesize batteryLevel = _batteryLevel;
 @synthesize batteryState = _batteryState;
+@synthesize sampledMetrics = _sampledMetrics;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithTimestamp:(NSDate *)timestamp {
+    if ((self = [super initWithTimestamp:timestamp])) {
+        _sampledMetrics = IAIDeviceMetricAll;
+    }
+    return self;
+}
+
 
 @end
 
@@ -119,18 +851,128 @@ NSString* const IAILoggerDidAddConsoleLog = @"IAIOverviewLoggerDidAddConsoleLog"
 @implementation IAIConsoleLogEntry
 
 @synthesize log = _log;
+@synthesize level = _level;
+@synthesize tag = _tag;
+@synthesize repeatCount = _repeatCount;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Reads a level word such as "Error:" or "WARN" at the given location. Returns the number of
+// characters that were consumed, or 0 if there is no level word.
+static NSUInteger IAIScanConsoleLogLevel(NSString* log, NSUInteger location,
+                                         IAIConsoleLogLevel* level) {
+    static NSArray* sLevelWords = nil;
+    static IAIConsoleLogLevel sLevels[] = {
+        IAIConsoleLogLevelError, IAIConsoleLogLevelError,
+        IAIConsoleLogLevelWarning, IAIConsoleLogLevelWarning,
+        IAIConsoleLogLevelInfo, IAIConsoleLogLevelDebug,
+    };
+    // Console logs may be added from any thread.
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sLevelWords = [NSArray arrayWithObjects:
+                       @"error", @"err", @"warning", @"warn", @"info", @"debug", nil];
+    });
+    
+    NSUInteger length = [log length];
+    for (NSUInteger ix = 0; ix < [sLevelWords count]; ++ix) {
+        NSString* word = [sLevelWords objectAtIndex:ix];
+        NSUInteger end = location + [word length];
+        if (end > length
+            || [log compare: word
+                    options: NSCaseInsensitiveSearch
+                      range: NSMakeRange(location, [word length])] != NSOrderedSame) {
+            continue;
+        }
+        // The word must stand alone, e.g. "Error:" but not "Errors were found".
+        unichar next = (end < length) ? [log characterAtIndex:end] : ' ';
+        if (next == ':' || next == ' ' || next == ']') {
+            *level = sLevels[ix];
+            return [word length];
+        }
+    }
+    return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Reads the "[Tag] Level:" prefix of a log.
+static void IAIParseConsoleLog(NSString* log, IAIConsoleLogLevel* level, NSString** tag) {
+    *level = IAIConsoleLogLevelInfo;
+    *tag = nil;
+    
+    NSUInteger length = [log length];
+    NSUInteger location = 0;
+    while (location < length && [log characterAtIndex:location] == ' ') {
+        ++location;
+    }
+    
+    if (location < length && [log characterAtIndex:location] == '[') {
+        NSRange searchRange = NSMakeRange(location + 1, MIN(length - location - 1, 32));
+        NSRange closingRange = [log rangeOfString:@"]" options:0 range:searchRange];
+        if (closingRange.location != NSNotFound && closingRange.location > location + 1) {
+            // "[ERROR]" is a level rather than a tag.
+            NSUInteger consumed = IAIScanConsoleLogLevel(log, location + 1, level);
+            if (consumed != closingRange.location - location - 1) {
+                *level = IAIConsoleLogLevelInfo;
+                *tag = [log substringWithRange:
+                        NSMakeRange(location + 1, closingRange.location - location - 1)];
+            }
+            location = closingRange.location + 1;
+            while (location < length && [log characterAtIndex:location] == ' ') {
+                ++location;
+            }
+        }
+    }
+    
+    if (location < length) {
+        IAIScanConsoleLogLevel(log, location, level);
+    }
+}
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 - (id)initWithLog:(NSString *)logText {
     if ((self = [super initWithTimestamp:[NSDate date]])) {
         _log = [logText copy];
+        
+        NSString* tag = nil;
+        IAIParseConsoleLog(_log, &_level, &tag);
+        _tag = [tag copy];
+        IAIOverheadCountAllocations((nil != _tag) ? 2 : 1);
+        
+        _repeatCount = 1;
+        _lastTimeInterval = [self.timestamp timeIntervalSinceReferenceDate];
     }
     
     return self;
 }
 
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)setTimestamp:(NSDate *)timestamp {
+    [super setTimestamp:timestamp];
+    
+    // An entry that is given the time it was logged at, e.g. by a replay, has not repeated yet.
+    if (1 == _repeatCount) {
+        _lastTimeInterval = [timestamp timeIntervalSinceReferenceDate];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSDate *)lastTimestamp {
+    return [NSDate dateWithTimeIntervalSinceReferenceDate:_lastTimeInterval];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)addRepeatAtTime:(NSTimeInterval)timeIntervalSinceReferenceDate {
+    _lastTimeInterval = timeIntervalSinceReferenceDate;
+    ++_repeatCount;
+}
+
+
 @end
 
 
@@ -140,12 +982,42 @@ NSString* const IAILoggerDidAddConsoleLog = @"IAIOverviewLoggerDidAddConsoleLog"
 @implementation IAIEventLogEntry
 
 @synthesize type = _eventType;
+@synthesize value = _value;
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-- (id)initWithType:(NSInteger)type {
+- (id)initWithType:(NSInteger)type value:(double)value {
     if ((self = [super initWithTimestamp:[NSDate date]])) {
         _eventType = type;
+        _value = value;
+    }
+    
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithType:(NSInteger)type {
+    return [self initWithType:type value:0];
+}
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIMetricLogEntry
+
+@synthesize name = _name;
+@synthesize value = _value;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithName:(NSString *)name value:(double)value {
+    if ((self = [super initWithTimestamp:[NSDate date]])) {
+        _name = [name copy];
+        _value = value;
     }
     
     return self;
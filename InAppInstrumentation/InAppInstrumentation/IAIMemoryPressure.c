@@ -0,0 +1,55 @@
+//
+//  IAIMemoryPressure.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#include "IAIMemoryPressure.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAIMemoryPressureReadStall(IAIMemoryStall* stall) {
+    memset(stall, 0, sizeof(*stall));
+#if defined(__APPLE__)
+    return 0;
+#else
+    FILE* file = fopen("/proc/pressure/memory", "r");
+    if (NULL == file) {
+        return 0;
+    }
+    // some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+    // full avg10=0.00 avg60=0.00 avg300=0.00 total=0
+    int found = 0;
+    char line[128];
+    double value;
+    while (NULL != fgets(line, sizeof(line), file)) {
+        if (1 == sscanf(line, "some avg10=%lf", &value)) {
+            stall->someStall = value;
+            found |= 1;
+        } else if (1 == sscanf(line, "full avg10=%lf", &value)) {
+            stall->fullStall = value;
+            found |= 2;
+        }
+    }
+    fclose(file);
+    // Kernels before 5.13 have no full line for the whole system.
+    return (found & 1);
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+IAIMemoryPressureLevel IAIMemoryPressureLevelOfStall(const IAIMemoryStall* stall) {
+    if (stall->fullStall >= IAIMemoryPressureCriticalStall) {
+        return IAIMemoryPressureCritical;
+    }
+    if (stall->someStall >= IAIMemoryPressureWarningStall) {
+        return IAIMemoryPressureWarning;
+    }
+    return IAIMemoryPressureNormal;
+}
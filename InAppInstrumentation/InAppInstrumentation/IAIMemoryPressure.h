@@ -0,0 +1,49 @@
+//
+//  IAIMemoryPressure.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#ifndef InAppInstrumentation_IAIMemoryPressure_h
+#define InAppInstrumentation_IAIMemoryPressure_h
+
+/**
+ * Reads how much the system is short of memory.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * On Apple platforms the kernel announces the pressure level itself, through dispatch memory
+ * pressure sources and memory warnings, so there is nothing to read here. On Linux the level is
+ * derived from the pressure stall information in /proc/pressure/memory: the share of the last
+ * ten seconds in which some or all of the runnable tasks were stalled waiting for memory.
+ */
+
+typedef enum {
+    IAIMemoryPressureNormal,
+    IAIMemoryPressureWarning,
+    IAIMemoryPressureCritical,
+} IAIMemoryPressureLevel;
+
+// The share of time, in percent, that tasks may be stalled on memory before the pressure is
+// a warning (some tasks stalled) or critical (all tasks stalled).
+#define IAIMemoryPressureWarningStall   10.0
+#define IAIMemoryPressureCriticalStall  10.0
+
+typedef struct {
+    double someStall;   // Percent of the last 10 seconds that some tasks were stalled.
+    double fullStall;   // Percent of the last 10 seconds that all tasks were stalled.
+} IAIMemoryStall;
+
+/**
+ * Reads the memory stalls of the system. Returns 0 if the system doesn't report them.
+ */
+int IAIMemoryPressureReadStall(IAIMemoryStall* stall);
+
+/**
+ * The pressure level that a stall amounts to.
+ */
+IAIMemoryPressureLevel IAIMemoryPressureLevelOfStall(const IAIMemoryStall* stall);
+
+#endif
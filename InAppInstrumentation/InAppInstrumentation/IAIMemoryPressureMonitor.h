@@ -0,0 +1,127 @@
+//
+//  IAIMemoryPressureMonitor.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "IAIMemoryPressure.h"
+
+@class IAILogger;
+
+/**
+ * How far the logger's histories have been cut back to relieve memory pressure. Each stage
+ * includes the ones before it.
+ */
+typedef enum {
+    IAIMemoryShedNothing,
+    IAIMemoryShedByCompacting,      // Device logs are kept in compressed blocks.
+    IAIMemoryShedByDownsampling,    // Raw entries are rolled up sooner and fine rollups freed.
+    IAIMemoryShedByDropping,        // Only the newest raw entries and console logs are kept.
+} IAIMemoryShedStage;
+
+/**
+ * Shrinks the logger's histories while the system is short of memory.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * The histories would otherwise add to the very pressure that they are recording. The monitor
+ * follows the pressure level of the system (see IAIMemoryPressure.h) and memory warnings, and
+ * sheds memory in stages: first it compresses the device logs, then it halves the retention of
+ * the raw entries and frees the rollup tiers finer than the coarsest, and last it keeps only the
+ * newest ten seconds of raw entries and thirty seconds of console logs.
+ *
+ * Under a warning the monitor moves one stage further every escalationInterval seconds while
+ * the pressure lasts, up to downsampling; a critical level goes through every stage at once.
+ * Each stage adds an IAIEventDidShedMemory event whose value is the number of bytes it freed.
+ *
+ * Once there has been no pressure for recoveryInterval seconds the monitor undoes its own
+ * changes to the logger's settings and adds an IAIEventDidRestoreMemory event whose value is
+ * the number of bytes shed in all. The retention is given back by the amount that the monitor
+ * took, on top of whatever it is now, so the changes that the overhead monitor (see
+ * IAIOverheadMonitor) made to stay within its memory budget meanwhile are kept. Settings that
+ * were changed by someone else since the monitor changed them are left alone. The histories
+ * then grow back as new entries come in; what was dropped stays dropped, apart from its
+ * rollups.
+ */
+@interface IAIMemoryPressureMonitor : NSObject {
+@private
+    __weak IAILogger* _logger;
+
+    dispatch_source_t _pressureSource;
+    IAIMemoryPressureLevel _systemLevel;
+    NSTimeInterval _lastMemoryWarningTime;
+
+    NSTimeInterval _escalationInterval;
+    NSTimeInterval _recoveryInterval;
+    IAIMemoryPressureLevel _level;
+    IAIMemoryShedStage _stage;
+    NSTimeInterval _lastStageChangeTime;
+    NSTimeInterval _lastPressureTime;
+    unsigned long long _bytesShed;
+
+    BOOL _hasCompressedDeviceLogs;
+    NSTimeInterval _shedLogAge;
+    NSTimeInterval _shedConsoleLogAge;
+    BOOL _hasShedKeptConsoleLogs;
+    NSTimeInterval _previousMinimumRollupResolution;
+    NSTimeInterval _raisedMinimumRollupResolution;
+}
+
+#pragma mark Creating a Monitor /** @name Creating a Monitor */
+
+/**
+ * Designated initializer.
+ *
+ * Starts listening for the pressure level of the system. The logger is not retained.
+ */
+- (id)initWithLogger:(IAILogger *)logger;
+
+
+#pragma mark Shedding Memory /** @name Shedding Memory */
+
+/**
+ * The number of seconds that a warning must last before the next stage is shed.
+ *
+ * By default this is 5 seconds.
+ */
+@property (nonatomic, readwrite, assign) NSTimeInterval escalationInterval;
+
+/**
+ * The number of seconds without pressure after which the logger's settings are put back.
+ *
+ * By default this is 30 seconds.
+ */
+@property (nonatomic, readwrite, assign) NSTimeInterval recoveryInterval;
+
+/**
+ * Checks the pressure level and sheds or restores memory.
+ *
+ * Call this from the main thread once per heartbeat. Changes of the level of the system and
+ * memory warnings are also handled as soon as they arrive.
+ */
+- (void)update;
+
+/**
+ * Counts a memory warning as pressure for the next recoveryInterval seconds.
+ *
+ * Call this from the main thread.
+ */
+- (void)didReceiveMemoryWarning;
+
+/**
+ * The pressure level as of the last update.
+ */
+@property (nonatomic, readonly, assign) IAIMemoryPressureLevel level;
+
+@property (nonatomic, readonly, assign) IAIMemoryShedStage stage;
+
+/**
+ * The number of bytes shed since the pressure began, or 0 when nothing is shed.
+ */
+@property (nonatomic, readonly, assign) unsigned long long bytesShed;
+
+@end
@@ -0,0 +1,254 @@
+//
+//  IAIMemoryPressureMonitor.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAIMemoryPressureMonitor.h"
+
+#import "IAIDeviceInfo.h"
+#import "IAILogger.h"
+#import "IAIOverhead.h"
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+// The retention of the raw entries and console logs once the oldest have been dropped.
+static const NSTimeInterval kDroppedLogAge = 10;
+static const NSTimeInterval kDroppedConsoleLogAge = 30;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static unsigned long long IAIBytesOfHistories(IAILogger* logger) {
+    unsigned long long bytesOfHistories[IAIOverheadNumberOfHistories];
+    IAIOverheadMeasureHistories(logger, bytesOfHistories);
+
+    unsigned long long bytes = 0;
+    for (NSInteger ix = 0; ix < IAIOverheadNumberOfHistories; ++ix) {
+        bytes += bytesOfHistories[ix];
+    }
+    return bytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static NSString* IAINameOfShedStage(IAIMemoryShedStage stage) {
+    switch (stage) {
+        case IAIMemoryShedByCompacting:
+            return @"compacting";
+        case IAIMemoryShedByDownsampling:
+            return @"downsampling";
+        case IAIMemoryShedByDropping:
+            return @"dropping the oldest entries";
+        default:
+            return @"nothing";
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@interface IAIMemoryPressureMonitor()
+
+- (void)systemLevelDidChange:(IAIMemoryPressureLevel)level;
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIMemoryPressureMonitor
+
+@synthesize escalationInterval = _escalationInterval;
+@synthesize recoveryInterval = _recoveryInterval;
+@synthesize level = _level;
+@synthesize stage = _stage;
+@synthesize bytesShed = _bytesShed;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)dealloc {
+    if (nil != _pressureSource) {
+        dispatch_source_cancel(_pressureSource);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithLogger:(IAILogger *)logger {
+    if ((self = [super init])) {
+        _logger = logger;
+        _escalationInterval = 5;
+        _recoveryInterval = 30;
+
+#ifdef DISPATCH_SOURCE_TYPE_MEMORYPRESSURE
+        _pressureSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+                                                 (DISPATCH_MEMORYPRESSURE_NORMAL
+                                                  | DISPATCH_MEMORYPRESSURE_WARN
+                                                  | DISPATCH_MEMORYPRESSURE_CRITICAL),
+                                                 dispatch_get_main_queue());
+        if (nil != _pressureSource) {
+            __weak IAIMemoryPressureMonitor* weakSelf = self;
+            dispatch_source_t source = _pressureSource;
+            dispatch_source_set_event_handler(_pressureSource, ^{
+                unsigned long data = dispatch_source_get_data(source);
+                IAIMemoryPressureLevel level = IAIMemoryPressureNormal;
+                if (data & DISPATCH_MEMORYPRESSURE_CRITICAL) {
+                    level = IAIMemoryPressureCritical;
+
+                } else if (data & DISPATCH_MEMORYPRESSURE_WARN) {
+                    level = IAIMemoryPressureWarning;
+                }
+                [weakSelf systemLevelDidChange:level];
+            });
+            dispatch_resume(_pressureSource);
+        }
+#endif
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)systemLevelDidChange:(IAIMemoryPressureLevel)level {
+    _systemLevel = level;
+    [self update];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)didReceiveMemoryWarning {
+    _lastMemoryWarningTime = [NSDate timeIntervalSinceReferenceDate];
+    [self update];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)shedStage:(IAIMemoryShedStage)stage {
+    IAILogger* logger = _logger;
+
+    unsigned long long bytesBefore = IAIBytesOfHistories(logger);
+
+    // Only this monitor's changes are remembered, so that restore can undo them without
+    // undoing the overhead monitor's.
+    NSTimeInterval oldestLogAge = logger.oldestLogAge;
+    if (IAIMemoryShedByCompacting == stage) {
+        if (!logger.compressesDeviceLogs) {
+            _hasCompressedDeviceLogs = YES;
+            logger.compressesDeviceLogs = YES;
+        }
+
+    } else if (IAIMemoryShedByDownsampling == stage) {
+        oldestLogAge = MAX(logger.oldestLogAge / 2, kDroppedLogAge);
+        IAIRollupTier* coarsestTier = [logger.rollupTiers lastObject];
+        if (logger.minimumRollupResolution < coarsestTier.resolution) {
+            _previousMinimumRollupResolution = logger.minimumRollupResolution;
+            _raisedMinimumRollupResolution = coarsestTier.resolution;
+            logger.minimumRollupResolution = coarsestTier.resolution;
+        }
+
+    } else if (IAIMemoryShedByDropping == stage) {
+        oldestLogAge = MIN(logger.oldestLogAge, kDroppedLogAge);
+        if (0 == logger.oldestConsoleLogAge) {
+            _hasShedKeptConsoleLogs = YES;
+            logger.oldestConsoleLogAge = kDroppedConsoleLogAge;
+
+        } else if (logger.oldestConsoleLogAge > kDroppedConsoleLogAge) {
+            _shedConsoleLogAge += logger.oldestConsoleLogAge - kDroppedConsoleLogAge;
+            logger.oldestConsoleLogAge = kDroppedConsoleLogAge;
+        }
+    }
+    if (oldestLogAge < logger.oldestLogAge) {
+        _shedLogAge += logger.oldestLogAge - oldestLogAge;
+        logger.oldestLogAge = oldestLogAge;
+    }
+    [logger pruneExpiredEntries];
+
+    unsigned long long bytesAfter = IAIBytesOfHistories(logger);
+    unsigned long long bytesShed = (bytesBefore > bytesAfter) ? bytesBefore - bytesAfter : 0;
+    _bytesShed += bytesShed;
+    _stage = stage;
+    _lastStageChangeTime = [NSDate timeIntervalSinceReferenceDate];
+
+    [logger addEventLog:[[IAIEventLogEntry alloc] initWithType: IAIEventDidShedMemory
+                                                         value: (double)bytesShed]];
+    NSLog(@"Memory pressure: shed %@ of instrumentation by %@.",
+          NIStringFromBytes(bytesShed), IAINameOfShedStage(stage));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)restore {
+    IAILogger* logger = _logger;
+    if (_hasCompressedDeviceLogs) {
+        logger.compressesDeviceLogs = NO;
+    }
+    logger.oldestLogAge += _shedLogAge;
+    if (_hasShedKeptConsoleLogs) {
+        logger.oldestConsoleLogAge = 0;
+
+    } else if (0 != logger.oldestConsoleLogAge) {
+        logger.oldestConsoleLogAge += _shedConsoleLogAge;
+    }
+    if (_raisedMinimumRollupResolution > 0
+        && logger.minimumRollupResolution == _raisedMinimumRollupResolution) {
+        logger.minimumRollupResolution = _previousMinimumRollupResolution;
+    }
+    _hasCompressedDeviceLogs = NO;
+    _shedLogAge = 0;
+    _shedConsoleLogAge = 0;
+    _hasShedKeptConsoleLogs = NO;
+    _raisedMinimumRollupResolution = 0;
+
+    [logger addEventLog:[[IAIEventLogEntry alloc] initWithType: IAIEventDidRestoreMemory
+                                                         value: (double)_bytesShed]];
+    NSLog(@"Memory pressure cleared after shedding %@ of instrumentation.",
+          NIStringFromBytes(_bytesShed));
+
+    _stage = IAIMemoryShedNothing;
+    _lastStageChangeTime = [NSDate timeIntervalSinceReferenceDate];
+    _bytesShed = 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)update {
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+
+    IAIMemoryPressureLevel level = _systemLevel;
+    IAIMemoryStall stall;
+    if (IAIMemoryPressureReadStall(&stall)) {
+        level = MAX(level, IAIMemoryPressureLevelOfStall(&stall));
+    }
+    if (_lastMemoryWarningTime > 0 && now - _lastMemoryWarningTime < _recoveryInterval) {
+        level = MAX(level, IAIMemoryPressureWarning);
+    }
+    _level = level;
+
+    if (IAIMemoryPressureNormal == level) {
+        if (IAIMemoryShedNothing != _stage && now - _lastPressureTime >= _recoveryInterval) {
+            [self restore];
+        }
+        return;
+    }
+    _lastPressureTime = now;
+
+    if (IAIMemoryPressureCritical == level) {
+        while (_stage < IAIMemoryShedByDropping) {
+            [self shedStage:_stage + 1];
+        }
+
+    } else if (IAIMemoryShedNothing == _stage
+               || (_stage < IAIMemoryShedByDownsampling
+                   && now - _lastStageChangeTime >= _escalationInterval)) {
+        [self shedStage:_stage + 1];
+    }
+}
+
+
+@end
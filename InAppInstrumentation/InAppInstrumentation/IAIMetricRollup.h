@@ -0,0 +1,156 @@
+//
+//  IAIMetricRollup.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ * An aggregate of all of the samples of a metric that fell within a fixed interval of time.
+ *
+ *      @ingroup Overview-Logger
+ */
+typedef struct {
+    // The start of the interval, in seconds since the reference date.
+    NSTimeInterval startTime;
+    double min;
+    double max;
+    double sum;
+    double last;
+    // The time of the sample in last.
+    NSTimeInterval lastTime;
+    NSUInteger count;
+} IAIRollupBucket;
+
+/**
+ * The mean of all of the samples in a bucket.
+ */
+double IAIRollupBucketMean(IAIRollupBucket bucket);
+
+/**
+ * A single resolution of aggregated history for a metric.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * A tier stores its buckets in a ring sorted by time. The ring is allocated with the first
+ * sample and doubles as buckets are filled, up to retention / resolution + 1 buckets, so a
+ * metric that is sampled rarely or only for a while costs memory in proportion to its samples,
+ * and no tier grows past its retention.
+ *
+ * Tiers given to IAILogger are used as templates; copying a tier returns an empty tier with
+ * the same resolution and retention.
+ */
+@interface IAIRollupTier : NSObject <NSCopying> {
+@private
+    NSTimeInterval _resolution;
+    NSTimeInterval _retention;
+
+    IAIRollupBucket* _buckets;
+    NSUInteger _capacity;
+    NSUInteger _maximumCapacity;
+    NSUInteger _head;
+    NSUInteger _count;
+}
+
+#pragma mark Creating a Tier /** @name Creating a Tier */
+
+/**
+ * Designated initializer.
+ *
+ *      @param resolution The length of time aggregated into a single bucket.
+ *      @param retention  The amount of history this tier keeps.
+ */
+- (id)initWithResolution:(NSTimeInterval)resolution retention:(NSTimeInterval)retention;
+
+
+#pragma mark Tier Information /** @name Tier Information */
+
+/**
+ * The length of time aggregated into a single bucket.
+ */
+@property (nonatomic, readonly, assign) NSTimeInterval resolution;
+
+/**
+ * The amount of history this tier keeps.
+ */
+@property (nonatomic, readonly, assign) NSTimeInterval retention;
+
+/**
+ * The number of bytes this tier holds on to, which grows with the number of filled buckets up
+ * to retention / resolution + 1 buckets.
+ */
+@property (nonatomic, readonly, assign) NSUInteger bytesOfStorage;
+
+
+#pragma mark Adding Samples /** @name Adding Samples */
+
+/**
+ * Folds a sample into the bucket that covers the given time.
+ *
+ * Samples may be added in any order. A sample older than the retention of the tier, counted
+ * back from the newest bucket, is dropped.
+ */
+- (void)addValue:(double)value atTime:(NSTimeInterval)time;
+
+
+#pragma mark Accessing Buckets /** @name Accessing Buckets */
+
+/**
+ * Enumerates the buckets that overlap [fromTime, toTime] in increasing chronological order,
+ * including the newest bucket, which may still be filled.
+ */
+- (void)enumerateBucketsFromTime: (NSTimeInterval)fromTime
+                          toTime: (NSTimeInterval)toTime
+                      usingBlock: (void (^)(IAIRollupBucket bucket, BOOL* stop))block;
+
+@end
+
+
+/**
+ * The aggregated history of a single metric at several resolutions.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * Every sample is folded into every tier, so each tier independently covers its full
+ * retention. Queries use the finest tier that still reaches back to the requested start time.
+ */
+@interface IAIMetricRollup : NSObject {
+@private
+    NSArray* _tiers;
+}
+
+/**
+ * Designated initializer.
+ *
+ * The tiers are copied and should be sorted from the finest resolution to the coarsest.
+ */
+- (id)initWithTiers:(NSArray *)tiers;
+
+/**
+ * The tiers of this rollup, from the finest resolution to the coarsest.
+ *
+ * Setting this keeps the buckets of the tiers whose resolution and retention are unchanged;
+ * the new tiers are copied and start out empty.
+ */
+@property (nonatomic, readwrite, copy) NSArray* tiers;
+
+/**
+ * The number of bytes held by all of the tiers.
+ */
+@property (nonatomic, readonly, assign) NSUInteger bytesOfStorage;
+
+/**
+ * Folds a sample into every tier.
+ */
+- (void)addValue:(double)value atTime:(NSTimeInterval)time;
+
+/**
+ * Returns the finest tier whose retention reaches back to the given time, or the coarsest
+ * tier if none do.
+ */
+- (IAIRollupTier *)tierReachingBackToTime:(NSTimeInterval)time now:(NSTimeInterval)now;
+
+@end
@@ -0,0 +1,256 @@
+//
+//  IAIMetricRollup.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAIMetricRollup.h"
+
+#import <objc/runtime.h>
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+double IAIRollupBucketMean(IAIRollupBucket bucket) {
+    return (bucket.count > 0) ? (bucket.sum / (double)bucket.count) : 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIRollupTier
+
+@synthesize resolution = _resolution;
+@synthesize retention = _retention;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)dealloc {
+    free(_buckets);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithResolution:(NSTimeInterval)resolution retention:(NSTimeInterval)retention {
+    if ((self = [super init])) {
+        IAIDASSERT(resolution > 0 && retention >= resolution);
+        _resolution = MAX(resolution, 0.001);
+        _retention = MAX(retention, _resolution);
+
+        // One extra bucket so that a full retention's worth of older buckets is kept while the
+        // newest bucket is still being filled. The buckets are allocated as they are filled.
+        _maximumCapacity = (NSUInteger)ceil(_retention / _resolution) + 1;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)copyWithZone:(NSZone *)zone {
+    return [[[self class] allocWithZone:zone] initWithResolution:_resolution retention:_retention];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSUInteger)bytesOfStorage {
+    return _capacity * sizeof(IAIRollupBucket) + class_getInstanceSize([self class]);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAIRollupBucket *)bucketAtIndex:(NSUInteger)index {
+    return &_buckets[(_head + index) % _capacity];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Doubles the ring, unrolling it so that the oldest bucket comes first. Returns NO if the ring
+// is already as large as the retention allows.
+- (BOOL)grow {
+    if (_capacity >= _maximumCapacity) {
+        return NO;
+    }
+    NSUInteger capacity = MIN(MAX(_capacity * 2, 16), _maximumCapacity);
+    IAIRollupBucket* buckets = malloc(capacity * sizeof(IAIRollupBucket));
+    if (NULL == buckets) {
+        return NO;
+    }
+    for (NSUInteger ix = 0; ix < _count; ++ix) {
+        buckets[ix] = *[self bucketAtIndex:ix];
+    }
+    free(_buckets);
+    _buckets = buckets;
+    _capacity = capacity;
+    _head = 0;
+    return YES;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)pruneBucketsBeforeTime:(NSTimeInterval)cutoffTime {
+    while (_count > 0 && _buckets[_head].startTime < cutoffTime) {
+        _head = (_head + 1) % _capacity;
+        --_count;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The index of the first bucket that starts at or after the given time. Late samples are
+// usually only a few buckets late, so the search walks back from the newest bucket.
+- (NSUInteger)indexOfBucketStartingAtOrAfterTime:(NSTimeInterval)startTime {
+    NSUInteger index = _count;
+    while (index > 0 && [self bucketAtIndex:index - 1]->startTime >= startTime) {
+        --index;
+    }
+    return index;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Makes room for a bucket before the bucket at the index. Returns NULL if there is no room.
+- (IAIRollupBucket *)insertBucketAtIndex:(NSUInteger)index {
+    if (_count == _capacity && ![self grow]) {
+        if (0 == index) {
+            return NULL;
+        }
+        // The oldest bucket falls off the end of the retention window.
+        _head = (_head + 1) % _capacity;
+        --_count;
+        --index;
+    }
+    for (NSUInteger ix = _count; ix > index; --ix) {
+        *[self bucketAtIndex:ix] = *[self bucketAtIndex:ix - 1];
+    }
+    ++_count;
+    return [self bucketAtIndex:index];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)addValue:(double)value atTime:(NSTimeInterval)time {
+    NSTimeInterval bucketStart = floor(time / _resolution) * _resolution;
+
+    if (0 == _count || bucketStart > [self bucketAtIndex:_count - 1]->startTime) {
+        [self pruneBucketsBeforeTime:bucketStart - _retention];
+
+    } else if (bucketStart < [self bucketAtIndex:_count - 1]->startTime - _retention) {
+        return;
+    }
+
+    NSUInteger index = [self indexOfBucketStartingAtOrAfterTime:bucketStart];
+    if (index < _count && [self bucketAtIndex:index]->startTime == bucketStart) {
+        IAIRollupBucket* bucket = [self bucketAtIndex:index];
+        bucket->min = MIN(bucket->min, value);
+        bucket->max = MAX(bucket->max, value);
+        bucket->sum += value;
+        if (time >= bucket->lastTime) {
+            bucket->last = value;
+            bucket->lastTime = time;
+        }
+        ++bucket->count;
+        return;
+    }
+
+    IAIRollupBucket* bucket = [self insertBucketAtIndex:index];
+    if (NULL != bucket) {
+        bucket->startTime = bucketStart;
+        bucket->min = value;
+        bucket->max = value;
+        bucket->sum = value;
+        bucket->last = value;
+        bucket->lastTime = time;
+        bucket->count = 1;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)enumerateBucketsFromTime: (NSTimeInterval)fromTime
+                          toTime: (NSTimeInterval)toTime
+                      usingBlock: (void (^)(IAIRollupBucket bucket, BOOL* stop))block {
+    BOOL stop = NO;
+    for (NSUInteger ix = 0; ix < _count && !stop; ++ix) {
+        IAIRollupBucket bucket = *[self bucketAtIndex:ix];
+        if (bucket.startTime > toTime) {
+            return;
+        }
+        if (bucket.startTime + _resolution >= fromTime) {
+            block(bucket, &stop);
+        }
+    }
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIMetricRollup
+
+@synthesize tiers = _tiers;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithTiers:(NSArray *)tiers {
+    if ((self = [super init])) {
+        _tiers = [[NSArray alloc] initWithArray:tiers copyItems:YES];
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)setTiers:(NSArray *)tiers {
+    NSMutableArray* newTiers = [NSMutableArray arrayWithCapacity:[tiers count]];
+    for (IAIRollupTier* tier in tiers) {
+        IAIRollupTier* keptTier = nil;
+        for (IAIRollupTier* oldTier in _tiers) {
+            if (oldTier.resolution == tier.resolution && oldTier.retention == tier.retention) {
+                keptTier = oldTier;
+                break;
+            }
+        }
+        [newTiers addObject:(nil != keptTier) ? keptTier : [tier copy]];
+    }
+    _tiers = [newTiers copy];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSUInteger)bytesOfStorage {
+    NSUInteger bytes = 0;
+    for (IAIRollupTier* tier in _tiers) {
+        bytes += tier.bytesOfStorage;
+    }
+    return bytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)addValue:(double)value atTime:(NSTimeInterval)time {
+    for (IAIRollupTier* tier in _tiers) {
+        [tier addValue:value atTime:time];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAIRollupTier *)tierReachingBackToTime:(NSTimeInterval)time now:(NSTimeInterval)now {
+    for (IAIRollupTier* tier in _tiers) {
+        if (now - tier.retention <= time) {
+            return tier;
+        }
+    }
+    return [_tiers lastObject];
+}
+
+
+@end
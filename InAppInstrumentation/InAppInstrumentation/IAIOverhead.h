@@ -0,0 +1,262 @@
+//
+//  IAIOverhead.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class IAILogger;
+
+/**
+ * The parts of the instrumentation whose time is accounted for.
+ */
+typedef enum {
+    IAIOverheadHeartbeat,       // Sampling the device in +heartbeat.
+    IAIOverheadConsoleCapture,  // IAILogMethod, for each NSLog.
+    IAIOverheadLogging,         // Adding entries to the logger and handing them to exporters.
+    IAIOverheadPruning,         // Removing expired entries and rolling them up.
+    IAIOverheadPageUpdates,     // IAIView::updatePages.
+    IAIOverheadDrawing,         // Drawing the graphs.
+    IAIOverheadProfiling,       // Sampling stacks in IAIProfiler.
+    IAIOverheadStorageScanning, // Listing the sandbox in IAIStorageMonitor.
+    IAIOverheadNumberOfCollectors,
+} IAIOverheadCollector;
+
+/**
+ * The histories of the logger whose memory is accounted for.
+ */
+typedef enum {
+    IAIOverheadDeviceLogs,
+    IAIOverheadConsoleLogs,
+    IAIOverheadEventLogs,
+    IAIOverheadMetricLogs,
+    IAIOverheadRollups,
+    IAIOverheadNumberOfHistories,
+} IAIOverheadHistory;
+
+/**
+ * A timed section of the instrumentation. Lives on the stack of the thread that times it.
+ */
+typedef struct IAIOverheadSection {
+    struct IAIOverheadSection* parent;
+    IAIOverheadCollector collector;
+    uint64_t startTime;
+    uint64_t nestedTime;
+} IAIOverheadSection;
+
+
+#pragma mark Counting Overhead /** @name Counting Overhead */
+
+/**
+ * Starts timing a section of the instrumentation on the calling thread.
+ *
+ * Sections may be nested. The time of a nested section is only counted against its own
+ * collector, never against the section that contains it, so the collectors add up to the
+ * total time spent in the instrumentation.
+ *
+ * @code
+ *  IAIOverheadSection section;
+ *  IAIOverheadBeginSection(&section, IAIOverheadPruning);
+ *  ...
+ *  IAIOverheadEndSection(&section);
+ * @endcode
+ */
+void IAIOverheadBeginSection(IAIOverheadSection* section, IAIOverheadCollector collector);
+
+/**
+ * Stops timing a section and counts its time against its collector.
+ */
+void IAIOverheadEndSection(IAIOverheadSection* section);
+
+/**
+ * Counts objects that the instrumentation allocated.
+ */
+void IAIOverheadCountAllocations(unsigned count);
+
+/**
+ * Counts records that the instrumentation dropped, such as suppressed console logs or frames
+ * that an exporter could not send.
+ */
+void IAIOverheadCountDroppedRecords(unsigned count);
+
+
+/**
+ * Measures what the instrumentation itself costs and keeps it within a budget.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * The instrumentation times its own work in sections (see IAIOverheadBeginSection) and counts
+ * the objects it allocates and the records it drops. Once per heartbeat the monitor turns
+ * these counters into rates and estimates the memory held by each of the logger's histories.
+ *
+ * Times are wall-clock time spent inside the sections on the thread that ran them, which
+ * includes any time the thread was preempted, so they overstate the CPU time a little when
+ * the device is busy.
+ *
+ * <h2>Budgets</h2>
+ *
+ * When the instrumentation uses more than cpuBudget of a core, the monitor doubles the
+ * heartbeat interval, up to maximumHeartbeatInterval, and halves it again once the usage falls
+ * below half the budget. When the raw histories hold more than memoryBudget bytes, the monitor
+ * halves the logger's oldestLogAge and oldestConsoleLogAge, and once they hold less than half
+ * the budget it gives back what it took, doubling the retention at each check. Only the
+ * reductions the monitor made itself are given back, relative to the logger's current
+ * retention, so changes made meanwhile by the app or by IAIMemoryPressureMonitor are kept. The
+ * rollups are not counted against the budget, since shortening the retention frees none of
+ * their memory; the logger bounds them with maximumNumberOfRollups instead. The budgets are
+ * checked at most once every budgetCheckInterval seconds so that the effect of each change can
+ * be seen before the next one.
+ */
+@interface IAIOverheadMonitor : NSObject {
+@private
+    __weak IAILogger* _logger;
+
+    double _cpuBudget;
+    unsigned long long _memoryBudget;
+    NSTimeInterval _minimumHeartbeatInterval;
+    NSTimeInterval _maximumHeartbeatInterval;
+    NSTimeInterval _heartbeatInterval;
+    NSTimeInterval _budgetCheckInterval;
+
+    NSTimeInterval _lastUpdateTime;
+    NSTimeInterval _lastBudgetCheckTime;
+    uint64_t _timeAtLastBudgetCheck;
+    uint64_t _lastCollectorTimes[IAIOverheadNumberOfCollectors];
+    int64_t _lastNumberOfAllocations;
+
+    double _cpuFractions[IAIOverheadNumberOfCollectors];
+    unsigned long long _bytesOfHistories[IAIOverheadNumberOfHistories];
+    double _allocationsPerSecond;
+    NSUInteger _numberOfBudgetAdjustments;
+
+    // The retention that the memory budget has taken from the logger and not yet given back.
+    NSTimeInterval _shedLogAge;
+    NSTimeInterval _shedConsoleLogAge;
+    BOOL _hasShedKeptConsoleLogs;
+}
+
+#pragma mark Creating a Monitor /** @name Creating a Monitor */
+
+/**
+ * Designated initializer.
+ *
+ * The logger is not retained.
+ */
+- (id)initWithLogger:(IAILogger *)logger;
+
+
+#pragma mark Budgets /** @name Budgets */
+
+/**
+ * The fraction of one core that the instrumentation may use.
+ *
+ * By default this is 0.05. 0 disables the CPU budget.
+ */
+@property (nonatomic, readwrite, assign) double cpuBudget;
+
+/**
+ * The number of bytes that the logger's raw histories may hold, not counting the rollups.
+ *
+ * By default this is 16 MB. 0 disables the memory budget.
+ */
+@property (nonatomic, readwrite, assign) unsigned long long memoryBudget;
+
+/**
+ * The heartbeat interval when the instrumentation is within its CPU budget.
+ *
+ * By default this is 0.5 seconds.
+ */
+@property (nonatomic, readwrite, assign) NSTimeInterval minimumHeartbeatInterval;
+
+/**
+ * The longest heartbeat interval the CPU budget may lead to.
+ *
+ * By default this is 8 seconds.
+ */
+@property (nonatomic, readwrite, assign) NSTimeInterval maximumHeartbeatInterval;
+
+/**
+ * The number of seconds between checks of the budgets.
+ *
+ * By default this is 5 seconds.
+ */
+@property (nonatomic, readwrite, assign) NSTimeInterval budgetCheckInterval;
+
+/**
+ * The interval at which the device should be sampled to stay within the CPU budget.
+ */
+@property (nonatomic, readonly, assign) NSTimeInterval heartbeatInterval;
+
+/**
+ * The number of times the monitor has changed the heartbeat interval or the retention.
+ */
+@property (nonatomic, readonly, assign) NSUInteger numberOfBudgetAdjustments;
+
+
+#pragma mark Measuring Overhead /** @name Measuring Overhead */
+
+/**
+ * Reads the counters, estimates the memory of the histories and checks the budgets.
+ *
+ * Call this from the main thread once per heartbeat.
+ */
+- (void)update;
+
+/**
+ * The fraction of one core used by a collector between the last two updates.
+ */
+- (double)cpuFractionForCollector:(IAIOverheadCollector)collector;
+
+/**
+ * The fraction of one core used by every collector between the last two updates.
+ */
+@property (nonatomic, readonly, assign) double cpuFraction;
+
+/**
+ * The total time spent in a collector's sections since launch.
+ */
+- (NSTimeInterval)timeSpentInCollector:(IAIOverheadCollector)collector;
+
+/**
+ * The estimated number of bytes held by one of the logger's histories as of the last update.
+ */
+- (unsigned long long)bytesOfHistory:(IAIOverheadHistory)history;
+
+/**
+ * The estimated number of bytes held by all of the logger's histories as of the last update.
+ */
+@property (nonatomic, readonly, assign) unsigned long long bytesOfHistories;
+
+/**
+ * The number of objects allocated per second by the instrumentation between the last two
+ * updates.
+ */
+@property (nonatomic, readonly, assign) double allocationsPerSecond;
+
+/**
+ * The number of records dropped since launch.
+ */
+@property (nonatomic, readonly, assign) unsigned long long numberOfDroppedRecords;
+
+@end
+
+
+/**
+ * The display name of a collector, such as "Heartbeat".
+ */
+NSString* IAIOverheadCollectorName(IAIOverheadCollector collector);
+
+/**
+ * The display name of a history, such as "Console logs".
+ */
+NSString* IAIOverheadHistoryName(IAIOverheadHistory history);
+
+/**
+ * Estimates the number of bytes held by each of a logger's histories now.
+ *
+ * bytesOfHistories must have room for IAIOverheadNumberOfHistories values.
+ */
+void IAIOverheadMeasureHistories(IAILogger* logger, unsigned long long* bytesOfHistories);
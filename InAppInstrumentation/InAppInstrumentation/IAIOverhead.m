@@ -0,0 +1,412 @@
+//
+//  IAIOverhead.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAIOverhead.h"
+
+#import "IAILogger.h"
+#import "IAISampleBlockStore.h"
+
+#import <libkern/OSAtomic.h>
+#import <mach/mach_time.h>
+#import <objc/runtime.h>
+#import <pthread.h>
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+// The retention is never lowered below these ages by the memory budget.
+static const NSTimeInterval kMinimumLogAge = 10;
+static const NSTimeInterval kMinimumConsoleLogAge = 30;
+
+// An NSDate, which every entry holds as its timestamp.
+static const size_t kBytesOfDate = 16;
+
+static pthread_key_t sSectionKey;
+static pthread_once_t sSectionKeyOnce = PTHREAD_ONCE_INIT;
+
+static volatile int64_t sCollectorTimes[IAIOverheadNumberOfCollectors];
+static volatile int64_t sNumberOfAllocations = 0;
+static volatile int64_t sNumberOfDroppedRecords = 0;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAIOverheadCreateSectionKey(void) {
+    pthread_key_create(&sSectionKey, NULL);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static NSTimeInterval IAIOverheadSecondsFromMachTime(uint64_t machTime) {
+    static mach_timebase_info_data_t sTimebase;
+    if (0 == sTimebase.denom) {
+        mach_timebase_info(&sTimebase);
+    }
+    return (NSTimeInterval)machTime * sTimebase.numer / sTimebase.denom / 1e9;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Reads a counter in one piece, which a plain load does not guarantee on 32-bit devices.
+static int64_t IAIOverheadReadCounter(volatile int64_t* counter) {
+    return OSAtomicAdd64Barrier(0, counter);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIOverheadBeginSection(IAIOverheadSection* section, IAIOverheadCollector collector) {
+    pthread_once(&sSectionKeyOnce, IAIOverheadCreateSectionKey);
+    section->parent = pthread_getspecific(sSectionKey);
+    section->collector = collector;
+    section->nestedTime = 0;
+    pthread_setspecific(sSectionKey, section);
+    section->startTime = mach_absolute_time();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIOverheadEndSection(IAIOverheadSection* section) {
+    uint64_t elapsedTime = mach_absolute_time() - section->startTime;
+    OSAtomicAdd64Barrier((int64_t)(elapsedTime - section->nestedTime),
+                         &sCollectorTimes[section->collector]);
+    if (NULL != section->parent) {
+        section->parent->nestedTime += elapsedTime;
+    }
+    pthread_setspecific(sSectionKey, section->parent);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIOverheadCountAllocations(unsigned count) {
+    OSAtomicAdd64Barrier((int64_t)count, &sNumberOfAllocations);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIOverheadCountDroppedRecords(unsigned count) {
+    OSAtomicAdd64Barrier((int64_t)count, &sNumberOfDroppedRecords);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+NSString* IAIOverheadCollectorName(IAIOverheadCollector collector) {
+    switch (collector) {
+        case IAIOverheadHeartbeat: return @"Heartbeat";
+        case IAIOverheadConsoleCapture: return @"Console capture";
+        case IAIOverheadLogging: return @"Logging";
+        case IAIOverheadPruning: return @"Pruning";
+        case IAIOverheadPageUpdates: return @"Page updates";
+        case IAIOverheadDrawing: return @"Drawing";
+        case IAIOverheadProfiling: return @"Profiling";
+        case IAIOverheadStorageScanning: return @"Storage scanning";
+        default: return nil;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+NSString* IAIOverheadHistoryName(IAIOverheadHistory history) {
+    switch (history) {
+        case IAIOverheadDeviceLogs: return @"Device logs";
+        case IAIOverheadConsoleLogs: return @"Console logs";
+        case IAIOverheadEventLogs: return @"Events";
+        case IAIOverheadMetricLogs: return @"Metrics";
+        case IAIOverheadRollups: return @"Rollups";
+        default: return nil;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Each entry is an object that holds a timestamp and takes a slot in its history.
+static unsigned long long IAIOverheadBytesOfEntries(NSUInteger count, Class entryClass) {
+    return ((unsigned long long)count
+            * (class_getInstanceSize(entryClass) + kBytesOfDate + sizeof(id)));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIOverheadMeasureHistories(IAILogger* logger, unsigned long long* bytesOfHistories) {
+    id<IAILogCollection> deviceLogs = logger.deviceLogs;
+    if (logger.compressesDeviceLogs) {
+        bytesOfHistories[IAIOverheadDeviceLogs] = [(IAISampleBlockStore *)deviceLogs
+                                                   bytesOfStorage];
+    } else {
+        bytesOfHistories[IAIOverheadDeviceLogs] =
+        IAIOverheadBytesOfEntries([deviceLogs count], [IAIDeviceLogEntry class]);
+    }
+    bytesOfHistories[IAIOverheadConsoleLogs] = logger.bytesOfConsoleLogs;
+    bytesOfHistories[IAIOverheadEventLogs] =
+    IAIOverheadBytesOfEntries([logger.eventLogs count], [IAIEventLogEntry class]);
+    bytesOfHistories[IAIOverheadMetricLogs] =
+    IAIOverheadBytesOfEntries([logger.metricLogs count], [IAIMetricLogEntry class]);
+    bytesOfHistories[IAIOverheadRollups] = logger.bytesOfRollups;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIOverheadMonitor
+
+@synthesize cpuBudget = _cpuBudget;
+@synthesize memoryBudget = _memoryBudget;
+@synthesize minimumHeartbeatInterval = _minimumHeartbeatInterval;
+@synthesize maximumHeartbeatInterval = _maximumHeartbeatInterval;
+@synthesize budgetCheckInterval = _budgetCheckInterval;
+@synthesize heartbeatInterval = _heartbeatInterval;
+@synthesize numberOfBudgetAdjustments = _numberOfBudgetAdjustments;
+@synthesize allocationsPerSecond = _allocationsPerSecond;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithLogger:(IAILogger *)logger {
+    if ((self = [super init])) {
+        _logger = logger;
+
+        _cpuBudget = 0.05;
+        _memoryBudget = 16 * 1024 * 1024;
+        _minimumHeartbeatInterval = 0.5;
+        _maximumHeartbeatInterval = 8;
+        _heartbeatInterval = _minimumHeartbeatInterval;
+        _budgetCheckInterval = 5;
+
+        _lastUpdateTime = [NSDate timeIntervalSinceReferenceDate];
+        _lastBudgetCheckTime = _lastUpdateTime;
+        for (NSInteger ix = 0; ix < IAIOverheadNumberOfCollectors; ++ix) {
+            _lastCollectorTimes[ix] = (uint64_t)IAIOverheadReadCounter(&sCollectorTimes[ix]);
+            _timeAtLastBudgetCheck += _lastCollectorTimes[ix];
+        }
+        _lastNumberOfAllocations = IAIOverheadReadCounter(&sNumberOfAllocations);
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)init {
+    return [self initWithLogger:nil];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)setMinimumHeartbeatInterval:(NSTimeInterval)minimumHeartbeatInterval {
+    _minimumHeartbeatInterval = minimumHeartbeatInterval;
+    _heartbeatInterval = MAX(_heartbeatInterval, _minimumHeartbeatInterval);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)setMaximumHeartbeatInterval:(NSTimeInterval)maximumHeartbeatInterval {
+    _maximumHeartbeatInterval = maximumHeartbeatInterval;
+    _heartbeatInterval = MAX(MIN(_heartbeatInterval, _maximumHeartbeatInterval),
+                             _minimumHeartbeatInterval);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Measuring
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)measureHistories {
+    IAIOverheadMeasureHistories(_logger, _bytesOfHistories);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)checkCPUBudgetAtTime:(NSTimeInterval)now {
+    uint64_t time = 0;
+    for (NSInteger ix = 0; ix < IAIOverheadNumberOfCollectors; ++ix) {
+        time += (uint64_t)IAIOverheadReadCounter(&sCollectorTimes[ix]);
+    }
+    double cpuFraction = (IAIOverheadSecondsFromMachTime(time - _timeAtLastBudgetCheck)
+                          / (now - _lastBudgetCheckTime));
+    _timeAtLastBudgetCheck = time;
+
+    if (_cpuBudget <= 0) {
+        return;
+    }
+    if (cpuFraction > _cpuBudget && _heartbeatInterval < _maximumHeartbeatInterval) {
+        _heartbeatInterval = MIN(_heartbeatInterval * 2, _maximumHeartbeatInterval);
+        ++_numberOfBudgetAdjustments;
+
+    } else if (cpuFraction < _cpuBudget / 2 && _heartbeatInterval > _minimumHeartbeatInterval) {
+        _heartbeatInterval = MAX(_heartbeatInterval / 2, _minimumHeartbeatInterval);
+        ++_numberOfBudgetAdjustments;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)shedRetention {
+    IAILogger* logger = _logger;
+
+    NSTimeInterval oldestLogAge = MAX(logger.oldestLogAge / 2, kMinimumLogAge);
+
+    // Console logs are kept forever by default, so start from the age of the oldest one.
+    NSTimeInterval oldestConsoleLogAge = logger.oldestConsoleLogAge;
+    if (0 == oldestConsoleLogAge) {
+        IAILogEntry* oldestEntry = [logger.consoleLogs firstObject];
+        oldestConsoleLogAge = -[oldestEntry.timestamp timeIntervalSinceNow];
+    }
+    oldestConsoleLogAge = MAX(oldestConsoleLogAge / 2, kMinimumConsoleLogAge);
+
+    if (oldestLogAge < logger.oldestLogAge) {
+        _shedLogAge += logger.oldestLogAge - oldestLogAge;
+        logger.oldestLogAge = oldestLogAge;
+        ++_numberOfBudgetAdjustments;
+    }
+    if (0 == logger.oldestConsoleLogAge) {
+        _hasShedKeptConsoleLogs = YES;
+        logger.oldestConsoleLogAge = oldestConsoleLogAge;
+        ++_numberOfBudgetAdjustments;
+
+    } else if (oldestConsoleLogAge < logger.oldestConsoleLogAge) {
+        _shedConsoleLogAge += logger.oldestConsoleLogAge - oldestConsoleLogAge;
+        logger.oldestConsoleLogAge = oldestConsoleLogAge;
+        ++_numberOfBudgetAdjustments;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Gives back at most what shedRetention took, on top of whatever the retention is now.
+- (void)restoreRetention {
+    IAILogger* logger = _logger;
+
+    if (_shedLogAge > 0) {
+        NSTimeInterval oldestLogAge = MIN(logger.oldestLogAge * 2,
+                                          logger.oldestLogAge + _shedLogAge);
+        _shedLogAge = MAX(_shedLogAge - (oldestLogAge - logger.oldestLogAge), 0);
+        logger.oldestLogAge = oldestLogAge;
+        ++_numberOfBudgetAdjustments;
+    }
+
+    if (0 == logger.oldestConsoleLogAge) {
+        // Every console log is kept again, whoever decided so.
+        _shedConsoleLogAge = 0;
+        _hasShedKeptConsoleLogs = NO;
+
+    } else if (_shedConsoleLogAge > 0) {
+        NSTimeInterval oldestConsoleLogAge = MIN(logger.oldestConsoleLogAge * 2,
+                                                 logger.oldestConsoleLogAge + _shedConsoleLogAge);
+        _shedConsoleLogAge = MAX(_shedConsoleLogAge
+                                 - (oldestConsoleLogAge - logger.oldestConsoleLogAge), 0);
+        logger.oldestConsoleLogAge = oldestConsoleLogAge;
+        ++_numberOfBudgetAdjustments;
+
+    } else if (_hasShedKeptConsoleLogs) {
+        _hasShedKeptConsoleLogs = NO;
+        logger.oldestConsoleLogAge = 0;
+        ++_numberOfBudgetAdjustments;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)checkMemoryBudget {
+    if (0 == _memoryBudget) {
+        return;
+    }
+
+    // Shortening the retention frees none of the rollups, which the logger caps on its own.
+    unsigned long long bytesOfRawHistories = (self.bytesOfHistories
+                                              - _bytesOfHistories[IAIOverheadRollups]);
+    if (bytesOfRawHistories > _memoryBudget) {
+        [self shedRetention];
+
+    } else if (bytesOfRawHistories < _memoryBudget / 2) {
+        [self restoreRetention];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)update {
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    NSTimeInterval elapsed = now - _lastUpdateTime;
+    if (elapsed <= 0) {
+        return;
+    }
+    _lastUpdateTime = now;
+
+    for (NSInteger ix = 0; ix < IAIOverheadNumberOfCollectors; ++ix) {
+        uint64_t time = (uint64_t)IAIOverheadReadCounter(&sCollectorTimes[ix]);
+        _cpuFractions[ix] = (IAIOverheadSecondsFromMachTime(time - _lastCollectorTimes[ix])
+                             / elapsed);
+        _lastCollectorTimes[ix] = time;
+    }
+    int64_t numberOfAllocations = IAIOverheadReadCounter(&sNumberOfAllocations);
+    _allocationsPerSecond = (double)(numberOfAllocations - _lastNumberOfAllocations) / elapsed;
+    _lastNumberOfAllocations = numberOfAllocations;
+
+    [self measureHistories];
+
+    if (now - _lastBudgetCheckTime >= _budgetCheckInterval) {
+        [self checkCPUBudgetAtTime:now];
+        [self checkMemoryBudget];
+        _lastBudgetCheckTime = now;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Readings
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (double)cpuFractionForCollector:(IAIOverheadCollector)collector {
+    return _cpuFractions[collector];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (double)cpuFraction {
+    double cpuFraction = 0;
+    for (NSInteger ix = 0; ix < IAIOverheadNumberOfCollectors; ++ix) {
+        cpuFraction += _cpuFractions[ix];
+    }
+    return cpuFraction;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSTimeInterval)timeSpentInCollector:(IAIOverheadCollector)collector {
+    return IAIOverheadSecondsFromMachTime((uint64_t)
+                                          IAIOverheadReadCounter(&sCollectorTimes[collector]));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (unsigned long long)bytesOfHistory:(IAIOverheadHistory)history {
+    return _bytesOfHistories[history];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (unsigned long long)bytesOfHistories {
+    unsigned long long bytes = 0;
+    for (NSInteger ix = 0; ix < IAIOverheadNumberOfHistories; ++ix) {
+        bytes += _bytesOfHistories[ix];
+    }
+    return bytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (unsigned long long)numberOfDroppedRecords {
+    return (unsigned long long)IAIOverheadReadCounter(&sNumberOfDroppedRecords);
+}
+
+
+@end
@@ -11,6 +11,8 @@
 
 #ifdef DEBUG
 
+@class IAILogger;
+
 /**
  * A page in the Overview.
  *
@@ -20,6 +22,7 @@
 @private
     NSString* _pageTitle;
     UILabel*  _titleLabel;
+    IAILogger* _logger;
 }
 
 #pragma mark Creating a Page /** @name Creating a Page */
@@ -47,6 +50,14 @@
  */
 @property (nonatomic, readwrite, copy) NSString* pageTitle;
 
+/**
+ * The logger whose entries the page shows.
+ *
+ * By default this is [IAInstrumentation logger]. Pages that show a monitor still show the
+ * monitors of IAInstrumentation.
+ */
+@property (nonatomic, readwrite, IAI_STRONG) IAILogger* logger;
+
 
 /**
  * The following methods are provided to aid in subclassing and are not meant to be
@@ -89,6 +100,49 @@
 @end
 
 
+/**
+ * A page that graphs the samples of one metric of the logger.
+ *
+ *      @ingroup Overview-Pages
+ *
+ * The samples are kept by the page and only the ones added since the last update are read from
+ * the logger (see IAILogger::metricLogsNamed:fromDate:toDate:), so redrawing the graph does not
+ * scan the metric logs. Samples older than the first device log are dropped, so that the graph
+ * lines up with the device log graphs, whose range the x axis spans. A sample that is added
+ * behind one that is already shown is skipped.
+ */
+@interface IAIMetricGraphPageView : IAIGraphPageView {
+@private
+    NSString* _metricName;
+    double _valueScale;
+    BOOL _plotsFromMinimum;
+    NSMutableArray* _entries;
+    NSUInteger _pointIndex;
+    double _minValue;
+}
+
+/**
+ * The name of the metric to graph.
+ */
+@property (nonatomic, readwrite, copy) NSString* metricName;
+
+/**
+ * The factor that the values are multiplied by before they are plotted.
+ *
+ * By default this is 1.
+ */
+@property (nonatomic, readwrite, assign) double valueScale;
+
+/**
+ * Whether the y axis starts at the smallest value rather than at 0.
+ *
+ * By default this is NO.
+ */
+@property (nonatomic, readwrite, assign) BOOL plotsFromMinimum;
+
+@end
+
+
 /**
  * A page that renders a graph showing free memory.
  *
@@ -121,19 +175,181 @@
 @end
 
 
+/**
+ * A page that renders a graph of the growth of the app's heap.
+ *
+ *      @ingroup Overview-Pages
+ *
+ * Shows the metrics of the allocation monitor (see IAIAllocationMonitor): the bytes allocated
+ * and not yet freed, the rate of allocations and the most common size of block.
+ */
+@interface IAIAllocationPageView : IAIMetricGraphPageView
+
+@end
+
+
+/**
+ * A page that renders a graph of the work waiting on the app's queues.
+ *
+ *      @ingroup Overview-Pages
+ *
+ * Graphs the total number of pending blocks on the queues tracked by the queue monitor (see
+ * IAIQueueMonitor) and lists the deepest queues with the 99th percentile of their recent wait
+ * times. Queues that became saturated show up as events on the graph.
+ */
+@interface IAIQueuePageView : IAIMetricGraphPageView
+
+@end
+
+
+/**
+ * A page that renders a graph of the page faults of the app's process.
+ *
+ *      @ingroup Overview-Pages
+ *
+ * Shows the metrics of the process monitor (see IAIProcessMonitor): graphs the page faults per
+ * second and lists the major faults, context switches, bytes read and written per second and
+ * the number of open files.
+ */
+@interface IAIProcessPageView : IAIMetricGraphPageView
+
+@end
+
+
+/**
+ * A page that shows columns of text.
+ *
+ *      @ingroup Overview-Pages
+ *
+ * The columns share the width of the page evenly and are as tall as their text, up to the title.
+ */
+@interface IAITextPageView : IAIPageView {
+@private
+    NSMutableArray* _textColumns;
+}
+
+/**
+ * Adds a multi-line label to the right of the existing columns and returns it.
+ */
+- (UILabel *)addTextColumn;
+
+@end
+
+
+/**
+ * A page that shows what the Overview itself costs.
+ *
+ *      @ingroup Overview-Pages
+ *
+ * The left column shows the share of a core used by each part of the instrumentation and the
+ * right column the memory held by each of the logger's histories, along with the budgets of
+ * the overhead monitor (see IAIOverheadMonitor).
+ */
+@interface IAIOverheadPageView : IAITextPageView {
+@private
+    UILabel* _cpuLabel;
+    UILabel* _memoryLabel;
+}
+
+@end
+
+
+/**
+ * A page that shows the functions the main thread spends its time in.
+ *
+ *      @ingroup Overview-Pages
+ *
+ * Lists the functions that the profiler (see IAIProfiler) found running most often, with the
+ * share of the samples in which each was running and in which it was on the stack.
+ */
+@interface IAIProfilerPageView : IAITextPageView {
+@private
+    UILabel* _label;
+    unsigned long long _numberOfSamplesShown;
+}
+
+@end
+
+
+/**
+ * A page that shows the most contended locks.
+ *
+ *      @ingroup Overview-Pages
+ *
+ * Lists the lock sites that threads have spent the longest waiting for (see IAILockMonitor),
+ * with the share of their acquisitions that had to wait and the 99th percentile of their wait
+ * and hold times.
+ */
+@interface IAILocksPageView : IAITextPageView {
+@private
+    UILabel* _label;
+}
+
+@end
+
+
+/**
+ * A page that shows the types whose live instances grow the fastest.
+ *
+ *      @ingroup Overview-Pages
+ *
+ * Lists the types counted by the instance tracker (see IAIInstanceTracker) by how fast their
+ * number of live instances grew over the snapshots that the logger keeps, with the number of
+ * instances that are live now.
+ */
+@interface IAIInstancesPageView : IAITextPageView {
+@private
+    UILabel* _label;
+}
+
+@end
+
+
+/**
+ * A page that shows the storage used by the app's sandbox.
+ *
+ *      @ingroup Overview-Pages
+ *
+ * Lists the bytes used by each directory of the storage monitor (see IAIStorageMonitor), and the
+ * files that grew the fastest, with how much they grew per minute.
+ */
+@interface IAIStoragePageView : IAITextPageView {
+@private
+    UILabel* _label;
+}
+
+@end
+
+
+@class IAIConsoleLogQuery;
+
 /**
  * A page that shows all of the logs sent to the console.
  *
  * @image html overview-log1.png "The log page."
  *
  *      @ingroup Overview-Pages
+ *
+ * Typing in the filter field at the top of the page switches the page to filter mode, in
+ * which only the logs matching the filter are shown. Matches are found with the logger's
+ * consoleLogIndex. See IAIConsoleLogQuery::queryWithFilterString: for the filter syntax.
  */
-@interface IAIConsoleLogPageView : IAIGraphPageView {
+@interface IAIConsoleLogPageView : IAIGraphPageView <UITextFieldDelegate> {
 @private
+    UITextField* _filterField;
     UIScrollView* _logScrollView;
     UILabel* _logLabel;
+    NSMutableString* _logText;
+    IAIConsoleLogQuery* _filterQuery;
 }
 
+/**
+ * The query that logs must match to be shown, or nil to show every log.
+ *
+ * At most the newest 500 matches are shown.
+ */
+@property (nonatomic, readwrite, copy) IAIConsoleLogQuery* filterQuery;
+
 @end
 
 #endif
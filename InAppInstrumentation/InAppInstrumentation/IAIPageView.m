@@ -14,6 +14,15 @@
 #import "IAIDeviceInfo.h"
 #import "IAIGraphView.h"
 #import "IAILogger.h"
+#import "IAIConsoleLogIndex.h"
+#import "IAIAllocationMonitor.h"
+#import "IAILockMonitor.h"
+#import "IAIQueueMonitor.h"
+#import "IAIInstanceTracker.h"
+#import "IAIStorageMonitor.h"
+#import "IAIProcessMonitor.h"
+#import "IAIOverhead.h"
+#import "IAIProfiler.h"
 
 #if !defined(__has_feature) || !__has_feature(objc_arc)
 #error "Nimbus requires ARC support."
@@ -21,6 +30,8 @@
 
 static UIEdgeInsets kPagePadding;
 static const CGFloat kGraphRightMargin = 5;
+static const CGFloat kFilterFieldHeight = 20;
+static const NSUInteger kMaximumNumberOfFilteredLogs = 500;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -29,6 +40,7 @@ static const CGFloat kGraphRightMargin = 5;
 
 @synthesize pageTitle = _pageTitle;
 @synthesize titleLabel = _titleLabel;
+@synthesize logger = _logger;
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -94,6 +106,12 @@ static const CGFloat kGraphRightMargin = 5;
 }
 
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAILogger *)logger {
+    return (nil != _logger) ? _logger : [IAInstrumentation logger];
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 - (void)update {
     // No-op.
@@ -179,7 +197,7 @@ static const CGFloat kGraphRightMargin = 5;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 - (CGFloat)graphViewXRange:(IAIGraphView *)graphView {
-    IAILinkedList* deviceLogs = [[IAInstrumentation logger] deviceLogs];
+    id<IAILogCollection> deviceLogs = [self.logger deviceLogs];
     IAILogEntry* firstEntry = [deviceLogs firstObject];
     IAILogEntry* lastEntry = [deviceLogs lastObject];
     NSTimeInterval interval = [lastEntry.timestamp timeIntervalSinceDate:firstEntry.timestamp];
@@ -213,7 +231,15 @@ static const CGFloat kGraphRightMargin = 5;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 - (void)resetEventIterator {
-    _eventEnumerator = [[[IAInstrumentation logger] eventLogs] objectEnumerator];
+    NSDate* initialTimestamp = [self initialTimestamp];
+    if (nil == initialTimestamp) {
+        _eventEnumerator = nil;
+        return;
+    }
+    // Events older than the first plotted point would land off the left edge of the graph.
+    _eventEnumerator = [[self.logger eventLogsFromDate: initialTimestamp
+                                                               toDate: [NSDate distantFuture]]
+                        objectEnumerator];
 }
 
 
@@ -225,6 +251,14 @@ static const CGFloat kGraphRightMargin = 5;
     if (nil == sEventColors) {
         sEventColors = [NSArray arrayWithObjects:
                         [UIColor redColor], // IAIEventDidReceiveMemoryWarning
+                        [UIColor grayColor], // IAIEventProcessDidStart
+                        [UIColor grayColor], // IAIEventDidReachMain
+                        [UIColor grayColor], // IAIEventDidFinishLaunching
+                        [UIColor greenColor], // IAIEventDidDrawFirstFrame
+                        [UIColor orangeColor], // IAIEventQueueDidSaturate
+                        [UIColor purpleColor], // IAIEventDidShedMemory
+                        [UIColor blueColor], // IAIEventDidRestoreMemory
+                        [UIColor magentaColor], // IAIEventBudgetWasExceeded
                         nil];
     }
     IAIEventLogEntry* entry = [_eventEnumerator nextObject];
@@ -240,6 +274,138 @@ static const CGFloat kGraphRightMargin = 5;
 @end
 
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIMetricGraphPageView
+
+@synthesize metricName = _metricName;
+@synthesize valueScale = _valueScale;
+@synthesize plotsFromMinimum = _plotsFromMinimum;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithFrame:(CGRect)frame {
+    if ((self = [super initWithFrame:frame])) {
+        _valueScale = 1;
+        _entries = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)setMetricName:(NSString *)metricName {
+    if (![_metricName isEqualToString:metricName]) {
+        _metricName = [metricName copy];
+        [_entries removeAllObjects];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)setLogger:(IAILogger *)logger {
+    [super setLogger:logger];
+    [_entries removeAllObjects];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)updateEntries {
+    NSDate* initialTimestamp = [self initialTimestamp];
+    if (nil == initialTimestamp || nil == _metricName) {
+        [_entries removeAllObjects];
+        return;
+    }
+    
+    // The samples that were pruned along with the device logs would land off the left edge.
+    NSUInteger numberOfExpiredEntries = 0;
+    for (IAIMetricLogEntry* entry in _entries) {
+        if ([entry.timestamp compare:initialTimestamp] != NSOrderedAscending) {
+            break;
+        }
+        ++numberOfExpiredEntries;
+    }
+    [_entries removeObjectsInRange:NSMakeRange(0, numberOfExpiredEntries)];
+    
+    IAIMetricLogEntry* lastEntry = [_entries lastObject];
+    NSDate* fromDate = (nil != lastEntry) ? lastEntry.timestamp : initialTimestamp;
+    for (IAIMetricLogEntry* entry in [self.logger metricLogsNamed: _metricName
+                                                          fromDate: fromDate
+                                                            toDate: [NSDate distantFuture]]) {
+        if (nil == lastEntry
+            || [entry.timestamp compare:lastEntry.timestamp] == NSOrderedDescending) {
+            [_entries addObject:entry];
+        }
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)update {
+    [self updateEntries];
+    
+    [super update];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark IAIGraphViewDataSource
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (CGFloat)graphViewYRange:(IAIGraphView *)graphView {
+    if (0 == _entries.count) {
+        return 0;
+    }
+    
+    IAIMetricLogEntry* firstEntry = [_entries objectAtIndex:0];
+    double minY = _plotsFromMinimum ? firstEntry.value : 0;
+    double maxY = minY;
+    for (IAIMetricLogEntry* entry in _entries) {
+        if (_plotsFromMinimum) {
+            minY = MIN(entry.value, minY);
+        }
+        maxY = MAX(entry.value, maxY);
+    }
+    _minValue = minY;
+    return (CGFloat)((maxY - minY) * _valueScale);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)resetPointIterator {
+    _pointIndex = 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSDate *)initialTimestamp {
+    // Line up with the device log graphs, whose range the x axis spans.
+    id<IAILogCollection> deviceLogs = [self.logger deviceLogs];
+    IAILogEntry* firstEntry = [deviceLogs firstObject];
+    return firstEntry.timestamp;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)nextPointInGraphView: (IAIGraphView *)graphView
+                       point: (CGPoint *)point {
+    if (_pointIndex >= _entries.count) {
+        return NO;
+    }
+    IAIMetricLogEntry* entry = [_entries objectAtIndex:_pointIndex++];
+    NSTimeInterval interval = [entry.timestamp timeIntervalSinceDate:[self initialTimestamp]];
+    *point = CGPointMake((CGFloat)interval, (CGFloat)((entry.value - _minValue) * _valueScale));
+    return YES;
+}
+
+
+@end
+
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -261,15 +427,15 @@ static const CGFloat kGraphRightMargin = 5;
 - (void)update {
     [super update];
     
-    [IAIDeviceInfo beginCachedDeviceInfo];
-    
-    self.label1.text = [NSString stringWithFormat:@"%@ free",
-                        NIStringFromBytes([IAIDeviceInfo bytesOfFreeMemory])];
-    
-    self.label2.text = [NSString stringWithFormat:@"%@ total",
-                        NIStringFromBytes([IAIDeviceInfo bytesOfTotalMemory])];
-    
-    [IAIDeviceInfo endCachedDeviceInfo];
+    // The newest sample rather than the device, so that the labels match the graph.
+    IAIDeviceLogEntry* entry = [self.logger.deviceLogs lastObject];
+    if (nil != entry) {
+        self.label1.text = [NSString stringWithFormat:@"%@ free",
+                            NIStringFromBytes(entry.bytesOfFreeMemory)];
+        
+        self.label2.text = [NSString stringWithFormat:@"%@ total",
+                            NIStringFromBytes(entry.bytesOfTotalMemory)];
+    }
     
     [self setNeedsLayout];
 }
@@ -283,14 +449,14 @@ static const CGFloat kGraphRightMargin = 5;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 - (CGFloat)graphViewYRange:(IAIGraphView *)graphView {
-    IAILinkedList* deviceLogs = [[IAInstrumentation logger] deviceLogs];
+    id<IAILogCollection> deviceLogs = [self.logger deviceLogs];
     if ([deviceLogs count] == 0) {
         return 0;
     }
     
     unsigned long long minY = (unsigned long long)-1;
     unsigned long long maxY = 0;
-    for (IAIDeviceLogEntry* entry in deviceLogs) {
+    for (IAIDeviceLogEntry* entry in [deviceLogs objectEnumerator]) {
         minY = MIN(entry.bytesOfFreeMemory, minY);
         maxY = MAX(entry.bytesOfFreeMemory, maxY);
     }
@@ -302,13 +468,13 @@ static const CGFloat kGraphRightMargin = 5;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 - (void)resetPointIterator {
-    _enumerator = [[[IAInstrumentation logger] deviceLogs] objectEnumerator];
+    _enumerator = [[self.logger deviceLogs] objectEnumerator];
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 - (NSDate *)initialTimestamp {
-    IAILinkedList* deviceLogs = [[IAInstrumentation logger] deviceLogs];
+    id<IAILogCollection> deviceLogs = [self.logger deviceLogs];
     IAILogEntry* firstEntry = [deviceLogs firstObject];
     return firstEntry.timestamp;
 }
@@ -352,15 +518,14 @@ static const CGFloat kGraphRightMargin = 5;
 - (void)update {
     [super update];
     
-    [IAIDeviceInfo beginCachedDeviceInfo];
-    
-    self.label1.text = [NSString stringWithFormat:@"%@ free",
-                        NIStringFromBytes([IAIDeviceInfo bytesOfFreeDiskSpace])];
-    
-    self.label2.text = [NSString stringWithFormat:@"%@ total",
-                        NIStringFromBytes([IAIDeviceInfo bytesOfTotalDiskSpace])];
-    
-    [IAIDeviceInfo endCachedDeviceInfo];
+    IAIDeviceLogEntry* entry = [self.logger.deviceLogs lastObject];
+    if (nil != entry) {
+        self.label1.text = [NSString stringWithFormat:@"%@ free",
+                            NIStringFromBytes(entry.bytesOfFreeDiskSpace)];
+        
+        self.label2.text = [NSString stringWithFormat:@"%@ total",
+                            NIStringFromBytes(entry.bytesOfTotalDiskSpace)];
+    }
     
     [self setNeedsLayout];
 }
@@ -374,14 +539,14 @@ static const CGFloat kGraphRightMargin = 5;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 - (CGFloat)graphViewYRange:(IAIGraphView *)graphView {
-    IAILinkedList* deviceLogs = [[IAInstrumentation logger] deviceLogs];
+    id<IAILogCollection> deviceLogs = [self.logger deviceLogs];
     if ([deviceLogs count] == 0) {
         return 0;
     }
     
     unsigned long long minY = (unsigned long long)-1;
     unsigned long long maxY = 0;
-    for (IAIDeviceLogEntry* entry in deviceLogs) {
+    for (IAIDeviceLogEntry* entry in [deviceLogs objectEnumerator]) {
         minY = MIN(entry.bytesOfFreeDiskSpace, minY);
         maxY = MAX(entry.bytesOfFreeDiskSpace, maxY);
     }
@@ -393,13 +558,13 @@ static const CGFloat kGraphRightMargin = 5;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 - (void)resetPointIterator {
-    _enumerator = [[[IAInstrumentation logger] deviceLogs] objectEnumerator];
+    _enumerator = [[self.logger deviceLogs] objectEnumerator];
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 - (NSDate *)initialTimestamp {
-    IAILinkedList* deviceLogs = [[IAInstrumentation logger] deviceLogs];
+    id<IAILogCollection> deviceLogs = [self.logger deviceLogs];
     IAILogEntry* firstEntry = [deviceLogs firstObject];
     return firstEntry.timestamp;
 }
@@ -422,11 +587,518 @@ static const CGFloat kGraphRightMargin = 5;
 @end
 
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIAllocationPageView
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithFrame:(CGRect)frame {
+    if ((self = [super initWithFrame:frame])) {
+        self.pageTitle = NSLocalizedString(@"Heap", @"Overview Page Title: Heap");
+        
+        self.label2.numberOfLines = 0;
+        self.metricName = IAIMetricBytesOfLiveHeap;
+        self.valueScale = 1.0 / 1024 / 1024;
+        self.plotsFromMinimum = YES;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)update {
+    [super update];
+    
+    IAIAllocationMonitor* monitor = [IAInstrumentation allocationMonitor];
+    if (!monitor.isRunning) {
+        self.label1.text = @"Off";
+        self.label2.text = @"Start [IAInstrumentation\nallocationMonitor]";
+        [self setNeedsLayout];
+        return;
+    }
+    
+    long long bytesOfLiveHeap = monitor.bytesOfLiveHeap;
+    self.label1.text = [NSString stringWithFormat:@"%@%@ live",
+                        (bytesOfLiveHeap < 0) ? @"-" : @"",
+                        NIStringFromBytes((unsigned long long)llabs(bytesOfLiveHeap))];
+    
+    NSMutableString* text = [NSMutableString stringWithFormat:@"%.0f allocs/s\n%@/s",
+                             monitor.allocationsPerSecond,
+                             NIStringFromBytes((unsigned long long)
+                                               monitor.bytesAllocatedPerSecond)];
+    
+    unsigned long long numberOfAllocations = monitor.numberOfAllocations;
+    NSUInteger mostCommonSizeClass = 0;
+    for (NSUInteger ix = 1; ix < IAIAllocationNumberOfSizeClasses; ++ix) {
+        if ([monitor numberOfAllocationsInSizeClass:ix]
+            > [monitor numberOfAllocationsInSizeClass:mostCommonSizeClass]) {
+            mostCommonSizeClass = ix;
+        }
+    }
+    if (numberOfAllocations > 0) {
+        uint64_t limit = IAIAllocationSizeClassLimit((unsigned)mostCommonSizeClass);
+        NSString* size = ((UINT64_MAX == limit)
+                          ? [NSString stringWithFormat:@"> %@",
+                             NIStringFromBytes(IAIAllocationSizeClassLimit(
+                                                 (unsigned)mostCommonSizeClass - 1))]
+                          : [NSString stringWithFormat:@"<= %@", NIStringFromBytes(limit)]);
+        [text appendFormat:@"\n%.0f%% %@",
+         (double)[monitor numberOfAllocationsInSizeClass:mostCommonSizeClass] * 100
+         / numberOfAllocations, size];
+    }
+    self.label2.text = text;
+    
+    [self setNeedsLayout];
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIQueuePageView
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithFrame:(CGRect)frame {
+    if ((self = [super initWithFrame:frame])) {
+        self.pageTitle = NSLocalizedString(@"Queues", @"Overview Page Title: Queues");
+        
+        self.label2.numberOfLines = 0;
+        self.metricName = IAIMetricQueueDepth;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)update {
+    [super update];
+    
+    NSArray* summaries = [[IAInstrumentation queueMonitor] queueSummaries];
+    if (0 == summaries.count) {
+        self.label1.text = @"No queues";
+        self.label2.text = @"Submit with IAIDispatchAsync";
+        [self setNeedsLayout];
+        return;
+    }
+    
+    NSInteger numberOfPendingBlocks = 0;
+    for (IAIQueueSummary* summary in summaries) {
+        numberOfPendingBlocks += summary.numberOfPendingBlocks;
+    }
+    self.label1.text = [NSString stringWithFormat:@"%ld pending", (long)numberOfPendingBlocks];
+    
+    NSMutableString* text = [NSMutableString string];
+    NSUInteger numberOfQueuesShown = MIN(summaries.count, (NSUInteger)3);
+    for (NSUInteger ix = 0; ix < numberOfQueuesShown; ++ix) {
+        IAIQueueSummary* summary = [summaries objectAtIndex:ix];
+        [text appendFormat:@"%@%@%@ %ld %.0fms", (ix > 0) ? @"\n" : @"",
+         summary.isSaturated ? @"! " : @"", summary.name,
+         (long)summary.maximumNumberOfPendingBlocks, summary.recentP99WaitTime * 1000];
+    }
+    self.label2.text = text;
+    
+    [self setNeedsLayout];
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIProcessPageView
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithFrame:(CGRect)frame {
+    if ((self = [super initWithFrame:frame])) {
+        self.pageTitle = NSLocalizedString(@"Process", @"Overview Page Title: Process");
+        
+        self.label2.numberOfLines = 0;
+        self.metricName = IAIMetricPageFaultsPerSecond;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)update {
+    [super update];
+    
+    IAIProcessMonitor* monitor = [IAInstrumentation processMonitor];
+    unsigned availableCounters = monitor.availableCounters;
+    
+    self.label1.text = [NSString stringWithFormat:@"%.0f faults/s", monitor.pageFaultsPerSecond];
+    
+    NSMutableString* text = [NSMutableString string];
+    [text appendFormat:@"%.0f major/s", monitor.majorPageFaultsPerSecond];
+    if (availableCounters & IAIProcessCounterContextSwitches) {
+        [text appendFormat:@"\n%.0f/%.0f switches/s", monitor.voluntaryContextSwitchesPerSecond,
+         monitor.involuntaryContextSwitchesPerSecond];
+    }
+    if (availableCounters & IAIProcessCounterBytes) {
+        [text appendFormat:@"\nR %@/s W %@/s",
+         NIStringFromBytes((unsigned long long)monitor.bytesReadPerSecond),
+         NIStringFromBytes((unsigned long long)monitor.bytesWrittenPerSecond)];
+    }
+    if (availableCounters & IAIProcessCounterOpenFiles) {
+        [text appendFormat:@"\n%u open files", monitor.counts.numberOfOpenFiles];
+    }
+    self.label2.text = text;
+    
+    [self setNeedsLayout];
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAITextPageView
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (UILabel *)label {
+    UILabel* label = [super label];
+    label.font = [UIFont boldSystemFontOfSize:11];
+    label.numberOfLines = 0;
+    return label;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithFrame:(CGRect)frame {
+    if ((self = [super initWithFrame:frame])) {
+        _textColumns = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)layoutSubviews {
+    [super layoutSubviews];
+    
+    if (0 == _textColumns.count) {
+        return;
+    }
+    CGFloat columnWidth = floorf((self.bounds.size.width - kPagePadding.left
+                                  - kPagePadding.right) / _textColumns.count);
+    CGSize columnSize = CGSizeMake(columnWidth, self.titleLabel.frame.origin.y
+                                   - kPagePadding.top);
+    
+    CGFloat x = kPagePadding.left;
+    for (UILabel* label in _textColumns) {
+        CGSize labelSize = [label sizeThatFits:columnSize];
+        label.frame = CGRectMake(x, kPagePadding.top,
+                                 columnWidth, MIN(labelSize.height, columnSize.height));
+        x += columnWidth;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)update {
+    [super update];
+    
+    // Subclasses change the text after calling this, before the next layout pass.
+    [self setNeedsLayout];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (UILabel *)addTextColumn {
+    UILabel* label = [self label];
+    [_textColumns addObject:label];
+    [self addSubview:label];
+    [self setNeedsLayout];
+    return label;
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIOverheadPageView
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithFrame:(CGRect)frame {
+    if ((self = [super initWithFrame:frame])) {
+        self.pageTitle = NSLocalizedString(@"Overhead", @"Overview Page Title: Overhead");
+        
+        _cpuLabel = [self addTextColumn];
+        _memoryLabel = [self addTextColumn];
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)update {
+    [super update];
+    
+    IAIOverheadMonitor* monitor = [IAInstrumentation overheadMonitor];
+    
+    NSMutableString* cpuText = [NSMutableString stringWithFormat:
+                                @"CPU %.2f%% of %.0f%%",
+                                monitor.cpuFraction * 100, monitor.cpuBudget * 100];
+    for (NSInteger ix = 0; ix < IAIOverheadNumberOfCollectors; ++ix) {
+        [cpuText appendFormat:@"\n%@ %.2f%%",
+         IAIOverheadCollectorName(ix), [monitor cpuFractionForCollector:ix] * 100];
+    }
+    [cpuText appendFormat:@"\nSampling every %.1fs", monitor.heartbeatInterval];
+    _cpuLabel.text = cpuText;
+    
+    NSMutableString* memoryText = [NSMutableString stringWithFormat:
+                                   @"Memory %@ of %@",
+                                   NIStringFromBytes(monitor.bytesOfHistories),
+                                   NIStringFromBytes(monitor.memoryBudget)];
+    for (NSInteger ix = 0; ix < IAIOverheadNumberOfHistories; ++ix) {
+        [memoryText appendFormat:@"\n%@ %@",
+         IAIOverheadHistoryName(ix), NIStringFromBytes([monitor bytesOfHistory:ix])];
+    }
+    [memoryText appendFormat:@"\n%.0f allocations/s", monitor.allocationsPerSecond];
+    [memoryText appendFormat:@"\n%llu dropped", monitor.numberOfDroppedRecords];
+    _memoryLabel.text = memoryText;
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIProfilerPageView
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithFrame:(CGRect)frame {
+    if ((self = [super initWithFrame:frame])) {
+        self.pageTitle = NSLocalizedString(@"Profiler", @"Overview Page Title: Profiler");
+        
+        _label = [self addTextColumn];
+        _numberOfSamplesShown = ULLONG_MAX;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)update {
+    [super update];
+    
+    IAIProfiler* profiler = [IAInstrumentation profiler];
+    unsigned long long numberOfSamples = profiler.numberOfSamples;
+    
+    // Symbolizing the samples is the expensive part, so only do it when there are new ones.
+    if (numberOfSamples == _numberOfSamplesShown) {
+        return;
+    }
+    _numberOfSamplesShown = numberOfSamples;
+    
+    if (0 == numberOfSamples) {
+        _label.text = (profiler.isRunning
+                       ? @"Sampling the main thread..."
+                       : @"Start [IAInstrumentation profiler] to sample the main thread.");
+        return;
+    }
+    
+    NSMutableString* text = [NSMutableString stringWithFormat:@"%llu samples", numberOfSamples];
+    if (profiler.numberOfTruncatedSamples > 0) {
+        [text appendFormat:@", %llu truncated", profiler.numberOfTruncatedSamples];
+    }
+    [text appendString:@" (self / total)"];
+    for (IAIProfiledFunction* function in [profiler topFunctions:8]) {
+        [text appendFormat:@"\n%4.1f%% %4.1f%% %@",
+         (double)function.selfCount * 100 / numberOfSamples,
+         (double)function.totalCount * 100 / numberOfSamples, function.name];
+    }
+    _label.text = text;
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static NSString* IAIStringFromDuration(NSTimeInterval duration) {
+    if (duration < 0.000001) {
+        return [NSString stringWithFormat:@"%.0fns", duration * 1000000000];
+    } else if (duration < 0.001) {
+        return [NSString stringWithFormat:@"%.1fus", duration * 1000000];
+    } else if (duration < 1) {
+        return [NSString stringWithFormat:@"%.1fms", duration * 1000];
+    }
+    return [NSString stringWithFormat:@"%.2fs", duration];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAILocksPageView
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithFrame:(CGRect)frame {
+    if ((self = [super initWithFrame:frame])) {
+        self.pageTitle = NSLocalizedString(@"Locks", @"Overview Page Title: Locks");
+        
+        _label = [self addTextColumn];
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)update {
+    [super update];
+    
+    IAILockMonitor* monitor = [IAInstrumentation lockMonitor];
+    NSArray* summaries = monitor.siteSummaries;
+    if (0 == summaries.count) {
+        _label.text = @"Use the locks of IAILockProfiler.h or IAISynchronized to measure them.";
+        return;
+    }
+    
+    NSMutableString* text =
+    [NSMutableString stringWithFormat:@"%.0f contentions/s, %@ waited/s "
+     @"(contended, wait p99, hold p99)",
+     monitor.contentionsPerSecond, IAIStringFromDuration(monitor.waitTimePerSecond)];
+    NSUInteger numberOfSitesShown = MIN(summaries.count, (NSUInteger)7);
+    for (NSUInteger ix = 0; ix < numberOfSitesShown; ++ix) {
+        IAILockSiteSummary* summary = [summaries objectAtIndex:ix];
+        [text appendFormat:@"\n%4.1f%% %@ %@ %@", summary.contentionRate * 100,
+         IAIStringFromDuration(summary.p99WaitTime), IAIStringFromDuration(summary.p99HoldTime),
+         summary.name];
+    }
+    _label.text = text;
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIInstancesPageView
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithFrame:(CGRect)frame {
+    if ((self = [super initWithFrame:frame])) {
+        self.pageTitle = NSLocalizedString(@"Instances", @"Overview Page Title: Instances");
+        
+        _label = [self addTextColumn];
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)update {
+    [super update];
+    
+    NSArray* summaries = [IAInstrumentation instanceTracker].typeSummaries;
+    if (0 == summaries.count) {
+        _label.text = (@"Track classes with IAIInstanceTracker, or derive C++ classes from "
+                       @"IAICountedInstance, to count their live instances.");
+        return;
+    }
+    
+    NSMutableString* text = [NSMutableString stringWithString:@"(growth/min, live)"];
+    NSUInteger numberOfTypesShown = MIN(summaries.count, (NSUInteger)7);
+    for (NSUInteger ix = 0; ix < numberOfTypesShown; ++ix) {
+        IAIInstanceTypeSummary* summary = [summaries objectAtIndex:ix];
+        [text appendFormat:@"\n%+8.1f %8lld %@", summary.growthPerSecond * 60,
+         summary.numberOfLiveInstances, summary.name];
+    }
+    _label.text = text;
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIStoragePageView
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithFrame:(CGRect)frame {
+    if ((self = [super initWithFrame:frame])) {
+        self.pageTitle = NSLocalizedString(@"Storage", @"Overview Page Title: Storage");
+        
+        _label = [self addTextColumn];
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)update {
+    [super update];
+    
+    IAIStorageMonitor* monitor = [IAInstrumentation storageMonitor];
+    if (0 == monitor.rootSummaries.count) {
+        _label.text = @"Scanning...";
+        return;
+    }
+    
+    NSMutableString* text = [NSMutableString string];
+    for (IAIStorageRootSummary* summary in monitor.rootSummaries) {
+        [text appendFormat:@"%@ %@ (%llu files)\n", NIStringFromBytes(summary.numberOfBytes),
+         summary.name, summary.numberOfFiles];
+    }
+    
+    NSArray* fileSummaries = monitor.fileSummaries;
+    if (0 == fileSummaries.count) {
+        [text appendString:@"No files have grown."];
+    } else {
+        [text appendString:@"(growth/min)"];
+    }
+    NSString* home = [NSHomeDirectory() stringByAppendingString:@"/"];
+    NSUInteger numberOfFilesShown = MIN(fileSummaries.count, (NSUInteger)3);
+    for (NSUInteger ix = 0; ix < numberOfFilesShown; ++ix) {
+        IAIStorageFileSummary* summary = [fileSummaries objectAtIndex:ix];
+        NSString* path = summary.path;
+        if ([path hasPrefix:home]) {
+            path = [path substringFromIndex:home.length];
+        }
+        [text appendFormat:@"\n+%@ %@",
+         NIStringFromBytes((unsigned long long)(summary.growthPerSecond * 60)), path];
+    }
+    _label.text = text;
+}
+
+
+@end
+
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 @implementation IAIConsoleLogPageView
 
+@synthesize filterQuery = _filterQuery;
+
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 - (void)dealloc {
@@ -469,6 +1141,25 @@ static const CGFloat kGraphRightMargin = 5;
         _logLabel = [self label];
         [_logScrollView addSubview:_logLabel];
         
+        _logText = [[NSMutableString alloc] init];
+        
+        _filterField = [[UITextField alloc] init];
+        _filterField.font = [UIFont systemFontOfSize:11];
+        _filterField.textColor = [UIColor whiteColor];
+        _filterField.backgroundColor = [UIColor colorWithWhite:1 alpha:0.15f];
+        _filterField.placeholder = NSLocalizedString(@"Filter",
+                                                     @"Overview Console Log Filter Placeholder");
+        _filterField.contentVerticalAlignment = UIControlContentVerticalAlignmentCenter;
+        _filterField.clearButtonMode = UITextFieldViewModeWhileEditing;
+        _filterField.autocapitalizationType = UITextAutocapitalizationTypeNone;
+        _filterField.autocorrectionType = UITextAutocorrectionTypeNo;
+        _filterField.returnKeyType = UIReturnKeyDone;
+        _filterField.delegate = self;
+        [_filterField addTarget: self
+                         action: @selector(filterFieldDidChange)
+               forControlEvents: UIControlEventEditingChanged];
+        [self addSubview:_filterField];
+        
         [[NSNotificationCenter defaultCenter] addObserver: self
                                                  selector: @selector(didAddLog:)
                                                      name: IAILoggerDidAddConsoleLog
@@ -486,9 +1177,15 @@ static const CGFloat kGraphRightMargin = 5;
         isBottomNearby = YES;
     }
     
-    _logScrollView.frame = CGRectMake(0, 0,
+    _filterField.frame = CGRectMake(kPagePadding.left, kPagePadding.top,
+                                    self.bounds.size.width - kPagePadding.left
+                                    - kPagePadding.right,
+                                    kFilterFieldHeight);
+    
+    CGFloat filterBottom = CGRectGetMaxY(_filterField.frame);
+    _logScrollView.frame = CGRectMake(0, filterBottom,
                                       self.bounds.size.width,
-                                      self.bounds.size.height);
+                                      self.bounds.size.height - filterBottom);
     
     CGSize labelSize = [_logLabel.text sizeWithFont: _logLabel.font
                                   constrainedToSize: CGSizeMake(_logScrollView.bounds.size.width,
@@ -534,9 +1231,7 @@ static const CGFloat kGraphRightMargin = 5;
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-- (void)didAddLog:(NSNotification *)notification {
-    IAIConsoleLogEntry* entry = [[notification userInfo] objectForKey:@"entry"];
-    
+- (NSString *)formattedLogEntry:(IAIConsoleLogEntry *)entry {
     static NSDateFormatter* formatter = nil;
     if (nil == formatter) {
         formatter = [[NSDateFormatter alloc] init];
@@ -548,10 +1243,107 @@ static const CGFloat kGraphRightMargin = 5;
                               [formatter stringFromDate:entry.timestamp],
                               entry.log];
     
-    if (nil != _logLabel.text) {
-        _logLabel.text = [_logLabel.text stringByAppendingFormat:@"\n%@", formattedLog];
+    // Repeats are counted on the entry after it is first shown, so only entries formatted
+    // later, such as filter results, show the count.
+    if (entry.repeatCount > 1) {
+        formattedLog = [formattedLog stringByAppendingFormat:
+                        @" (x%lu)", (unsigned long)entry.repeatCount];
+    }
+    return formattedLog;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)isFiltering {
+    return nil != _filterQuery && ![_filterQuery isEmpty];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)reloadLogText {
+    if (![self isFiltering]) {
+        _logLabel.text = ([_logText length] > 0) ? [_logText copy] : nil;
+        [self contentSizeChanged];
+        return;
+    }
+    
+    // Walk back from the newest match so that only the lines that are shown are formatted.
+    NSMutableArray* formattedLogs = [[NSMutableArray alloc] init];
+    [self.logger readConsoleLogIndexUsingBlock:^(IAIConsoleLogIndex* index) {
+        NSIndexSet* lineIds = [index lineIdsMatchingQuery:_filterQuery];
+        [lineIds enumerateIndexesWithOptions: NSEnumerationReverse
+                                  usingBlock:
+         ^(NSUInteger lineId, BOOL* stop) {
+             [formattedLogs addObject:[self formattedLogEntry:[index entryWithLineId:lineId]]];
+             *stop = ([formattedLogs count] >= kMaximumNumberOfFilteredLogs);
+         }];
+    }];
+    
+    NSArray* chronologicalLogs = [[formattedLogs reverseObjectEnumerator] allObjects];
+    _logLabel.text = ([chronologicalLogs count] > 0
+                      ? [chronologicalLogs componentsJoinedByString:@"\n"]
+                      : nil);
+    [self contentSizeChanged];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)setFilterQuery:(IAIConsoleLogQuery *)filterQuery {
+    _filterQuery = [filterQuery copy];
+    
+    [self reloadLogText];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)filterFieldDidChange {
+    self.filterQuery = [IAIConsoleLogQuery queryWithFilterString:_filterField.text];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)textFieldShouldReturn:(UITextField *)textField {
+    [textField resignFirstResponder];
+    return NO;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)didAddLog:(NSNotification *)notification {
+    if ([notification object] != self.logger) {
+        return;
+    }
+    NSArray* entries = [[notification userInfo] objectForKey:@"entries"];
+    
+    NSMutableString* matchingLogs = [NSMutableString string];
+    for (IAIConsoleLogEntry* entry in entries) {
+        NSString* formattedLog = [self formattedLogEntry:entry];
+        
+        if ([_logText length] > 0) {
+            [_logText appendString:@"\n"];
+        }
+        [_logText appendString:formattedLog];
+        
+        if ([self isFiltering] && [_filterQuery matchesEntry:entry]) {
+            if ([matchingLogs length] > 0) {
+                [matchingLogs appendString:@"\n"];
+            }
+            [matchingLogs appendString:formattedLog];
+        }
+    }
+    
+    if (![self isFiltering]) {
+        _logLabel.text = [_logText copy];
+        
+    } else if ([matchingLogs length] > 0) {
+        if (nil != _logLabel.text) {
+            _logLabel.text = [_logLabel.text stringByAppendingFormat:@"\n%@", matchingLogs];
+        } else {
+            _logLabel.text = matchingLogs;
+        }
+        
     } else {
-        _logLabel.text = formattedLog;
+        return;
     }
     
     [self contentSizeChanged];
@@ -0,0 +1,206 @@
+//
+//  IAIProcessCounters.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#include "IAIProcessCounters.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#include <fcntl.h>
+#include <mach/mach.h>
+#if defined(__has_include)
+#if __has_include(<libproc.h>)
+#include <libproc.h>
+#define IAI_HAS_LIBPROC 1
+#endif
+#endif
+#else
+#include <dirent.h>
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static unsigned IAIProcessCountersReadContextSwitches(IAIProcessCounts* counts) {
+    struct rusage usage;
+    if (0 != getrusage(RUSAGE_SELF, &usage)) {
+        return 0;
+    }
+    counts->numberOfVoluntaryContextSwitches = (uint64_t)usage.ru_nvcsw;
+    counts->numberOfInvoluntaryContextSwitches = (uint64_t)usage.ru_nivcsw;
+    return IAIProcessCounterContextSwitches;
+}
+
+
+#if defined(__APPLE__)
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static unsigned IAIProcessCountersReadPageFaults(IAIProcessCounts* counts) {
+    task_events_info_data_t info;
+    mach_msg_type_number_t count = TASK_EVENTS_INFO_COUNT;
+    if (KERN_SUCCESS != task_info(mach_task_self(), TASK_EVENTS_INFO, (task_info_t)&info,
+                                  &count)) {
+        return 0;
+    }
+    // The kernel keeps these in 32 bits.
+    counts->numberOfPageFaults = (uint32_t)info.faults;
+    counts->numberOfMajorPageFaults = (uint32_t)info.pageins;
+    return IAIProcessCounterPageFaults;
+}
+
+
+#if defined(IAI_HAS_LIBPROC)
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static unsigned IAIProcessCountersReadOpenFiles(IAIProcessCounts* counts) {
+    // Without a buffer the call returns the size of the process's table of files, which is
+    // usually larger than the number of files that are open.
+    pid_t pid = getpid();
+    int bufferSize = proc_pidinfo(pid, PROC_PIDLISTFDS, 0, NULL, 0);
+    if (bufferSize <= 0) {
+        return 0;
+    }
+    struct proc_fdinfo* fds = malloc((size_t)bufferSize);
+    if (NULL == fds) {
+        return 0;
+    }
+    int size = proc_pidinfo(pid, PROC_PIDLISTFDS, 0, fds, bufferSize);
+    free(fds);
+    if (size < 0) {
+        return 0;
+    }
+    counts->numberOfOpenFiles = (uint32_t)(size / PROC_PIDLISTFD_SIZE);
+    return IAIProcessCounterOpenFiles;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static unsigned IAIProcessCountersReadBytes(IAIProcessCounts* counts) {
+    struct rusage_info_v2 info;
+    if (0 != proc_pid_rusage(getpid(), RUSAGE_INFO_V2, (rusage_info_t *)&info)) {
+        return 0;
+    }
+    counts->bytesRead = info.ri_diskio_bytesread;
+    counts->bytesWritten = info.ri_diskio_byteswritten;
+    return IAIProcessCounterBytes;
+}
+
+#else
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The SDK has no proc_pidinfo, so probe each descriptor. The table of an app holds a few hundred
+// descriptors unless it raises its limit.
+static unsigned IAIProcessCountersReadOpenFiles(IAIProcessCounts* counts) {
+    int tableSize = getdtablesize();
+    uint32_t numberOfOpenFiles = 0;
+    for (int fd = 0; fd < tableSize; ++fd) {
+        if (-1 != fcntl(fd, F_GETFD)) {
+            ++numberOfOpenFiles;
+        }
+    }
+    counts->numberOfOpenFiles = numberOfOpenFiles;
+    return IAIProcessCounterOpenFiles;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static unsigned IAIProcessCountersReadBytes(IAIProcessCounts* counts) {
+    return 0;
+}
+
+#endif
+
+#else
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static unsigned IAIProcessCountersReadPageFaults(IAIProcessCounts* counts) {
+    FILE* file = fopen("/proc/self/stat", "r");
+    if (NULL == file) {
+        return 0;
+    }
+    char line[1024];
+    char* fields = NULL;
+    if (NULL != fgets(line, sizeof(line), file)) {
+        // The name of the command is in parentheses and may itself contain spaces and
+        // parentheses, so the fields start after the last one.
+        fields = strrchr(line, ')');
+    }
+    fclose(file);
+
+    // The fields after the name are state, ppid, pgrp, session, tty_nr, tpgid, flags, minflt,
+    // cminflt and majflt.
+    unsigned long long minorFaults = 0;
+    unsigned long long majorFaults = 0;
+    if (NULL == fields
+        || 2 != sscanf(fields + 1, " %*c %*d %*d %*d %*d %*d %*u %llu %*u %llu",
+                       &minorFaults, &majorFaults)) {
+        return 0;
+    }
+    counts->numberOfPageFaults = minorFaults + majorFaults;
+    counts->numberOfMajorPageFaults = majorFaults;
+    return IAIProcessCounterPageFaults;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static unsigned IAIProcessCountersReadOpenFiles(IAIProcessCounts* counts) {
+    DIR* directory = opendir("/proc/self/fd");
+    if (NULL == directory) {
+        return 0;
+    }
+    uint32_t numberOfEntries = 0;
+    struct dirent* entry;
+    while (NULL != (entry = readdir(directory))) {
+        if ('.' != entry->d_name[0]) {
+            ++numberOfEntries;
+        }
+    }
+    closedir(directory);
+
+    // Leave out the descriptor of the directory itself.
+    counts->numberOfOpenFiles = (numberOfEntries > 0) ? numberOfEntries - 1 : 0;
+    return IAIProcessCounterOpenFiles;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static unsigned IAIProcessCountersReadBytes(IAIProcessCounts* counts) {
+    FILE* file = fopen("/proc/self/io", "r");
+    if (NULL == file) {
+        return 0;
+    }
+    unsigned found = 0;
+    char line[128];
+    unsigned long long value;
+    while (NULL != fgets(line, sizeof(line), file)) {
+        if (1 == sscanf(line, "read_bytes: %llu", &value)) {
+            counts->bytesRead = value;
+            found |= 1;
+        } else if (1 == sscanf(line, "write_bytes: %llu", &value)) {
+            counts->bytesWritten = value;
+            found |= 2;
+        }
+    }
+    fclose(file);
+    return (3 == found) ? IAIProcessCounterBytes : 0;
+}
+
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned IAIProcessCountersRead(IAIProcessCounts* counts) {
+    memset(counts, 0, sizeof(*counts));
+    return (IAIProcessCountersReadPageFaults(counts)
+            | IAIProcessCountersReadContextSwitches(counts)
+            | IAIProcessCountersReadOpenFiles(counts)
+            | IAIProcessCountersReadBytes(counts));
+}
@@ -0,0 +1,57 @@
+//
+//  IAIProcessCounters.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#ifndef InAppInstrumentation_IAIProcessCounters_h
+#define InAppInstrumentation_IAIProcessCounters_h
+
+#include <stdint.h>
+
+/**
+ * Reads the kernel's counters of the work it has done for the process.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * On Apple platforms the page faults come from the task's events (task_info with
+ * TASK_EVENTS_INFO), the context switches from getrusage and the open files and bytes read and
+ * written from proc_pidinfo and proc_pid_rusage where the SDK has them. Elsewhere the page
+ * faults come from /proc/self/stat, the context switches from getrusage, the bytes from
+ * /proc/self/io and the open files from the entries of /proc/self/fd.
+ *
+ * A major page fault had to wait for the page to be read in from storage; a minor one was
+ * resolved in memory, e.g. by zero filling a new page or mapping one that was already cached.
+ * Bytes read and written are those that reached storage, not those that were served from or
+ * absorbed by the file cache.
+ *
+ * All counts except the number of open files are totals since the process started.
+ */
+
+typedef enum {
+    IAIProcessCounterPageFaults         = 1 << 0,
+    IAIProcessCounterContextSwitches    = 1 << 1,
+    IAIProcessCounterOpenFiles          = 1 << 2,
+    IAIProcessCounterBytes              = 1 << 3,
+} IAIProcessCounter;
+
+typedef struct {
+    uint64_t numberOfPageFaults;
+    uint64_t numberOfMajorPageFaults;
+    uint64_t numberOfVoluntaryContextSwitches;
+    uint64_t numberOfInvoluntaryContextSwitches;
+    uint64_t bytesRead;
+    uint64_t bytesWritten;
+    uint32_t numberOfOpenFiles;
+} IAIProcessCounts;
+
+/**
+ * Reads the counters of the calling process.
+ *
+ * Returns the IAIProcessCounter flags of the counters that could be read; the others are zero.
+ */
+unsigned IAIProcessCountersRead(IAIProcessCounts* counts);
+
+#endif
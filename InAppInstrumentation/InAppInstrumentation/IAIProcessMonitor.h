@@ -0,0 +1,92 @@
+//
+//  IAIProcessMonitor.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "IAIProcessCounters.h"
+
+@class IAILogger;
+
+// The metrics that the process monitor adds to its logger.
+extern NSString* const IAIMetricPageFaultsPerSecond;
+extern NSString* const IAIMetricMajorPageFaultsPerSecond;
+extern NSString* const IAIMetricVoluntaryContextSwitchesPerSecond;
+extern NSString* const IAIMetricInvoluntaryContextSwitchesPerSecond;
+extern NSString* const IAIMetricBytesReadPerSecond;
+extern NSString* const IAIMetricBytesWrittenPerSecond;
+extern NSString* const IAIMetricNumberOfOpenFiles;
+
+/**
+ * Measures how hard the app is working the kernel.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * Once per heartbeat the monitor reads the process's counters (see IAIProcessCounters.h), turns
+ * the page faults, context switches and bytes read and written into rates and adds them to the
+ * logger as metrics, along with the number of open files. The metrics are kept, rolled up and
+ * exported like every other metric of the logger.
+ *
+ * Voluntary context switches are the thread blocking, e.g. on I/O or a lock; involuntary ones
+ * are the scheduler taking the CPU away, which grows when the app has more runnable threads
+ * than there are cores. A number of open files that only ever grows is a leak of descriptors.
+ *
+ * Counters that the platform can't read are left out of the metrics.
+ */
+@interface IAIProcessMonitor : NSObject {
+@private
+    __weak IAILogger* _logger;
+
+    NSTimeInterval _lastUpdateTime;
+    IAIProcessCounts _lastCounts;
+    unsigned _availableCounters;
+    double _pageFaultsPerSecond;
+    double _majorPageFaultsPerSecond;
+    double _voluntaryContextSwitchesPerSecond;
+    double _involuntaryContextSwitchesPerSecond;
+    double _bytesReadPerSecond;
+    double _bytesWrittenPerSecond;
+}
+
+#pragma mark Creating a Monitor /** @name Creating a Monitor */
+
+/**
+ * Designated initializer.
+ *
+ * The logger is not retained.
+ */
+- (id)initWithLogger:(IAILogger *)logger;
+
+
+#pragma mark Reading Counters /** @name Reading Counters */
+
+/**
+ * Reads the counters and adds the metrics to the logger.
+ *
+ * Call this from the main thread once per heartbeat.
+ */
+- (void)update;
+
+/**
+ * The IAIProcessCounter flags of the counters that the last update could read.
+ */
+@property (nonatomic, readonly, assign) unsigned availableCounters;
+
+/**
+ * The counters as of the last update.
+ */
+@property (nonatomic, readonly, assign) IAIProcessCounts counts;
+
+// The rates between the last two updates.
+@property (nonatomic, readonly, assign) double pageFaultsPerSecond;
+@property (nonatomic, readonly, assign) double majorPageFaultsPerSecond;
+@property (nonatomic, readonly, assign) double voluntaryContextSwitchesPerSecond;
+@property (nonatomic, readonly, assign) double involuntaryContextSwitchesPerSecond;
+@property (nonatomic, readonly, assign) double bytesReadPerSecond;
+@property (nonatomic, readonly, assign) double bytesWrittenPerSecond;
+
+@end
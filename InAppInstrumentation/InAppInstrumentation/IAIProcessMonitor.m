@@ -0,0 +1,112 @@
+//
+//  IAIProcessMonitor.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAIProcessMonitor.h"
+
+#import "IAILogger.h"
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+NSString* const IAIMetricPageFaultsPerSecond = @"pageFaultsPerSecond";
+NSString* const IAIMetricMajorPageFaultsPerSecond = @"majorPageFaultsPerSecond";
+NSString* const IAIMetricVoluntaryContextSwitchesPerSecond = @"voluntaryContextSwitchesPerSecond";
+NSString* const IAIMetricInvoluntaryContextSwitchesPerSecond =
+    @"involuntaryContextSwitchesPerSecond";
+NSString* const IAIMetricBytesReadPerSecond = @"bytesReadPerSecond";
+NSString* const IAIMetricBytesWrittenPerSecond = @"bytesWrittenPerSecond";
+NSString* const IAIMetricNumberOfOpenFiles = @"numberOfOpenFiles";
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Counters that the kernel keeps in 32 bits wrap around, so a counter that went backwards is
+// counted as unchanged rather than as a huge rate.
+static double IAIRateOfCounter(uint64_t count, uint64_t lastCount, NSTimeInterval elapsed) {
+    return (count >= lastCount) ? (double)(count - lastCount) / elapsed : 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIProcessMonitor
+
+@synthesize availableCounters = _availableCounters;
+@synthesize counts = _lastCounts;
+@synthesize pageFaultsPerSecond = _pageFaultsPerSecond;
+@synthesize majorPageFaultsPerSecond = _majorPageFaultsPerSecond;
+@synthesize voluntaryContextSwitchesPerSecond = _voluntaryContextSwitchesPerSecond;
+@synthesize involuntaryContextSwitchesPerSecond = _involuntaryContextSwitchesPerSecond;
+@synthesize bytesReadPerSecond = _bytesReadPerSecond;
+@synthesize bytesWrittenPerSecond = _bytesWrittenPerSecond;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithLogger:(IAILogger *)logger {
+    if ((self = [super init])) {
+        _logger = logger;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)update {
+    IAIProcessCounts counts;
+    unsigned availableCounters = IAIProcessCountersRead(&counts);
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    IAILogger* logger = _logger;
+
+    // The first update only sets the baseline of the rates, and so does the first update after
+    // a counter becomes readable.
+    unsigned ratedCounters = (_lastUpdateTime > 0 && now > _lastUpdateTime)
+                              ? (availableCounters & _availableCounters) : 0;
+    NSTimeInterval elapsed = now - _lastUpdateTime;
+
+    if (ratedCounters & IAIProcessCounterPageFaults) {
+        _pageFaultsPerSecond = IAIRateOfCounter(counts.numberOfPageFaults,
+                                                _lastCounts.numberOfPageFaults, elapsed);
+        _majorPageFaultsPerSecond = IAIRateOfCounter(counts.numberOfMajorPageFaults,
+                                                     _lastCounts.numberOfMajorPageFaults,
+                                                     elapsed);
+        [logger addMetricValue:_pageFaultsPerSecond forName:IAIMetricPageFaultsPerSecond];
+        [logger addMetricValue: _majorPageFaultsPerSecond
+                       forName: IAIMetricMajorPageFaultsPerSecond];
+    }
+    if (ratedCounters & IAIProcessCounterContextSwitches) {
+        _voluntaryContextSwitchesPerSecond =
+        IAIRateOfCounter(counts.numberOfVoluntaryContextSwitches,
+                         _lastCounts.numberOfVoluntaryContextSwitches, elapsed);
+        _involuntaryContextSwitchesPerSecond =
+        IAIRateOfCounter(counts.numberOfInvoluntaryContextSwitches,
+                         _lastCounts.numberOfInvoluntaryContextSwitches, elapsed);
+        [logger addMetricValue: _voluntaryContextSwitchesPerSecond
+                       forName: IAIMetricVoluntaryContextSwitchesPerSecond];
+        [logger addMetricValue: _involuntaryContextSwitchesPerSecond
+                       forName: IAIMetricInvoluntaryContextSwitchesPerSecond];
+    }
+    if (ratedCounters & IAIProcessCounterBytes) {
+        _bytesReadPerSecond = IAIRateOfCounter(counts.bytesRead, _lastCounts.bytesRead, elapsed);
+        _bytesWrittenPerSecond = IAIRateOfCounter(counts.bytesWritten, _lastCounts.bytesWritten,
+                                                  elapsed);
+        [logger addMetricValue:_bytesReadPerSecond forName:IAIMetricBytesReadPerSecond];
+        [logger addMetricValue:_bytesWrittenPerSecond forName:IAIMetricBytesWrittenPerSecond];
+    }
+    if (availableCounters & IAIProcessCounterOpenFiles) {
+        [logger addMetricValue: (double)counts.numberOfOpenFiles
+                       forName: IAIMetricNumberOfOpenFiles];
+    }
+
+    _lastUpdateTime = now;
+    _lastCounts = counts;
+    _availableCounters = availableCounters;
+}
+
+
+@end
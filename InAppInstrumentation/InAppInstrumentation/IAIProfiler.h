@@ -0,0 +1,159 @@
+//
+//  IAIProfiler.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <pthread.h>
+
+#import "IAICallTree.h"
+#import "IAIStackSampler.h"
+
+/**
+ * A function that appeared in the samples of an IAIProfiler.
+ *
+ *      @ingroup Overview-Logger
+ */
+@interface IAIProfiledFunction : NSObject {
+@private
+    NSString* _name;
+    NSUInteger _selfCount;
+    NSUInteger _totalCount;
+}
+
+/**
+ * The symbol of the function, or its image and offset if the image has no symbols.
+ */
+@property (nonatomic, readonly, copy) NSString* name;
+
+/**
+ * The number of samples in which the function was running.
+ */
+@property (nonatomic, readonly, assign) NSUInteger selfCount;
+
+/**
+ * The number of samples in which the function was on the stack.
+ */
+@property (nonatomic, readonly, assign) NSUInteger totalCount;
+
+@end
+
+
+/**
+ * A sampling profiler of one thread.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * While it runs, the profiler captures the stack of its thread every samplingInterval seconds
+ * from a thread of its own (see IAIStackSampler.h) and adds it to a call tree (see
+ * IAICallTree.h). The stacks are kept as raw addresses and are only symbolized when they are
+ * read, so a sample costs a stack walk and a walk down the tree.
+ *
+ * The tree holds a fixed number of nodes. Once they are used up, stacks that need new nodes
+ * are cut short and counted in numberOfTruncatedSamples; call reset to start over.
+ *
+ * The stacks can be read as the functions that were sampled most often or in the collapsed
+ * format of Brendan Gregg's FlameGraph tools:
+ *
+ * @code
+ *  [profiler writeCollapsedStacksToFile:path error:&error];
+ *
+ *  $ flamegraph.pl stacks.txt > stacks.svg
+ * @endcode
+ */
+@interface IAIProfiler : NSObject {
+@private
+    IAIStackSampler* _sampler;
+    IAICallTree _tree;
+    pthread_mutex_t _treeLock;
+    NSThread* _samplingThread;
+    NSTimeInterval _samplingInterval;
+    volatile int64_t _numberOfFailedSamples;
+
+    // Symbolization, only used on the main thread.
+    NSMutableDictionary* _functionStartsByAddress;
+    NSMutableDictionary* _functionNamesByStart;
+}
+
+#pragma mark Creating a Profiler /** @name Creating a Profiler */
+
+/**
+ * Creates a profiler of the calling thread whose tree holds the given number of nodes.
+ *
+ * Designated initializer. Returns nil if the tree can't be allocated or the thread's stack
+ * can't be found.
+ */
+- (id)initWithCapacity:(NSUInteger)numberOfNodes;
+
+/**
+ * Creates a profiler of the calling thread with room for 32768 nodes.
+ */
+- (id)init;
+
+
+#pragma mark Sampling /** @name Sampling */
+
+/**
+ * The number of seconds between samples.
+ *
+ * By default this is 0.01 seconds.
+ */
+@property (nonatomic, readwrite, assign) NSTimeInterval samplingInterval;
+
+/**
+ * Starts sampling on a new thread. The thread retains the profiler until it is stopped.
+ */
+- (void)start;
+
+/**
+ * Stops sampling. The samples are kept.
+ */
+- (void)stop;
+
+@property (nonatomic, readonly, assign, getter=isRunning) BOOL running;
+
+/**
+ * Removes every sample.
+ */
+- (void)reset;
+
+@property (nonatomic, readonly, assign) unsigned long long numberOfSamples;
+
+/**
+ * The number of samples whose stacks were cut short because the tree was full.
+ */
+@property (nonatomic, readonly, assign) unsigned long long numberOfTruncatedSamples;
+
+/**
+ * The number of times the stack could not be captured.
+ */
+@property (nonatomic, readonly, assign) unsigned long long numberOfFailedSamples;
+
+
+#pragma mark Reading Samples /** @name Reading Samples */
+
+/**
+ * The functions that were running in the most samples, as IAIProfiledFunction objects, most
+ * sampled first.
+ *
+ * Call this from the main thread.
+ */
+- (NSArray *)topFunctions:(NSUInteger)count;
+
+/**
+ * One line for every distinct stack, with the functions from the root to the leaf separated by
+ * semicolons and followed by the number of samples.
+ *
+ * Call this from the main thread.
+ */
+- (NSString *)collapsedStacks;
+
+/**
+ * Writes collapsedStacks to a file.
+ */
+- (BOOL)writeCollapsedStacksToFile:(NSString *)path error:(NSError **)error;
+
+@end
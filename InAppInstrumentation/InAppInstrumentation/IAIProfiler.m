@@ -0,0 +1,349 @@
+//
+//  IAIProfiler.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAIProfiler.h"
+
+#import "IAIOverhead.h"
+
+#import <dlfcn.h>
+#import <libkern/OSAtomic.h>
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+static const NSUInteger kDefaultCapacity = 32768;
+
+// A stack copied out of the tree, followed by its frames.
+typedef struct {
+    uint32_t count;
+    uint32_t depth;
+} IAIProfilerStackHeader;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIProfiledFunction
+
+@synthesize name = _name;
+@synthesize selfCount = _selfCount;
+@synthesize totalCount = _totalCount;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithName:(NSString *)name {
+    if ((self = [super init])) {
+        _name = [name copy];
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)addSamples:(NSUInteger)count running:(BOOL)running {
+    if (running) {
+        _selfCount += count;
+    }
+    _totalCount += count;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@ %@ self %lu total %lu>",
+            NSStringFromClass([self class]), _name,
+            (unsigned long)_selfCount, (unsigned long)_totalCount];
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIProfiler
+
+@synthesize samplingInterval = _samplingInterval;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)dealloc {
+    IAIStackSamplerDestroy(_sampler);
+    IAICallTreeDestroy(&_tree);
+    pthread_mutex_destroy(&_treeLock);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithCapacity:(NSUInteger)numberOfNodes {
+    if ((self = [super init])) {
+        if (!IAICallTreeInit(&_tree, (uint32_t)MIN(numberOfNodes, UINT32_MAX))) {
+            return nil;
+        }
+        _sampler = IAIStackSamplerCreateForCurrentThread();
+        if (NULL == _sampler) {
+            return nil;
+        }
+        pthread_mutex_init(&_treeLock, NULL);
+        _samplingInterval = 0.01;
+        _functionStartsByAddress = [[NSMutableDictionary alloc] init];
+        _functionNamesByStart = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)init {
+    return [self initWithCapacity:kDefaultCapacity];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Sampling
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)sampleUntilCancelled {
+    @autoreleasepool {
+        [[NSThread currentThread] setName:@"IAIProfiler"];
+        [NSThread setThreadPriority:1.0];
+    }
+
+    // Samples allocate nothing, so that they don't disturb what they measure.
+    uintptr_t frames[IAICallTreeMaxDepth];
+    NSThread* thread = [NSThread currentThread];
+    while (![thread isCancelled]) {
+        IAIOverheadSection section;
+        IAIOverheadBeginSection(&section, IAIOverheadProfiling);
+
+        // The tree is only locked once the thread is running again, since the thread may be
+        // waiting for the lock itself.
+        unsigned depth = IAIStackSamplerCapture(_sampler, frames, IAICallTreeMaxDepth);
+        if (depth > 0) {
+            pthread_mutex_lock(&_treeLock);
+            IAICallTreeAddStack(&_tree, frames, depth);
+            pthread_mutex_unlock(&_treeLock);
+
+        } else {
+            OSAtomicIncrement64Barrier(&_numberOfFailedSamples);
+        }
+
+        IAIOverheadEndSection(&section);
+
+        usleep((useconds_t)(_samplingInterval * 1000000));
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)start {
+    if (nil == _samplingThread) {
+        _samplingThread = [[NSThread alloc] initWithTarget: self
+                                                  selector: @selector(sampleUntilCancelled)
+                                                    object: nil];
+        [_samplingThread start];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)stop {
+    [_samplingThread cancel];
+    _samplingThread = nil;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)isRunning {
+    return nil != _samplingThread;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)reset {
+    pthread_mutex_lock(&_treeLock);
+    IAICallTreeReset(&_tree);
+    pthread_mutex_unlock(&_treeLock);
+    _numberOfFailedSamples = 0;
+    [_functionStartsByAddress removeAllObjects];
+    [_functionNamesByStart removeAllObjects];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (unsigned long long)numberOfSamples {
+    pthread_mutex_lock(&_treeLock);
+    unsigned long long numberOfSamples = _tree.numberOfSamples;
+    pthread_mutex_unlock(&_treeLock);
+    return numberOfSamples;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (unsigned long long)numberOfTruncatedSamples {
+    pthread_mutex_lock(&_treeLock);
+    unsigned long long numberOfTruncatedSamples = _tree.numberOfTruncatedSamples;
+    pthread_mutex_unlock(&_treeLock);
+    return numberOfTruncatedSamples;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (unsigned long long)numberOfFailedSamples {
+    return (unsigned long long)OSAtomicAdd64Barrier(0, &_numberOfFailedSamples);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Reading Samples
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAIProfilerCopyStack(const uintptr_t* frames, unsigned depth, uint32_t count,
+                                 void* context) {
+    NSMutableData* stacks = (__bridge NSMutableData *)context;
+    IAIProfilerStackHeader header = { count, depth };
+    [stacks appendBytes:&header length:sizeof(header)];
+    [stacks appendBytes:frames length:depth * sizeof(uintptr_t)];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Copies the stacks out of the tree so that it is only locked for as long as the copy takes.
+- (void)enumerateStacksUsingBlock:(void (^)(const uintptr_t* frames, unsigned depth,
+                                            NSUInteger count))block {
+    NSMutableData* stacks = [[NSMutableData alloc] init];
+    pthread_mutex_lock(&_treeLock);
+    IAICallTreeEnumerateStacks(&_tree, IAIProfilerCopyStack, (__bridge void *)stacks);
+    pthread_mutex_unlock(&_treeLock);
+
+    const uint8_t* bytes = [stacks bytes];
+    const uint8_t* end = bytes + [stacks length];
+    while (bytes < end) {
+        IAIProfilerStackHeader header;
+        memcpy(&header, bytes, sizeof(header));
+        bytes += sizeof(header);
+        block((const uintptr_t *)bytes, header.depth, header.count);
+        bytes += header.depth * sizeof(uintptr_t);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The start of the function that contains an address, which identifies the function.
+- (NSNumber *)functionStartForAddress:(uintptr_t)address {
+    NSNumber* key = [NSNumber numberWithUnsignedLong:address];
+    NSNumber* start = [_functionStartsByAddress objectForKey:key];
+    if (nil != start) {
+        return start;
+    }
+
+    Dl_info info;
+    BOOL found = (0 != dladdr((const void *)address, &info));
+    NSString* name = nil;
+    if (found && NULL != info.dli_saddr && NULL != info.dli_sname) {
+        start = [NSNumber numberWithUnsignedLong:(uintptr_t)info.dli_saddr];
+        name = [NSString stringWithUTF8String:info.dli_sname];
+
+    } else if (found && NULL != info.dli_fname) {
+        // Without symbols, every address of the image is its own function.
+        uintptr_t offset = address - (uintptr_t)info.dli_fbase;
+        start = key;
+        name = [NSString stringWithFormat:@"%@+0x%lx",
+                [[NSString stringWithUTF8String:info.dli_fname] lastPathComponent],
+                (unsigned long)offset];
+
+    } else {
+        start = key;
+        name = [NSString stringWithFormat:@"0x%lx", (unsigned long)address];
+    }
+
+    [_functionStartsByAddress setObject:start forKey:key];
+    if (nil == [_functionNamesByStart objectForKey:start]) {
+        [_functionNamesByStart setObject:name forKey:start];
+    }
+    return start;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSArray *)topFunctions:(NSUInteger)count {
+    NSMutableDictionary* functions = [[NSMutableDictionary alloc] init];
+    [self enumerateStacksUsingBlock:^(const uintptr_t* frames, unsigned depth,
+                                      NSUInteger stackCount) {
+        // A recursive function is only counted once per stack.
+        NSMutableSet* functionsOfStack = [[NSMutableSet alloc] initWithCapacity:depth];
+        for (NSInteger ix = depth - 1; ix >= 0; --ix) {
+            NSNumber* start = [self functionStartForAddress:frames[ix]];
+            if ([functionsOfStack containsObject:start]) {
+                continue;
+            }
+            [functionsOfStack addObject:start];
+
+            IAIProfiledFunction* function = [functions objectForKey:start];
+            if (nil == function) {
+                function = [[IAIProfiledFunction alloc]
+                            initWithName:[_functionNamesByStart objectForKey:start]];
+                [functions setObject:function forKey:start];
+            }
+            [function addSamples:stackCount running:(ix == (NSInteger)depth - 1)];
+        }
+    }];
+
+    NSArray* sortedFunctions = [[functions allValues] sortedArrayUsingComparator:
+                                ^NSComparisonResult(IAIProfiledFunction* function1,
+                                                    IAIProfiledFunction* function2) {
+                                    if (function1.selfCount != function2.selfCount) {
+                                        return ((function1.selfCount > function2.selfCount)
+                                                ? NSOrderedAscending : NSOrderedDescending);
+                                    }
+                                    return [function1.name compare:function2.name];
+                                }];
+    return [sortedFunctions subarrayWithRange:NSMakeRange(0, MIN(count,
+                                                                 [sortedFunctions count]))];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSString *)collapsedStacks {
+    NSMutableString* collapsedStacks = [[NSMutableString alloc] init];
+    [self enumerateStacksUsingBlock:^(const uintptr_t* frames, unsigned depth,
+                                      NSUInteger stackCount) {
+        for (unsigned ix = 0; ix < depth; ++ix) {
+            NSNumber* start = [self functionStartForAddress:frames[ix]];
+            NSString* name = [_functionNamesByStart objectForKey:start];
+            if (ix > 0) {
+                [collapsedStacks appendString:@";"];
+            }
+            // Semicolons separate the frames.
+            [collapsedStacks appendString:[name stringByReplacingOccurrencesOfString: @";"
+                                                                          withString: @":"]];
+        }
+        [collapsedStacks appendFormat:@" %lu\n", (unsigned long)stackCount];
+    }];
+    return collapsedStacks;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)writeCollapsedStacksToFile:(NSString *)path error:(NSError **)error {
+    return [[self collapsedStacks] writeToFile: path
+                                    atomically: YES
+                                      encoding: NSUTF8StringEncoding
+                                         error: error];
+}
+
+
+@end
@@ -0,0 +1,254 @@
+//
+//  IAIQueueMonitor.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import <pthread.h>
+
+#import "IAIHistogram.h"
+
+@class IAILogger;
+
+// The metrics that the queue monitor adds to its logger. The total depth is the number of
+// blocks waiting to start on all tracked queues; the prefixed metrics are per queue, e.g.
+// "queueDepth.image decoding".
+extern NSString* const IAIMetricQueueDepth;
+extern NSString* const IAIMetricQueueDepthPrefix;
+extern NSString* const IAIMetricQueueWaitTimePrefix;
+
+/**
+ * Submits a block to a dispatch queue and tracks how long it waits and runs.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * The block is charged to the tracker with the given name, or to the queue's label if the name
+ * is nil. Queues without a label share the tracker named "(unlabeled)".
+ */
+void IAIDispatchAsync(dispatch_queue_t queue, NSString* name, dispatch_block_t block);
+
+/**
+ * Adds a block to an operation queue and tracks how long it waits and runs.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * The block is charged to the tracker named after the queue. Queues without a name share the
+ * tracker named "(unnamed NSOperationQueue)", since trackers live as long as the app. A block
+ * whose operation is cancelled before it starts leaves the queue without being counted.
+ */
+void IAIOperationQueueAddOperationWithBlock(NSOperationQueue* queue, void (^block)(void));
+
+
+/**
+ * The depth and latency of the work submitted to one queue.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * Work is stamped three times: when it is enqueued, when it starts and when it finishes. The
+ * difference between the first two is its wait time and between the last two its run time,
+ * both kept in histograms in nanoseconds. IAIDispatchAsync and
+ * IAIOperationQueueAddOperationWithBlock stamp the blocks they submit; other kinds of queue can
+ * call the stamping methods directly, or wrap their blocks with trackedBlock:.
+ *
+ * Trackers are created on first use and live as long as the app. All methods are thread safe.
+ */
+@interface IAIQueueTracker : NSObject {
+@private
+    NSString* _name;
+    volatile int32_t _numberOfPendingBlocks;
+    volatile int32_t _numberOfRunningBlocks;
+    volatile int32_t _maximumNumberOfPendingBlocks;
+    volatile int64_t _numberOfCompletedBlocks;
+
+    pthread_mutex_t _mutex;
+    IAIHistogram _waitTimes;
+    IAIHistogram _runTimes;
+    IAIHistogram _recentWaitTimes;
+}
+
+#pragma mark Finding Trackers /** @name Finding Trackers */
+
+/**
+ * The tracker with the given name, created if there isn't one yet.
+ */
++ (IAIQueueTracker *)trackerNamed:(NSString *)name;
+
+/**
+ * Every tracker created so far.
+ */
++ (NSArray *)allTrackers;
+
+@property (nonatomic, readonly, copy) NSString* name;
+
+
+#pragma mark Stamping Work /** @name Stamping Work */
+
+/**
+ * Counts a block as waiting and returns the time to pass to workWillStartWithEnqueueTime:.
+ */
+- (uint64_t)workWasEnqueued;
+
+/**
+ * Counts a block as running and returns the time to pass to workDidFinishWithStartTime:.
+ */
+- (uint64_t)workWillStartWithEnqueueTime:(uint64_t)enqueueTime;
+
+- (void)workDidFinishWithStartTime:(uint64_t)startTime;
+
+/**
+ * Stops counting a block that was enqueued but will never start.
+ */
+- (void)workWasCancelled;
+
+/**
+ * Stamps a block as enqueued now and returns a block that stamps its start and finish.
+ *
+ * The returned block must be run exactly once.
+ */
+- (dispatch_block_t)trackedBlock:(dispatch_block_t)block;
+
+
+#pragma mark Reading Work /** @name Reading Work */
+
+/**
+ * The number of blocks that are waiting to start.
+ */
+@property (nonatomic, readonly, assign) NSInteger numberOfPendingBlocks;
+
+@property (nonatomic, readonly, assign) NSInteger numberOfRunningBlocks;
+@property (nonatomic, readonly, assign) unsigned long long numberOfCompletedBlocks;
+
+/**
+ * Copies the wait and run times of every block so far. Either histogram may be NULL.
+ */
+- (void)readWaitTimes:(IAIHistogram *)waitTimes runTimes:(IAIHistogram *)runTimes;
+
+/**
+ * Copies the wait times and the largest number of pending blocks since the last call, and
+ * starts over. Used by the queue monitor once per heartbeat.
+ */
+- (NSInteger)takeRecentWaitTimes:(IAIHistogram *)waitTimes;
+
+@end
+
+
+/**
+ * The state of one queue as of the last update of the monitor.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * Times are in seconds.
+ */
+@interface IAIQueueSummary : NSObject {
+@private
+    NSString* _name;
+    NSInteger _numberOfPendingBlocks;
+    NSInteger _maximumNumberOfPendingBlocks;
+    NSInteger _numberOfRunningBlocks;
+    unsigned long long _numberOfCompletedBlocks;
+    NSTimeInterval _recentP99WaitTime;
+    NSTimeInterval _medianWaitTime;
+    NSTimeInterval _p99WaitTime;
+    NSTimeInterval _medianRunTime;
+    NSTimeInterval _p99RunTime;
+    BOOL _saturated;
+}
+
+@property (nonatomic, readonly, copy) NSString* name;
+@property (nonatomic, readonly, assign) NSInteger numberOfPendingBlocks;
+
+/**
+ * The largest number of pending blocks between the last two updates.
+ */
+@property (nonatomic, readonly, assign) NSInteger maximumNumberOfPendingBlocks;
+
+@property (nonatomic, readonly, assign) NSInteger numberOfRunningBlocks;
+@property (nonatomic, readonly, assign) unsigned long long numberOfCompletedBlocks;
+
+/**
+ * The 99th percentile of the wait times of the blocks that started between the last two
+ * updates.
+ */
+@property (nonatomic, readonly, assign) NSTimeInterval recentP99WaitTime;
+
+@property (nonatomic, readonly, assign) NSTimeInterval medianWaitTime;
+@property (nonatomic, readonly, assign) NSTimeInterval p99WaitTime;
+@property (nonatomic, readonly, assign) NSTimeInterval medianRunTime;
+@property (nonatomic, readonly, assign) NSTimeInterval p99RunTime;
+
+@property (nonatomic, readonly, assign, getter=isSaturated) BOOL saturated;
+
+@end
+
+
+/**
+ * Watches the queues for work that piles up or waits too long to start.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * Once per heartbeat the monitor reads every IAIQueueTracker and adds the number of pending
+ * blocks and the recent 99th percentile wait time of each active queue to the logger as
+ * metrics, along with the total depth as IAIMetricQueueDepth.
+ *
+ * A queue is saturated while more than saturationDepth blocks were pending at once, or while
+ * the 99th percentile of the recent wait times is over saturationWaitTime. When a queue becomes
+ * saturated the monitor adds an IAIEventQueueDidSaturate event, which the graph pages draw with
+ * the other events, and names the queue in the console. A pool of threads that is starved shows
+ * up here as waits that grow across its queues well before the main thread hangs.
+ */
+@interface IAIQueueMonitor : NSObject {
+@private
+    __weak IAILogger* _logger;
+
+    NSInteger _saturationDepth;
+    NSTimeInterval _saturationWaitTime;
+    NSArray* _queueSummaries;
+    NSMutableSet* _saturatedQueueNames;
+}
+
+#pragma mark Creating a Monitor /** @name Creating a Monitor */
+
+/**
+ * Designated initializer.
+ *
+ * The logger is not retained.
+ */
+- (id)initWithLogger:(IAILogger *)logger;
+
+
+#pragma mark Saturation /** @name Saturation */
+
+/**
+ * The number of pending blocks above which a queue is saturated.
+ *
+ * By default this is 32.
+ */
+@property (nonatomic, readwrite, assign) NSInteger saturationDepth;
+
+/**
+ * The 99th percentile wait time above which a queue is saturated.
+ *
+ * By default this is 0.1 seconds.
+ */
+@property (nonatomic, readwrite, assign) NSTimeInterval saturationWaitTime;
+
+
+#pragma mark Reading Queues /** @name Reading Queues */
+
+/**
+ * Reads the trackers, adds the metrics to the logger and logs saturation events.
+ *
+ * Call this from the main thread once per heartbeat.
+ */
+- (void)update;
+
+/**
+ * The summaries of all queues as of the last update, the deepest first.
+ */
+@property (nonatomic, readonly, copy) NSArray* queueSummaries;
+
+@end
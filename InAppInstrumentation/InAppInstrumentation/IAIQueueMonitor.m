@@ -0,0 +1,408 @@
+//
+//  IAIQueueMonitor.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAIQueueMonitor.h"
+
+#import "IAILogger.h"
+
+#import <libkern/OSAtomic.h>
+#import <mach/mach_time.h>
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+NSString* const IAIMetricQueueDepth = @"queueDepth";
+NSString* const IAIMetricQueueDepthPrefix = @"queueDepth.";
+NSString* const IAIMetricQueueWaitTimePrefix = @"queueWaitTime.";
+
+// The trackers shared by the queues that have no name of their own.
+static NSString* const kUnlabeledDispatchQueueName = @"(unlabeled)";
+static NSString* const kUnnamedOperationQueueName = @"(unnamed NSOperationQueue)";
+
+static pthread_mutex_t sTrackersMutex = PTHREAD_MUTEX_INITIALIZER;
+static NSMutableDictionary* sTrackers = nil;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static uint64_t IAIQueueNow(void) {
+    static mach_timebase_info_data_t sTimebase;
+    if (0 == sTimebase.denom) {
+        mach_timebase_info(&sTimebase);
+    }
+    return mach_absolute_time() * sTimebase.numer / sTimebase.denom;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static NSTimeInterval IAISecondsFromNanoseconds(uint64_t nanoseconds) {
+    return (NSTimeInterval)nanoseconds / NSEC_PER_SEC;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIDispatchAsync(dispatch_queue_t queue, NSString* name, dispatch_block_t block) {
+    if (nil == name) {
+        const char* label = dispatch_queue_get_label(queue);
+        name = ((NULL != label && '\0' != label[0])
+                ? [NSString stringWithUTF8String:label]
+                : nil);
+        if (nil == name) {
+            // Also a label that isn't UTF-8.
+            name = kUnlabeledDispatchQueueName;
+        }
+    }
+    dispatch_async(queue, [[IAIQueueTracker trackerNamed:name] trackedBlock:block]);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIOperationQueueAddOperationWithBlock(NSOperationQueue* queue, void (^block)(void)) {
+    NSString* name = queue.name;
+    if ([name length] == 0) {
+        name = kUnnamedOperationQueueName;
+    }
+    IAIQueueTracker* tracker = [IAIQueueTracker trackerNamed:name];
+
+    // The completion block runs for cancelled operations too, which never start.
+    __block volatile int32_t didStart = 0;
+    uint64_t enqueueTime = [tracker workWasEnqueued];
+    NSBlockOperation* operation = [NSBlockOperation blockOperationWithBlock:^{
+        OSAtomicIncrement32Barrier(&didStart);
+        uint64_t startTime = [tracker workWillStartWithEnqueueTime:enqueueTime];
+        block();
+        [tracker workDidFinishWithStartTime:startTime];
+    }];
+    operation.completionBlock = ^{
+        if (OSAtomicCompareAndSwap32Barrier(0, 1, &didStart)) {
+            [tracker workWasCancelled];
+        }
+    };
+    [queue addOperation:operation];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@interface IAIQueueTracker()
+
+- (id)initWithName:(NSString *)name;
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIQueueTracker
+
+@synthesize name = _name;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (IAIQueueTracker *)trackerNamed:(NSString *)name {
+    pthread_mutex_lock(&sTrackersMutex);
+    if (nil == sTrackers) {
+        sTrackers = [[NSMutableDictionary alloc] init];
+    }
+    IAIQueueTracker* tracker = [sTrackers objectForKey:name];
+    if (nil == tracker) {
+        tracker = [[IAIQueueTracker alloc] initWithName:name];
+        [sTrackers setObject:tracker forKey:tracker.name];
+    }
+    pthread_mutex_unlock(&sTrackersMutex);
+    return tracker;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (NSArray *)allTrackers {
+    pthread_mutex_lock(&sTrackersMutex);
+    NSArray* trackers = [sTrackers allValues];
+    pthread_mutex_unlock(&sTrackersMutex);
+    return (nil != trackers) ? trackers : [NSArray array];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)dealloc {
+    pthread_mutex_destroy(&_mutex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithName:(NSString *)name {
+    if ((self = [super init])) {
+        _name = [name copy];
+        pthread_mutex_init(&_mutex, NULL);
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@ %@ %d pending, %d running>",
+            NSStringFromClass([self class]), _name, _numberOfPendingBlocks,
+            _numberOfRunningBlocks];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (uint64_t)workWasEnqueued {
+    int32_t numberOfPendingBlocks = OSAtomicIncrement32Barrier(&_numberOfPendingBlocks);
+
+    // Raise the recent maximum unless another thread already raised it further.
+    int32_t maximum = _maximumNumberOfPendingBlocks;
+    while (numberOfPendingBlocks > maximum
+           && !OSAtomicCompareAndSwap32Barrier(maximum, numberOfPendingBlocks,
+                                               &_maximumNumberOfPendingBlocks)) {
+        maximum = _maximumNumberOfPendingBlocks;
+    }
+    return IAIQueueNow();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (uint64_t)workWillStartWithEnqueueTime:(uint64_t)enqueueTime {
+    uint64_t startTime = IAIQueueNow();
+    OSAtomicDecrement32Barrier(&_numberOfPendingBlocks);
+    OSAtomicIncrement32Barrier(&_numberOfRunningBlocks);
+
+    pthread_mutex_lock(&_mutex);
+    IAIHistogramRecord(&_waitTimes, startTime - enqueueTime);
+    IAIHistogramRecord(&_recentWaitTimes, startTime - enqueueTime);
+    pthread_mutex_unlock(&_mutex);
+    return startTime;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)workDidFinishWithStartTime:(uint64_t)startTime {
+    uint64_t finishTime = IAIQueueNow();
+    OSAtomicDecrement32Barrier(&_numberOfRunningBlocks);
+    OSAtomicIncrement64Barrier(&_numberOfCompletedBlocks);
+
+    pthread_mutex_lock(&_mutex);
+    IAIHistogramRecord(&_runTimes, finishTime - startTime);
+    pthread_mutex_unlock(&_mutex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)workWasCancelled {
+    OSAtomicDecrement32Barrier(&_numberOfPendingBlocks);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (dispatch_block_t)trackedBlock:(dispatch_block_t)block {
+    uint64_t enqueueTime = [self workWasEnqueued];
+    return [^{
+        uint64_t startTime = [self workWillStartWithEnqueueTime:enqueueTime];
+        block();
+        [self workDidFinishWithStartTime:startTime];
+    } copy];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSInteger)numberOfPendingBlocks {
+    return _numberOfPendingBlocks;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSInteger)numberOfRunningBlocks {
+    return _numberOfRunningBlocks;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (unsigned long long)numberOfCompletedBlocks {
+    return (unsigned long long)OSAtomicAdd64Barrier(0, &_numberOfCompletedBlocks);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)readWaitTimes:(IAIHistogram *)waitTimes runTimes:(IAIHistogram *)runTimes {
+    pthread_mutex_lock(&_mutex);
+    if (NULL != waitTimes) {
+        memcpy(waitTimes, &_waitTimes, sizeof(*waitTimes));
+    }
+    if (NULL != runTimes) {
+        memcpy(runTimes, &_runTimes, sizeof(*runTimes));
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSInteger)takeRecentWaitTimes:(IAIHistogram *)waitTimes {
+    pthread_mutex_lock(&_mutex);
+    memcpy(waitTimes, &_recentWaitTimes, sizeof(*waitTimes));
+    IAIHistogramReset(&_recentWaitTimes);
+    pthread_mutex_unlock(&_mutex);
+
+    // Start the next maximum from the blocks that are still pending.
+    int32_t maximum = _maximumNumberOfPendingBlocks;
+    while (!OSAtomicCompareAndSwap32Barrier(maximum, _numberOfPendingBlocks,
+                                            &_maximumNumberOfPendingBlocks)) {
+        maximum = _maximumNumberOfPendingBlocks;
+    }
+    return MAX(maximum, _numberOfPendingBlocks);
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@interface IAIQueueSummary()
+
+@property (nonatomic, readwrite, assign, getter=isSaturated) BOOL saturated;
+
+- (id)initWithTracker:(IAIQueueTracker *)tracker;
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIQueueSummary
+
+@synthesize name = _name;
+@synthesize numberOfPendingBlocks = _numberOfPendingBlocks;
+@synthesize maximumNumberOfPendingBlocks = _maximumNumberOfPendingBlocks;
+@synthesize numberOfRunningBlocks = _numberOfRunningBlocks;
+@synthesize numberOfCompletedBlocks = _numberOfCompletedBlocks;
+@synthesize recentP99WaitTime = _recentP99WaitTime;
+@synthesize medianWaitTime = _medianWaitTime;
+@synthesize p99WaitTime = _p99WaitTime;
+@synthesize medianRunTime = _medianRunTime;
+@synthesize p99RunTime = _p99RunTime;
+@synthesize saturated = _saturated;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithTracker:(IAIQueueTracker *)tracker {
+    if ((self = [super init])) {
+        _name = [tracker.name copy];
+
+        IAIHistogram histogram;
+        _maximumNumberOfPendingBlocks = [tracker takeRecentWaitTimes:&histogram];
+        _recentP99WaitTime = IAISecondsFromNanoseconds(IAIHistogramValueAtPercentile(&histogram,
+                                                                                     99));
+        [tracker readWaitTimes:&histogram runTimes:NULL];
+        _medianWaitTime = IAISecondsFromNanoseconds(IAIHistogramValueAtPercentile(&histogram, 50));
+        _p99WaitTime = IAISecondsFromNanoseconds(IAIHistogramValueAtPercentile(&histogram, 99));
+        [tracker readWaitTimes:NULL runTimes:&histogram];
+        _medianRunTime = IAISecondsFromNanoseconds(IAIHistogramValueAtPercentile(&histogram, 50));
+        _p99RunTime = IAISecondsFromNanoseconds(IAIHistogramValueAtPercentile(&histogram, 99));
+
+        _numberOfPendingBlocks = tracker.numberOfPendingBlocks;
+        _numberOfRunningBlocks = tracker.numberOfRunningBlocks;
+        _numberOfCompletedBlocks = tracker.numberOfCompletedBlocks;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@ %@ %ld pending, p99 wait %.3fs>",
+            NSStringFromClass([self class]), _name, (long)_numberOfPendingBlocks, _p99WaitTime];
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIQueueMonitor
+
+@synthesize saturationDepth = _saturationDepth;
+@synthesize saturationWaitTime = _saturationWaitTime;
+@synthesize queueSummaries = _queueSummaries;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithLogger:(IAILogger *)logger {
+    if ((self = [super init])) {
+        _logger = logger;
+        _saturationDepth = 32;
+        _saturationWaitTime = 0.1;
+        _queueSummaries = [NSArray array];
+        _saturatedQueueNames = [[NSMutableSet alloc] init];
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)update {
+    IAILogger* logger = _logger;
+
+    NSMutableArray* summaries = [NSMutableArray array];
+    NSInteger totalNumberOfPendingBlocks = 0;
+    for (IAIQueueTracker* tracker in [IAIQueueTracker allTrackers]) {
+        IAIQueueSummary* summary = [[IAIQueueSummary alloc] initWithTracker:tracker];
+        [summaries addObject:summary];
+        totalNumberOfPendingBlocks += summary.numberOfPendingBlocks;
+
+        // Idle queues would only repeat zeros.
+        BOOL wasActive = (summary.maximumNumberOfPendingBlocks > 0
+                          || summary.recentP99WaitTime > 0);
+        if (wasActive) {
+            [logger addMetricValue: summary.numberOfPendingBlocks
+                           forName: [IAIMetricQueueDepthPrefix
+                                     stringByAppendingString:summary.name]];
+            [logger addMetricValue: summary.recentP99WaitTime
+                           forName: [IAIMetricQueueWaitTimePrefix
+                                     stringByAppendingString:summary.name]];
+        }
+
+        summary.saturated = (summary.maximumNumberOfPendingBlocks > _saturationDepth
+                             || summary.recentP99WaitTime > _saturationWaitTime);
+        if (summary.isSaturated && ![_saturatedQueueNames containsObject:summary.name]) {
+            [_saturatedQueueNames addObject:summary.name];
+            [logger addEventLog:
+             [[IAIEventLogEntry alloc] initWithType:IAIEventQueueDidSaturate]];
+            NSLog(@"Queue \"%@\" is saturated: %ld blocks pending, 99%% waited up to %.3fs.",
+                  summary.name, (long)summary.maximumNumberOfPendingBlocks,
+                  summary.recentP99WaitTime);
+
+        } else if (!summary.isSaturated) {
+            [_saturatedQueueNames removeObject:summary.name];
+        }
+    }
+    [logger addMetricValue:totalNumberOfPendingBlocks forName:IAIMetricQueueDepth];
+
+    [summaries sortUsingComparator:^NSComparisonResult(IAIQueueSummary* summary1,
+                                                       IAIQueueSummary* summary2) {
+        if (summary1.maximumNumberOfPendingBlocks != summary2.maximumNumberOfPendingBlocks) {
+            return (summary1.maximumNumberOfPendingBlocks > summary2.maximumNumberOfPendingBlocks
+                    ? NSOrderedAscending : NSOrderedDescending);
+        }
+        if (summary1.recentP99WaitTime != summary2.recentP99WaitTime) {
+            return (summary1.recentP99WaitTime > summary2.recentP99WaitTime
+                    ? NSOrderedAscending : NSOrderedDescending);
+        }
+        return [summary1.name compare:summary2.name];
+    }];
+    _queueSummaries = [summaries copy];
+}
+
+
+@end
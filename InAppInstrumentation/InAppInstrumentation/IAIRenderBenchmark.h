@@ -0,0 +1,164 @@
+//
+//  IAIRenderBenchmark.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+
+#import "IAIHistogram.h"
+
+#ifdef DEBUG
+
+@class IAIReplaySession;
+
+/**
+ * The measurements of one page in a render benchmark.
+ *
+ *      @ingroup Overview-Pages
+ *
+ * All of the times are in nanoseconds.
+ */
+@interface IAIRenderBenchmarkResult : NSObject {
+@private
+    Class _pageClass;
+    NSUInteger _numberOfUpdates;
+    NSUInteger _numberOfMissedFrames;
+    IAIHistogram _updateTimes;
+    IAIHistogram _layoutTimes;
+    IAIHistogram _graphDrawTimes;
+    IAIHistogram _drawTimes;
+    IAIHistogram _totalTimes;
+}
+
+@property (nonatomic, readonly, assign) Class pageClass;
+
+@property (nonatomic, readonly, assign) NSUInteger numberOfUpdates;
+
+/**
+ * The number of updates whose update, layout and drawing together took longer than the frame
+ * budget.
+ */
+@property (nonatomic, readonly, assign) NSUInteger numberOfMissedFrames;
+
+/**
+ * Copies the times of the page's update method, of laying out the page, of drawing its graph
+ * view, and of drawing all of its layers including the graph view. Any of the histograms may
+ * be NULL.
+ *
+ * Pages without a graph view have no graph drawing times.
+ */
+- (void)readUpdateTimes: (IAIHistogram *)updateTimes
+            layoutTimes: (IAIHistogram *)layoutTimes
+         graphDrawTimes: (IAIHistogram *)graphDrawTimes
+              drawTimes: (IAIHistogram *)drawTimes
+             totalTimes: (IAIHistogram *)totalTimes;
+
+/**
+ * A line of comma separated values: the page, the number of updates and missed frames, and the
+ * median, 99th percentile and maximum of each of the times in microseconds.
+ */
+- (NSString *)reportLine;
+
+/**
+ * The names of the columns of reportLine.
+ */
++ (NSString *)reportHeader;
+
+@end
+
+
+/**
+ * Measures how long the Overview pages take to render a session.
+ *
+ *      @ingroup Overview-Pages
+ *
+ * Each page is given a logger of its own, fed by an IAIReplaySource of the session. The
+ * benchmark advances the replay by updateInterval seconds of virtual time, as the heartbeat
+ * would, and then times the page's update method, the layout of the page and the drawing of its
+ * layers, until the whole session has been played. Because the replay is driven by virtual
+ * time, every run sees the same entries at the same updates, and the results of two revisions
+ * can be compared directly:
+ *
+ * @code
+ *  IAIReplaySession* session = [IAIReplaySession syntheticSessionWithDuration: 600
+ *                                                           heartbeatInterval: 0.5
+ *                                                        consoleLogsPerSecond: 20
+ *                                                                        seed: 1];
+ *  IAIRenderBenchmark* benchmark = [[IAIRenderBenchmark alloc] initWithSession:session];
+ *  NSLog(@"%@", [IAIRenderBenchmark reportOfResults:[benchmark run]]);
+ * @endcode
+ *
+ * The pages are drawn off screen on the calling thread, which must be the main thread. The
+ * times include the graph view's enumeration of the logger, which is what grows with the
+ * history, but not the compositing of the layers on screen.
+ */
+@interface IAIRenderBenchmark : NSObject {
+@private
+    IAIReplaySession* _session;
+    NSArray* _pageClasses;
+    CGSize _pageSize;
+    NSTimeInterval _updateInterval;
+    NSTimeInterval _frameBudget;
+}
+
+#pragma mark Creating a Benchmark /** @name Creating a Benchmark */
+
+/**
+ * Designated initializer.
+ */
+- (id)initWithSession:(IAIReplaySession *)session;
+
+@property (nonatomic, readonly, IAI_STRONG) IAIReplaySession* session;
+
+
+#pragma mark Configuring a Benchmark /** @name Configuring a Benchmark */
+
+/**
+ * The IAIPageView subclasses to measure.
+ *
+ * By default these are the pages that graph the logger: IAIMemoryPageView, IAIDiskPageView,
+ * IAIConsoleLogPageView, IAIAllocationPageView, IAIQueuePageView and IAIProcessPageView.
+ */
+@property (nonatomic, readwrite, copy) NSArray* pageClasses;
+
+/**
+ * By default this is the size of the Overview on an iPhone in portrait, 320 by 150 points.
+ */
+@property (nonatomic, readwrite, assign) CGSize pageSize;
+
+/**
+ * The number of seconds of the session between updates.
+ *
+ * By default this is 0.5 seconds, the heartbeat of the Overview.
+ */
+@property (nonatomic, readwrite, assign) NSTimeInterval updateInterval;
+
+/**
+ * The number of seconds that an update may take before it misses a frame.
+ *
+ * By default this is 1/60 of a second.
+ */
+@property (nonatomic, readwrite, assign) NSTimeInterval frameBudget;
+
+
+#pragma mark Running a Benchmark /** @name Running a Benchmark */
+
+/**
+ * Plays the session through each page in turn.
+ *
+ *      @returns An IAIRenderBenchmarkResult for each of the page classes, in order, or nil if
+ *               updateInterval is not positive, since the replay would never finish.
+ */
+- (NSArray *)run;
+
+/**
+ * The report header followed by the report line of each result.
+ */
++ (NSString *)reportOfResults:(NSArray *)results;
+
+@end
+
+#endif
@@ -0,0 +1,287 @@
+//
+//  IAIRenderBenchmark.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAIRenderBenchmark.h"
+
+#ifdef DEBUG
+
+#import "IAILogger.h"
+#import "IAIPageView.h"
+#import "IAIReplay.h"
+
+#import <QuartzCore/QuartzCore.h>
+#import <mach/mach_time.h>
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static uint64_t IAIBenchmarkNow(void) {
+    static mach_timebase_info_data_t sTimebase;
+    if (0 == sTimebase.denom) {
+        mach_timebase_info(&sTimebase);
+    }
+    return mach_absolute_time() * sTimebase.numer / sTimebase.denom;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Draws every layer of the tree that has been marked as needing display, as the next commit of
+// the render loop would.
+static void IAIDisplayLayerTree(CALayer* layer) {
+    [layer displayIfNeeded];
+    for (CALayer* sublayer in layer.sublayers) {
+        IAIDisplayLayerTree(sublayer);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static NSString* IAIReportColumnsOfHistogram(const IAIHistogram* histogram) {
+    return [NSString stringWithFormat:@"%.1f,%.1f,%.1f",
+            IAIHistogramValueAtPercentile(histogram, 50) / 1000.0,
+            IAIHistogramValueAtPercentile(histogram, 99) / 1000.0,
+            histogram->max / 1000.0];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@interface IAIRenderBenchmarkResult()
+
+- (id)initWithPageClass:(Class)pageClass;
+
+- (void)recordUpdateTime: (uint64_t)updateTime
+              layoutTime: (uint64_t)layoutTime
+           graphDrawTime: (uint64_t)graphDrawTime
+                drawTime: (uint64_t)drawTime
+             frameBudget: (uint64_t)frameBudget;
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIRenderBenchmarkResult
+
+@synthesize pageClass = _pageClass;
+@synthesize numberOfUpdates = _numberOfUpdates;
+@synthesize numberOfMissedFrames = _numberOfMissedFrames;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (NSString *)reportHeader {
+    NSMutableString* header = [NSMutableString stringWithString:@"page,updates,missedFrames"];
+    NSArray* times = [NSArray arrayWithObjects:@"update", @"layout", @"graphDraw", @"draw",
+                      @"total", nil];
+    for (NSString* time in times) {
+        [header appendFormat:@",%@P50Us,%@P99Us,%@MaxUs", time, time, time];
+    }
+    return header;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithPageClass:(Class)pageClass {
+    if ((self = [super init])) {
+        _pageClass = pageClass;
+        IAIHistogramReset(&_updateTimes);
+        IAIHistogramReset(&_layoutTimes);
+        IAIHistogramReset(&_graphDrawTimes);
+        IAIHistogramReset(&_drawTimes);
+        IAIHistogramReset(&_totalTimes);
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)recordUpdateTime: (uint64_t)updateTime
+              layoutTime: (uint64_t)layoutTime
+           graphDrawTime: (uint64_t)graphDrawTime
+                drawTime: (uint64_t)drawTime
+             frameBudget: (uint64_t)frameBudget {
+    uint64_t totalTime = updateTime + layoutTime + drawTime;
+
+    IAIHistogramRecord(&_updateTimes, updateTime);
+    IAIHistogramRecord(&_layoutTimes, layoutTime);
+    if ([_pageClass isSubclassOfClass:[IAIGraphPageView class]]) {
+        IAIHistogramRecord(&_graphDrawTimes, graphDrawTime);
+    }
+    IAIHistogramRecord(&_drawTimes, drawTime);
+    IAIHistogramRecord(&_totalTimes, totalTime);
+
+    ++_numberOfUpdates;
+    if (totalTime > frameBudget) {
+        ++_numberOfMissedFrames;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)readUpdateTimes: (IAIHistogram *)updateTimes
+            layoutTimes: (IAIHistogram *)layoutTimes
+         graphDrawTimes: (IAIHistogram *)graphDrawTimes
+              drawTimes: (IAIHistogram *)drawTimes
+             totalTimes: (IAIHistogram *)totalTimes {
+    if (NULL != updateTimes) {
+        *updateTimes = _updateTimes;
+    }
+    if (NULL != layoutTimes) {
+        *layoutTimes = _layoutTimes;
+    }
+    if (NULL != graphDrawTimes) {
+        *graphDrawTimes = _graphDrawTimes;
+    }
+    if (NULL != drawTimes) {
+        *drawTimes = _drawTimes;
+    }
+    if (NULL != totalTimes) {
+        *totalTimes = _totalTimes;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSString *)reportLine {
+    return [NSString stringWithFormat:@"%@,%u,%u,%@,%@,%@,%@,%@",
+            NSStringFromClass(_pageClass),
+            (unsigned)_numberOfUpdates, (unsigned)_numberOfMissedFrames,
+            IAIReportColumnsOfHistogram(&_updateTimes),
+            IAIReportColumnsOfHistogram(&_layoutTimes),
+            IAIReportColumnsOfHistogram(&_graphDrawTimes),
+            IAIReportColumnsOfHistogram(&_drawTimes),
+            IAIReportColumnsOfHistogram(&_totalTimes)];
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@interface IAIRenderBenchmark()
+
+- (IAIRenderBenchmarkResult *)runPageClass:(Class)pageClass;
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIRenderBenchmark
+
+@synthesize session = _session;
+@synthesize pageClasses = _pageClasses;
+@synthesize pageSize = _pageSize;
+@synthesize updateInterval = _updateInterval;
+@synthesize frameBudget = _frameBudget;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (NSString *)reportOfResults:(NSArray *)results {
+    NSMutableString* report = [NSMutableString stringWithString:
+                               [IAIRenderBenchmarkResult reportHeader]];
+    for (IAIRenderBenchmarkResult* result in results) {
+        [report appendFormat:@"\n%@", [result reportLine]];
+    }
+    return report;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithSession:(IAIReplaySession *)session {
+    if ((self = [super init])) {
+        _session = session;
+        _pageClasses = [NSArray arrayWithObjects:
+                        [IAIMemoryPageView class],
+                        [IAIDiskPageView class],
+                        [IAIConsoleLogPageView class],
+                        [IAIAllocationPageView class],
+                        [IAIQueuePageView class],
+                        [IAIProcessPageView class],
+                        nil];
+        _pageSize = CGSizeMake(320, 150);
+        _updateInterval = 0.5;
+        _frameBudget = 1.0 / 60.0;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAIRenderBenchmarkResult *)runPageClass:(Class)pageClass {
+    IAIRenderBenchmarkResult* result = [[IAIRenderBenchmarkResult alloc]
+                                        initWithPageClass:pageClass];
+
+    // A logger of the page's own, with the default retention and rollups, so that each page
+    // sees the same history no matter which pages ran before it.
+    IAILogger* logger = [[IAILogger alloc] init];
+    IAIReplaySource* source = [[IAIReplaySource alloc] initWithSession: _session
+                                                                logger: logger];
+
+    IAIPageView* page = [pageClass page];
+    page.logger = logger;
+    page.frame = CGRectMake(0, 0, _pageSize.width, _pageSize.height);
+
+    IAIGraphView* graphView = nil;
+    if ([page isKindOfClass:[IAIGraphPageView class]]) {
+        graphView = [(IAIGraphPageView *)page graphView];
+    }
+
+    uint64_t frameBudget = (uint64_t)(_frameBudget * NSEC_PER_SEC);
+    while (!source.isFinished) {
+        @autoreleasepool {
+            [source advanceByTimeInterval:_updateInterval];
+
+            uint64_t startTime = IAIBenchmarkNow();
+            [page update];
+            uint64_t updateTime = IAIBenchmarkNow();
+            [page layoutIfNeeded];
+            uint64_t layoutTime = IAIBenchmarkNow();
+            [graphView.layer displayIfNeeded];
+            uint64_t graphDrawTime = IAIBenchmarkNow();
+            IAIDisplayLayerTree(page.layer);
+            uint64_t drawTime = IAIBenchmarkNow();
+
+            [result recordUpdateTime: updateTime - startTime
+                          layoutTime: layoutTime - updateTime
+                       graphDrawTime: graphDrawTime - layoutTime
+                            drawTime: drawTime - layoutTime
+                         frameBudget: frameBudget];
+        }
+    }
+
+    return result;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSArray *)run {
+    IAIDASSERT(_updateInterval > 0);
+    if (_updateInterval <= 0) {
+        return nil;
+    }
+    
+    NSMutableArray* results = [[NSMutableArray alloc] initWithCapacity:[_pageClasses count]];
+    for (Class pageClass in _pageClasses) {
+        [results addObject:[self runPageClass:pageClass]];
+    }
+    return results;
+}
+
+
+@end
+
+#endif
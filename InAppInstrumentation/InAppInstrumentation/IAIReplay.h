@@ -0,0 +1,182 @@
+//
+//  IAIReplay.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "IAILogger.h"
+
+/**
+ * A clock whose time is set by hand.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * A replay source moves its clock along with the session so that the logger it feeds prunes
+ * and rolls up its entries as if the session were happening now.
+ */
+@interface IAIReplayClock : NSObject <IAIClock> {
+@private
+    NSDate* _date;
+}
+
+/**
+ * The time that the clock reads.
+ */
+@property (nonatomic, readwrite, IAI_STRONG) NSDate* date;
+
+@end
+
+
+/**
+ * A recorded or made up session of log entries.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * A session holds device logs, console logs, events and metric samples in increasing
+ * chronological order, and can be read from the telemetry recordings of the collector
+ * (iai-collector -o) or the snapshots of the trigger rules (IAILogSnapshot::writeToFile:error:).
+ * The entries of a session are never added to a logger themselves, so the same session can be
+ * replayed any number of times.
+ *
+ * Synthetic sessions are made by a seeded generator and are the same on every run with the
+ * same seed, which makes them the input of choice for comparing revisions.
+ */
+@interface IAIReplaySession : NSObject {
+@private
+    NSArray* _entries;
+}
+
+#pragma mark Creating a Session /** @name Creating a Session */
+
+/**
+ * A session of the given log entries, which are sorted by their timestamps.
+ */
++ (IAIReplaySession *)sessionWithEntries:(NSArray *)entries;
+
+/**
+ * Reads the frames of a telemetry recording.
+ *
+ * Frames that are not entries, such as hello and drop frames, are skipped, and so is a last
+ * frame that was cut short when the recording stopped.
+ *
+ *      @returns nil and sets the error if the file can't be read or is not a recording.
+ */
++ (IAIReplaySession *)sessionWithContentsOfTelemetryFile: (NSString *)path
+                                                   error: (NSError **)error;
+
+/**
+ * A made up session with a device log every heartbeat and console logs at the given rate.
+ *
+ * The free memory wanders and now and then drops sharply, followed by a memory warning; the
+ * free disk space shrinks slowly; the console logs are a mix of levels and tags; and the page
+ * fault rate, the live heap and the queue depth metrics are sampled with every device log.
+ *
+ *      @returns nil if heartbeatInterval is not positive.
+ */
++ (IAIReplaySession *)syntheticSessionWithDuration: (NSTimeInterval)duration
+                                 heartbeatInterval: (NSTimeInterval)heartbeatInterval
+                              consoleLogsPerSecond: (double)consoleLogsPerSecond
+                                              seed: (uint32_t)seed;
+
+
+#pragma mark Reading a Session /** @name Reading a Session */
+
+/**
+ * The log entries in increasing chronological order.
+ */
+@property (nonatomic, readonly, copy) NSArray* entries;
+
+/**
+ * The timestamp of the first entry, or nil if the session is empty.
+ */
+@property (nonatomic, readonly, IAI_STRONG) NSDate* startDate;
+
+/**
+ * The number of seconds from the first entry to the last.
+ */
+@property (nonatomic, readonly, assign) NSTimeInterval duration;
+
+@end
+
+
+/**
+ * Feeds a session into a logger.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * The source sets itself up as the clock of the logger (see IAILogger::clock), and before
+ * adding each entry moves the clock to the time of the entry. The logger, and any page that
+ * shows it (see IAIPageView::logger), then behave exactly as they would have while the
+ * session was recorded.
+ *
+ * Once started the source plays the session in real time, or faster or slower by the rate.
+ * For measurements that must be the same on every run, don't start the source and call
+ * advanceByTimeInterval: instead, which plays the session in steps of virtual time regardless
+ * of how long each step takes.
+ *
+ * The logger should be one of its own rather than [IAInstrumentation logger], which the
+ * heartbeat keeps adding to.
+ */
+@interface IAIReplaySource : NSObject {
+@private
+    IAIReplaySession* _session;
+    __weak IAILogger* _logger;
+    IAIReplayClock* _clock;
+
+    NSUInteger _nextEntryIndex;
+    NSTimeInterval _elapsed;
+    double _rate;
+    NSTimer* _timer;
+    NSTimeInterval _lastTickTime;
+}
+
+#pragma mark Creating a Source /** @name Creating a Source */
+
+/**
+ * Designated initializer.
+ *
+ * Sets the clock of the logger to the start of the session. The logger is not retained.
+ */
+- (id)initWithSession:(IAIReplaySession *)session logger:(IAILogger *)logger;
+
+@property (nonatomic, readonly, IAI_STRONG) IAIReplaySession* session;
+@property (nonatomic, readonly, IAI_STRONG) IAIReplayClock* clock;
+
+
+#pragma mark Playing a Session /** @name Playing a Session */
+
+/**
+ * The number of seconds of the session played per second of real time.
+ *
+ * By default this is 1.
+ */
+@property (nonatomic, readwrite, assign) double rate;
+
+/**
+ * Plays the session on the main run loop until it is finished or stopped.
+ */
+- (void)start;
+
+- (void)stop;
+
+/**
+ * Adds the entries of the next interval seconds of the session and moves the clock to the end
+ * of the interval.
+ */
+- (void)advanceByTimeInterval:(NSTimeInterval)interval;
+
+/**
+ * The number of seconds of the session played so far.
+ */
+@property (nonatomic, readonly, assign) NSTimeInterval elapsed;
+
+/**
+ * Whether every entry of the session has been added.
+ */
+@property (nonatomic, readonly, assign, getter=isFinished) BOOL finished;
+
+@end
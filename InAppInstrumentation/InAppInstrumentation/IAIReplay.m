@@ -0,0 +1,470 @@
+//
+//  IAIReplay.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAIReplay.h"
+
+#import "IAIAllocationMonitor.h"
+#import "IAIProcessMonitor.h"
+#import "IAIQueueMonitor.h"
+#import "IAITelemetryFrame.h"
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+// How often a started source adds the entries that have come due.
+static const NSTimeInterval kTickInterval = 1.0 / 60.0;
+
+static const unsigned long long kSyntheticTotalMemory = 512ULL * 1024 * 1024;
+static const unsigned long long kSyntheticTotalDiskSpace = 16ULL * 1024 * 1024 * 1024;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static NSDate* IAIDateOfTelemetryTime(int64_t time) {
+    return [NSDate dateWithTimeIntervalSince1970:(NSTimeInterval)time / 1000000.0];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static NSString* IAIStringOfTelemetryText(IAITelemetryReader* payload) {
+    size_t length = 0;
+    const char* text = IAITelemetryReadText(payload, &length);
+    NSString* string = [[NSString alloc] initWithBytes: text
+                                                length: length
+                                              encoding: NSUTF8StringEncoding];
+    // A truncated frame may end in the middle of a character.
+    return (nil != string) ? string : @"";
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Returns nil for frames that are not entries.
+static IAILogEntry* IAIEntryOfTelemetryFrame(const IAITelemetryFrameHeader* header,
+                                             IAITelemetryReader* payload) {
+    NSDate* timestamp = IAIDateOfTelemetryTime(header->time);
+
+    switch (header->type) {
+        case IAITelemetryFrameDeviceSample: {
+            uint64_t freeMemory = 0, totalMemory = 0, freeDisk = 0, totalDisk = 0;
+            double batteryLevel = 0;
+            uint8_t batteryState = 0;
+            uint8_t sampledMetrics = IAIDeviceMetricAll;
+            IAITelemetryReadUInt64(payload, &freeMemory);
+            IAITelemetryReadUInt64(payload, &totalMemory);
+            IAITelemetryReadUInt64(payload, &freeDisk);
+            IAITelemetryReadUInt64(payload, &totalDisk);
+            IAITelemetryReadDouble(payload, &batteryLevel);
+            IAITelemetryReadUInt8(payload, &batteryState);
+            // Left as is by frames recorded before the field was added.
+            IAITelemetryReadUInt8(payload, &sampledMetrics);
+
+            IAIDeviceLogEntry* entry = [[IAIDeviceLogEntry alloc] initWithTimestamp:timestamp];
+            entry.bytesOfFreeMemory = freeMemory;
+            entry.bytesOfTotalMemory = totalMemory;
+            entry.bytesOfFreeDiskSpace = freeDisk;
+            entry.bytesOfTotalDiskSpace = totalDisk;
+            entry.batteryLevel = (CGFloat)batteryLevel;
+            entry.batteryState = (UIDeviceBatteryState)batteryState;
+            entry.sampledMetrics = (IAIDeviceMetrics)(sampledMetrics & IAIDeviceMetricAll);
+            return entry;
+        }
+        case IAITelemetryFrameConsoleLog: {
+            uint8_t level = 0;
+            IAITelemetryReadUInt8(payload, &level);
+            IAIConsoleLogEntry* entry =
+            [[IAIConsoleLogEntry alloc] initWithLog:IAIStringOfTelemetryText(payload)];
+            entry.timestamp = timestamp;
+            entry.level = (IAIConsoleLogLevel)level;
+            return entry;
+        }
+        case IAITelemetryFrameEvent: {
+            uint32_t type = 0;
+            double value = 0;
+            IAITelemetryReadUInt32(payload, &type);
+            IAITelemetryReadDouble(payload, &value);
+            IAIEventLogEntry* entry = [[IAIEventLogEntry alloc] initWithType: (int32_t)type
+                                                                       value: value];
+            entry.timestamp = timestamp;
+            return entry;
+        }
+        case IAITelemetryFrameMetric: {
+            double value = 0;
+            IAITelemetryReadDouble(payload, &value);
+            IAIMetricLogEntry* entry =
+            [[IAIMetricLogEntry alloc] initWithName: IAIStringOfTelemetryText(payload)
+                                              value: value];
+            entry.timestamp = timestamp;
+            return entry;
+        }
+        default:
+            return nil;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// xorshift32, so that a seed makes the same session on every platform.
+static uint32_t IAINextRandom(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// A number from 0 up to but not including 1.
+static double IAINextUniform(uint32_t* state) {
+    return (double)IAINextRandom(state) / 4294967296.0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIReplayClock
+
+@synthesize date = _date;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSDate *)now {
+    return _date;
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIReplaySession
+
+@synthesize entries = _entries;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (IAIReplaySession *)sessionWithEntries:(NSArray *)entries {
+    IAIReplaySession* session = [[[self class] alloc] init];
+    session->_entries = [entries sortedArrayWithOptions: NSSortStable
+                                        usingComparator:
+                         ^NSComparisonResult(IAILogEntry* entry1, IAILogEntry* entry2) {
+                             return [entry1.timestamp compare:entry2.timestamp];
+                         }];
+    return session;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (IAIReplaySession *)sessionWithContentsOfTelemetryFile: (NSString *)path
+                                                   error: (NSError **)error {
+    NSData* data = [NSData dataWithContentsOfFile: path
+                                          options: NSDataReadingMappedIfSafe
+                                            error: error];
+    if (nil == data) {
+        return nil;
+    }
+
+    NSMutableArray* entries = [[NSMutableArray alloc] init];
+    const uint8_t* bytes = [data bytes];
+    size_t length = [data length];
+    size_t offset = 0;
+    while (offset < length) {
+        IAITelemetryFrameHeader header;
+        IAITelemetryReader payload;
+        long frameLength = IAITelemetryParseFrame(bytes + offset, length - offset,
+                                                  &header, &payload);
+        if (frameLength < 0) {
+            if (NULL != error) {
+                *error = [NSError errorWithDomain: NSCocoaErrorDomain
+                                             code: NSFileReadCorruptFileError
+                                         userInfo: [NSDictionary dictionaryWithObject: path
+                                                                               forKey:
+                                                    NSFilePathErrorKey]];
+            }
+            return nil;
+        }
+        if (0 == frameLength) {
+            break;
+        }
+
+        IAILogEntry* entry = IAIEntryOfTelemetryFrame(&header, &payload);
+        if (nil != entry) {
+            [entries addObject:entry];
+        }
+        offset += (size_t)frameLength;
+    }
+
+    return [self sessionWithEntries:entries];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (IAIReplaySession *)syntheticSessionWithDuration: (NSTimeInterval)duration
+                                 heartbeatInterval: (NSTimeInterval)heartbeatInterval
+                              consoleLogsPerSecond: (double)consoleLogsPerSecond
+                                              seed: (uint32_t)seed {
+    static NSString* sLogFormats[] = {
+        @"[Network] Info: request %u finished",
+        @"[Network] Error: request %u timed out",
+        @"[Cache] Debug: evicted %u objects",
+        @"[Sync] Warning: retrying batch %u",
+        @"Loaded %u rows",
+    };
+    const NSUInteger numberOfLogFormats = sizeof(sLogFormats) / sizeof(sLogFormats[0]);
+
+    // A heartbeat of 0 would never advance the time.
+    IAIDASSERT(heartbeatInterval > 0);
+    if (heartbeatInterval <= 0) {
+        return nil;
+    }
+
+    // xorshift never leaves 0.
+    uint32_t state = (0 != seed) ? seed : 1;
+
+    // A fixed start rather than now, so that the entries are the same on every run.
+    NSDate* startDate = [NSDate dateWithTimeIntervalSinceReferenceDate:0];
+    NSMutableArray* entries = [[NSMutableArray alloc] init];
+
+    double freeMemory = kSyntheticTotalMemory / 2;
+    double freeDiskSpace = kSyntheticTotalDiskSpace / 4;
+    double batteryLevel = 1;
+    double bytesOfLiveHeap = kSyntheticTotalMemory / 16;
+    double nextLogTime = 0;
+    unsigned logNumber = 0;
+
+    for (NSTimeInterval time = 0; time <= duration; time += heartbeatInterval) {
+        // A random walk around half of the memory, with a sharp drop now and then.
+        freeMemory += (IAINextUniform(&state) - 0.5) * kSyntheticTotalMemory / 64;
+        BOOL isWarning = (IAINextUniform(&state) < heartbeatInterval / 60);
+        if (isWarning) {
+            freeMemory -= kSyntheticTotalMemory / 8;
+        }
+        freeMemory = MIN(MAX(freeMemory, kSyntheticTotalMemory / 32),
+                         kSyntheticTotalMemory * 3 / 4);
+        freeDiskSpace = MAX(freeDiskSpace - IAINextUniform(&state) * 64 * 1024, 0);
+        batteryLevel = MAX(batteryLevel - heartbeatInterval / 36000, 0);
+
+        NSDate* date = [startDate dateByAddingTimeInterval:time];
+        IAIDeviceLogEntry* deviceLog = [[IAIDeviceLogEntry alloc] initWithTimestamp:date];
+        deviceLog.bytesOfFreeMemory = (unsigned long long)freeMemory;
+        deviceLog.bytesOfTotalMemory = kSyntheticTotalMemory;
+        deviceLog.bytesOfFreeDiskSpace = (unsigned long long)freeDiskSpace;
+        deviceLog.bytesOfTotalDiskSpace = kSyntheticTotalDiskSpace;
+        deviceLog.batteryLevel = (CGFloat)batteryLevel;
+        deviceLog.batteryState = UIDeviceBatteryStateUnplugged;
+        [entries addObject:deviceLog];
+
+        double pageFaultsPerSecond = IAINextUniform(&state) * (isWarning ? 5000 : 500);
+        IAIMetricLogEntry* metric =
+        [[IAIMetricLogEntry alloc] initWithName: IAIMetricPageFaultsPerSecond
+                                          value: pageFaultsPerSecond];
+        metric.timestamp = date;
+        [entries addObject:metric];
+
+        // A heap that leaks a little and frees a lot after each warning.
+        bytesOfLiveHeap += (IAINextUniform(&state) - 0.45) * 256 * 1024;
+        if (isWarning) {
+            bytesOfLiveHeap /= 2;
+        }
+        bytesOfLiveHeap = MAX(bytesOfLiveHeap, 1024 * 1024);
+        metric = [[IAIMetricLogEntry alloc] initWithName: IAIMetricBytesOfLiveHeap
+                                                   value: bytesOfLiveHeap];
+        metric.timestamp = date;
+        [entries addObject:metric];
+
+        double queueDepth = floor(IAINextUniform(&state) * (isWarning ? 64 : 8));
+        metric = [[IAIMetricLogEntry alloc] initWithName: IAIMetricQueueDepth
+                                                   value: queueDepth];
+        metric.timestamp = date;
+        [entries addObject:metric];
+
+        if (isWarning) {
+            IAIEventLogEntry* event =
+            [[IAIEventLogEntry alloc] initWithType:IAIEventDidReceiveMemoryWarning];
+            event.timestamp = date;
+            [entries addObject:event];
+        }
+
+        // Exponential gaps between the logs make them arrive in bursts, like real logs do.
+        while (consoleLogsPerSecond > 0 && nextLogTime < time + heartbeatInterval) {
+            NSString* format = sLogFormats[IAINextRandom(&state) % numberOfLogFormats];
+            IAIConsoleLogEntry* consoleLog =
+            [[IAIConsoleLogEntry alloc] initWithLog:[NSString stringWithFormat:format,
+                                                     ++logNumber]];
+            consoleLog.timestamp = [startDate dateByAddingTimeInterval:MIN(nextLogTime,
+                                                                           duration)];
+            [entries addObject:consoleLog];
+
+            nextLogTime += -log(1 - IAINextUniform(&state)) / consoleLogsPerSecond;
+        }
+    }
+
+    return [self sessionWithEntries:entries];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSDate *)startDate {
+    return ([_entries count] > 0) ? [[_entries objectAtIndex:0] timestamp] : nil;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSTimeInterval)duration {
+    if ([_entries count] == 0) {
+        return 0;
+    }
+    return [[[_entries lastObject] timestamp] timeIntervalSinceDate:self.startDate];
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@interface IAIReplaySource()
+
+- (void)tick;
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIReplaySource
+
+@synthesize session = _session;
+@synthesize clock = _clock;
+@synthesize rate = _rate;
+@synthesize elapsed = _elapsed;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)dealloc {
+    [_timer invalidate];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithSession:(IAIReplaySession *)session logger:(IAILogger *)logger {
+    if ((self = [super init])) {
+        _session = session;
+        _logger = logger;
+        _rate = 1;
+
+        _clock = [[IAIReplayClock alloc] init];
+        _clock.date = (nil != session.startDate) ? session.startDate : [NSDate date];
+        logger.clock = _clock;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)isFinished {
+    return _nextEntryIndex >= [_session.entries count];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)advanceByTimeInterval:(NSTimeInterval)interval {
+    IAILogger* logger = _logger;
+    NSArray* entries = _session.entries;
+    NSDate* startDate = _session.startDate;
+    NSDate* endDate = [startDate dateByAddingTimeInterval:_elapsed + interval];
+
+    // The session's own entries stay untouched, so each one is added as a copy.
+    while (_nextEntryIndex < [entries count]) {
+        IAILogEntry* entry = [entries objectAtIndex:_nextEntryIndex];
+        if ([entry.timestamp compare:endDate] == NSOrderedDescending) {
+            break;
+        }
+        _clock.date = entry.timestamp;
+
+        if ([entry isKindOfClass:[IAIDeviceLogEntry class]]) {
+            IAIDeviceLogEntry* deviceLog = (IAIDeviceLogEntry *)entry;
+            IAIDeviceLogEntry* copy =
+            [[IAIDeviceLogEntry alloc] initWithTimestamp:deviceLog.timestamp];
+            copy.bytesOfFreeMemory = deviceLog.bytesOfFreeMemory;
+            copy.bytesOfTotalMemory = deviceLog.bytesOfTotalMemory;
+            copy.bytesOfFreeDiskSpace = deviceLog.bytesOfFreeDiskSpace;
+            copy.bytesOfTotalDiskSpace = deviceLog.bytesOfTotalDiskSpace;
+            copy.batteryLevel = deviceLog.batteryLevel;
+            copy.batteryState = deviceLog.batteryState;
+            copy.sampledMetrics = deviceLog.sampledMetrics;
+            [logger addDeviceLog:copy];
+
+        } else if ([entry isKindOfClass:[IAIConsoleLogEntry class]]) {
+            IAIConsoleLogEntry* consoleLog = (IAIConsoleLogEntry *)entry;
+            IAIConsoleLogEntry* copy = [[IAIConsoleLogEntry alloc] initWithLog:consoleLog.log];
+            copy.timestamp = consoleLog.timestamp;
+            copy.level = consoleLog.level;
+            [logger addConsoleLog:copy];
+
+        } else if ([entry isKindOfClass:[IAIEventLogEntry class]]) {
+            IAIEventLogEntry* eventLog = (IAIEventLogEntry *)entry;
+            IAIEventLogEntry* copy = [[IAIEventLogEntry alloc] initWithType: eventLog.type
+                                                                      value: eventLog.value];
+            copy.timestamp = eventLog.timestamp;
+            [logger addEventLog:copy];
+
+        } else if ([entry isKindOfClass:[IAIMetricLogEntry class]]) {
+            IAIMetricLogEntry* metricLog = (IAIMetricLogEntry *)entry;
+            [logger addMetricValue:metricLog.value forName:metricLog.name];
+        }
+        ++_nextEntryIndex;
+    }
+
+    _elapsed += interval;
+    if (nil != startDate) {
+        _clock.date = endDate;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)tick {
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    [self advanceByTimeInterval:(now - _lastTickTime) * _rate];
+    _lastTickTime = now;
+
+    if (self.isFinished) {
+        [self stop];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)start {
+    if (nil != _timer) {
+        return;
+    }
+    _lastTickTime = [NSDate timeIntervalSinceReferenceDate];
+    _timer = [NSTimer scheduledTimerWithTimeInterval: kTickInterval
+                                              target: self
+                                            selector: @selector(tick)
+                                            userInfo: nil
+                                             repeats: YES];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)stop {
+    [_timer invalidate];
+    _timer = nil;
+}
+
+
+@end
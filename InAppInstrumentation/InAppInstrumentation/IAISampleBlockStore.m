@@ -0,0 +1,566 @@
+//
+//  IAISampleBlockStore.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAISampleBlockStore.h"
+
+#import "IAILogger.h"
+
+#import <objc/runtime.h>
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+typedef enum {
+    IAIDeviceLogColumnFreeMemory,
+    IAIDeviceLogColumnTotalMemory,
+    IAIDeviceLogColumnFreeDiskSpace,
+    IAIDeviceLogColumnTotalDiskSpace,
+    IAIDeviceLogColumnBatteryLevel,
+    IAIDeviceLogColumnBatteryState,
+    IAIDeviceLogColumnSampledMetrics,
+    IAIDeviceLogColumnCount,
+} IAIDeviceLogColumn;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static int64_t IAIMillisecondsFromTime(NSTimeInterval time) {
+    return (int64_t)llround(time * 1000.0);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static NSTimeInterval IAITimeFromMilliseconds(int64_t milliseconds) {
+    return (NSTimeInterval)milliseconds / 1000.0;
+}
+
+
+// An immutable, encoded run of samples.
+@interface IAISampleBlock : NSObject
+@property (nonatomic, readwrite, IAI_STRONG) NSData* data;
+@property (nonatomic, readwrite, assign) NSUInteger count;
+@property (nonatomic, readwrite, assign) NSTimeInterval firstTime;
+@property (nonatomic, readwrite, assign) NSTimeInterval lastTime;
+@end
+
+@implementation IAISampleBlock
+@synthesize data = _data;
+@synthesize count = _count;
+@synthesize firstTime = _firstTime;
+@synthesize lastTime = _lastTime;
+@end
+
+@interface IAISampleBlockDecoder()
+- (id)initWithBlocks:(NSArray *)blocks columnCount:(unsigned)columnCount;
+@end
+
+// The published state of an IAISampleBlockStore, copied under its sequence lock.
+typedef struct {
+    __unsafe_unretained NSArray* sealedBlocks;
+    NSUInteger sealedCount;
+    NSUInteger openCount;
+    NSUInteger bytesOfOpenBuffer;
+    NSTimeInterval openFirstTime;
+    NSTimeInterval openLastTime;
+} IAISampleBlockStoreState;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAISampleBlockStore
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)dealloc {
+    // The buffer belongs to _openBuffer.
+    _encoder.buffer = NULL;
+    IAISampleEncoderDestroy(&_encoder);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithColumnCount:(NSUInteger)columnCount samplesPerBlock:(NSUInteger)samplesPerBlock {
+    if ((self = [super init])) {
+        IAIDASSERT(columnCount <= IAISampleCodecMaxColumns);
+        _columnCount = (unsigned)MIN(columnCount, IAISampleCodecMaxColumns);
+        _samplesPerBlock = MAX(samplesPerBlock, 1);
+        _sealedBlocks = [[NSArray alloc] init];
+        _retiredObjects = [[NSMutableArray alloc] init];
+
+        memset(&_encoder, 0, sizeof(_encoder));
+        IAISampleEncoderReset(&_encoder, _columnCount);
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Publishing
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Copies a consistent view of the published state, and of the bytes of the open block if
+// openData isn't NULL. Anything retained from the state must be retained before exitReader is
+// called.
+- (IAISampleBlockStoreState)enterReaderCopyingOpenBlock:(NSData **)openData {
+    IAISeqLockEnterReader(&_lock);
+    IAISampleBlockStoreState state;
+    int32_t sequence;
+    do {
+        sequence = IAISeqLockReadBegin(&_lock);
+        state.sealedBlocks = _sealedBlocks;
+        state.sealedCount = _sealedCount;
+        state.openCount = _encoder.count;
+        state.openFirstTime = _openFirstTime;
+        state.openLastTime = _openLastTime;
+
+        // A buffer that was replaced while this copies is kept until the readers exit, and
+        // the length is clamped to it, so a torn copy is only ever wasted, never out of bounds.
+        NSMutableData* openBuffer = _openBuffer;
+        state.bytesOfOpenBuffer = [openBuffer length];
+        if (NULL != openData) {
+            NSUInteger length = MIN(IAISampleEncoderByteLength(&_encoder), [openBuffer length]);
+            *openData = ((state.openCount > 0)
+                         ? [NSData dataWithBytes:[openBuffer bytes] length:length]
+                         : nil);
+        }
+    } while (IAISeqLockReadRetry(&_lock, sequence));
+    return state;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAISampleBlockStoreState)enterReader {
+    return [self enterReaderCopyingOpenBlock:NULL];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)exitReader {
+    IAISeqLockExitReader(&_lock);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Call between IAISeqLockBeginWrite and IAISeqLockEndWrite. A reader may have copied the old
+// pointer without retaining it yet.
+- (void)retireObject:(id)object {
+    if (nil != object) {
+        [_retiredObjects addObject:object];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)releaseRetiredObjects {
+    if ([_retiredObjects count] > 0 && !IAISeqLockHasReaders(&_lock)) {
+        [_retiredObjects removeAllObjects];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Grows the open buffer ahead of the next sample so that the encoder never reallocates it
+// while a reader is copying from it. Call between IAISeqLockBeginWrite and IAISeqLockEndWrite.
+- (void)reserveOpenBuffer {
+    // The encoder's worst case for a sample: a 68 bit timestamp and 77 bits per column.
+    NSUInteger needed = (IAISampleEncoderByteLength(&_encoder)
+                         + (68 + 77 * _columnCount + 7) / 8 + 1);
+    if (needed <= _encoder.capacity) {
+        return;
+    }
+    NSUInteger length = MAX([_openBuffer length] * 2, (NSUInteger)256);
+    while (length < needed) {
+        length *= 2;
+    }
+    NSMutableData* buffer = [NSMutableData dataWithLength:length];
+    if (nil != _openBuffer) {
+        memcpy([buffer mutableBytes], [_openBuffer bytes], [_openBuffer length]);
+    }
+    [self retireObject:_openBuffer];
+    _openBuffer = buffer;
+    _encoder.buffer = [buffer mutableBytes];
+    _encoder.capacity = length;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Call between IAISeqLockBeginWrite and IAISeqLockEndWrite.
+- (void)replaceSealedBlocks:(NSArray *)sealedBlocks sealedCount:(NSUInteger)sealedCount {
+    [self retireObject:_sealedBlocks];
+    _sealedBlocks = sealedBlocks;
+    _sealedCount = sealedCount;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Public Methods
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSUInteger)columnCount {
+    return _columnCount;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSUInteger)count {
+    IAISampleBlockStoreState state = [self enterReader];
+    NSUInteger count = state.sealedCount + state.openCount;
+    [self exitReader];
+    return count;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSUInteger)bytesOfStorage {
+    IAISampleBlockStoreState state = [self enterReader];
+    NSUInteger bytes = state.bytesOfOpenBuffer;
+    for (IAISampleBlock* block in state.sealedBlocks) {
+        bytes += [block.data length] + class_getInstanceSize([IAISampleBlock class]);
+    }
+    [self exitReader];
+    return bytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSTimeInterval)firstTime {
+    IAISampleBlockStoreState state = [self enterReader];
+    NSTimeInterval time = ([state.sealedBlocks count] > 0
+                           ? [(IAISampleBlock *)[state.sealedBlocks objectAtIndex:0] firstTime]
+                           : (state.openCount > 0) ? state.openFirstTime : 0);
+    [self exitReader];
+    return time;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSTimeInterval)lastTime {
+    IAISampleBlockStoreState state = [self enterReader];
+    NSTimeInterval time = ((state.openCount > 0)
+                           ? state.openLastTime
+                           : [(IAISampleBlock *)[state.sealedBlocks lastObject] lastTime]);
+    [self exitReader];
+    return time;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)appendSampleAtTime:(NSTimeInterval)time values:(const uint64_t *)values {
+    // The sample is encoded in place. Readers copy the open block themselves and retry if it
+    // changed meanwhile, so the only copy the writer makes is when the block is sealed.
+    IAISeqLockBeginWrite(&_lock);
+    [self reserveOpenBuffer];
+    BOOL didAppend = (_encoder.capacity > 0
+                      && IAISampleEncoderAppend(&_encoder, IAIMillisecondsFromTime(time), values));
+    if (didAppend) {
+        if (1 == _encoder.count) {
+            _openFirstTime = time;
+        }
+        _openLastTime = time;
+    }
+    IAISeqLockEndWrite(&_lock);
+
+    if (didAppend && _encoder.count >= _samplesPerBlock) {
+        IAISampleBlock* block = [[IAISampleBlock alloc] init];
+        block.data = [NSData dataWithBytes: _encoder.buffer
+                                    length: IAISampleEncoderByteLength(&_encoder)];
+        block.count = _encoder.count;
+        block.firstTime = _openFirstTime;
+        block.lastTime = _openLastTime;
+
+        IAISeqLockBeginWrite(&_lock);
+        IAISampleEncoderReset(&_encoder, _columnCount);
+        [self replaceSealedBlocks: [_sealedBlocks arrayByAddingObject:block]
+                      sealedCount: _sealedCount + block.count];
+        IAISeqLockEndWrite(&_lock);
+    }
+    [self releaseRetiredObjects];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSUInteger)removeBlocksBeforeTime: (NSTimeInterval)time
+                          usingBlock: (void (^)(NSTimeInterval time, const uint64_t* values))block {
+    NSUInteger numberOfBlocks = 0;
+    NSUInteger numberRemoved = 0;
+    for (IAISampleBlock* sealedBlock in _sealedBlocks) {
+        if (sealedBlock.lastTime >= time) {
+            break;
+        }
+
+        if (nil != block) {
+            IAISampleBlockDecoder* decoder =
+            [[IAISampleBlockDecoder alloc] initWithBlocks: [NSArray arrayWithObject:sealedBlock]
+                                              columnCount: _columnCount];
+            NSTimeInterval sampleTime = 0;
+            uint64_t values[IAISampleCodecMaxColumns];
+            while ([decoder nextSampleTime:&sampleTime values:values]) {
+                block(sampleTime, values);
+            }
+        }
+
+        ++numberOfBlocks;
+        numberRemoved += sealedBlock.count;
+    }
+
+    if (numberOfBlocks > 0) {
+        NSRange keptRange = NSMakeRange(numberOfBlocks, [_sealedBlocks count] - numberOfBlocks);
+        IAISeqLockBeginWrite(&_lock);
+        [self replaceSealedBlocks: [_sealedBlocks subarrayWithRange:keptRange]
+                      sealedCount: _sealedCount - numberRemoved];
+        IAISeqLockEndWrite(&_lock);
+        [self releaseRetiredObjects];
+    }
+    return numberRemoved;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)removeAllSamples {
+    IAISeqLockBeginWrite(&_lock);
+    IAISampleEncoderReset(&_encoder, _columnCount);
+    [self replaceSealedBlocks:[NSArray array] sealedCount:0];
+    IAISeqLockEndWrite(&_lock);
+    [self releaseRetiredObjects];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAISampleBlockDecoder *)decoder {
+    return [self decoderFromTime:-DBL_MAX];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAISampleBlockDecoder *)decoderFromTime:(NSTimeInterval)time {
+    NSData* openData = nil;
+    IAISampleBlockStoreState state = [self enterReaderCopyingOpenBlock:&openData];
+    NSArray* sealedBlocks = state.sealedBlocks;
+    [self exitReader];
+
+    IAISampleBlock* openBlock = nil;
+    if (nil != openData) {
+        openBlock = [[IAISampleBlock alloc] init];
+        openBlock.data = openData;
+        openBlock.count = state.openCount;
+        openBlock.firstTime = state.openFirstTime;
+        openBlock.lastTime = state.openLastTime;
+    }
+
+    // Find the first sealed block whose newest sample is at or after the given time.
+    NSUInteger low = 0;
+    NSUInteger high = [sealedBlocks count];
+    while (low < high) {
+        NSUInteger middle = low + (high - low) / 2;
+        if ([(IAISampleBlock *)[sealedBlocks objectAtIndex:middle] lastTime] < time) {
+            low = middle + 1;
+
+        } else {
+            high = middle;
+        }
+    }
+
+    NSMutableArray* blocks =
+    [[sealedBlocks subarrayWithRange:NSMakeRange(low, [sealedBlocks count] - low)] mutableCopy];
+    if (nil != openBlock) {
+        [blocks addObject:openBlock];
+    }
+    return [[IAISampleBlockDecoder alloc] initWithBlocks:blocks columnCount:_columnCount];
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAISampleBlockDecoder
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithBlocks:(NSArray *)blocks columnCount:(unsigned)columnCount {
+    if ((self = [super init])) {
+        _blocks = blocks;
+        _columnCount = columnCount;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)nextSampleTime:(NSTimeInterval *)time values:(uint64_t *)values {
+    int64_t milliseconds = 0;
+    while (!_hasDecoder || !IAISampleDecoderNext(&_decoder, &milliseconds, values)) {
+        if (_blockIndex >= [_blocks count]) {
+            return NO;
+        }
+        // The block's data is retained by _blocks for as long as the decoder reads from it.
+        IAISampleBlock* block = [_blocks objectAtIndex:_blockIndex++];
+        IAISampleDecoderInit(&_decoder, [block.data bytes], [block.data length],
+                             block.count, _columnCount);
+        _hasDecoder = YES;
+    }
+    *time = IAITimeFromMilliseconds(milliseconds);
+    return YES;
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @internal
+ *
+ * Materializes device log entries from a sample decoder one at a time.
+ */
+@interface IAIDeviceLogBlockEnumerator : NSEnumerator {
+@private
+    IAISampleBlockDecoder* _decoder;
+}
+- (id)initWithDecoder:(IAISampleBlockDecoder *)decoder;
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static IAIDeviceLogEntry* IAIDeviceLogEntryFromSample(NSTimeInterval time, const uint64_t* values) {
+    IAIDeviceLogEntry* entry =
+    [[IAIDeviceLogEntry alloc] initWithTimestamp:
+     [NSDate dateWithTimeIntervalSinceReferenceDate:time]];
+    entry.bytesOfFreeMemory = values[IAIDeviceLogColumnFreeMemory];
+    entry.bytesOfTotalMemory = values[IAIDeviceLogColumnTotalMemory];
+    entry.bytesOfFreeDiskSpace = values[IAIDeviceLogColumnFreeDiskSpace];
+    entry.bytesOfTotalDiskSpace = values[IAIDeviceLogColumnTotalDiskSpace];
+    entry.batteryLevel =
+    (CGFloat)IAISampleCodecDoubleFromBits(values[IAIDeviceLogColumnBatteryLevel]);
+    entry.batteryState = (UIDeviceBatteryState)values[IAIDeviceLogColumnBatteryState];
+    entry.sampledMetrics = (IAIDeviceMetrics)values[IAIDeviceLogColumnSampledMetrics];
+    return entry;
+}
+
+
+@implementation IAIDeviceLogBlockEnumerator
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithDecoder:(IAISampleBlockDecoder *)decoder {
+    if ((self = [super init])) {
+        _decoder = decoder;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)nextObject {
+    NSTimeInterval time = 0;
+    uint64_t values[IAISampleCodecMaxColumns];
+    if (![_decoder nextSampleTime:&time values:values]) {
+        _decoder = nil;
+        return nil;
+    }
+    return IAIDeviceLogEntryFromSample(time, values);
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIDeviceLogBlockStore
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithSamplesPerBlock:(NSUInteger)samplesPerBlock {
+    return [super initWithColumnCount:IAIDeviceLogColumnCount samplesPerBlock:samplesPerBlock];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)addDeviceLog:(IAIDeviceLogEntry *)logEntry {
+    uint64_t values[IAIDeviceLogColumnCount];
+    values[IAIDeviceLogColumnFreeMemory] = logEntry.bytesOfFreeMemory;
+    values[IAIDeviceLogColumnTotalMemory] = logEntry.bytesOfTotalMemory;
+    values[IAIDeviceLogColumnFreeDiskSpace] = logEntry.bytesOfFreeDiskSpace;
+    values[IAIDeviceLogColumnTotalDiskSpace] = logEntry.bytesOfTotalDiskSpace;
+    values[IAIDeviceLogColumnBatteryLevel] =
+    IAISampleCodecBitsFromDouble((double)logEntry.batteryLevel);
+    values[IAIDeviceLogColumnBatteryState] = (uint64_t)logEntry.batteryState;
+    values[IAIDeviceLogColumnSampledMetrics] = (uint64_t)logEntry.sampledMetrics;
+
+    [self appendSampleAtTime:[logEntry.timestamp timeIntervalSinceReferenceDate] values:values];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)removeEntriesBeforeDate: (NSDate *)date
+                     usingBlock: (void (^)(IAIDeviceLogEntry* logEntry))block {
+    [self removeBlocksBeforeTime: [date timeIntervalSinceReferenceDate]
+                      usingBlock: ^(NSTimeInterval time, const uint64_t* values) {
+                          if (nil != block) {
+                              block(IAIDeviceLogEntryFromSample(time, values));
+                          }
+                      }];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSArray *)entriesFromDate:(NSDate *)fromDate toDate:(NSDate *)toDate {
+    NSTimeInterval fromTime = [fromDate timeIntervalSinceReferenceDate];
+    NSTimeInterval toTime = [toDate timeIntervalSinceReferenceDate];
+    NSMutableArray* entries = [[NSMutableArray alloc] init];
+
+    IAISampleBlockDecoder* decoder = [self decoderFromTime:fromTime];
+    NSTimeInterval time = 0;
+    uint64_t values[IAISampleCodecMaxColumns];
+    while ([decoder nextSampleTime:&time values:values] && time <= toTime) {
+        if (time >= fromTime) {
+            [entries addObject:IAIDeviceLogEntryFromSample(time, values)];
+        }
+    }
+    return entries;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)firstObject {
+    // Only the first sample of the oldest block is decoded.
+    return [[self objectEnumerator] nextObject];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)lastObject {
+    // Starting from the newest sample's time decodes at most one block.
+    IAIDeviceLogBlockEnumerator* enumerator =
+    [[IAIDeviceLogBlockEnumerator alloc] initWithDecoder:[self decoderFromTime:self.lastTime]];
+    IAIDeviceLogEntry* lastEntry = nil;
+    for (IAIDeviceLogEntry* entry = [enumerator nextObject]; nil != entry;
+         entry = [enumerator nextObject]) {
+        lastEntry = entry;
+    }
+    return lastEntry;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSEnumerator *)objectEnumerator {
+    return [[IAIDeviceLogBlockEnumerator alloc] initWithDecoder:[self decoder]];
+}
+
+
+@end
@@ -0,0 +1,334 @@
+//
+//  IAISampleCodec.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#include "IAISampleCodec.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Marks a column that has not yet stored a meaningful-bits window.
+static const unsigned kNoWindow = 0xFF;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Bits
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static unsigned IAILeadingZeros(uint64_t value) {
+    return (0 == value) ? 64 : (unsigned)__builtin_clzll(value);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static unsigned IAITrailingZeros(uint64_t value) {
+    return (0 == value) ? 64 : (unsigned)__builtin_ctzll(value);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static int IAISampleEncoderReserve(IAISampleEncoder* encoder, unsigned bits) {
+    size_t needed = (encoder->bitCount + bits + 7) / 8;
+    if (needed <= encoder->capacity) {
+        return 1;
+    }
+    size_t capacity = (encoder->capacity > 0) ? encoder->capacity * 2 : 64;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    uint8_t* buffer = realloc(encoder->buffer, capacity);
+    if (NULL == buffer) {
+        return 0;
+    }
+    memset(buffer + encoder->capacity, 0, capacity - encoder->capacity);
+    encoder->buffer = buffer;
+    encoder->capacity = capacity;
+    return 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Writes the low `bits` bits of value, most significant bit first. Space must be reserved.
+static void IAISampleEncoderWrite(IAISampleEncoder* encoder, uint64_t value, unsigned bits) {
+    while (bits > 0) {
+        unsigned bitOffset = (unsigned)(encoder->bitCount & 7);
+        unsigned available = 8 - bitOffset;
+        unsigned take = (available < bits) ? available : bits;
+        uint8_t chunk = (uint8_t)((value >> (bits - take)) & ((1u << take) - 1));
+        encoder->buffer[encoder->bitCount >> 3] |= (uint8_t)(chunk << (available - take));
+        encoder->bitCount += take;
+        bits -= take;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static uint64_t IAISampleDecoderRead(IAISampleDecoder* decoder, unsigned bits) {
+    uint64_t value = 0;
+    while (bits > 0) {
+        unsigned bitOffset = (unsigned)(decoder->position & 7);
+        unsigned available = 8 - bitOffset;
+        unsigned take = (available < bits) ? available : bits;
+        uint8_t byte = decoder->buffer[decoder->position >> 3];
+        uint8_t chunk = (uint8_t)((byte >> (available - take)) & ((1u << take) - 1));
+        value = (value << take) | chunk;
+        decoder->position += take;
+        bits -= take;
+    }
+    return value;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+uint64_t IAISampleCodecBitsFromDouble(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+double IAISampleCodecDoubleFromBits(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Encoding
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAISampleEncoderReset(IAISampleEncoder* encoder, unsigned columnCount) {
+    if (NULL != encoder->buffer) {
+        memset(encoder->buffer, 0, encoder->capacity);
+    }
+    encoder->bitCount = 0;
+    encoder->count = 0;
+    encoder->columnCount = (columnCount < IAISampleCodecMaxColumns
+                            ? columnCount
+                            : IAISampleCodecMaxColumns);
+    encoder->lastTime = 0;
+    encoder->lastDelta = 0;
+    for (unsigned ix = 0; ix < IAISampleCodecMaxColumns; ++ix) {
+        encoder->lastValues[ix] = 0;
+        encoder->lastLeading[ix] = kNoWindow;
+        encoder->lastTrailing[ix] = 0;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAISampleEncoderDestroy(IAISampleEncoder* encoder) {
+    free(encoder->buffer);
+    encoder->buffer = NULL;
+    encoder->capacity = 0;
+    encoder->bitCount = 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAISampleEncoderWriteTime(IAISampleEncoder* encoder, int64_t time) {
+    if (0 == encoder->count) {
+        IAISampleEncoderWrite(encoder, (uint64_t)time, 64);
+
+    } else {
+        int64_t delta = time - encoder->lastTime;
+        int64_t deltaOfDelta = delta - encoder->lastDelta;
+
+        if (0 == deltaOfDelta) {
+            IAISampleEncoderWrite(encoder, 0x0, 1);
+
+        } else if (deltaOfDelta >= -63 && deltaOfDelta <= 64) {
+            IAISampleEncoderWrite(encoder, 0x2, 2);
+            IAISampleEncoderWrite(encoder, (uint64_t)(deltaOfDelta + 63), 7);
+
+        } else if (deltaOfDelta >= -255 && deltaOfDelta <= 256) {
+            IAISampleEncoderWrite(encoder, 0x6, 3);
+            IAISampleEncoderWrite(encoder, (uint64_t)(deltaOfDelta + 255), 9);
+
+        } else if (deltaOfDelta >= -2047 && deltaOfDelta <= 2048) {
+            IAISampleEncoderWrite(encoder, 0xE, 4);
+            IAISampleEncoderWrite(encoder, (uint64_t)(deltaOfDelta + 2047), 12);
+
+        } else {
+            IAISampleEncoderWrite(encoder, 0xF, 4);
+            IAISampleEncoderWrite(encoder, (uint64_t)deltaOfDelta, 64);
+        }
+        encoder->lastDelta = delta;
+    }
+    encoder->lastTime = time;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAISampleEncoderWriteValue(IAISampleEncoder* encoder, unsigned column, uint64_t value) {
+    if (0 == encoder->count) {
+        IAISampleEncoderWrite(encoder, value, 64);
+        encoder->lastValues[column] = value;
+        return;
+    }
+
+    uint64_t xor = value ^ encoder->lastValues[column];
+    encoder->lastValues[column] = value;
+
+    if (0 == xor) {
+        IAISampleEncoderWrite(encoder, 0x0, 1);
+        return;
+    }
+
+    unsigned leading = IAILeadingZeros(xor);
+    unsigned trailing = IAITrailingZeros(xor);
+    if (leading > 31) {
+        // The leading zero count is stored in 5 bits.
+        leading = 31;
+    }
+
+    unsigned lastLeading = encoder->lastLeading[column];
+    unsigned lastTrailing = encoder->lastTrailing[column];
+    if (kNoWindow != lastLeading && leading >= lastLeading && trailing >= lastTrailing) {
+        // The meaningful bits fit within the previous window.
+        unsigned meaningfulBits = 64 - lastLeading - lastTrailing;
+        IAISampleEncoderWrite(encoder, 0x2, 2);
+        IAISampleEncoderWrite(encoder, xor >> lastTrailing, meaningfulBits);
+
+    } else {
+        unsigned meaningfulBits = 64 - leading - trailing;
+        IAISampleEncoderWrite(encoder, 0x3, 2);
+        IAISampleEncoderWrite(encoder, leading, 5);
+        IAISampleEncoderWrite(encoder, meaningfulBits - 1, 6);
+        IAISampleEncoderWrite(encoder, xor >> trailing, meaningfulBits);
+        encoder->lastLeading[column] = leading;
+        encoder->lastTrailing[column] = trailing;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAISampleEncoderAppend(IAISampleEncoder* encoder, int64_t time, const uint64_t* values) {
+    // Worst case: a 68 bit timestamp and 77 bits per column.
+    if (!IAISampleEncoderReserve(encoder, 68 + 77 * encoder->columnCount)) {
+        return 0;
+    }
+    IAISampleEncoderWriteTime(encoder, time);
+    for (unsigned ix = 0; ix < encoder->columnCount; ++ix) {
+        IAISampleEncoderWriteValue(encoder, ix, values[ix]);
+    }
+    ++encoder->count;
+    return 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+size_t IAISampleEncoderByteLength(const IAISampleEncoder* encoder) {
+    return (encoder->bitCount + 7) / 8;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Decoding
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAISampleDecoderInit(IAISampleDecoder* decoder,
+                          const uint8_t* buffer, size_t byteLength,
+                          size_t count, unsigned columnCount) {
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->buffer = buffer;
+    decoder->bitLength = byteLength * 8;
+    decoder->remaining = count;
+    decoder->columnCount = (columnCount < IAISampleCodecMaxColumns
+                            ? columnCount
+                            : IAISampleCodecMaxColumns);
+    for (unsigned ix = 0; ix < IAISampleCodecMaxColumns; ++ix) {
+        decoder->lastLeading[ix] = kNoWindow;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static int64_t IAISampleDecoderReadTime(IAISampleDecoder* decoder) {
+    if (0 == decoder->index) {
+        decoder->lastTime = (int64_t)IAISampleDecoderRead(decoder, 64);
+        return decoder->lastTime;
+    }
+
+    int64_t deltaOfDelta;
+    if (0 == IAISampleDecoderRead(decoder, 1)) {
+        deltaOfDelta = 0;
+
+    } else if (0 == IAISampleDecoderRead(decoder, 1)) {
+        deltaOfDelta = (int64_t)IAISampleDecoderRead(decoder, 7) - 63;
+
+    } else if (0 == IAISampleDecoderRead(decoder, 1)) {
+        deltaOfDelta = (int64_t)IAISampleDecoderRead(decoder, 9) - 255;
+
+    } else if (0 == IAISampleDecoderRead(decoder, 1)) {
+        deltaOfDelta = (int64_t)IAISampleDecoderRead(decoder, 12) - 2047;
+
+    } else {
+        deltaOfDelta = (int64_t)IAISampleDecoderRead(decoder, 64);
+    }
+
+    decoder->lastDelta += deltaOfDelta;
+    decoder->lastTime += decoder->lastDelta;
+    return decoder->lastTime;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static uint64_t IAISampleDecoderReadValue(IAISampleDecoder* decoder, unsigned column) {
+    if (0 == decoder->index) {
+        decoder->lastValues[column] = IAISampleDecoderRead(decoder, 64);
+        return decoder->lastValues[column];
+    }
+
+    if (0 == IAISampleDecoderRead(decoder, 1)) {
+        return decoder->lastValues[column];
+    }
+
+    uint64_t xor;
+    if (0 == IAISampleDecoderRead(decoder, 1)) {
+        unsigned leading = decoder->lastLeading[column];
+        unsigned trailing = decoder->lastTrailing[column];
+        xor = IAISampleDecoderRead(decoder, 64 - leading - trailing) << trailing;
+
+    } else {
+        unsigned leading = (unsigned)IAISampleDecoderRead(decoder, 5);
+        unsigned meaningfulBits = (unsigned)IAISampleDecoderRead(decoder, 6) + 1;
+        unsigned trailing = 64 - leading - meaningfulBits;
+        xor = IAISampleDecoderRead(decoder, meaningfulBits) << trailing;
+        decoder->lastLeading[column] = leading;
+        decoder->lastTrailing[column] = trailing;
+    }
+
+    decoder->lastValues[column] ^= xor;
+    return decoder->lastValues[column];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAISampleDecoderNext(IAISampleDecoder* decoder, int64_t* time, uint64_t* values) {
+    if (0 == decoder->remaining) {
+        return 0;
+    }
+    *time = IAISampleDecoderReadTime(decoder);
+    for (unsigned ix = 0; ix < decoder->columnCount; ++ix) {
+        values[ix] = IAISampleDecoderReadValue(decoder, ix);
+    }
+    ++decoder->index;
+    --decoder->remaining;
+    return 1;
+}
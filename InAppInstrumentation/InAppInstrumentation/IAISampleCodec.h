@@ -0,0 +1,102 @@
+//
+//  IAISampleCodec.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#ifndef InAppInstrumentation_IAISampleCodec_h
+#define InAppInstrumentation_IAISampleCodec_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A bit-packed encoder and decoder for time series samples.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * Each sample is a timestamp in milliseconds and a fixed number of 64 bit columns.
+ *
+ * Timestamps are stored as the delta of the delta from the previous sample. The heartbeat
+ * samples at a regular interval, so most timestamps cost a single bit.
+ *
+ * Columns are stored as the XOR of the previous value in the same column. Values that did not
+ * change cost a single bit, and values that changed only in a few bits store just the
+ * meaningful bits between the leading and trailing zeros of the XOR. Doubles should be stored
+ * by their bit pattern (see IAISampleCodecBitsFromDouble).
+ *
+ * This is the encoding described in "Gorilla: A Fast, Scalable, In-Memory Time Series
+ * Database" (Pelkonen et al., VLDB 2015).
+ */
+
+#define IAISampleCodecMaxColumns 8
+
+typedef struct {
+    uint8_t* buffer;
+    size_t capacity;
+    size_t bitCount;
+
+    size_t count;
+    unsigned columnCount;
+
+    int64_t lastTime;
+    int64_t lastDelta;
+    uint64_t lastValues[IAISampleCodecMaxColumns];
+    unsigned lastLeading[IAISampleCodecMaxColumns];
+    unsigned lastTrailing[IAISampleCodecMaxColumns];
+} IAISampleEncoder;
+
+typedef struct {
+    const uint8_t* buffer;
+    size_t bitLength;
+    size_t position;
+
+    size_t remaining;
+    size_t index;
+    unsigned columnCount;
+
+    int64_t lastTime;
+    int64_t lastDelta;
+    uint64_t lastValues[IAISampleCodecMaxColumns];
+    unsigned lastLeading[IAISampleCodecMaxColumns];
+    unsigned lastTrailing[IAISampleCodecMaxColumns];
+} IAISampleDecoder;
+
+/**
+ * Prepares an encoder for a new block. Any memory held by the encoder is reused.
+ */
+void IAISampleEncoderReset(IAISampleEncoder* encoder, unsigned columnCount);
+
+/**
+ * Frees the memory held by an encoder.
+ */
+void IAISampleEncoderDestroy(IAISampleEncoder* encoder);
+
+/**
+ * Appends a sample to the block. Returns 0 if memory could not be allocated.
+ */
+int IAISampleEncoderAppend(IAISampleEncoder* encoder, int64_t time, const uint64_t* values);
+
+/**
+ * The number of bytes needed to hold the encoded block.
+ */
+size_t IAISampleEncoderByteLength(const IAISampleEncoder* encoder);
+
+/**
+ * Prepares a decoder to read count samples from an encoded block.
+ */
+void IAISampleDecoderInit(IAISampleDecoder* decoder,
+                          const uint8_t* buffer, size_t byteLength,
+                          size_t count, unsigned columnCount);
+
+/**
+ * Reads the next sample. Returns 0 once all of the samples have been read.
+ */
+int IAISampleDecoderNext(IAISampleDecoder* decoder, int64_t* time, uint64_t* values);
+
+uint64_t IAISampleCodecBitsFromDouble(double value);
+double IAISampleCodecDoubleFromBits(uint64_t bits);
+
+#endif
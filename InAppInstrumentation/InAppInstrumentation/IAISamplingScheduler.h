@@ -0,0 +1,160 @@
+//
+//  IAISamplingScheduler.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class IAILogger;
+
+// The prefix of the metrics in which the scheduler records the interval of each metric, e.g.
+// "samplingInterval.bytesOfFreeMemory".
+extern NSString* const IAIMetricSamplingIntervalPrefix;
+
+/**
+ * The sampling state of one metric.
+ *
+ *      @ingroup Overview-Logger
+ */
+@interface IAISamplingSchedule : NSObject {
+@private
+    NSString* _metricName;
+    NSTimeInterval _minimumInterval;
+    NSTimeInterval _maximumInterval;
+    double _changeThreshold;
+
+    NSTimeInterval _baseInterval;
+    NSTimeInterval _interval;
+    NSTimeInterval _nextSampleTime;
+    double _lastValue;
+    BOOL _hasLastValue;
+}
+
+@property (nonatomic, readonly, copy) NSString* metricName;
+
+/**
+ * The interval while the metric is changing or watched by a trigger rule.
+ */
+@property (nonatomic, readwrite, assign) NSTimeInterval minimumInterval;
+
+/**
+ * The interval that the schedule backs off to while the metric is flat.
+ */
+@property (nonatomic, readwrite, assign) NSTimeInterval maximumInterval;
+
+/**
+ * The smallest change between two samples, as a fraction of the earlier sample, that counts
+ * as the metric changing.
+ */
+@property (nonatomic, readwrite, assign) double changeThreshold;
+
+/**
+ * The current interval between samples.
+ */
+@property (nonatomic, readonly, assign) NSTimeInterval interval;
+
+/**
+ * The time of the next sample, in seconds since the reference date.
+ */
+@property (nonatomic, readonly, assign) NSTimeInterval nextSampleTime;
+
+@end
+
+
+/**
+ * Decides how often each metric of the device is sampled.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * A metric that changed since its last sample, or that a trigger rule of the logger watches,
+ * is sampled at its minimumInterval so that a spike is followed closely. While it stays flat
+ * the interval grows by backoffFactor with every sample, up to its maximumInterval, so that
+ * values like the total disk space are hardly read at all.
+ *
+ * The intervals are stretched by throttleFactor, which follows the CPU budget of the overhead
+ * monitor, and by lowPowerFactor while the device runs on a low battery. Whenever the interval
+ * of a metric changes, it is added to the logger as a metric named after the metric with the
+ * IAIMetricSamplingIntervalPrefix, so that the rate of any stretch of samples can be found
+ * later.
+ *
+ * A sample that isn't due carries the metric's last value forward, so the device logs hold
+ * every metric in every entry, drawn as a step from the time of the sample that read it. Each
+ * entry's sampledMetrics tells the values that were read from those that were carried, and
+ * only the values that were read are rolled up and evaluated by trigger rules.
+ */
+@interface IAISamplingScheduler : NSObject {
+@private
+    __weak IAILogger* _logger;
+    NSMutableDictionary* _schedules;
+    double _backoffFactor;
+    double _throttleFactor;
+    double _lowPowerFactor;
+    BOOL _lowPower;
+}
+
+#pragma mark Creating a Scheduler /** @name Creating a Scheduler */
+
+/**
+ * Designated initializer.
+ *
+ * Creates schedules for the metrics of IAIDeviceLogEntry. The logger is not retained.
+ */
+- (id)initWithLogger:(IAILogger *)logger;
+
+
+#pragma mark Configuring Schedules /** @name Configuring Schedules */
+
+/**
+ * The schedule of a metric, which is created the first time it is asked for.
+ */
+- (IAISamplingSchedule *)scheduleForMetric:(NSString *)metricName;
+
+/**
+ * The factor by which the interval of a flat metric grows with every sample.
+ *
+ * By default this is 1.5.
+ */
+@property (nonatomic, readwrite, assign) double backoffFactor;
+
+/**
+ * The factor by which every interval is stretched to stay within the CPU budget.
+ *
+ * By default this is 1.
+ */
+@property (nonatomic, readwrite, assign) double throttleFactor;
+
+/**
+ * Whether the device is running on a low battery.
+ */
+@property (nonatomic, readwrite, assign, getter=isLowPower) BOOL lowPower;
+
+/**
+ * The factor by which every interval is stretched while the device is running on a low
+ * battery.
+ *
+ * By default this is 4.
+ */
+@property (nonatomic, readwrite, assign) double lowPowerFactor;
+
+
+#pragma mark Sampling /** @name Sampling */
+
+/**
+ * Whether a metric should be sampled at the given time.
+ */
+- (BOOL)isMetricDue:(NSString *)metricName atTime:(NSTimeInterval)time;
+
+/**
+ * Adapts the schedule of a metric to a new sample of it.
+ */
+- (void)didSampleMetric:(NSString *)metricName value:(double)value atTime:(NSTimeInterval)time;
+
+/**
+ * The time at which the next metric is due.
+ */
+- (NSTimeInterval)nextSampleTime;
+
+@end
@@ -0,0 +1,218 @@
+//
+//  IAISamplingScheduler.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAISamplingScheduler.h"
+
+#import "IAILogger.h"
+#import "IAITriggerRule.h"
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+NSString* const IAIMetricSamplingIntervalPrefix = @"samplingInterval.";
+
+// Timers fire a little early or late, so a metric is due this long before its time.
+static const NSTimeInterval kDueTolerance = 0.01;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@interface IAISamplingSchedule()
+
+// The interval before it is stretched by the scheduler's factors.
+@property (nonatomic, readwrite, assign) NSTimeInterval baseInterval;
+
+- (id)initWithMetricName:(NSString *)metricName;
+- (BOOL)hasChangedToValue:(double)value;
+- (void)setInterval:(NSTimeInterval)interval fromTime:(NSTimeInterval)time;
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAISamplingSchedule
+
+@synthesize metricName = _metricName;
+@synthesize minimumInterval = _minimumInterval;
+@synthesize maximumInterval = _maximumInterval;
+@synthesize changeThreshold = _changeThreshold;
+@synthesize interval = _interval;
+@synthesize nextSampleTime = _nextSampleTime;
+@synthesize baseInterval = _baseInterval;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithMetricName:(NSString *)metricName {
+    if ((self = [super init])) {
+        _metricName = [metricName copy];
+        _minimumInterval = 0.5;
+        _maximumInterval = 8;
+        _changeThreshold = 0;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@ %@ every %.2fs>",
+            NSStringFromClass([self class]), _metricName, _interval];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Whether a value differs from the last sample by more than the threshold. Remembers the value.
+- (BOOL)hasChangedToValue:(double)value {
+    BOOL hasChanged = (!_hasLastValue
+                       || fabs(value - _lastValue) > _changeThreshold * fabs(_lastValue));
+    _lastValue = value;
+    _hasLastValue = YES;
+    return hasChanged;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)setInterval:(NSTimeInterval)interval fromTime:(NSTimeInterval)time {
+    _interval = interval;
+    _nextSampleTime = time + interval;
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAISamplingScheduler
+
+@synthesize backoffFactor = _backoffFactor;
+@synthesize throttleFactor = _throttleFactor;
+@synthesize lowPower = _lowPower;
+@synthesize lowPowerFactor = _lowPowerFactor;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)setMinimumInterval: (NSTimeInterval)minimumInterval
+           maximumInterval: (NSTimeInterval)maximumInterval
+           changeThreshold: (double)changeThreshold
+                 forMetric: (NSString *)metricName {
+    IAISamplingSchedule* schedule = [self scheduleForMetric:metricName];
+    schedule.minimumInterval = minimumInterval;
+    schedule.maximumInterval = maximumInterval;
+    schedule.changeThreshold = changeThreshold;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithLogger:(IAILogger *)logger {
+    if ((self = [super init])) {
+        _logger = logger;
+        _schedules = [[NSMutableDictionary alloc] init];
+        _backoffFactor = 1.5;
+        _throttleFactor = 1;
+        _lowPowerFactor = 4;
+
+        // Free memory moves quickly and matters most; the totals hardly ever change.
+        [self setMinimumInterval: 0.1
+                 maximumInterval: 2
+                 changeThreshold: 0.01
+                       forMetric: IAIMetricBytesOfFreeMemory];
+        [self setMinimumInterval: 1
+                 maximumInterval: 30
+                 changeThreshold: 0.001
+                       forMetric: IAIMetricBytesOfFreeDiskSpace];
+        [self setMinimumInterval: 5
+                 maximumInterval: 60
+                 changeThreshold: 0
+                       forMetric: IAIMetricBatteryLevel];
+        [self setMinimumInterval: 30
+                 maximumInterval: 600
+                 changeThreshold: 0
+                       forMetric: IAIMetricBytesOfTotalMemory];
+        [self setMinimumInterval: 30
+                 maximumInterval: 600
+                 changeThreshold: 0
+                       forMetric: IAIMetricBytesOfTotalDiskSpace];
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAISamplingSchedule *)scheduleForMetric:(NSString *)metricName {
+    IAISamplingSchedule* schedule = [_schedules objectForKey:metricName];
+    if (nil == schedule) {
+        schedule = [[IAISamplingSchedule alloc] initWithMetricName:metricName];
+        [_schedules setObject:schedule forKey:metricName];
+    }
+    return schedule;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)isMetricWatched:(NSString *)metricName {
+    for (IAITriggerRule* rule in _logger.triggerRules) {
+        if ([rule.metricName isEqualToString:metricName]) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)isMetricDue:(NSString *)metricName atTime:(NSTimeInterval)time {
+    IAISamplingSchedule* schedule = [_schedules objectForKey:metricName];
+    return (nil == schedule || time >= schedule.nextSampleTime - kDueTolerance);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)didSampleMetric:(NSString *)metricName value:(double)value atTime:(NSTimeInterval)time {
+    IAISamplingSchedule* schedule = [self scheduleForMetric:metricName];
+
+    // Drop straight to the minimum on a change so that the rest of a spike is caught, and back
+    // off gradually while the metric is flat.
+    if ([schedule hasChangedToValue:value] || [self isMetricWatched:metricName]) {
+        schedule.baseInterval = schedule.minimumInterval;
+
+    } else {
+        schedule.baseInterval = MAX(MIN(schedule.baseInterval * _backoffFactor,
+                                        schedule.maximumInterval),
+                                    schedule.minimumInterval);
+    }
+
+    NSTimeInterval interval = schedule.baseInterval * _throttleFactor;
+    if (_lowPower) {
+        interval *= _lowPowerFactor;
+    }
+    if (interval != schedule.interval) {
+        [_logger addMetricValue: interval
+                        forName: [IAIMetricSamplingIntervalPrefix
+                                  stringByAppendingString:metricName]];
+    }
+    [schedule setInterval:interval fromTime:time];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSTimeInterval)nextSampleTime {
+    NSTimeInterval nextSampleTime = DBL_MAX;
+    for (IAISamplingSchedule* schedule in [_schedules objectEnumerator]) {
+        nextSampleTime = MIN(schedule.nextSampleTime, nextSampleTime);
+    }
+    return nextSampleTime;
+}
+
+
+@end
@@ -0,0 +1,67 @@
+//
+//  IAISeqLock.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#include "IAISeqLock.h"
+
+#if defined(__APPLE__)
+#include <libkern/OSAtomic.h>
+#else
+#define OSAtomicAdd32Barrier(amount, value) __sync_add_and_fetch((value), (amount))
+#define OSAtomicIncrement32Barrier(value) __sync_add_and_fetch((value), 1)
+#define OSAtomicDecrement32Barrier(value) __sync_sub_and_fetch((value), 1)
+#define OSMemoryBarrier() __sync_synchronize()
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAISeqLockBeginWrite(IAISeqLock* lock) {
+    OSAtomicIncrement32Barrier(&lock->sequence);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAISeqLockEndWrite(IAISeqLock* lock) {
+    OSAtomicIncrement32Barrier(&lock->sequence);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAISeqLockHasReaders(IAISeqLock* lock) {
+    // Adding zero with a barrier orders this load after the writer's preceding stores.
+    return 0 != OSAtomicAdd32Barrier(0, &lock->readerCount);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAISeqLockEnterReader(IAISeqLock* lock) {
+    OSAtomicIncrement32Barrier(&lock->readerCount);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAISeqLockExitReader(IAISeqLock* lock) {
+    OSAtomicDecrement32Barrier(&lock->readerCount);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int32_t IAISeqLockReadBegin(IAISeqLock* lock) {
+    int32_t sequence;
+    while ((sequence = lock->sequence) & 1) {
+        // A change is in progress; it is only ever a handful of stores long.
+    }
+    OSMemoryBarrier();
+    return sequence;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAISeqLockReadRetry(IAISeqLock* lock, int32_t sequence) {
+    OSMemoryBarrier();
+    return lock->sequence != sequence;
+}
@@ -0,0 +1,67 @@
+//
+//  IAISeqLock.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#ifndef InAppInstrumentation_IAISeqLock_h
+#define InAppInstrumentation_IAISeqLock_h
+
+#include <stdint.h>
+
+/**
+ * A sequence lock that lets one writer publish state to any number of readers without either
+ * side taking a lock.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * The writer brackets every change with IAISeqLockBeginWrite and IAISeqLockEndWrite, which
+ * makes the sequence odd while the change is in progress. Readers copy the state and retry if
+ * the sequence was odd or changed while they were copying it:
+ *
+ * @code
+ *  IAISeqLockEnterReader(&lock);
+ *  int32_t sequence;
+ *  do {
+ *    sequence = IAISeqLockReadBegin(&lock);
+ *    // Copy the state.
+ *  } while (IAISeqLockReadRetry(&lock, sequence));
+ *  // Retain anything that was copied.
+ *  IAISeqLockExitReader(&lock);
+ * @endcode
+ *
+ * The writer never waits for readers. Instead, objects that the writer replaces must be kept
+ * alive until IAISeqLockHasReaders returns false after the change, because a reader may have
+ * copied a pointer to them but not yet retained it.
+ */
+typedef struct {
+    volatile int32_t sequence;
+    volatile int32_t readerCount;
+} IAISeqLock;
+
+void IAISeqLockBeginWrite(IAISeqLock* lock);
+void IAISeqLockEndWrite(IAISeqLock* lock);
+
+/**
+ * Whether any reader is between IAISeqLockEnterReader and IAISeqLockExitReader.
+ *
+ * Objects retired by the writer may be released once this returns 0 after IAISeqLockEndWrite.
+ */
+int IAISeqLockHasReaders(IAISeqLock* lock);
+
+void IAISeqLockEnterReader(IAISeqLock* lock);
+void IAISeqLockExitReader(IAISeqLock* lock);
+
+/**
+ * Returns the sequence to pass to IAISeqLockReadRetry, waiting out any change in progress.
+ */
+int32_t IAISeqLockReadBegin(IAISeqLock* lock);
+
+/**
+ * Returns 1 if the state copied since IAISeqLockReadBegin may be torn and must be copied again.
+ */
+int IAISeqLockReadRetry(IAISeqLock* lock, int32_t sequence);
+
+#endif
@@ -0,0 +1,109 @@
+//
+//  IAIShardedLog.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import <pthread.h>
+
+#import "IAIDataStructures.h"
+#import "IAISeqLock.h"
+
+@class IAILogEntry;
+
+// The seconds that the date of a prune must advance by before the shards are walked again.
+#define IAIShardedLogPruneInterval 0.25
+
+/**
+ * A log that any number of threads may append to without contending with each other.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * Each thread appends to its own shard, an IAIHistoryList that only that thread writes, so
+ * appending takes no lock and touches no memory that another appending thread writes. The
+ * shards are merged by timestamp only when the log is read: objectEnumerator performs a lazy
+ * k-way merge of a snapshot of every shard, and the time-range queries binary search each shard
+ * before merging.
+ *
+ * Pruning reads a snapshot of every shard, whichever thread it belongs to, and hands the
+ * expired entries to its block merged by timestamp. It then publishes the sequence number that
+ * each shard has been pruned to. Readers skip the pruned entries at once, and the shard's own
+ * thread removes them from its list the next time it appends, so no list ever has two writers.
+ * The entries of a thread that stops logging stay in memory, though not in the log, until it
+ * logs again or exits. When a thread exits its shard is kept until its entries expire, is then
+ * trimmed by the pruning thread itself, and is dropped. So that threads that log at a high rate
+ * don't take turns walking the shards, a prune is skipped while another thread is pruning, or
+ * when the date is less than IAIShardedLogPruneInterval seconds past the date of the last
+ * prune.
+ */
+@interface IAIShardedLog : NSObject <IAILogCollection> {
+@private
+    pthread_key_t _shardKey;
+
+    // Serializes threads that are adding or removing shards. Never taken to append or read.
+    pthread_mutex_t _registrationMutex;
+
+    // Published to readers through _lock. Replaced, never modified.
+    IAISeqLock _lock;
+    NSArray* _shards;
+    NSMutableArray* _retiredShards;
+
+    // Read without the registration mutex; a stale value only delays or repeats a prune.
+    volatile NSTimeInterval _nextPruneTime;
+}
+
+#pragma mark Adding Entries /** @name Adding Entries */
+
+/**
+ * Appends an entry to the calling thread's shard.
+ *
+ * Entries added by a single thread must be in chronological order.
+ */
+- (void)addEntry:(IAILogEntry *)entry;
+
+/**
+ * Removes the entries of every shard that are older than the given date, unless the prune is
+ * skipped as described above.
+ *
+ * The block is called with each removed entry in chronological order across all of the shards,
+ * while the log's registration lock is held: it must not add entries to the log.
+ */
+- (void)removeEntriesBeforeDate: (NSDate *)date
+                     usingBlock: (void (^)(IAILogEntry* logEntry))block;
+
+
+#pragma mark Reading the Log /** @name Reading the Log */
+
+/**
+ * The entries with timestamps in [fromDate, toDate], in chronological order.
+ *
+ * If only one shard has entries in the range, its snapshot is returned without copying.
+ *
+ *      Run-time: O(shards * log(count) + number of entries in the range * shards)
+ */
+- (IAIHistoryRange *)entriesFromDate:(NSDate *)fromDate toDate:(NSDate *)toDate;
+
+/**
+ * The entries of a chronologically ordered range with timestamps in [fromDate, toDate].
+ *
+ *      Run-time: O(log(count))
+ */
++ (IAIHistoryRange *)entriesInRange: (IAIHistoryRange *)range
+                           fromDate: (NSDate *)fromDate
+                             toDate: (NSDate *)toDate;
+
+/**
+ * A snapshot of each shard that has entries, in no particular order.
+ */
+- (NSArray *)shardSnapshots;
+
+/**
+ * The number of threads that have added entries to the log.
+ */
+@property (nonatomic, readonly, assign) NSUInteger numberOfShards;
+
+@end
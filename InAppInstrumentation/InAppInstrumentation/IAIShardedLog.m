@@ -0,0 +1,435 @@
+//
+//  IAIShardedLog.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAIShardedLog.h"
+
+#import "IAILogger.h"
+
+#import <libkern/OSAtomic.h>
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+// The entries appended by a single thread, which is the only one that writes the list while
+// it runs. The pruning thread publishes the sequence that the entries before have expired at,
+// and the shard's thread removes them when it next appends.
+@interface IAILogShard : NSObject {
+@public
+    IAIHistoryList* _entries;
+    volatile int64_t _prunedEndSequence;
+    volatile int32_t _isFinished;
+}
+@end
+
+@implementation IAILogShard
+
+- (id)init {
+    if ((self = [super init])) {
+        _entries = [[IAIHistoryList alloc] init];
+    }
+    return self;
+}
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Called by pthreads when a thread that has a shard exits. The log still owns the shard.
+static void IAILogShardThreadDidExit(void* value) {
+    IAILogShard* shard = (__bridge IAILogShard *)value;
+    OSAtomicIncrement32Barrier(&shard->_isFinished);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static NSTimeInterval IAITimeOfEntry(IAILogEntry* entry) {
+    return [entry.timestamp timeIntervalSinceReferenceDate];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static unsigned long long IAIPrunedEndSequenceOfShard(IAILogShard* shard) {
+    return (unsigned long long)OSAtomicAdd64Barrier(0, &shard->_prunedEndSequence);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The entries of the shard that haven't been pruned.
+static IAIHistoryRange* IAISnapshotOfShard(IAILogShard* shard) {
+    IAIHistoryRange* snapshot = [shard->_entries snapshot];
+    unsigned long long prunedEndSequence = IAIPrunedEndSequenceOfShard(shard);
+    if (prunedEndSequence <= snapshot.firstSequence) {
+        return snapshot;
+    }
+    NSUInteger numberOfPruned = (NSUInteger)MIN(prunedEndSequence - snapshot.firstSequence,
+                                                (unsigned long long)[snapshot count]);
+    return [snapshot subrangeWithRange:NSMakeRange(numberOfPruned,
+                                                   [snapshot count] - numberOfPruned)];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @internal
+ *
+ * Merges chronologically ordered ranges into a single chronological sequence.
+ *
+ * Each step compares the next entry of every range, which is cheaper than a heap for the
+ * handful of threads that log.
+ */
+@interface IAIMergedLogEnumerator : NSEnumerator {
+@private
+    NSArray* _ranges;
+    NSUInteger* _cursors;
+}
+
+- (id)initWithRanges:(NSArray *)ranges;
+
+@end
+
+
+@implementation IAIMergedLogEnumerator
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)dealloc {
+    free(_cursors);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithRanges:(NSArray *)ranges {
+    if ((self = [super init])) {
+        _ranges = ranges;
+        _cursors = calloc(MAX([ranges count], 1), sizeof(NSUInteger));
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)nextObject {
+    IAILogEntry* nextEntry = nil;
+    NSTimeInterval nextTime = 0;
+    NSUInteger nextIndex = 0;
+
+    NSUInteger ix = 0;
+    for (IAIHistoryRange* range in _ranges) {
+        IAILogEntry* entry = [range objectAtIndex:_cursors[ix]];
+        if (nil != entry) {
+            NSTimeInterval time = IAITimeOfEntry(entry);
+            if (nil == nextEntry || time < nextTime) {
+                nextEntry = entry;
+                nextTime = time;
+                nextIndex = ix;
+            }
+        }
+        ++ix;
+    }
+
+    if (nil != nextEntry) {
+        ++_cursors[nextIndex];
+    }
+    return nextEntry;
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIShardedLog
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)dealloc {
+    pthread_key_delete(_shardKey);
+    pthread_mutex_destroy(&_registrationMutex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)init {
+    if ((self = [super init])) {
+        pthread_key_create(&_shardKey, IAILogShardThreadDidExit);
+        pthread_mutex_init(&_registrationMutex, NULL);
+        _shards = [[NSArray alloc] init];
+        _retiredShards = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Shards
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Must be called with _registrationMutex held.
+- (void)publishShards:(NSArray *)shards {
+    IAISeqLockBeginWrite(&_lock);
+    // A reader may have copied the old pointer without retaining it yet.
+    [_retiredShards addObject:_shards];
+    _shards = shards;
+    IAISeqLockEndWrite(&_lock);
+
+    if (!IAISeqLockHasReaders(&_lock)) {
+        [_retiredShards removeAllObjects];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSArray *)shards {
+    IAISeqLockEnterReader(&_lock);
+    __unsafe_unretained NSArray* unretainedShards;
+    int32_t sequence;
+    do {
+        sequence = IAISeqLockReadBegin(&_lock);
+        unretainedShards = _shards;
+    } while (IAISeqLockReadRetry(&_lock, sequence));
+    NSArray* shards = unretainedShards;
+    IAISeqLockExitReader(&_lock);
+    return shards;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAILogShard *)shardForCurrentThread {
+    return (__bridge IAILogShard *)pthread_getspecific(_shardKey);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAILogShard *)registerShardForCurrentThread {
+    IAILogShard* shard = [[IAILogShard alloc] init];
+
+    pthread_mutex_lock(&_registrationMutex);
+    [self publishShards:[_shards arrayByAddingObject:shard]];
+    pthread_mutex_unlock(&_registrationMutex);
+
+    // The shards array owns the shard; the thread only keeps a pointer to it.
+    pthread_setspecific(_shardKey, (__bridge void *)shard);
+    return shard;
+}
+
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Public Methods
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)addEntry:(IAILogEntry *)entry {
+    IAILogShard* shard = [self shardForCurrentThread];
+    if (nil == shard) {
+        shard = [self registerShardForCurrentThread];
+    }
+    [shard->_entries removeObjectsBeforeSequence:IAIPrunedEndSequenceOfShard(shard)];
+    [shard->_entries addObject:entry];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)removeEntriesBeforeDate: (NSDate *)date
+                     usingBlock: (void (^)(IAILogEntry* logEntry))block {
+    NSTimeInterval time = [date timeIntervalSinceReferenceDate];
+    if (time < _nextPruneTime) {
+        return;
+    }
+
+    // Holding the registration mutex keeps the shards from changing and makes this the only
+    // pruning thread. The shards are only read, so their threads keep appending meanwhile.
+    if (0 != pthread_mutex_trylock(&_registrationMutex)) {
+        return;
+    }
+    _nextPruneTime = time + IAIShardedLogPruneInterval;
+
+    NSUInteger numberOfShards = [_shards count];
+    NSMutableArray* expiredRanges = [[NSMutableArray alloc] initWithCapacity:numberOfShards];
+    unsigned long long* prunedEndSequences = calloc(MAX(numberOfShards, 1),
+                                                    sizeof(unsigned long long));
+    NSUInteger shardIndex = 0;
+    for (IAILogShard* shard in _shards) {
+        IAIHistoryRange* snapshot = IAISnapshotOfShard(shard);
+        NSUInteger numberOfExpired = [snapshot indexOfFirstObjectNotPassingTest:
+                                      ^BOOL(IAILogEntry* entry) {
+                                          return IAITimeOfEntry(entry) < time;
+                                      }];
+        prunedEndSequences[shardIndex++] = snapshot.firstSequence + numberOfExpired;
+        if (numberOfExpired > 0) {
+            [expiredRanges addObject:[snapshot subrangeWithRange:
+                                      NSMakeRange(0, numberOfExpired)]];
+        }
+    }
+
+    // Merged, so that whatever the block aggregates the entries into sees them in order.
+    if (nil != block) {
+        IAIMergedLogEnumerator* enumerator = [[IAIMergedLogEnumerator alloc]
+                                              initWithRanges:expiredRanges];
+        for (IAILogEntry* entry = [enumerator nextObject]; nil != entry;
+             entry = [enumerator nextObject]) {
+            block(entry);
+        }
+    }
+
+    NSMutableArray* remainingShards = nil;
+    shardIndex = 0;
+    for (IAILogShard* shard in _shards) {
+        // Only the pruning thread writes the sequence, so adding the difference stores it, and
+        // does so atomically even where a 64-bit store isn't.
+        unsigned long long prunedEndSequence = prunedEndSequences[shardIndex++];
+        OSAtomicAdd64Barrier((int64_t)(prunedEndSequence - IAIPrunedEndSequenceOfShard(shard)),
+                             &shard->_prunedEndSequence);
+
+        // A finished shard has no thread left to trim it, nor to append to it.
+        if (shard->_isFinished) {
+            [shard->_entries removeObjectsBeforeSequence:prunedEndSequence];
+            if ([shard->_entries count] == 0) {
+                if (nil == remainingShards) {
+                    remainingShards = [_shards mutableCopy];
+                }
+                [remainingShards removeObjectIdenticalTo:shard];
+            }
+        }
+    }
+    free(prunedEndSequences);
+
+    if (nil != remainingShards) {
+        [self publishShards:[remainingShards copy]];
+    }
+    pthread_mutex_unlock(&_registrationMutex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSArray *)shardSnapshots {
+    NSArray* shards = [self shards];
+    NSMutableArray* snapshots = [[NSMutableArray alloc] initWithCapacity:[shards count]];
+    for (IAILogShard* shard in shards) {
+        IAIHistoryRange* snapshot = IAISnapshotOfShard(shard);
+        if ([snapshot count] > 0) {
+            [snapshots addObject:snapshot];
+        }
+    }
+    return snapshots;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSUInteger)numberOfShards {
+    return [[self shards] count];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (IAIHistoryRange *)entriesInRange: (IAIHistoryRange *)range
+                           fromDate: (NSDate *)fromDate
+                             toDate: (NSDate *)toDate {
+    NSTimeInterval fromTime = [fromDate timeIntervalSinceReferenceDate];
+    NSTimeInterval toTime = [toDate timeIntervalSinceReferenceDate];
+
+    NSUInteger fromIndex = [range indexOfFirstObjectNotPassingTest:^BOOL(IAILogEntry* entry) {
+        return IAITimeOfEntry(entry) < fromTime;
+    }];
+    NSUInteger toIndex = [range indexOfFirstObjectNotPassingTest:^BOOL(IAILogEntry* entry) {
+        return IAITimeOfEntry(entry) <= toTime;
+    }];
+    toIndex = MAX(fromIndex, toIndex);
+    return [range subrangeWithRange:NSMakeRange(fromIndex, toIndex - fromIndex)];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAIHistoryRange *)entriesFromDate:(NSDate *)fromDate toDate:(NSDate *)toDate {
+    NSMutableArray* ranges = [[NSMutableArray alloc] init];
+    NSUInteger count = 0;
+    for (IAIHistoryRange* snapshot in [self shardSnapshots]) {
+        IAIHistoryRange* range = [[self class] entriesInRange: snapshot
+                                                     fromDate: fromDate
+                                                       toDate: toDate];
+        if ([range count] > 0) {
+            [ranges addObject:range];
+            count += [range count];
+        }
+    }
+
+    if ([ranges count] <= 1) {
+        return (([ranges count] == 1)
+                ? [ranges lastObject]
+                : [[IAIHistoryRange alloc] initWithArray:[NSArray array]]);
+    }
+
+    NSMutableArray* entries = [[NSMutableArray alloc] initWithCapacity:count];
+    IAIMergedLogEnumerator* enumerator = [[IAIMergedLogEnumerator alloc] initWithRanges:ranges];
+    for (IAILogEntry* entry = [enumerator nextObject]; nil != entry;
+         entry = [enumerator nextObject]) {
+        [entries addObject:entry];
+    }
+    return [[IAIHistoryRange alloc] initWithArray:entries];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark IAILogCollection
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSUInteger)count {
+    NSUInteger count = 0;
+    for (IAILogShard* shard in [self shards]) {
+        count += [IAISnapshotOfShard(shard) count];
+    }
+    return count;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)firstObject {
+    IAILogEntry* firstEntry = nil;
+    for (IAILogShard* shard in [self shards]) {
+        IAILogEntry* entry = [IAISnapshotOfShard(shard) firstObject];
+        if (nil != entry
+            && (nil == firstEntry || IAITimeOfEntry(entry) < IAITimeOfEntry(firstEntry))) {
+            firstEntry = entry;
+        }
+    }
+    return firstEntry;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)lastObject {
+    IAILogEntry* lastEntry = nil;
+    for (IAILogShard* shard in [self shards]) {
+        IAILogEntry* entry = [IAISnapshotOfShard(shard) lastObject];
+        if (nil != entry
+            && (nil == lastEntry || IAITimeOfEntry(entry) >= IAITimeOfEntry(lastEntry))) {
+            lastEntry = entry;
+        }
+    }
+    return lastEntry;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSEnumerator *)objectEnumerator {
+    return [[IAIMergedLogEnumerator alloc] initWithRanges:[self shardSnapshots]];
+}
+
+
+@end
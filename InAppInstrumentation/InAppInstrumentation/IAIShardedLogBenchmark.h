@@ -0,0 +1,116 @@
+//
+//  IAIShardedLogBenchmark.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#ifdef DEBUG
+
+/**
+ * The measurements of one thread count in a sharded log benchmark.
+ *
+ *      @ingroup Overview-Logger
+ */
+@interface IAIShardedLogBenchmarkResult : NSObject {
+@private
+    NSUInteger _numberOfThreads;
+    NSUInteger _numberOfEntries;
+    uint64_t _duration;
+    double _speedup;
+}
+
+@property (nonatomic, readonly, assign) NSUInteger numberOfThreads;
+
+/**
+ * The entries added by all of the threads together.
+ */
+@property (nonatomic, readonly, assign) NSUInteger numberOfEntries;
+
+/**
+ * The nanoseconds from starting the threads until the last of them finished.
+ */
+@property (nonatomic, readonly, assign) uint64_t duration;
+
+@property (nonatomic, readonly, assign) double entriesPerSecond;
+
+/**
+ * The entries per second relative to those of a single thread. A log that scales linearly
+ * has a speedup equal to the number of threads, up to the number of cores.
+ */
+@property (nonatomic, readonly, assign) double speedup;
+
+/**
+ * A line of comma separated values: the number of threads and entries, the duration in
+ * milliseconds, the entries per second and the speedup.
+ */
+- (NSString *)reportLine;
+
+/**
+ * The names of the columns of reportLine.
+ */
++ (NSString *)reportHeader;
+
+@end
+
+
+/**
+ * Measures how the throughput of adding entries to an IAIShardedLog grows with the number of
+ * threads that add them.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * For each thread count, a new log is filled by that many threads at once. The entries of each
+ * thread are a millisecond apart in simulated time, and each thread prunes the entries more
+ * than a second older than the one it is about to add, as IAILogger does, rolling them up into
+ * an IAIMetricRollup. So the results include both the prunes that are skipped and the ones that
+ * merge the expired entries of every shard. The entries are created before the threads start,
+ * so the times measure the log rather than the allocator:
+ *
+ * @code
+ *  IAIShardedLogBenchmark* benchmark = [[IAIShardedLogBenchmark alloc] init];
+ *  NSLog(@"%@", [IAIShardedLogBenchmark reportOfResults:[benchmark run]]);
+ * @endcode
+ */
+@interface IAIShardedLogBenchmark : NSObject {
+@private
+    NSUInteger _maximumNumberOfThreads;
+    NSUInteger _numberOfEntriesPerThread;
+}
+
+#pragma mark Configuring a Benchmark /** @name Configuring a Benchmark */
+
+/**
+ * The benchmark runs with one thread, then doubles the number of threads up to this many.
+ *
+ * By default this is twice the number of active processors, so that the results show where
+ * the scaling stops.
+ */
+@property (nonatomic, readwrite, assign) NSUInteger maximumNumberOfThreads;
+
+/**
+ * By default this is 50000.
+ */
+@property (nonatomic, readwrite, assign) NSUInteger numberOfEntriesPerThread;
+
+
+#pragma mark Running a Benchmark /** @name Running a Benchmark */
+
+/**
+ * Fills a log with each number of threads in turn. Blocks the calling thread.
+ *
+ *      @returns An IAIShardedLogBenchmarkResult for each number of threads, fewest first.
+ */
+- (NSArray *)run;
+
+/**
+ * The report header followed by the report line of each result.
+ */
++ (NSString *)reportOfResults:(NSArray *)results;
+
+@end
+
+#endif
@@ -0,0 +1,256 @@
+//
+//  IAIShardedLogBenchmark.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAIShardedLogBenchmark.h"
+
+#ifdef DEBUG
+
+#import "IAILogger.h"
+#import "IAIMetricRollup.h"
+#import "IAIShardedLog.h"
+
+#import <mach/mach_time.h>
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+// Each thread logs a sample every millisecond of simulated time, and the log keeps a second.
+static const NSTimeInterval kEntryInterval = 0.001;
+static const NSTimeInterval kRetention = 1;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static uint64_t IAIBenchmarkNow(void) {
+    static mach_timebase_info_data_t sTimebase;
+    if (0 == sTimebase.denom) {
+        mach_timebase_info(&sTimebase);
+    }
+    return mach_absolute_time() * sTimebase.numer / sTimebase.denom;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @internal
+ *
+ * The threads of one run. The workers wait on the condition until the run starts, and count
+ * themselves off when they finish. Pruned entries are rolled up, as IAILogger does; only one
+ * thread prunes at a time, so the rollup needs no lock.
+ */
+@interface IAIShardedLogBenchmarkRun : NSObject {
+@public
+    IAIShardedLog* _log;
+    IAIMetricRollup* _rollup;
+    NSCondition* _condition;
+    BOOL _isStarted;
+    NSUInteger _numberOfRunningThreads;
+}
+@end
+
+@implementation IAIShardedLogBenchmarkRun
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)addEntries:(NSArray *)entries {
+    [_condition lock];
+    while (!_isStarted) {
+        [_condition wait];
+    }
+    [_condition unlock];
+
+    IAIMetricRollup* rollup = _rollup;
+    void (^rollUp)(IAILogEntry*) = ^(IAILogEntry* prunedEntry) {
+        [rollup addValue: ((IAIMetricLogEntry *)prunedEntry).value
+                  atTime: [prunedEntry.timestamp timeIntervalSinceReferenceDate]];
+    };
+    for (IAILogEntry* entry in entries) {
+        [_log removeEntriesBeforeDate: [entry.timestamp dateByAddingTimeInterval:-kRetention]
+                           usingBlock: rollUp];
+        [_log addEntry:entry];
+    }
+
+    [_condition lock];
+    --_numberOfRunningThreads;
+    [_condition broadcast];
+    [_condition unlock];
+}
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@interface IAIShardedLogBenchmarkResult()
+
+- (id)initWithNumberOfThreads: (NSUInteger)numberOfThreads
+              numberOfEntries: (NSUInteger)numberOfEntries
+                     duration: (uint64_t)duration;
+
+@property (nonatomic, readwrite, assign) double speedup;
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIShardedLogBenchmarkResult
+
+@synthesize numberOfThreads = _numberOfThreads;
+@synthesize numberOfEntries = _numberOfEntries;
+@synthesize duration = _duration;
+@synthesize speedup = _speedup;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (NSString *)reportHeader {
+    return @"threads,entries,durationMs,entriesPerSecond,speedup";
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithNumberOfThreads: (NSUInteger)numberOfThreads
+              numberOfEntries: (NSUInteger)numberOfEntries
+                     duration: (uint64_t)duration {
+    if ((self = [super init])) {
+        _numberOfThreads = numberOfThreads;
+        _numberOfEntries = numberOfEntries;
+        _duration = MAX(duration, 1);
+        _speedup = 1;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (double)entriesPerSecond {
+    return (double)_numberOfEntries * NSEC_PER_SEC / (double)_duration;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSString *)reportLine {
+    return [NSString stringWithFormat:@"%u,%u,%.1f,%.0f,%.2f",
+            (unsigned)_numberOfThreads, (unsigned)_numberOfEntries,
+            (double)_duration / NSEC_PER_MSEC, self.entriesPerSecond, _speedup];
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@interface IAIShardedLogBenchmark()
+
+- (IAIShardedLogBenchmarkResult *)runWithNumberOfThreads:(NSUInteger)numberOfThreads;
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIShardedLogBenchmark
+
+@synthesize maximumNumberOfThreads = _maximumNumberOfThreads;
+@synthesize numberOfEntriesPerThread = _numberOfEntriesPerThread;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (NSString *)reportOfResults:(NSArray *)results {
+    NSMutableString* report = [NSMutableString stringWithString:
+                               [IAIShardedLogBenchmarkResult reportHeader]];
+    for (IAIShardedLogBenchmarkResult* result in results) {
+        [report appendFormat:@"\n%@", [result reportLine]];
+    }
+    return report;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)init {
+    if ((self = [super init])) {
+        _maximumNumberOfThreads = MAX([[NSProcessInfo processInfo] activeProcessorCount] * 2, 2);
+        _numberOfEntriesPerThread = 50000;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (IAIShardedLogBenchmarkResult *)runWithNumberOfThreads:(NSUInteger)numberOfThreads {
+    IAIShardedLogBenchmarkRun* run = [[IAIShardedLogBenchmarkRun alloc] init];
+    run->_log = [[IAIShardedLog alloc] init];
+    run->_rollup = [[IAIMetricRollup alloc] initWithTiers:[[[IAILogger alloc] init] rollupTiers]];
+    run->_condition = [[NSCondition alloc] init];
+    run->_numberOfRunningThreads = numberOfThreads;
+
+    // Every thread's entries span the same simulated time, so that each prune finds expired
+    // entries in every shard.
+    NSDate* startDate = [NSDate date];
+    for (NSUInteger ix = 0; ix < numberOfThreads; ++ix) {
+        NSMutableArray* entries = [[NSMutableArray alloc]
+                                   initWithCapacity:_numberOfEntriesPerThread];
+        for (NSUInteger entryIndex = 0; entryIndex < _numberOfEntriesPerThread; ++entryIndex) {
+            IAIMetricLogEntry* entry = [[IAIMetricLogEntry alloc] initWithName: @"benchmark"
+                                                                         value: (double)entryIndex];
+            entry.timestamp = [startDate dateByAddingTimeInterval:entryIndex * kEntryInterval];
+            [entries addObject:entry];
+        }
+        [NSThread detachNewThreadSelector: @selector(addEntries:)
+                                 toTarget: run
+                               withObject: entries];
+    }
+
+    [run->_condition lock];
+    uint64_t startTime = IAIBenchmarkNow();
+    run->_isStarted = YES;
+    [run->_condition broadcast];
+    while (run->_numberOfRunningThreads > 0) {
+        [run->_condition wait];
+    }
+    uint64_t endTime = IAIBenchmarkNow();
+    [run->_condition unlock];
+
+    return [[IAIShardedLogBenchmarkResult alloc]
+            initWithNumberOfThreads: numberOfThreads
+                    numberOfEntries: numberOfThreads * _numberOfEntriesPerThread
+                           duration: endTime - startTime];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSArray *)run {
+    NSMutableArray* results = [[NSMutableArray alloc] init];
+    NSUInteger numberOfThreads = 1;
+    for (;;) {
+        @autoreleasepool {
+            [results addObject:[self runWithNumberOfThreads:numberOfThreads]];
+        }
+        if (numberOfThreads >= _maximumNumberOfThreads) {
+            break;
+        }
+        numberOfThreads = MIN(numberOfThreads * 2, _maximumNumberOfThreads);
+    }
+
+    double singleThreadRate = [[results objectAtIndex:0] entriesPerSecond];
+    for (IAIShardedLogBenchmarkResult* result in results) {
+        result.speedup = result.entriesPerSecond / singleThreadRate;
+    }
+    return results;
+}
+
+
+@end
+
+#endif
@@ -0,0 +1,61 @@
+//
+//  IAISharedMemoryExporter.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "IAILogger.h"
+
+/**
+ * Mirrors the logger's entries into rings in a memory mapped file.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * A profiler on the same machine, such as Tools/IAICollector/iai-ring-tail reading the file of
+ * an app in the simulator, maps the file read-only and reads the entries in place while the
+ * app runs. There is no serialization beyond writing each entry's frame into its ring, and no
+ * socket, thread or lock: exporting an entry is an atomic increment and a few stores on the
+ * thread that logged it.
+ *
+ * The region holds one ring each for device samples, console logs, events and metrics. The
+ * layout is described in IAISharedRing.h and each record is a frame in the format of
+ * IAITelemetryFrame.h. Each ring keeps its most recent records; older records are overwritten
+ * whether or not a reader has seen them, so the app never waits for a reader.
+ *
+ * Attach an exporter to a logger by adding it to IAILogger::exporters.
+ */
+@interface IAISharedMemoryExporter : NSObject <IAILogExporter> {
+@private
+    NSString* _path;
+    void* _region;
+    size_t _regionLength;
+}
+
+/**
+ * The path of the file in the app's temporary directory that is used by default.
+ */
++ (NSString *)defaultPath;
+
+/**
+ * Creates the region in a new file at the given path.
+ *
+ * A file that already exists at the path is unlinked first, so readers that still have the
+ * old file mapped are unaffected. Returns nil if the file could not be created and mapped.
+ */
+- (id)initWithPath:(NSString *)path;
+
+/**
+ * The path of the file that holds the region.
+ */
+@property (nonatomic, readonly, copy) NSString* path;
+
+/**
+ * The size of the region in bytes.
+ */
+@property (nonatomic, readonly, assign) size_t regionLength;
+
+@end
@@ -0,0 +1,173 @@
+//
+//  IAISharedMemoryExporter.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAISharedMemoryExporter.h"
+
+#import "IAIOverhead.h"
+#import "IAISharedRing.h"
+#import "IAITelemetryExporter.h"
+#import "IAITelemetryFrame.h"
+
+#import <fcntl.h>
+#import <sys/mman.h>
+#import <unistd.h>
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+typedef enum {
+    IAISharedRingDeviceLogs,
+    IAISharedRingConsoleLogs,
+    IAISharedRingEventLogs,
+    IAISharedRingMetricLogs,
+    IAISharedRingCount,
+} IAISharedRingIndex;
+
+// The frame sizes fit the largest frame of each type; longer console logs and metric names
+// are truncated. About 2.7 MB in all.
+static const IAISharedRingConfig kRingConfigs[IAISharedRingCount] = {
+    { IAITelemetryFrameDeviceSample, 64, 1024 },
+    { IAITelemetryFrameConsoleLog, IAITelemetryMaxFrameLength, 4096 },
+    { IAITelemetryFrameEvent, 32, 256 },
+    { IAITelemetryFrameMetric, 256, 2048 },
+};
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAISharedMemoryExporter
+
+@synthesize path = _path;
+@synthesize regionLength = _regionLength;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)dealloc {
+    if (NULL != _region) {
+        munmap(_region, _regionLength);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (NSString *)defaultPath {
+    return [NSTemporaryDirectory() stringByAppendingPathComponent:@"overview.iais"];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithPath:(NSString *)path {
+    if ((self = [super init])) {
+        _path = [path copy];
+        _regionLength = IAISharedRegionLength(kRingConfigs, IAISharedRingCount);
+
+        const char* fileSystemPath = [_path fileSystemRepresentation];
+        unlink(fileSystemPath);
+        int fd = open(fileSystemPath, O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd < 0) {
+            return nil;
+        }
+        if (ftruncate(fd, (off_t)_regionLength) != 0) {
+            close(fd);
+            return nil;
+        }
+        void* region = mmap(NULL, _regionLength, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (MAP_FAILED == region) {
+            return nil;
+        }
+        _region = region;
+
+        // A new file is zeroed, which is what IAISharedRegionInit expects.
+        IAISharedRegionInit(_region, kRingConfigs, IAISharedRingCount, (uint32_t)getpid(),
+                            (int64_t)([[NSDate date] timeIntervalSince1970] * 1000000.0));
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)init {
+    return [self initWithPath:[[self class] defaultPath]];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark IAILogExporter
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)exportDeviceLog:(IAIDeviceLogEntry *)logEntry {
+    uint64_t sequence;
+    IAISharedRingIndex ring = IAISharedRingDeviceLogs;
+    uint8_t* bytes = IAISharedRingBeginWrite(_region, ring, &sequence);
+    if (NULL == bytes) {
+        IAIOverheadCountDroppedRecords(1);
+        return;
+    }
+    size_t length = IAITelemetryEncodeDeviceLog(logEntry, bytes, kRingConfigs[ring].maxFrameLength);
+    if (!IAISharedRingEndWrite(_region, ring, sequence, length)) {
+        IAIOverheadCountDroppedRecords(1);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)exportConsoleLog:(IAIConsoleLogEntry *)logEntry {
+    uint64_t sequence;
+    IAISharedRingIndex ring = IAISharedRingConsoleLogs;
+    uint8_t* bytes = IAISharedRingBeginWrite(_region, ring, &sequence);
+    if (NULL == bytes) {
+        IAIOverheadCountDroppedRecords(1);
+        return;
+    }
+    size_t length = IAITelemetryEncodeConsoleLog(logEntry, bytes,
+                                                 kRingConfigs[ring].maxFrameLength);
+    if (!IAISharedRingEndWrite(_region, ring, sequence, length)) {
+        IAIOverheadCountDroppedRecords(1);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)exportEventLog:(IAIEventLogEntry *)logEntry {
+    uint64_t sequence;
+    IAISharedRingIndex ring = IAISharedRingEventLogs;
+    uint8_t* bytes = IAISharedRingBeginWrite(_region, ring, &sequence);
+    if (NULL == bytes) {
+        IAIOverheadCountDroppedRecords(1);
+        return;
+    }
+    size_t length = IAITelemetryEncodeEventLog(logEntry, bytes, kRingConfigs[ring].maxFrameLength);
+    if (!IAISharedRingEndWrite(_region, ring, sequence, length)) {
+        IAIOverheadCountDroppedRecords(1);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)exportMetricLog:(IAIMetricLogEntry *)logEntry {
+    uint64_t sequence;
+    IAISharedRingIndex ring = IAISharedRingMetricLogs;
+    uint8_t* bytes = IAISharedRingBeginWrite(_region, ring, &sequence);
+    if (NULL == bytes) {
+        IAIOverheadCountDroppedRecords(1);
+        return;
+    }
+    size_t length = IAITelemetryEncodeMetricLog(logEntry, bytes, kRingConfigs[ring].maxFrameLength);
+    if (!IAISharedRingEndWrite(_region, ring, sequence, length)) {
+        IAIOverheadCountDroppedRecords(1);
+    }
+}
+
+
+@end
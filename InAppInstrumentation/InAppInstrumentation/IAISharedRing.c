@@ -0,0 +1,193 @@
+//
+//  IAISharedRing.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#include "IAISharedRing.h"
+
+#include <string.h>
+
+#if defined(__APPLE__)
+#include <libkern/OSAtomic.h>
+#else
+// Readers of the region also build on Linux.
+#define OSMemoryBarrier() __sync_synchronize()
+#define OSAtomicIncrement64Barrier(value) __sync_add_and_fetch((value), 1)
+#define OSAtomicCompareAndSwap32Barrier(oldValue, newValue, value) \
+    __sync_bool_compare_and_swap((value), (oldValue), (newValue))
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static uint32_t IAISharedRingRoundedSlotCount(uint32_t slotCount) {
+    uint32_t rounded = 1;
+    while (rounded < slotCount) {
+        rounded *= 2;
+    }
+    return rounded;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static uint32_t IAISharedRingSlotLength(uint32_t maxFrameLength) {
+    // Keep every slot aligned for its sequence.
+    return (IAISharedRingSlotHeaderLength + maxFrameLength + 7) & ~7u;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static uint8_t* IAISharedRingSlot(const void* region, const IAISharedRingHeader* ring,
+                                  uint64_t sequence) {
+    uint64_t slotIndex = sequence & (ring->slotCount - 1);
+    return (uint8_t *)region + ring->offset + slotIndex * ring->slotLength;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Writing
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+size_t IAISharedRegionLength(const IAISharedRingConfig* configs, unsigned ringCount) {
+    size_t length = IAISharedRegionHeaderLength;
+    for (unsigned ix = 0; ix < ringCount && ix < IAISharedRegionMaxRings; ++ix) {
+        length += ((size_t)IAISharedRingSlotLength(configs[ix].maxFrameLength)
+                   * IAISharedRingRoundedSlotCount(configs[ix].slotCount));
+    }
+    return length;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAISharedRegionInit(void* region, const IAISharedRingConfig* configs, unsigned ringCount,
+                         uint32_t processId, int64_t creationTime) {
+    IAISharedRegionHeader* header = region;
+    if (ringCount > IAISharedRegionMaxRings) {
+        ringCount = IAISharedRegionMaxRings;
+    }
+
+    header->version = IAISharedRegionVersion;
+    header->ringCount = (uint16_t)ringCount;
+    header->regionLength = IAISharedRegionLength(configs, ringCount);
+    header->creationTime = creationTime;
+    header->processId = processId;
+
+    uint64_t offset = IAISharedRegionHeaderLength;
+    for (unsigned ix = 0; ix < ringCount; ++ix) {
+        IAISharedRingHeader* ring = &header->rings[ix];
+        ring->frameType = configs[ix].frameType;
+        ring->slotLength = IAISharedRingSlotLength(configs[ix].maxFrameLength);
+        ring->slotCount = IAISharedRingRoundedSlotCount(configs[ix].slotCount);
+        ring->offset = offset;
+        ring->head = 0;
+        offset += (uint64_t)ring->slotLength * ring->slotCount;
+    }
+
+    OSMemoryBarrier();
+    header->magic = IAISharedRegionMagic;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+uint8_t* IAISharedRingBeginWrite(void* region, unsigned ringIndex, uint64_t* sequence) {
+    IAISharedRingHeader* ring = &((IAISharedRegionHeader *)region)->rings[ringIndex];
+    uint64_t claimed = (uint64_t)OSAtomicIncrement64Barrier((volatile int64_t *)&ring->head) - 1;
+
+    uint8_t* slot = IAISharedRingSlot(region, ring, claimed);
+    uint32_t mark = (uint32_t)(2 * claimed + 1);
+
+    // A writer that a full lap has passed may still be writing an older record into the slot,
+    // and writing this one alongside it would tear both. A later record means that this writer
+    // was itself lapped before it got to the slot.
+    for (;;) {
+        uint32_t current = *(volatile uint32_t *)slot;
+        if (0 != (current & 1) || (int32_t)(current - mark) > 0) {
+            return NULL;
+        }
+        if (OSAtomicCompareAndSwap32Barrier((int32_t)current, (int32_t)mark,
+                                            (volatile int32_t *)slot)) {
+            break;
+        }
+    }
+
+    *sequence = claimed;
+    return slot + IAISharedRingSlotHeaderLength;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAISharedRingEndWrite(void* region, unsigned ringIndex, uint64_t sequence, size_t length) {
+    IAISharedRingHeader* ring = &((IAISharedRegionHeader *)region)->rings[ringIndex];
+    uint8_t* slot = IAISharedRingSlot(region, ring, sequence);
+    uint32_t mark = (uint32_t)(2 * sequence + 1);
+    if (*(volatile uint32_t *)slot != mark) {
+        return 0;
+    }
+    ((uint32_t *)slot)[1] = (uint32_t)length;
+
+    // Only publishes if the slot is still marked as this record's.
+    OSMemoryBarrier();
+    return OSAtomicCompareAndSwap32Barrier((int32_t)mark, (int32_t)(mark + 1),
+                                           (volatile int32_t *)slot) ? 1 : 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Reading
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAISharedRegionIsValid(const void* region, size_t length) {
+    const IAISharedRegionHeader* header = region;
+    if (length < IAISharedRegionHeaderLength
+        || IAISharedRegionMagic != header->magic
+        || IAISharedRegionVersion != header->version
+        || header->ringCount > IAISharedRegionMaxRings
+        || header->regionLength > length) {
+        return 0;
+    }
+    for (unsigned ix = 0; ix < header->ringCount; ++ix) {
+        const IAISharedRingHeader* ring = &header->rings[ix];
+        if (0 == ring->slotCount || (ring->slotCount & (ring->slotCount - 1)) != 0
+            || ring->slotLength <= IAISharedRingSlotHeaderLength
+            || ring->offset + (uint64_t)ring->slotLength * ring->slotCount > length) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+const uint8_t* IAISharedRingRecord(const void* region, unsigned ringIndex, uint64_t sequence,
+                                   size_t* length) {
+    const IAISharedRingHeader* ring = &((const IAISharedRegionHeader *)region)->rings[ringIndex];
+    const uint8_t* slot = IAISharedRingSlot(region, ring, sequence);
+    if (*(const volatile uint32_t *)slot != (uint32_t)(2 * sequence + 2)) {
+        return NULL;
+    }
+    OSMemoryBarrier();
+
+    uint32_t frameLength = ((const uint32_t *)slot)[1];
+    if (frameLength > ring->slotLength - IAISharedRingSlotHeaderLength) {
+        return NULL;
+    }
+    *length = frameLength;
+    return slot + IAISharedRingSlotHeaderLength;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAISharedRingRecordIsIntact(const void* region, unsigned ringIndex, uint64_t sequence) {
+    const IAISharedRingHeader* ring = &((const IAISharedRegionHeader *)region)->rings[ringIndex];
+    const uint8_t* slot = IAISharedRingSlot(region, ring, sequence);
+    OSMemoryBarrier();
+    return *(const volatile uint32_t *)slot == (uint32_t)(2 * sequence + 2);
+}
@@ -0,0 +1,140 @@
+//
+//  IAISharedRing.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#ifndef InAppInstrumentation_IAISharedRing_h
+#define InAppInstrumentation_IAISharedRing_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The layout of a shared memory region of telemetry rings.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * The app writes its records into a memory mapped file, and another process on the same
+ * machine maps the file read-only and reads the records in place. Integers in the headers are
+ * in the native byte order of the machine. Each record is a frame in the format described in
+ * IAITelemetryFrame.h.
+ *
+ * @code
+ *  offset 0      IAISharedRegionHeader, padded to IAISharedRegionHeaderLength bytes
+ *  rings[i].offset
+ *                rings[i].slotCount slots of rings[i].slotLength bytes:
+ *                  uint32  sequence    2 * n + 1 while record n is written, 2 * n + 2 after.
+ *                  uint32  length      The length of the frame. 0 if the slot holds no frame.
+ *                  ...     frame
+ * @endcode
+ *
+ * A ring's head is the number of records that have been claimed in it. Record n lives in slot
+ * n % slotCount, so a ring keeps the last slotCount records. Any thread may write to any ring:
+ * a writer claims a record by incrementing the head, marks the slot as being written, writes
+ * the frame and then marks the slot as written.
+ *
+ * Only one writer is ever in a slot. A writer only marks a slot that holds a written record of
+ * an earlier lap. If the slot is still being written by a writer that a full lap of others has
+ * passed, or a later record has already taken it, the writer gives up its record, which readers
+ * see as a record that is never finished.
+ *
+ * Readers never write to the region. To read record n a reader checks that the slot's sequence
+ * is 2 * n + 2, reads the frame, and checks the sequence again. If the sequence changed, the
+ * record was overwritten while it was being read. A reader that falls more than slotCount
+ * records behind the head has lost the records in between.
+ *
+ * The magic number is written last, once the headers are complete. The version changes
+ * whenever the layout changes in a way that old readers can't skip.
+ */
+
+#define IAISharedRegionMagic         0x53494149u  // "IAIS"
+#define IAISharedRegionVersion       1
+#define IAISharedRegionMaxRings      8
+#define IAISharedRegionHeaderLength  4096
+#define IAISharedRingSlotHeaderLength 8
+
+typedef struct {
+    uint32_t frameType;         // The IAITelemetryFrameType of the records.
+    uint32_t slotLength;        // Including the slot header.
+    uint32_t slotCount;         // A power of two.
+    uint32_t reserved;
+    uint64_t offset;            // From the start of the region.
+    volatile uint64_t head;
+} IAISharedRingHeader;
+
+typedef struct {
+    volatile uint32_t magic;
+    uint16_t version;
+    uint16_t ringCount;
+    uint64_t regionLength;
+    int64_t creationTime;       // Microseconds since 1970.
+    uint32_t processId;
+    uint32_t reserved;
+    IAISharedRingHeader rings[IAISharedRegionMaxRings];
+} IAISharedRegionHeader;
+
+typedef struct {
+    uint32_t frameType;
+    uint32_t maxFrameLength;
+    uint32_t slotCount;
+} IAISharedRingConfig;
+
+
+#pragma mark Writing /** @name Writing */
+
+/**
+ * The number of bytes needed for a region with the given rings.
+ */
+size_t IAISharedRegionLength(const IAISharedRingConfig* configs, unsigned ringCount);
+
+/**
+ * Lays out a zeroed region of IAISharedRegionLength bytes and publishes its header.
+ *
+ * Slot counts are rounded up to a power of two.
+ */
+void IAISharedRegionInit(void* region, const IAISharedRingConfig* configs, unsigned ringCount,
+                         uint32_t processId, int64_t creationTime);
+
+/**
+ * Claims the next record of a ring.
+ *
+ *      @returns The buffer for the frame, which is maxFrameLength bytes long. Pass the
+ *               sequence to IAISharedRingEndWrite once the frame has been written. NULL if the
+ *               record had to be given up because its slot was taken by another writer.
+ */
+uint8_t* IAISharedRingBeginWrite(void* region, unsigned ringIndex, uint64_t* sequence);
+
+/**
+ * Publishes a record.
+ *
+ *      @returns 0 if the slot no longer belongs to the record, in which case it is given up.
+ */
+int IAISharedRingEndWrite(void* region, unsigned ringIndex, uint64_t sequence, size_t length);
+
+
+#pragma mark Reading /** @name Reading */
+
+/**
+ * Checks that the bytes are a complete region of a version this code can read.
+ */
+int IAISharedRegionIsValid(const void* region, size_t length);
+
+/**
+ * The frame of record n of a ring, read in place.
+ *
+ *      @returns NULL if the record has not been written yet or has already been overwritten.
+ *               Otherwise the frame must be checked with IAISharedRingRecordIsIntact once it
+ *               has been read.
+ */
+const uint8_t* IAISharedRingRecord(const void* region, unsigned ringIndex, uint64_t sequence,
+                                   size_t* length);
+
+/**
+ * Whether record n was still in its slot after it was read.
+ */
+int IAISharedRingRecordIsIntact(const void* region, unsigned ringIndex, uint64_t sequence);
+
+#endif
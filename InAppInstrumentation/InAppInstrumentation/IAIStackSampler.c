@@ -0,0 +1,290 @@
+//
+//  IAIStackSampler.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#if !defined(__APPLE__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "IAIStackSampler.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <errno.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+#endif
+
+// How long a capture waits for the signal handler of the thread.
+#define IAIStackSamplerTimeoutNanoseconds 100000000L
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Follows the frame pointers from the given registers. Every frame holds the caller's frame
+// pointer followed by the return address.
+static unsigned IAIStackSamplerWalk(uintptr_t pc, uintptr_t fp,
+                                    uintptr_t stackLow, uintptr_t stackHigh,
+                                    uintptr_t* frames, unsigned maxDepth) {
+    unsigned depth = 0;
+    if (depth < maxDepth) {
+        frames[depth++] = pc;
+    }
+    while (depth < maxDepth && fp >= stackLow && fp <= stackHigh - 2 * sizeof(uintptr_t)
+           && 0 == fp % sizeof(uintptr_t)) {
+        const uintptr_t* frame = (const uintptr_t *)fp;
+        uintptr_t nextFP = frame[0];
+        uintptr_t returnAddress = frame[1];
+        if (0 == returnAddress) {
+            break;
+        }
+        frames[depth++] = returnAddress - 1;
+
+        // The stack grows down, so the caller's frame is always above this one.
+        if (nextFP <= fp) {
+            break;
+        }
+        fp = nextFP;
+    }
+    return depth;
+}
+
+
+#if defined(__APPLE__)
+
+struct IAIStackSampler {
+    thread_t thread;
+    uintptr_t stackLow;
+    uintptr_t stackHigh;
+};
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+IAIStackSampler* IAIStackSamplerCreateForCurrentThread(void) {
+    IAIStackSampler* sampler = calloc(1, sizeof(IAIStackSampler));
+    if (NULL == sampler) {
+        return NULL;
+    }
+    pthread_t thread = pthread_self();
+    sampler->thread = mach_thread_self();
+    sampler->stackHigh = (uintptr_t)pthread_get_stackaddr_np(thread);
+    sampler->stackLow = sampler->stackHigh - pthread_get_stacksize_np(thread);
+    return sampler;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIStackSamplerDestroy(IAIStackSampler* sampler) {
+    if (NULL != sampler) {
+        mach_port_deallocate(mach_task_self(), sampler->thread);
+        free(sampler);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned IAIStackSamplerCapture(IAIStackSampler* sampler, uintptr_t* frames, unsigned maxDepth) {
+    if (KERN_SUCCESS != thread_suspend(sampler->thread)) {
+        return 0;
+    }
+
+    uintptr_t pc = 0;
+    uintptr_t fp = 0;
+    kern_return_t result;
+#if defined(__arm64__)
+    arm_thread_state64_t state;
+    mach_msg_type_number_t count = ARM_THREAD_STATE64_COUNT;
+    result = thread_get_state(sampler->thread, ARM_THREAD_STATE64, (thread_state_t)&state, &count);
+    pc = (uintptr_t)state.__pc;
+    fp = (uintptr_t)state.__fp;
+#elif defined(__arm__)
+    arm_thread_state_t state;
+    mach_msg_type_number_t count = ARM_THREAD_STATE_COUNT;
+    result = thread_get_state(sampler->thread, ARM_THREAD_STATE, (thread_state_t)&state, &count);
+    pc = state.__pc;
+    fp = state.__r[7];
+#elif defined(__x86_64__)
+    x86_thread_state64_t state;
+    mach_msg_type_number_t count = x86_THREAD_STATE64_COUNT;
+    result = thread_get_state(sampler->thread, x86_THREAD_STATE64, (thread_state_t)&state,
+                              &count);
+    pc = (uintptr_t)state.__rip;
+    fp = (uintptr_t)state.__rbp;
+#elif defined(__i386__)
+    x86_thread_state32_t state;
+    mach_msg_type_number_t count = x86_THREAD_STATE32_COUNT;
+    result = thread_get_state(sampler->thread, x86_THREAD_STATE32, (thread_state_t)&state,
+                              &count);
+    pc = state.__eip;
+    fp = state.__ebp;
+#else
+#error "IAIStackSampler doesn't know the registers of this architecture."
+#endif
+
+    unsigned depth = 0;
+    if (KERN_SUCCESS == result) {
+        depth = IAIStackSamplerWalk(pc, fp, sampler->stackLow, sampler->stackHigh,
+                                    frames, maxDepth);
+    }
+    thread_resume(sampler->thread);
+    return depth;
+}
+
+
+#else
+
+#define IAIStackSamplerBufferDepth 256
+
+struct IAIStackSampler {
+    pthread_t thread;
+    uintptr_t stackLow;
+    uintptr_t stackHigh;
+    sem_t captured;
+
+    // Written by the signal handler for the capture whose request it saw.
+    volatile unsigned request;
+    volatile unsigned answeredRequest;
+    unsigned depth;
+    uintptr_t frames[IAIStackSamplerBufferDepth];
+};
+
+static pthread_once_t sHandlerOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t sCaptureLock = PTHREAD_MUTEX_INITIALIZER;
+static IAIStackSampler* volatile sCapturingSampler = NULL;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAIStackSamplerHandleSignal(int signal, siginfo_t* info, void* context) {
+    (void)signal;
+    (void)info;
+    int savedErrno = errno;
+    IAIStackSampler* sampler = sCapturingSampler;
+    if (NULL != sampler && pthread_equal(sampler->thread, pthread_self())) {
+        const ucontext_t* ucontext = context;
+        uintptr_t pc = 0;
+        uintptr_t fp = 0;
+#if defined(__x86_64__)
+        pc = (uintptr_t)ucontext->uc_mcontext.gregs[REG_RIP];
+        fp = (uintptr_t)ucontext->uc_mcontext.gregs[REG_RBP];
+#elif defined(__aarch64__)
+        pc = (uintptr_t)ucontext->uc_mcontext.pc;
+        fp = (uintptr_t)ucontext->uc_mcontext.regs[29];
+#elif defined(__i386__)
+        pc = (uintptr_t)ucontext->uc_mcontext.gregs[REG_EIP];
+        fp = (uintptr_t)ucontext->uc_mcontext.gregs[REG_EBP];
+#else
+#error "IAIStackSampler doesn't know the registers of this architecture."
+#endif
+        unsigned request = sampler->request;
+        sampler->depth = IAIStackSamplerWalk(pc, fp, sampler->stackLow, sampler->stackHigh,
+                                             sampler->frames, IAIStackSamplerBufferDepth);
+        __sync_synchronize();
+        sampler->answeredRequest = request;
+        sem_post(&sampler->captured);
+    }
+    errno = savedErrno;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAIStackSamplerInstallHandler(void) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = IAIStackSamplerHandleSignal;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, NULL);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+IAIStackSampler* IAIStackSamplerCreateForCurrentThread(void) {
+    pthread_attr_t attributes;
+    void* stackAddress = NULL;
+    size_t stackSize = 0;
+    if (0 != pthread_getattr_np(pthread_self(), &attributes)) {
+        return NULL;
+    }
+    int result = pthread_attr_getstack(&attributes, &stackAddress, &stackSize);
+    pthread_attr_destroy(&attributes);
+    if (0 != result) {
+        return NULL;
+    }
+
+    IAIStackSampler* sampler = calloc(1, sizeof(IAIStackSampler));
+    if (NULL == sampler) {
+        return NULL;
+    }
+    if (0 != sem_init(&sampler->captured, 0, 0)) {
+        free(sampler);
+        return NULL;
+    }
+    sampler->thread = pthread_self();
+    sampler->stackLow = (uintptr_t)stackAddress;
+    sampler->stackHigh = (uintptr_t)stackAddress + stackSize;
+    pthread_once(&sHandlerOnce, IAIStackSamplerInstallHandler);
+    return sampler;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAIStackSamplerDestroy(IAIStackSampler* sampler) {
+    if (NULL != sampler) {
+        sem_destroy(&sampler->captured);
+        free(sampler);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned IAIStackSamplerCapture(IAIStackSampler* sampler, uintptr_t* frames, unsigned maxDepth) {
+    unsigned depth = 0;
+    pthread_mutex_lock(&sCaptureLock);
+
+    // A handler that ran after an earlier capture gave up may have left a post behind.
+    while (0 == sem_trywait(&sampler->captured)) {
+    }
+    unsigned request = ++sampler->request;
+    sCapturingSampler = sampler;
+    __sync_synchronize();
+
+    if (0 == pthread_kill(sampler->thread, SIGPROF)) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += IAIStackSamplerTimeoutNanoseconds;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        for (;;) {
+            if (0 != sem_timedwait(&sampler->captured, &deadline)) {
+                if (EINTR == errno) {
+                    continue;
+                }
+                break;
+            }
+            __sync_synchronize();
+            if (sampler->answeredRequest == request) {
+                depth = (sampler->depth < maxDepth) ? sampler->depth : maxDepth;
+                memcpy(frames, sampler->frames, depth * sizeof(uintptr_t));
+                break;
+            }
+        }
+    }
+
+    sCapturingSampler = NULL;
+    pthread_mutex_unlock(&sCaptureLock);
+    return depth;
+}
+
+#endif
@@ -0,0 +1,54 @@
+//
+//  IAIStackSampler.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#ifndef InAppInstrumentation_IAIStackSampler_h
+#define InAppInstrumentation_IAIStackSampler_h
+
+#include <stdint.h>
+
+/**
+ * Captures the stack of one thread from another thread.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * The stack is walked through the chain of frame pointers, so it only reaches through code
+ * that keeps frame pointers. Apple's ABIs require them; elsewhere code must be built with
+ * -fno-omit-frame-pointer. A leaf function that keeps no frame of its own hides its caller,
+ * because the frame pointer still points to the caller's frame. Every frame pointer is checked
+ * against the bounds of the thread's stack before it is read, so a broken chain ends the walk
+ * instead of crashing it.
+ *
+ * On Apple platforms the sampler suspends the thread, reads its registers with
+ * thread_get_state(), walks its stack and resumes it. Nothing that may take a lock is called
+ * while the thread is suspended, because the thread may hold the lock.
+ *
+ * Elsewhere the sampler sends SIGPROF to the thread, whose handler walks its own stack and
+ * wakes the sampler. The handler is installed by the first sampler that is created, and
+ * replaces any other handler of SIGPROF. Only one capture runs at a time.
+ */
+
+typedef struct IAIStackSampler IAIStackSampler;
+
+/**
+ * A sampler of the calling thread. Returns NULL if the thread's stack can't be found.
+ */
+IAIStackSampler* IAIStackSamplerCreateForCurrentThread(void);
+
+void IAIStackSamplerDestroy(IAIStackSampler* sampler);
+
+/**
+ * Captures the stack of the sampler's thread. Must not be called from that thread.
+ *
+ * The first frame is the program counter. The others are return addresses minus one, so that
+ * they fall within the instruction that made the call.
+ *
+ *      @returns The number of frames written, leaf first. 0 if the stack couldn't be captured.
+ */
+unsigned IAIStackSamplerCapture(IAIStackSampler* sampler, uintptr_t* frames, unsigned maxDepth);
+
+#endif
@@ -0,0 +1,206 @@
+//
+//  IAIStorageMonitor.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "IAIFileWatcher.h"
+
+@class IAILogger;
+
+// The bytes used by each root directory are added to the logger as the metric with this prefix
+// and the name of the root, e.g. "storageBytes.Library/Caches".
+extern NSString* const IAIMetricStorageBytesPrefix;
+
+/**
+ * The storage used by one of the monitored directories and everything below it.
+ *
+ *      @ingroup Overview-Logger
+ */
+@interface IAIStorageRootSummary : NSObject {
+@private
+    NSString* _name;
+    NSString* _path;
+    unsigned long long _numberOfBytes;
+    unsigned long long _numberOfFiles;
+}
+
+/**
+ * The path of the directory relative to the app's home directory, or its full path if it is
+ * elsewhere.
+ */
+@property (nonatomic, readonly, copy) NSString* name;
+
+@property (nonatomic, readonly, copy) NSString* path;
+
+/**
+ * The bytes of storage allocated to the files, which may be more than their lengths.
+ */
+@property (nonatomic, readonly, assign) unsigned long long numberOfBytes;
+
+@property (nonatomic, readonly, assign) unsigned long long numberOfFiles;
+
+@end
+
+
+/**
+ * A file that grew since the monitor first saw it change.
+ *
+ *      @ingroup Overview-Logger
+ */
+@interface IAIStorageFileSummary : NSObject {
+@private
+    NSString* _path;
+    unsigned long long _numberOfBytes;
+    long long _growth;
+    double _growthPerSecond;
+}
+
+@property (nonatomic, readonly, copy) NSString* path;
+@property (nonatomic, readonly, assign) unsigned long long numberOfBytes;
+
+/**
+ * The bytes that the file grew by since the scan before its first change. Files that were
+ * created after the first scan grew from nothing.
+ */
+@property (nonatomic, readonly, assign) long long growth;
+
+@property (nonatomic, readonly, assign) double growthPerSecond;
+
+@end
+
+
+/**
+ * Measures the storage used by the app's sandbox directories and finds the files that grow.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * The free space of the volume says little about the app's own caches and databases. The
+ * monitor keeps the size of every file below a few root directories, by default Documents,
+ * Library/Caches and tmp, and adds the bytes used by each root to the logger once per
+ * heartbeat as a metric named with IAIMetricStorageBytesPrefix.
+ *
+ * Nothing is scanned on the main thread. Each update hands a step of work to a serial
+ * background queue, and the results of the step are published back to the main thread for the
+ * next update. A step lists again only the directories that changed, as reported by an
+ * IAIFileWatcher, and lists at most maximumNumberOfEntriesPerUpdate entries, so a large tree
+ * is taken in over several heartbeats. The first scan lists everything. Every rescanInterval
+ * seconds a rescan starts, which lists the directories that aren't watched, since at most
+ * maximumNumberOfWatchedDirectories are, with the entries that each step has left after the
+ * reported changes. Where the watch of a directory misses the files that grow in place, as on
+ * iOS (see IAIFileWatcher.h), the rescan lists the watched directories too, and the files that
+ * were last seen to change are watched on their own, at most maximumNumberOfWatchedFiles of
+ * them, so that their directory is listed again as soon as they grow.
+ *
+ * Symbolic links are neither followed nor counted.
+ */
+@interface IAIStorageMonitor : NSObject {
+@private
+    __weak IAILogger* _logger;
+
+    NSArray* _rootPaths;
+    NSTimeInterval _rescanInterval;
+    NSUInteger _maximumNumberOfEntriesPerUpdate;
+    NSUInteger _maximumNumberOfWatchedDirectories;
+    NSUInteger _maximumNumberOfWatchedFiles;
+    dispatch_queue_t _scanQueue;
+    BOOL _isScanning;
+    NSArray* _rootSummaries;
+    NSArray* _fileSummaries;
+
+    // Only touched on _scanQueue.
+    IAIFileWatcher* _watcher;
+    NSMutableDictionary* _directories;
+    NSMutableDictionary* _directoriesByWatch;
+    NSMutableArray* _changedPaths;
+    NSUInteger _changedPathIndex;
+    NSMutableSet* _changedPathSet;
+    NSMutableDictionary* _grownFiles;
+    NSMutableDictionary* _grownFilesByWatch;
+    NSUInteger _numberOfWatchedDirectories;
+    NSTimeInterval _lastRescanTime;
+    NSArray* _rescanPaths;
+    NSUInteger _rescanPathIndex;
+    NSTimeInterval _rescanStartTime;
+    BOOL _rescansWatchedDirectories;
+    unsigned long long* _rootBytes;
+    unsigned long long* _rootFiles;
+}
+
+#pragma mark Creating a Monitor /** @name Creating a Monitor */
+
+/**
+ * Designated initializer.
+ *
+ * The roots must not contain each other. The logger is not retained.
+ */
+- (id)initWithLogger:(IAILogger *)logger rootPaths:(NSArray *)rootPaths;
+
+/**
+ * Monitors Documents, Library/Caches and tmp in the app's home directory.
+ */
+- (id)initWithLogger:(IAILogger *)logger;
+
+@property (nonatomic, readonly, copy) NSArray* rootPaths;
+
+
+#pragma mark Scanning /** @name Scanning */
+
+/**
+ * The number of seconds between rescans of every directory.
+ *
+ * By default this is 60 seconds.
+ */
+@property (nonatomic, readwrite, assign) NSTimeInterval rescanInterval;
+
+/**
+ * The most directory entries that are listed in one update.
+ *
+ * By default this is 1000.
+ */
+@property (nonatomic, readwrite, assign) NSUInteger maximumNumberOfEntriesPerUpdate;
+
+/**
+ * The most directories that are watched for changes. Directories are watched in the order in
+ * which they are found, so the roots and the directories nearest to them come first.
+ *
+ * By default this is 256.
+ */
+@property (nonatomic, readwrite, assign) NSUInteger maximumNumberOfWatchedDirectories;
+
+/**
+ * The most files that are watched for growing in place, where the watch of their directory
+ * misses it (see IAIFileWatcherReportsFileWrites). Once this many are watched, the file that
+ * changed the longest ago stops being watched when another changes.
+ *
+ * By default this is 16.
+ */
+@property (nonatomic, readwrite, assign) NSUInteger maximumNumberOfWatchedFiles;
+
+/**
+ * Adds the usage of the last step to the logger and starts the next step, unless the last
+ * one is still running.
+ *
+ * Call this from the main thread once per heartbeat.
+ */
+- (void)update;
+
+
+#pragma mark Reading Usage /** @name Reading Usage */
+
+/**
+ * The summaries of the roots as of the last finished step, in the order of rootPaths.
+ */
+@property (nonatomic, readonly, copy) NSArray* rootSummaries;
+
+/**
+ * The files that grew the fastest as of the last finished step, the fastest first. At most
+ * 20 files are listed.
+ */
+@property (nonatomic, readonly, copy) NSArray* fileSummaries;
+
+@end
@@ -0,0 +1,730 @@
+//
+//  IAIStorageMonitor.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAIStorageMonitor.h"
+
+#import "IAILogger.h"
+#import "IAIOverhead.h"
+
+#import <dirent.h>
+#import <fcntl.h>
+#import <sys/stat.h>
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+NSString* const IAIMetricStorageBytesPrefix = @"storageBytes.";
+
+static const NSUInteger kMaximumNumberOfFileSummaries = 20;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// A directory below one of the roots, as of its last listing.
+@interface IAIStorageDirectory : NSObject {
+@public
+    NSString* _path;
+    NSUInteger _rootIndex;
+    int _watch;
+    NSMutableDictionary* _fileBytes;        // Name to NSNumber.
+    NSMutableSet* _subdirectoryNames;
+    unsigned long long _numberOfBytes;
+    NSTimeInterval _lastScanTime;           // 0 until the directory is first listed.
+}
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIStorageDirectory
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// A file that changed, with its size at the listing before its first change.
+@interface IAIStorageGrowth : NSObject {
+@public
+    NSString* _directoryPath;
+    unsigned long long _firstNumberOfBytes;
+    NSTimeInterval _firstTime;
+    unsigned long long _numberOfBytes;
+    NSTimeInterval _lastChangeTime;
+    int _watch;                             // -1 unless the file is watched on its own.
+}
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIStorageGrowth
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@interface IAIStorageRootSummary()
+
+- (id)initWithName: (NSString *)name
+              path: (NSString *)path
+     numberOfBytes: (unsigned long long)numberOfBytes
+     numberOfFiles: (unsigned long long)numberOfFiles;
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIStorageRootSummary
+
+@synthesize name = _name;
+@synthesize path = _path;
+@synthesize numberOfBytes = _numberOfBytes;
+@synthesize numberOfFiles = _numberOfFiles;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithName: (NSString *)name
+              path: (NSString *)path
+     numberOfBytes: (unsigned long long)numberOfBytes
+     numberOfFiles: (unsigned long long)numberOfFiles {
+    if ((self = [super init])) {
+        _name = [name copy];
+        _path = [path copy];
+        _numberOfBytes = numberOfBytes;
+        _numberOfFiles = numberOfFiles;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@ %@ %llu bytes in %llu files>",
+            NSStringFromClass([self class]), _name, _numberOfBytes, _numberOfFiles];
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@interface IAIStorageFileSummary()
+
+- (id)initWithPath: (NSString *)path
+     numberOfBytes: (unsigned long long)numberOfBytes
+            growth: (long long)growth
+   growthPerSecond: (double)growthPerSecond;
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIStorageFileSummary
+
+@synthesize path = _path;
+@synthesize numberOfBytes = _numberOfBytes;
+@synthesize growth = _growth;
+@synthesize growthPerSecond = _growthPerSecond;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithPath: (NSString *)path
+     numberOfBytes: (unsigned long long)numberOfBytes
+            growth: (long long)growth
+   growthPerSecond: (double)growthPerSecond {
+    if ((self = [super init])) {
+        _path = [path copy];
+        _numberOfBytes = numberOfBytes;
+        _growth = growth;
+        _growthPerSecond = growthPerSecond;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@ %@ %llu bytes, %+lld bytes at %.1f bytes/s>",
+            NSStringFromClass([self class]), _path, _numberOfBytes, _growth, _growthPerSecond];
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@interface IAIStorageMonitor()
+
+- (void)watchDidChange:(int)watch;
+- (void)addChangedPath:(NSString *)path;
+- (NSString *)removeFirstChangedPath;
+- (void)beginRescanIncludingWatchedDirectories: (BOOL)includesWatchedDirectories
+                                           now: (NSTimeInterval)now;
+- (IAIStorageDirectory *)nextDirectoryToScan;
+
+- (void)addDirectoryAtPath: (NSString *)path
+                 rootIndex: (NSUInteger)rootIndex
+              lastScanTime: (NSTimeInterval)lastScanTime;
+- (void)clearDirectory:(IAIStorageDirectory *)directory;
+- (void)removeDirectoryAtPath:(NSString *)path;
+- (void)watchGrownFile: (IAIStorageGrowth *)growth
+                atPath: (NSString *)path
+maximumNumberOfWatches: (NSUInteger)maximumNumberOfWatches;
+- (void)stopWatchingGrownFile:(IAIStorageGrowth *)growth;
+- (void)removeGrownFileAtPath:(NSString *)path;
+- (NSUInteger)        scanDirectory: (IAIStorageDirectory *)directory
+  maximumNumberOfWatchedDirectories: (NSUInteger)maximumNumberOfWatchedDirectories
+        maximumNumberOfWatchedFiles: (NSUInteger)maximumNumberOfWatchedFiles
+                                now: (NSTimeInterval)now;
+
+- (void)scanWithMaximumNumberOfEntries: (NSUInteger)maximumNumberOfEntries
+     maximumNumberOfWatchedDirectories: (NSUInteger)maximumNumberOfWatchedDirectories
+           maximumNumberOfWatchedFiles: (NSUInteger)maximumNumberOfWatchedFiles
+                        rescanInterval: (NSTimeInterval)rescanInterval;
+- (NSArray *)currentRootSummaries;
+- (NSArray *)currentFileSummaries;
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAIStorageMonitorWatchDidChange(int watch, void* context) {
+    [(__bridge IAIStorageMonitor *)context watchDidChange:watch];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The path relative to the home directory, or the path itself if it's elsewhere.
+static NSString* IAINameOfRootPath(NSString* path) {
+    NSString* home = [NSHomeDirectory() stringByStandardizingPath];
+    if ([path hasPrefix:[home stringByAppendingString:@"/"]]) {
+        return [path substringFromIndex:[home length] + 1];
+    }
+    return path;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAIStorageMonitor
+
+@synthesize rootPaths = _rootPaths;
+@synthesize rescanInterval = _rescanInterval;
+@synthesize maximumNumberOfEntriesPerUpdate = _maximumNumberOfEntriesPerUpdate;
+@synthesize maximumNumberOfWatchedDirectories = _maximumNumberOfWatchedDirectories;
+@synthesize maximumNumberOfWatchedFiles = _maximumNumberOfWatchedFiles;
+@synthesize rootSummaries = _rootSummaries;
+@synthesize fileSummaries = _fileSummaries;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Steps on the scan queue retain the monitor, so none can be running.
+- (void)dealloc {
+    if (NULL != _watcher) {
+        for (IAIStorageDirectory* directory in [_directories objectEnumerator]) {
+            if (directory->_watch >= 0) {
+                IAIFileWatcherRemoveWatch(_watcher, directory->_watch);
+            }
+        }
+        for (NSNumber* watch in _grownFilesByWatch) {
+            IAIFileWatcherRemoveWatch(_watcher, [watch intValue]);
+        }
+        IAIFileWatcherDestroy(_watcher);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithLogger:(IAILogger *)logger rootPaths:(NSArray *)rootPaths {
+    if ((self = [super init])) {
+        _logger = logger;
+        NSMutableArray* standardizedPaths = [NSMutableArray arrayWithCapacity:[rootPaths count]];
+        for (NSString* path in rootPaths) {
+            [standardizedPaths addObject:[path stringByStandardizingPath]];
+        }
+        _rootPaths = [standardizedPaths copy];
+        _rescanInterval = 60;
+        _maximumNumberOfEntriesPerUpdate = 1000;
+        _maximumNumberOfWatchedDirectories = 256;
+        _maximumNumberOfWatchedFiles = 16;
+        _scanQueue = dispatch_queue_create("com.overview.storage", DISPATCH_QUEUE_SERIAL);
+        _rootSummaries = [NSArray array];
+        _fileSummaries = [NSArray array];
+
+        // Without a watcher every change waits for the next rescan.
+        _watcher = IAIFileWatcherCreate();
+        _directories = [[NSMutableDictionary alloc] init];
+        _directoriesByWatch = [[NSMutableDictionary alloc] init];
+        _changedPaths = [[NSMutableArray alloc] init];
+        _changedPathSet = [[NSMutableSet alloc] init];
+        _grownFiles = [[NSMutableDictionary alloc] init];
+        _grownFilesByWatch = [[NSMutableDictionary alloc] init];
+        [_rootPaths enumerateObjectsUsingBlock:^(NSString* path, NSUInteger ix, BOOL* stop) {
+            [self addDirectoryAtPath:path rootIndex:ix lastScanTime:0];
+        }];
+        _lastRescanTime = [NSDate timeIntervalSinceReferenceDate];
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithLogger:(IAILogger *)logger {
+    NSString* home = NSHomeDirectory();
+    NSArray* rootPaths = [NSArray arrayWithObjects:
+                          [home stringByAppendingPathComponent:@"Documents"],
+                          [home stringByAppendingPathComponent:@"Library/Caches"],
+                          [home stringByAppendingPathComponent:@"tmp"],
+                          nil];
+    return [self initWithLogger:logger rootPaths:rootPaths];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Directories
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// A watched file that changed has its directory listed again.
+- (void)watchDidChange:(int)watch {
+    NSNumber* key = [NSNumber numberWithInt:watch];
+    IAIStorageDirectory* directory = [_directoriesByWatch objectForKey:key];
+    if (nil != directory) {
+        [self addChangedPath:directory->_path];
+        return;
+    }
+    IAIStorageGrowth* growth = [_grownFilesByWatch objectForKey:key];
+    if (nil != growth) {
+        [self addChangedPath:growth->_directoryPath];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)addChangedPath:(NSString *)path {
+    if (![_changedPathSet containsObject:path]) {
+        [_changedPathSet addObject:path];
+        [_changedPaths addObject:path];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The paths that were taken are only removed from the array once they are half of it, so that
+// taking a path doesn't move the rest of the array.
+- (NSString *)removeFirstChangedPath {
+    if (_changedPathIndex >= [_changedPaths count]) {
+        return nil;
+    }
+    NSString* path = [_changedPaths objectAtIndex:_changedPathIndex];
+    ++_changedPathIndex;
+    [_changedPathSet removeObject:path];
+    if (_changedPathIndex * 2 >= [_changedPaths count]) {
+        [_changedPaths removeObjectsInRange:NSMakeRange(0, _changedPathIndex)];
+        _changedPathIndex = 0;
+    }
+    return path;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The rescan goes through the directories as they are now, and lists each one that wasn't
+// listed since it began. Where the watcher reports the files that are written, the watched
+// directories are only listed again when changes were lost.
+- (void)beginRescanIncludingWatchedDirectories: (BOOL)includesWatchedDirectories
+                                           now: (NSTimeInterval)now {
+    _rescanPaths = [_directories allKeys];
+    _rescanPathIndex = 0;
+    _rescanStartTime = now;
+    _rescansWatchedDirectories = includesWatchedDirectories;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The directories that changed come before those of the rescan.
+- (IAIStorageDirectory *)nextDirectoryToScan {
+    NSString* path;
+    while (nil != (path = [self removeFirstChangedPath])) {
+        IAIStorageDirectory* directory = [_directories objectForKey:path];
+        if (nil != directory) {
+            return directory;
+        }
+    }
+    while (_rescanPathIndex < [_rescanPaths count]) {
+        path = [_rescanPaths objectAtIndex:_rescanPathIndex];
+        ++_rescanPathIndex;
+        IAIStorageDirectory* directory = [_directories objectForKey:path];
+        if (nil != directory && directory->_lastScanTime < _rescanStartTime
+            && (_rescansWatchedDirectories || directory->_watch < 0)) {
+            return directory;
+        }
+    }
+    _rescanPaths = nil;
+    return nil;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)addDirectoryAtPath: (NSString *)path
+                 rootIndex: (NSUInteger)rootIndex
+              lastScanTime: (NSTimeInterval)lastScanTime {
+    IAIStorageDirectory* directory = [[IAIStorageDirectory alloc] init];
+    directory->_path = path;
+    directory->_rootIndex = rootIndex;
+    directory->_watch = -1;
+    directory->_fileBytes = [[NSMutableDictionary alloc] init];
+    directory->_subdirectoryNames = [[NSMutableSet alloc] init];
+    directory->_lastScanTime = lastScanTime;
+    [_directories setObject:directory forKey:path];
+    [self addChangedPath:path];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Forgets the directory's files and subdirectories and stops watching it.
+- (void)clearDirectory:(IAIStorageDirectory *)directory {
+    if (directory->_watch >= 0) {
+        IAIFileWatcherRemoveWatch(_watcher, directory->_watch);
+        [_directoriesByWatch removeObjectForKey:[NSNumber numberWithInt:directory->_watch]];
+        directory->_watch = -1;
+        --_numberOfWatchedDirectories;
+    }
+    for (NSString* name in directory->_fileBytes) {
+        [self removeGrownFileAtPath:[directory->_path stringByAppendingPathComponent:name]];
+    }
+    for (NSString* name in directory->_subdirectoryNames) {
+        [self removeDirectoryAtPath:[directory->_path stringByAppendingPathComponent:name]];
+    }
+    [directory->_fileBytes removeAllObjects];
+    [directory->_subdirectoryNames removeAllObjects];
+    directory->_numberOfBytes = 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)removeDirectoryAtPath:(NSString *)path {
+    IAIStorageDirectory* directory = [_directories objectForKey:path];
+    if (nil != directory) {
+        [self clearDirectory:directory];
+        [_directories removeObjectForKey:path];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Once the most files are watched, the one that changed the longest ago makes room.
+- (void)watchGrownFile: (IAIStorageGrowth *)growth
+                atPath: (NSString *)path
+maximumNumberOfWatches: (NSUInteger)maximumNumberOfWatches {
+    if (IAIFileWatcherReportsFileWrites || NULL == _watcher || growth->_watch >= 0
+        || 0 == maximumNumberOfWatches) {
+        return;
+    }
+    while ([_grownFilesByWatch count] >= maximumNumberOfWatches) {
+        IAIStorageGrowth* oldestGrowth = nil;
+        for (IAIStorageGrowth* watchedGrowth in [_grownFilesByWatch objectEnumerator]) {
+            if (nil == oldestGrowth
+                || watchedGrowth->_lastChangeTime < oldestGrowth->_lastChangeTime) {
+                oldestGrowth = watchedGrowth;
+            }
+        }
+        [self stopWatchingGrownFile:oldestGrowth];
+    }
+    int watch = IAIFileWatcherAddFile(_watcher, [path fileSystemRepresentation]);
+    if (watch >= 0) {
+        growth->_watch = watch;
+        [_grownFilesByWatch setObject:growth forKey:[NSNumber numberWithInt:watch]];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)stopWatchingGrownFile:(IAIStorageGrowth *)growth {
+    if (growth->_watch >= 0) {
+        IAIFileWatcherRemoveWatch(_watcher, growth->_watch);
+        [_grownFilesByWatch removeObjectForKey:[NSNumber numberWithInt:growth->_watch]];
+        growth->_watch = -1;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)removeGrownFileAtPath:(NSString *)path {
+    IAIStorageGrowth* growth = [_grownFiles objectForKey:path];
+    if (nil != growth) {
+        [self stopWatchingGrownFile:growth];
+        [_grownFiles removeObjectForKey:path];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Lists the directory and returns the number of entries listed.
+- (NSUInteger)        scanDirectory: (IAIStorageDirectory *)directory
+  maximumNumberOfWatchedDirectories: (NSUInteger)maximumNumberOfWatchedDirectories
+        maximumNumberOfWatchedFiles: (NSUInteger)maximumNumberOfWatchedFiles
+                                now: (NSTimeInterval)now {
+    NSString* path = directory->_path;
+    DIR* dir = opendir([path fileSystemRepresentation]);
+    if (NULL == dir) {
+        // Gone; its parent removes it once it is listed again.
+        [self clearDirectory:directory];
+        return 1;
+    }
+    if (directory->_watch < 0 && NULL != _watcher
+        && _numberOfWatchedDirectories < maximumNumberOfWatchedDirectories) {
+        int watch = IAIFileWatcherAddDirectory(_watcher, [path fileSystemRepresentation]);
+        if (watch >= 0) {
+            directory->_watch = watch;
+            [_directoriesByWatch setObject:directory forKey:[NSNumber numberWithInt:watch]];
+            ++_numberOfWatchedDirectories;
+        }
+    }
+
+    NSMutableDictionary* fileBytes = [[NSMutableDictionary alloc] init];
+    NSMutableSet* subdirectoryNames = [[NSMutableSet alloc] init];
+    unsigned long long numberOfBytes = 0;
+    NSUInteger numberOfEntries = 1;
+    struct dirent* entry;
+    while (NULL != (entry = readdir(dir))) {
+        if (0 == strcmp(entry->d_name, ".") || 0 == strcmp(entry->d_name, "..")) {
+            continue;
+        }
+        ++numberOfEntries;
+        struct stat status;
+        if (0 != fstatat(dirfd(dir), entry->d_name, &status, AT_SYMLINK_NOFOLLOW)) {
+            continue;
+        }
+        NSString* name = [[NSFileManager defaultManager]
+                          stringWithFileSystemRepresentation: entry->d_name
+                                                      length: strlen(entry->d_name)];
+        if (S_ISDIR(status.st_mode)) {
+            [subdirectoryNames addObject:name];
+        } else if (S_ISREG(status.st_mode)) {
+            unsigned long long bytes = (unsigned long long)status.st_blocks * 512;
+            [fileBytes setObject:[NSNumber numberWithUnsignedLongLong:bytes] forKey:name];
+            numberOfBytes += bytes;
+        }
+    }
+    closedir(dir);
+
+    // Files that changed since the last listing start or continue growing. On the first
+    // listing there is nothing to compare with.
+    NSTimeInterval lastScanTime = directory->_lastScanTime;
+    [fileBytes enumerateKeysAndObjectsUsingBlock:^(NSString* name, NSNumber* bytes, BOOL* stop) {
+        NSNumber* lastBytes = [directory->_fileBytes objectForKey:name];
+        if (0 == lastScanTime || (nil != lastBytes && [bytes isEqualToNumber:lastBytes])) {
+            return;
+        }
+        NSString* filePath = [path stringByAppendingPathComponent:name];
+        IAIStorageGrowth* growth = [_grownFiles objectForKey:filePath];
+        if (nil == growth) {
+            growth = [[IAIStorageGrowth alloc] init];
+            growth->_directoryPath = path;
+            // New files grew from nothing.
+            growth->_firstNumberOfBytes = [lastBytes unsignedLongLongValue];
+            growth->_firstTime = lastScanTime;
+            growth->_watch = -1;
+            [_grownFiles setObject:growth forKey:filePath];
+        }
+        growth->_numberOfBytes = [bytes unsignedLongLongValue];
+        growth->_lastChangeTime = now;
+        [self watchGrownFile: growth
+                      atPath: filePath
+      maximumNumberOfWatches: maximumNumberOfWatchedFiles];
+    }];
+    for (NSString* name in directory->_fileBytes) {
+        if (nil == [fileBytes objectForKey:name]) {
+            [self removeGrownFileAtPath:[path stringByAppendingPathComponent:name]];
+        }
+    }
+
+    for (NSString* name in directory->_subdirectoryNames) {
+        if (![subdirectoryNames containsObject:name]) {
+            [self removeDirectoryAtPath:[path stringByAppendingPathComponent:name]];
+        }
+    }
+    for (NSString* name in subdirectoryNames) {
+        NSString* subdirectoryPath = [path stringByAppendingPathComponent:name];
+        if (nil == [_directories objectForKey:subdirectoryPath]) {
+            // A directory that appeared since the last listing grew from nothing since then.
+            [self addDirectoryAtPath: subdirectoryPath
+                           rootIndex: directory->_rootIndex
+                        lastScanTime: lastScanTime];
+        }
+    }
+
+    directory->_fileBytes = fileBytes;
+    directory->_subdirectoryNames = subdirectoryNames;
+    directory->_numberOfBytes = numberOfBytes;
+    directory->_lastScanTime = now;
+    return numberOfEntries;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Scanning
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Runs on the scan queue.
+- (void)scanWithMaximumNumberOfEntries: (NSUInteger)maximumNumberOfEntries
+     maximumNumberOfWatchedDirectories: (NSUInteger)maximumNumberOfWatchedDirectories
+           maximumNumberOfWatchedFiles: (NSUInteger)maximumNumberOfWatchedFiles
+                        rescanInterval: (NSTimeInterval)rescanInterval {
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    if (NULL != _watcher) {
+        int numberOfChanges = IAIFileWatcherReadChanges(_watcher,
+                                                        IAIStorageMonitorWatchDidChange,
+                                                        (__bridge void *)self);
+        if (IAIFileWatcherOverflow == numberOfChanges) {
+            [self beginRescanIncludingWatchedDirectories:YES now:now];
+        }
+    }
+    if (now - _lastRescanTime >= rescanInterval) {
+        // A rescan that hasn't finished carries on.
+        if (nil == _rescanPaths) {
+            [self beginRescanIncludingWatchedDirectories:!IAIFileWatcherReportsFileWrites now:now];
+        }
+        _lastRescanTime = now;
+    }
+
+    NSUInteger numberOfEntries = 0;
+    while (numberOfEntries < maximumNumberOfEntries) {
+        IAIStorageDirectory* directory = [self nextDirectoryToScan];
+        if (nil == directory) {
+            break;
+        }
+        numberOfEntries += [self        scanDirectory: directory
+                    maximumNumberOfWatchedDirectories: maximumNumberOfWatchedDirectories
+                          maximumNumberOfWatchedFiles: maximumNumberOfWatchedFiles
+                                                  now: now];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Runs on the scan queue.
+- (NSArray *)currentRootSummaries {
+    NSUInteger numberOfRoots = [_rootPaths count];
+    if (0 == numberOfRoots) {
+        return [NSArray array];
+    }
+    unsigned long long rootBytes[numberOfRoots];
+    unsigned long long rootFiles[numberOfRoots];
+    memset(rootBytes, 0, sizeof(rootBytes));
+    memset(rootFiles, 0, sizeof(rootFiles));
+    for (IAIStorageDirectory* directory in [_directories objectEnumerator]) {
+        rootBytes[directory->_rootIndex] += directory->_numberOfBytes;
+        rootFiles[directory->_rootIndex] += [directory->_fileBytes count];
+    }
+
+    NSMutableArray* summaries = [NSMutableArray arrayWithCapacity:numberOfRoots];
+    for (NSUInteger ix = 0; ix < numberOfRoots; ++ix) {
+        NSString* path = [_rootPaths objectAtIndex:ix];
+        [summaries addObject:[[IAIStorageRootSummary alloc] initWithName: IAINameOfRootPath(path)
+                                                                    path: path
+                                                           numberOfBytes: rootBytes[ix]
+                                                           numberOfFiles: rootFiles[ix]]];
+    }
+    return summaries;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Runs on the scan queue.
+- (NSArray *)currentFileSummaries {
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    NSMutableArray* summaries = [NSMutableArray array];
+    [_grownFiles enumerateKeysAndObjectsUsingBlock:^(NSString* path, IAIStorageGrowth* growth,
+                                                     BOOL* stop) {
+        if (growth->_numberOfBytes <= growth->_firstNumberOfBytes) {
+            return;
+        }
+        long long bytes = (long long)(growth->_numberOfBytes - growth->_firstNumberOfBytes);
+        NSTimeInterval elapsed = MAX(now - growth->_firstTime, 1);
+        [summaries addObject:[[IAIStorageFileSummary alloc] initWithPath: path
+                                                           numberOfBytes: growth->_numberOfBytes
+                                                                  growth: bytes
+                                                         growthPerSecond: bytes / elapsed]];
+    }];
+    [summaries sortUsingComparator:^NSComparisonResult(IAIStorageFileSummary* summary1,
+                                                       IAIStorageFileSummary* summary2) {
+        if (summary1.growthPerSecond != summary2.growthPerSecond) {
+            return (summary1.growthPerSecond > summary2.growthPerSecond
+                    ? NSOrderedAscending : NSOrderedDescending);
+        }
+        return [summary1.path compare:summary2.path];
+    }];
+    if ([summaries count] > kMaximumNumberOfFileSummaries) {
+        [summaries removeObjectsInRange:NSMakeRange(kMaximumNumberOfFileSummaries,
+                                                    [summaries count]
+                                                    - kMaximumNumberOfFileSummaries)];
+    }
+    return summaries;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)update {
+    IAILogger* logger = _logger;
+    for (IAIStorageRootSummary* summary in _rootSummaries) {
+        [logger addMetricValue: (double)summary.numberOfBytes
+                       forName: [IAIMetricStorageBytesPrefix stringByAppendingString:summary.name]];
+    }
+
+    if (_isScanning) {
+        return;
+    }
+    _isScanning = YES;
+    NSUInteger maximumNumberOfEntries = _maximumNumberOfEntriesPerUpdate;
+    NSUInteger maximumNumberOfWatchedDirectories = _maximumNumberOfWatchedDirectories;
+    NSUInteger maximumNumberOfWatchedFiles = _maximumNumberOfWatchedFiles;
+    NSTimeInterval rescanInterval = _rescanInterval;
+    dispatch_async(_scanQueue, ^{
+        IAIOverheadSection section;
+        IAIOverheadBeginSection(&section, IAIOverheadStorageScanning);
+        [self scanWithMaximumNumberOfEntries: maximumNumberOfEntries
+           maximumNumberOfWatchedDirectories: maximumNumberOfWatchedDirectories
+                 maximumNumberOfWatchedFiles: maximumNumberOfWatchedFiles
+                              rescanInterval: rescanInterval];
+        NSArray* rootSummaries = [self currentRootSummaries];
+        NSArray* fileSummaries = [self currentFileSummaries];
+        IAIOverheadEndSection(&section);
+
+        dispatch_async(dispatch_get_main_queue(), ^{
+            _rootSummaries = [rootSummaries copy];
+            _fileSummaries = [fileSummaries copy];
+            _isScanning = NO;
+        });
+    });
+}
+
+
+@end
@@ -0,0 +1,151 @@
+//
+//  IAITelemetryExporter.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "IAILogger.h"
+#import "IAIFrameQueue.h"
+#import "IAITelemetryFrame.h"
+
+/**
+ * Encodes an entry as a telemetry frame.
+ *
+ *      @returns The length of the frame, or 0 if it did not fit in the given capacity.
+ */
+size_t IAITelemetryEncodeDeviceLog(IAIDeviceLogEntry* logEntry, uint8_t* bytes, size_t capacity);
+size_t IAITelemetryEncodeConsoleLog(IAIConsoleLogEntry* logEntry, uint8_t* bytes, size_t capacity);
+size_t IAITelemetryEncodeEventLog(IAIEventLogEntry* logEntry, uint8_t* bytes, size_t capacity);
+size_t IAITelemetryEncodeMetricLog(IAIMetricLogEntry* logEntry, uint8_t* bytes, size_t capacity);
+
+/**
+ * Streams the logger's entries to a collector on the same machine.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * The exporter connects to a UNIX domain socket, or to a TCP port on the loopback interface,
+ * and sends each entry as a frame in the format described in IAITelemetryFrame.h. Tools/
+ * IAICollector is a reference collector that records the stream to disk.
+ *
+ * <h2>Never Blocking the App</h2>
+ *
+ * Exporting an entry encodes it straight into a slot of a bounded lock-free queue (see
+ * IAIFrameQueue) on the thread that logged it. A private serial queue drains the frames every
+ * batchInterval and sends them in batches with non-blocking writes.
+ *
+ * If the collector reads too slowly, the unsent batch stops the exporter from draining the
+ * queue, the queue fills up, and new frames are dropped. Frames are also dropped while the
+ * exporter is not connected. Every dropped frame is counted by type, and the totals are sent
+ * to the collector in a drops frame once it can be reached again.
+ *
+ * Attach an exporter to a logger by adding it to IAILogger::exporters.
+ */
+@interface IAITelemetryExporter : NSObject <IAILogExporter> {
+@private
+    IAIFrameQueue _queue;
+    NSString* _socketPath;
+    uint16_t _port;
+    NSTimeInterval _batchInterval;
+
+    volatile int32_t _isRunning;
+    dispatch_queue_t _senderQueue;
+    dispatch_source_t _timer;
+
+    // Only touched on _senderQueue.
+    int _socket;
+    NSMutableData* _unsentBytes;
+    NSUInteger _unsentOffset;
+    NSMutableData* _unsentFrames;
+    NSUInteger _numberOfWrittenUnsentFrames;
+    CFAbsoluteTime _lastConnectionAttemptTime;
+    int64_t _numberOfReportedDroppedFrames;
+
+    volatile int64_t _droppedFrameCounts[IAITelemetryNumberOfFrameTypes];
+    volatile int64_t _numberOfSentFrames;
+    volatile int64_t _numberOfSentBytes;
+    volatile int32_t _isConnected;
+}
+
+#pragma mark Creating an Exporter /** @name Creating an Exporter */
+
+/**
+ * Creates an exporter that connects to the UNIX domain socket at the given path.
+ */
+- (id)initWithUnixSocketPath:(NSString *)path;
+
+/**
+ * Creates an exporter that connects to the given TCP port on 127.0.0.1.
+ */
+- (id)initWithLoopbackPort:(uint16_t)port;
+
+/**
+ * Designated initializer.
+ *
+ * Exactly one of path and port should be given. The queue holds up to queueCapacity frames
+ * (rounded up to a power of two) of up to IAITelemetryMaxFrameLength bytes each.
+ */
+- (id)initWithUnixSocketPath: (NSString *)path
+                loopbackPort: (uint16_t)port
+               queueCapacity: (NSUInteger)queueCapacity;
+
+
+#pragma mark Streaming /** @name Streaming */
+
+/**
+ * Starts connecting and sending. A lost connection is retried once a second.
+ */
+- (void)start;
+
+/**
+ * Stops sending and closes the connection. Frames that have not been sent are discarded.
+ */
+- (void)stop;
+
+/**
+ * How often queued frames are sent. By default this is 0.1 seconds. Changes take effect the
+ * next time the exporter is started.
+ */
+@property (nonatomic, readwrite, assign) NSTimeInterval batchInterval;
+
+
+#pragma mark Exporting Entries /** @name Exporting Entries */
+
+/**
+ * These methods may be called from any thread. They never block. If the exporter isn't
+ * running they do nothing.
+ */
+- (void)exportDeviceLog:(IAIDeviceLogEntry *)logEntry;
+- (void)exportConsoleLog:(IAIConsoleLogEntry *)logEntry;
+- (void)exportEventLog:(IAIEventLogEntry *)logEntry;
+- (void)exportMetricLog:(IAIMetricLogEntry *)logEntry;
+
+
+#pragma mark Statistics /** @name Statistics */
+
+/**
+ * Whether the exporter is connected to the collector.
+ */
+@property (nonatomic, readonly, assign) BOOL isConnected;
+
+/**
+ * The number of frames that were dropped because the queue was full or the collector could not
+ * be reached, including the frames of a batch that was not written in full when the connection
+ * was lost or the exporter was stopped.
+ */
+@property (nonatomic, readonly, assign) unsigned long long numberOfDroppedFrames;
+
+/**
+ * The number of frames that have been handed to the socket in full.
+ */
+@property (nonatomic, readonly, assign) unsigned long long numberOfSentFrames;
+
+/**
+ * The number of bytes that have been handed to the socket.
+ */
+@property (nonatomic, readonly, assign) unsigned long long numberOfSentBytes;
+
+@end
@@ -0,0 +1,495 @@
+//
+//  IAITelemetryExporter.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAITelemetryExporter.h"
+
+#import "IAILogger.h"
+#import "IAIOverhead.h"
+
+#import <libkern/OSAtomic.h>
+#import <arpa/inet.h>
+#import <errno.h>
+#import <fcntl.h>
+#import <netinet/in.h>
+#import <sys/socket.h>
+#import <sys/un.h>
+#import <unistd.h>
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+static const NSUInteger kDefaultQueueCapacity = 2048;
+static const NSUInteger kMaximumBatchLength = 64 * 1024;
+static const NSTimeInterval kReconnectInterval = 1;
+
+// A queued frame in the unsent bytes, which ends at the given offset.
+typedef struct {
+    NSUInteger end;
+    IAITelemetryFrameType type;
+} IAIUnsentFrame;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static int64_t IAITelemetryTimeOfEntry(IAILogEntry* entry) {
+    return (int64_t)([entry.timestamp timeIntervalSince1970] * 1000000.0);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+size_t IAITelemetryEncodeDeviceLog(IAIDeviceLogEntry* logEntry, uint8_t* bytes, size_t capacity) {
+    IAITelemetryWriter writer;
+    IAITelemetryBeginFrame(&writer, bytes, capacity, IAITelemetryFrameDeviceSample,
+                           IAITelemetryTimeOfEntry(logEntry));
+    IAITelemetryWriteUInt64(&writer, logEntry.bytesOfFreeMemory);
+    IAITelemetryWriteUInt64(&writer, logEntry.bytesOfTotalMemory);
+    IAITelemetryWriteUInt64(&writer, logEntry.bytesOfFreeDiskSpace);
+    IAITelemetryWriteUInt64(&writer, logEntry.bytesOfTotalDiskSpace);
+    IAITelemetryWriteDouble(&writer, logEntry.batteryLevel);
+    IAITelemetryWriteUInt8(&writer, (uint8_t)logEntry.batteryState);
+    IAITelemetryWriteUInt8(&writer, (uint8_t)logEntry.sampledMetrics);
+    return IAITelemetryEndFrame(&writer);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+size_t IAITelemetryEncodeConsoleLog(IAIConsoleLogEntry* logEntry, uint8_t* bytes, size_t capacity) {
+    IAITelemetryWriter writer;
+    IAITelemetryBeginFrame(&writer, bytes, capacity, IAITelemetryFrameConsoleLog,
+                           IAITelemetryTimeOfEntry(logEntry));
+    IAITelemetryWriteUInt8(&writer, (uint8_t)logEntry.level);
+    const char* text = [logEntry.log UTF8String];
+    IAITelemetryWriteText(&writer, text, (NULL != text) ? strlen(text) : 0);
+    return IAITelemetryEndFrame(&writer);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+size_t IAITelemetryEncodeEventLog(IAIEventLogEntry* logEntry, uint8_t* bytes, size_t capacity) {
+    IAITelemetryWriter writer;
+    IAITelemetryBeginFrame(&writer, bytes, capacity, IAITelemetryFrameEvent,
+                           IAITelemetryTimeOfEntry(logEntry));
+    IAITelemetryWriteUInt32(&writer, (uint32_t)(int32_t)logEntry.type);
+    IAITelemetryWriteDouble(&writer, logEntry.value);
+    return IAITelemetryEndFrame(&writer);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+size_t IAITelemetryEncodeMetricLog(IAIMetricLogEntry* logEntry, uint8_t* bytes, size_t capacity) {
+    IAITelemetryWriter writer;
+    IAITelemetryBeginFrame(&writer, bytes, capacity, IAITelemetryFrameMetric,
+                           IAITelemetryTimeOfEntry(logEntry));
+    IAITelemetryWriteDouble(&writer, logEntry.value);
+    const char* name = [logEntry.name UTF8String];
+    IAITelemetryWriteText(&writer, name, (NULL != name) ? strlen(name) : 0);
+    return IAITelemetryEndFrame(&writer);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAITelemetryExporter
+
+@synthesize batchInterval = _batchInterval;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)dealloc {
+    [self stop];
+    IAIFrameQueueDestroy(&_queue);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithUnixSocketPath: (NSString *)path
+                loopbackPort: (uint16_t)port
+               queueCapacity: (NSUInteger)queueCapacity {
+    if ((self = [super init])) {
+        if (!IAIFrameQueueInit(&_queue, (uint32_t)queueCapacity, IAITelemetryMaxFrameLength)) {
+            return nil;
+        }
+        _socketPath = [path copy];
+        _port = port;
+        _batchInterval = 0.1;
+        _socket = -1;
+        _unsentBytes = [[NSMutableData alloc] initWithCapacity:kMaximumBatchLength];
+        _unsentFrames = [[NSMutableData alloc] init];
+        _senderQueue = dispatch_queue_create("com.overview.telemetry", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithUnixSocketPath:(NSString *)path {
+    return [self initWithUnixSocketPath:path loopbackPort:0 queueCapacity:kDefaultQueueCapacity];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithLoopbackPort:(uint16_t)port {
+    return [self initWithUnixSocketPath:nil loopbackPort:port queueCapacity:kDefaultQueueCapacity];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)init {
+    return [self initWithUnixSocketPath:nil loopbackPort:0 queueCapacity:kDefaultQueueCapacity];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Connection
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The queued frames that weren't written in full are dropped, and the totals of the drops are
+// sent again on the next connection, since the last drops frame may not have been written.
+- (void)disconnect {
+    if (_socket >= 0) {
+        close(_socket);
+        _socket = -1;
+    }
+    const IAIUnsentFrame* frames = [_unsentFrames bytes];
+    NSUInteger numberOfFrames = [_unsentFrames length] / sizeof(IAIUnsentFrame);
+    for (NSUInteger ix = _numberOfWrittenUnsentFrames; ix < numberOfFrames; ++ix) {
+        [self didDropFrameOfType:frames[ix].type];
+    }
+    [_unsentFrames setLength:0];
+    _numberOfWrittenUnsentFrames = 0;
+    _numberOfReportedDroppedFrames = 0;
+    [_unsentBytes setLength:0];
+    _unsentOffset = 0;
+    _isConnected = 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (int)openSocket {
+    if (nil != _socketPath) {
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        const char* path = [_socketPath fileSystemRepresentation];
+        if (strlen(path) >= sizeof(address.sun_path)) {
+            return -1;
+        }
+        strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+        return fd;
+    }
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(_port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)connect {
+    int fd = [self openSocket];
+    if (fd < 0) {
+        return NO;
+    }
+
+    // A collector that goes away must not kill the app with SIGPIPE.
+    int noSigPipe = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    _socket = fd;
+
+    uint8_t bytes[IAITelemetryMaxFrameLength];
+    IAITelemetryWriter writer;
+    IAITelemetryBeginFrame(&writer, bytes, sizeof(bytes), IAITelemetryFrameHello,
+                           (int64_t)([[NSDate date] timeIntervalSince1970] * 1000000.0));
+    IAITelemetryWriteUInt32(&writer, IAITelemetryMagic);
+    IAITelemetryWriteUInt16(&writer, IAITelemetryVersion);
+    IAITelemetryWriteUInt16(&writer, 0);
+    IAITelemetryWriteUInt32(&writer, (uint32_t)getpid());
+    [_unsentBytes appendBytes:bytes length:IAITelemetryEndFrame(&writer)];
+
+    _isConnected = 1;
+    return YES;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Writes as much of the unsent bytes as the socket will take without blocking.
+- (BOOL)flushUnsentBytes {
+    while (_unsentOffset < [_unsentBytes length]) {
+        ssize_t written = write(_socket,
+                                (const uint8_t *)[_unsentBytes bytes] + _unsentOffset,
+                                [_unsentBytes length] - _unsentOffset);
+        if (written < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            if (EAGAIN == errno || EWOULDBLOCK == errno) {
+                return YES;
+            }
+            [self disconnect];
+            return NO;
+        }
+        _unsentOffset += (NSUInteger)written;
+        OSAtomicAdd64Barrier(written, &_numberOfSentBytes);
+
+        // A frame is only sent once its last byte is.
+        const IAIUnsentFrame* frames = [_unsentFrames bytes];
+        NSUInteger numberOfFrames = [_unsentFrames length] / sizeof(IAIUnsentFrame);
+        while (_numberOfWrittenUnsentFrames < numberOfFrames
+               && frames[_numberOfWrittenUnsentFrames].end <= _unsentOffset) {
+            ++_numberOfWrittenUnsentFrames;
+            OSAtomicIncrement64Barrier(&_numberOfSentFrames);
+        }
+    }
+    [_unsentBytes setLength:0];
+    _unsentOffset = 0;
+    [_unsentFrames setLength:0];
+    _numberOfWrittenUnsentFrames = 0;
+    return YES;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Sending
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)didDropFrameOfType:(IAITelemetryFrameType)type {
+    OSAtomicIncrement64Barrier(&_droppedFrameCounts[type]);
+    IAIOverheadCountDroppedRecords(1);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)appendDropsFrameIfNeeded {
+    unsigned long long numberOfDroppedFrames = self.numberOfDroppedFrames;
+    if (numberOfDroppedFrames == (unsigned long long)_numberOfReportedDroppedFrames) {
+        return;
+    }
+    _numberOfReportedDroppedFrames = (int64_t)numberOfDroppedFrames;
+
+    uint8_t bytes[IAITelemetryMaxFrameLength];
+    IAITelemetryWriter writer;
+    IAITelemetryBeginFrame(&writer, bytes, sizeof(bytes), IAITelemetryFrameDrops,
+                           (int64_t)([[NSDate date] timeIntervalSince1970] * 1000000.0));
+    for (int type = IAITelemetryFrameDeviceSample; type <= IAITelemetryFrameMetric; ++type) {
+        IAITelemetryWriteUInt64(&writer, (uint64_t)_droppedFrameCounts[type]);
+    }
+    [_unsentBytes appendBytes:bytes length:IAITelemetryEndFrame(&writer)];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)sendBatch {
+    if (_socket < 0) {
+        CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+        if (now - _lastConnectionAttemptTime >= kReconnectInterval) {
+            _lastConnectionAttemptTime = now;
+            [self connect];
+        }
+    }
+
+    if (_socket >= 0 && ![self flushUnsentBytes]) {
+        return;
+    }
+
+    if (_socket < 0) {
+        // Nobody is listening. Discard the queue so that it doesn't hold on to stale frames.
+        size_t length = 0;
+        const uint8_t* frame = NULL;
+        while (NULL != (frame = IAIFrameQueuePeek(&_queue, &length))) {
+            if (length > 0) {
+                [self didDropFrameOfType:frame[4]];
+            }
+            IAIFrameQueuePop(&_queue);
+        }
+        return;
+    }
+
+    // While the previous batch is still unsent, frames stay in the queue: this is the
+    // backpressure that eventually makes the producers drop frames.
+    if ([_unsentBytes length] > 0) {
+        return;
+    }
+
+    [self appendDropsFrameIfNeeded];
+
+    size_t length = 0;
+    const uint8_t* frame = NULL;
+    while ([_unsentBytes length] + IAITelemetryMaxFrameLength <= kMaximumBatchLength
+           && NULL != (frame = IAIFrameQueuePeek(&_queue, &length))) {
+        if (length > 0) {
+            [_unsentBytes appendBytes:frame length:length];
+            IAIUnsentFrame unsentFrame = { [_unsentBytes length], frame[4] };
+            [_unsentFrames appendBytes:&unsentFrame length:sizeof(unsentFrame)];
+        }
+        IAIFrameQueuePop(&_queue);
+    }
+
+    [self flushUnsentBytes];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)start {
+    if (!OSAtomicCompareAndSwap32Barrier(0, 1, &_isRunning)) {
+        return;
+    }
+
+    _timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, _senderQueue);
+    uint64_t interval = (uint64_t)(_batchInterval * NSEC_PER_SEC);
+    dispatch_source_set_timer(_timer, dispatch_time(DISPATCH_TIME_NOW, 0), interval,
+                              interval / 10);
+
+    // The timer is cancelled in stop, which dealloc calls, so it can't outlive the exporter.
+    __unsafe_unretained IAITelemetryExporter* exporter = self;
+    dispatch_source_set_event_handler(_timer, ^{
+        [exporter sendBatch];
+    });
+    dispatch_resume(_timer);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)stop {
+    if (!OSAtomicCompareAndSwap32Barrier(1, 0, &_isRunning)) {
+        return;
+    }
+
+    dispatch_source_cancel(_timer);
+    _timer = nil;
+
+    // Waits for a batch that is being sent. Stop may be called from dealloc, so don't retain
+    // the exporter.
+    __unsafe_unretained IAITelemetryExporter* exporter = self;
+    dispatch_sync(_senderQueue, ^{
+        [exporter disconnect];
+    });
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Exporting Entries
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (uint8_t *)reserveFrameOfType:(IAITelemetryFrameType)type ticket:(int32_t *)ticket {
+    if (!_isRunning) {
+        return NULL;
+    }
+    uint8_t* bytes = IAIFrameQueueReserve(&_queue, ticket);
+    if (NULL == bytes) {
+        [self didDropFrameOfType:type];
+    }
+    return bytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)exportDeviceLog:(IAIDeviceLogEntry *)logEntry {
+    int32_t ticket;
+    uint8_t* bytes = [self reserveFrameOfType:IAITelemetryFrameDeviceSample ticket:&ticket];
+    if (NULL != bytes) {
+        size_t length = IAITelemetryEncodeDeviceLog(logEntry, bytes, IAITelemetryMaxFrameLength);
+        IAIFrameQueueCommit(&_queue, ticket, length);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)exportConsoleLog:(IAIConsoleLogEntry *)logEntry {
+    int32_t ticket;
+    uint8_t* bytes = [self reserveFrameOfType:IAITelemetryFrameConsoleLog ticket:&ticket];
+    if (NULL != bytes) {
+        size_t length = IAITelemetryEncodeConsoleLog(logEntry, bytes, IAITelemetryMaxFrameLength);
+        IAIFrameQueueCommit(&_queue, ticket, length);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)exportEventLog:(IAIEventLogEntry *)logEntry {
+    int32_t ticket;
+    uint8_t* bytes = [self reserveFrameOfType:IAITelemetryFrameEvent ticket:&ticket];
+    if (NULL != bytes) {
+        size_t length = IAITelemetryEncodeEventLog(logEntry, bytes, IAITelemetryMaxFrameLength);
+        IAIFrameQueueCommit(&_queue, ticket, length);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (void)exportMetricLog:(IAIMetricLogEntry *)logEntry {
+    int32_t ticket;
+    uint8_t* bytes = [self reserveFrameOfType:IAITelemetryFrameMetric ticket:&ticket];
+    if (NULL != bytes) {
+        size_t length = IAITelemetryEncodeMetricLog(logEntry, bytes, IAITelemetryMaxFrameLength);
+        IAIFrameQueueCommit(&_queue, ticket, length);
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Statistics
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)isConnected {
+    return (0 != _isConnected);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (unsigned long long)numberOfDroppedFrames {
+    unsigned long long total = 0;
+    for (int type = 0; type < IAITelemetryNumberOfFrameTypes; ++type) {
+        total += (unsigned long long)_droppedFrameCounts[type];
+    }
+    return total;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (unsigned long long)numberOfSentFrames {
+    return (unsigned long long)_numberOfSentFrames;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (unsigned long long)numberOfSentBytes {
+    return (unsigned long long)_numberOfSentBytes;
+}
+
+
+@end
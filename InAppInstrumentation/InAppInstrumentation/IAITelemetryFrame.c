@@ -0,0 +1,224 @@
+//
+//  IAITelemetryFrame.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#include "IAITelemetryFrame.h"
+
+#include <string.h>
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Writing Frames
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITelemetryWrite(IAITelemetryWriter* writer, uint64_t value, unsigned byteCount) {
+    if (writer->length + byteCount > writer->capacity) {
+        // EndFrame rejects the frame.
+        writer->length = writer->capacity + 1;
+        return;
+    }
+    for (unsigned ix = 0; ix < byteCount; ++ix) {
+        writer->bytes[writer->length++] = (uint8_t)(value >> (8 * ix));
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAITelemetryBeginFrame(IAITelemetryWriter* writer, uint8_t* bytes, size_t capacity,
+                            IAITelemetryFrameType type, int64_t time) {
+    writer->bytes = bytes;
+    writer->capacity = capacity;
+    writer->length = 0;
+    writer->flags = 0;
+
+    // The length and flags are filled in by EndFrame.
+    IAITelemetryWrite(writer, 0, 4);
+    IAITelemetryWrite(writer, (uint8_t)type, 1);
+    IAITelemetryWrite(writer, 0, 1);
+    IAITelemetryWrite(writer, 0, 2);
+    IAITelemetryWrite(writer, (uint64_t)time, 8);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAITelemetryWriteUInt8(IAITelemetryWriter* writer, uint8_t value) {
+    IAITelemetryWrite(writer, value, 1);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAITelemetryWriteUInt16(IAITelemetryWriter* writer, uint16_t value) {
+    IAITelemetryWrite(writer, value, 2);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAITelemetryWriteUInt32(IAITelemetryWriter* writer, uint32_t value) {
+    IAITelemetryWrite(writer, value, 4);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAITelemetryWriteUInt64(IAITelemetryWriter* writer, uint64_t value) {
+    IAITelemetryWrite(writer, value, 8);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAITelemetryWriteDouble(IAITelemetryWriter* writer, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    IAITelemetryWrite(writer, bits, 8);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAITelemetryWriteText(IAITelemetryWriter* writer, const char* text, size_t length) {
+    if (writer->length > writer->capacity) {
+        return;
+    }
+    size_t available = writer->capacity - writer->length;
+    if (length > available) {
+        // Don't cut a UTF-8 sequence in half.
+        length = available;
+        while (length > 0 && ((uint8_t)text[length] & 0xC0) == 0x80) {
+            --length;
+        }
+        writer->flags |= IAITelemetryFrameFlagTruncated;
+    }
+    memcpy(writer->bytes + writer->length, text, length);
+    writer->length += length;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+size_t IAITelemetryEndFrame(IAITelemetryWriter* writer) {
+    if (writer->length > writer->capacity) {
+        return 0;
+    }
+    uint32_t length = (uint32_t)(writer->length - 4);
+    for (unsigned ix = 0; ix < 4; ++ix) {
+        writer->bytes[ix] = (uint8_t)(length >> (8 * ix));
+    }
+    writer->bytes[5] = writer->flags;
+    return writer->length;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Reading Frames
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static uint64_t IAITelemetryDecode(const uint8_t* bytes, unsigned byteCount) {
+    uint64_t value = 0;
+    for (unsigned ix = 0; ix < byteCount; ++ix) {
+        value |= (uint64_t)bytes[ix] << (8 * ix);
+    }
+    return value;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+long IAITelemetryParseFrame(const uint8_t* bytes, size_t available,
+                            IAITelemetryFrameHeader* header, IAITelemetryReader* payload) {
+    if (available < 4) {
+        return 0;
+    }
+    uint32_t length = (uint32_t)IAITelemetryDecode(bytes, 4);
+    if (length < IAITelemetryHeaderLength - 4 || length > IAITelemetryMaxFrameLength - 4) {
+        return -1;
+    }
+    if (available < 4 + (size_t)length) {
+        return 0;
+    }
+
+    header->length = length;
+    header->type = bytes[4];
+    header->flags = bytes[5];
+    header->time = (int64_t)IAITelemetryDecode(bytes + 8, 8);
+
+    payload->bytes = bytes + IAITelemetryHeaderLength;
+    payload->length = 4 + length - IAITelemetryHeaderLength;
+    payload->position = 0;
+    return 4 + (long)length;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static int IAITelemetryRead(IAITelemetryReader* reader, unsigned byteCount, uint64_t* value) {
+    if (reader->position + byteCount > reader->length) {
+        return 0;
+    }
+    *value = IAITelemetryDecode(reader->bytes + reader->position, byteCount);
+    reader->position += byteCount;
+    return 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAITelemetryReadUInt8(IAITelemetryReader* reader, uint8_t* value) {
+    uint64_t bits;
+    if (!IAITelemetryRead(reader, 1, &bits)) {
+        return 0;
+    }
+    *value = (uint8_t)bits;
+    return 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAITelemetryReadUInt16(IAITelemetryReader* reader, uint16_t* value) {
+    uint64_t bits;
+    if (!IAITelemetryRead(reader, 2, &bits)) {
+        return 0;
+    }
+    *value = (uint16_t)bits;
+    return 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAITelemetryReadUInt32(IAITelemetryReader* reader, uint32_t* value) {
+    uint64_t bits;
+    if (!IAITelemetryRead(reader, 4, &bits)) {
+        return 0;
+    }
+    *value = (uint32_t)bits;
+    return 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAITelemetryReadUInt64(IAITelemetryReader* reader, uint64_t* value) {
+    return IAITelemetryRead(reader, 8, value);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int IAITelemetryReadDouble(IAITelemetryReader* reader, double* value) {
+    uint64_t bits;
+    if (!IAITelemetryRead(reader, 8, &bits)) {
+        return 0;
+    }
+    memcpy(value, &bits, sizeof(bits));
+    return 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+const char* IAITelemetryReadText(IAITelemetryReader* reader, size_t* length) {
+    const char* text = (const char *)reader->bytes + reader->position;
+    *length = reader->length - reader->position;
+    reader->position = reader->length;
+    return text;
+}
@@ -0,0 +1,149 @@
+//
+//  IAITelemetryFrame.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#ifndef InAppInstrumentation_IAITelemetryFrame_h
+#define InAppInstrumentation_IAITelemetryFrame_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The wire format of the telemetry stream.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * The stream is a sequence of length-prefixed frames. All integers are little endian and
+ * doubles are sent as the little endian bits of an IEEE 754 double.
+ *
+ * @code
+ *  uint32  length      The number of bytes that follow this field.
+ *  uint8   type        An IAITelemetryFrameType.
+ *  uint8   flags       IAITelemetryFrameFlagTruncated if the text of the frame was cut short.
+ *  uint16  reserved    0.
+ *  int64   time        Microseconds since 1970.
+ *  ...     payload     length - 12 bytes, described by the frame type.
+ * @endcode
+ *
+ * Every connection starts with a hello frame. Readers must skip frames of types they do not
+ * know, and ignore payload bytes past the fields they know, so that fields and frame types can
+ * be added without changing the version.
+ */
+
+#define IAITelemetryMagic           0x54494149u  // "IAIT"
+#define IAITelemetryVersion         1
+#define IAITelemetryHeaderLength    16
+
+// Frames are never longer than this, including the length field. Longer text is truncated.
+#define IAITelemetryMaxFrameLength  512
+
+#define IAITelemetryFrameFlagTruncated 0x01
+
+typedef enum {
+    // uint32 magic, uint16 version, uint16 reserved, uint32 process id.
+    IAITelemetryFrameHello = 1,
+
+    // uint64 bytes of free memory, uint64 bytes of total memory, uint64 bytes of free disk
+    // space, uint64 bytes of total disk space, double battery level, uint8 battery state,
+    // uint8 sampled metrics (IAIDeviceMetrics): the values that were read for this sample rather
+    // than carried forward. Frames without the last field sampled every value.
+    IAITelemetryFrameDeviceSample = 2,
+
+    // uint8 level (IAIConsoleLogLevel), then the UTF-8 text of the log to the end of the frame.
+    IAITelemetryFrameConsoleLog = 3,
+
+    // int32 event type (IAIEventType), double value.
+    IAITelemetryFrameEvent = 4,
+
+    // double value, then the UTF-8 name of the metric to the end of the frame.
+    IAITelemetryFrameMetric = 5,
+
+    // uint64 for each of the frame types from IAITelemetryFrameDeviceSample to
+    // IAITelemetryFrameMetric: the total number of frames of that type that the app has dropped
+    // since the stream started.
+    IAITelemetryFrameDrops = 6,
+
+    // double value, then the UTF-8 name of the trigger rule to the end of the frame. Starts the
+    // entries of an IAILogSnapshot.
+    IAITelemetryFrameTrigger = 7,
+} IAITelemetryFrameType;
+
+#define IAITelemetryNumberOfFrameTypes 8
+
+/**
+ * Writes a single frame into a caller-provided buffer.
+ */
+typedef struct {
+    uint8_t* bytes;
+    size_t capacity;
+    size_t length;
+    uint8_t flags;
+} IAITelemetryWriter;
+
+/**
+ * Reads the payload of a single frame.
+ */
+typedef struct {
+    const uint8_t* bytes;
+    size_t length;
+    size_t position;
+} IAITelemetryReader;
+
+typedef struct {
+    uint32_t length;
+    uint8_t type;
+    uint8_t flags;
+    int64_t time;
+} IAITelemetryFrameHeader;
+
+/**
+ * Starts a frame. The capacity must be at least IAITelemetryHeaderLength.
+ */
+void IAITelemetryBeginFrame(IAITelemetryWriter* writer, uint8_t* bytes, size_t capacity,
+                            IAITelemetryFrameType type, int64_t time);
+
+void IAITelemetryWriteUInt8(IAITelemetryWriter* writer, uint8_t value);
+void IAITelemetryWriteUInt16(IAITelemetryWriter* writer, uint16_t value);
+void IAITelemetryWriteUInt32(IAITelemetryWriter* writer, uint32_t value);
+void IAITelemetryWriteUInt64(IAITelemetryWriter* writer, uint64_t value);
+void IAITelemetryWriteDouble(IAITelemetryWriter* writer, double value);
+
+/**
+ * Writes as much of the text as fits, and marks the frame as truncated if it does not all fit.
+ */
+void IAITelemetryWriteText(IAITelemetryWriter* writer, const char* text, size_t length);
+
+/**
+ * Fills in the length and flags of the frame. Returns the length of the whole frame, or 0 if
+ * a fixed size field did not fit.
+ */
+size_t IAITelemetryEndFrame(IAITelemetryWriter* writer);
+
+/**
+ * Parses the frame at the start of a buffer.
+ *
+ *      @returns The length of the whole frame, 0 if the buffer does not yet hold the whole
+ *               frame, or -1 if the bytes are not a valid frame.
+ */
+long IAITelemetryParseFrame(const uint8_t* bytes, size_t available,
+                            IAITelemetryFrameHeader* header, IAITelemetryReader* payload);
+
+/**
+ * The read functions return 0 if the payload has no more bytes.
+ */
+int IAITelemetryReadUInt8(IAITelemetryReader* reader, uint8_t* value);
+int IAITelemetryReadUInt16(IAITelemetryReader* reader, uint16_t* value);
+int IAITelemetryReadUInt32(IAITelemetryReader* reader, uint32_t* value);
+int IAITelemetryReadUInt64(IAITelemetryReader* reader, uint64_t* value);
+int IAITelemetryReadDouble(IAITelemetryReader* reader, double* value);
+
+/**
+ * The rest of the payload. The text is not NUL terminated.
+ */
+const char* IAITelemetryReadText(IAITelemetryReader* reader, size_t* length);
+
+#endif
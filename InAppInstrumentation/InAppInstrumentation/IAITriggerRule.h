@@ -0,0 +1,228 @@
+//
+//  IAITriggerRule.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+typedef enum {
+    IAITriggerAboveThreshold,
+    IAITriggerBelowThreshold,
+    IAITriggerRateOfChange,
+    IAITriggerDeviation,
+    IAITriggerEvent,
+} IAITriggerKind;
+
+/**
+ * A rule that watches one series of the logger and fires when it does something unusual.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * A series is either a metric, such as IAIMetricBytesOfFreeMemory or a custom metric added with
+ * IAILogger::addMetricValue:forName:, or a type of event. The logger evaluates each rule as
+ * values of its series are added and captures an IAILogSnapshot when the rule fires.
+ *
+ * @code
+ *  IAITriggerRule* lowMemory = [IAITriggerRule ruleWithMetric: IAIMetricBytesOfFreeMemory
+ *                                                   belowValue: 20 * 1024 * 1024];
+ *  IAITriggerRule* slowFrames = [IAITriggerRule ruleWithMetric: @"frameTime"
+ *                                   deviatingByStandardDeviations: 4
+ *                                                       smoothing: 0.05];
+ * @endcode
+ *
+ * Threshold rules fire when the series crosses the threshold, not for every value beyond it.
+ * Once a rule has fired it does not fire again until its snapshot has been captured.
+ *
+ * A rule keeps the state it needs to evaluate its series, so a rule should only be given to
+ * one logger.
+ */
+@interface IAITriggerRule : NSObject {
+@private
+    IAITriggerKind _kind;
+    NSString* _metricName;
+    NSInteger _eventType;
+    double _threshold;
+    double _smoothing;
+    NSString* _name;
+    NSTimeInterval _preTriggerInterval;
+    NSTimeInterval _postTriggerInterval;
+
+    // Evaluation state.
+    NSUInteger _numberOfValues;
+    double _lastValue;
+    NSTimeInterval _lastTime;
+    double _mean;
+    double _variance;
+    NSTimeInterval _quietUntilTime;
+}
+
+#pragma mark Creating a Rule /** @name Creating a Rule */
+
+/**
+ * Fires when a metric rises above a value.
+ */
++ (id)ruleWithMetric:(NSString *)metricName aboveValue:(double)threshold;
+
+/**
+ * Fires when a metric falls below a value.
+ */
++ (id)ruleWithMetric:(NSString *)metricName belowValue:(double)threshold;
+
+/**
+ * Fires when a metric changes faster than the given amount per second in either direction,
+ * measured between consecutive values.
+ */
++ (id)ruleWithMetric:(NSString *)metricName changingFasterThan:(double)changePerSecond;
+
+/**
+ * Fires when a value of a metric is further than the given number of standard deviations from
+ * the metric's exponentially weighted moving average.
+ *
+ * The smoothing is the weight of each new value in the average, between 0 and 1. The rule
+ * doesn't fire until it has seen enough values for the average to settle.
+ */
++ (id)ruleWithMetric: (NSString *)metricName
+    deviatingByStandardDeviations: (double)standardDeviations
+                        smoothing: (double)smoothing;
+
+/**
+ * Fires whenever an event of the given type is logged.
+ */
++ (id)ruleWithEventType:(NSInteger)eventType;
+
+
+#pragma mark Configuring a Rule /** @name Configuring a Rule */
+
+/**
+ * A name for the rule that is shown in its snapshots.
+ *
+ * By default this describes the rule, e.g. "bytesOfFreeMemory < 20971520".
+ */
+@property (nonatomic, readwrite, copy) NSString* name;
+
+/**
+ * The number of seconds before the trigger that a snapshot keeps.
+ *
+ * By default this is 30 seconds.
+ */
+@property (nonatomic, readwrite, assign) NSTimeInterval preTriggerInterval;
+
+/**
+ * The number of seconds after the trigger that a snapshot keeps recording.
+ *
+ * The logger must retain entries for at least this long for the snapshot to be complete. By
+ * default this is 10 seconds.
+ */
+@property (nonatomic, readwrite, assign) NSTimeInterval postTriggerInterval;
+
+@property (nonatomic, readonly, assign) IAITriggerKind kind;
+
+/**
+ * The metric the rule watches, or nil for event rules.
+ */
+@property (nonatomic, readonly, copy) NSString* metricName;
+
+/**
+ * The event type the rule watches. Only used by event rules.
+ */
+@property (nonatomic, readonly, assign) NSInteger eventType;
+
+
+#pragma mark Evaluating a Rule /** @name Evaluating a Rule */
+
+/**
+ * Updates the rule with the next value of its series. Returns YES if the rule fires.
+ *
+ * Values must be given in chronological order. Called by the logger while it holds the rule
+ * locked.
+ */
+- (BOOL)shouldFireForValue:(double)value atTime:(NSTimeInterval)timeIntervalSinceReferenceDate;
+
+@end
+
+
+@class IAILogEntry;
+
+/**
+ * The entries of a logger around the time a trigger rule fired.
+ *
+ *      @ingroup Overview-Logger
+ *
+ * A snapshot takes a copy of the device logs, console logs, events and metric samples from
+ * preTriggerInterval seconds before the trigger as soon as the rule fires, and adds the
+ * entries of the following postTriggerInterval seconds once that time has passed. The entries
+ * are kept by the snapshot, so they outlive the logger's own retention.
+ */
+@interface IAILogSnapshot : NSObject {
+@private
+    IAITriggerRule* _rule;
+    NSDate* _triggerDate;
+    double _triggerValue;
+    BOOL _complete;
+    NSArray* _deviceLogs;
+    NSArray* _consoleLogs;
+    NSArray* _eventLogs;
+    NSArray* _metricLogs;
+}
+
+/**
+ * Designated initializer.
+ */
+- (id)initWithRule:(IAITriggerRule *)rule triggerDate:(NSDate *)date value:(double)value;
+
+@property (nonatomic, readonly, IAI_STRONG) IAITriggerRule* rule;
+
+/**
+ * The time at which the rule fired.
+ */
+@property (nonatomic, readonly, IAI_STRONG) NSDate* triggerDate;
+
+/**
+ * The value of the series that made the rule fire. The event type for event rules.
+ */
+@property (nonatomic, readonly, assign) double triggerValue;
+
+/**
+ * The start of the snapshot's window.
+ */
+@property (nonatomic, readonly, IAI_STRONG) NSDate* fromDate;
+
+/**
+ * The end of the snapshot's window.
+ */
+@property (nonatomic, readonly, IAI_STRONG) NSDate* toDate;
+
+/**
+ * Whether the entries after the trigger have been added.
+ */
+@property (nonatomic, readwrite, assign, getter=isComplete) BOOL complete;
+
+@property (nonatomic, readwrite, copy) NSArray* deviceLogs;
+@property (nonatomic, readwrite, copy) NSArray* consoleLogs;
+@property (nonatomic, readwrite, copy) NSArray* eventLogs;
+@property (nonatomic, readwrite, copy) NSArray* metricLogs;
+
+
+#pragma mark Exporting a Snapshot /** @name Exporting a Snapshot */
+
+/**
+ * The snapshot in the telemetry format of IAITelemetryFrame.h.
+ *
+ * A hello frame and a trigger frame are followed by every entry of the snapshot in
+ * chronological order, so the data can be read like a recording of iai-collector:
+ *
+ * @code
+ *  iai-collector -r snapshot.iait
+ * @endcode
+ */
+- (NSData *)telemetryRepresentation;
+
+/**
+ * Writes telemetryRepresentation to a file.
+ */
+- (BOOL)writeToFile:(NSString *)path error:(NSError **)error;
+
+@end
@@ -0,0 +1,285 @@
+//
+//  IAITriggerRule.m
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#import "IAITriggerRule.h"
+
+#import "IAILogger.h"
+#import "IAITelemetryExporter.h"
+#import "IAITelemetryFrame.h"
+
+#import <unistd.h>
+
+#if !defined(__has_feature) || !__has_feature(objc_arc)
+#error "InAppInstrumentation requires ARC support."
+#endif
+
+// A deviation rule doesn't fire until its average has seen this many values.
+static const NSUInteger kMinimumNumberOfValuesForDeviation = 10;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAITriggerRule
+
+@synthesize name = _name;
+@synthesize preTriggerInterval = _preTriggerInterval;
+@synthesize postTriggerInterval = _postTriggerInterval;
+@synthesize kind = _kind;
+@synthesize metricName = _metricName;
+@synthesize eventType = _eventType;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithKind:(IAITriggerKind)kind metricName:(NSString *)metricName
+         threshold:(double)threshold {
+    if ((self = [super init])) {
+        _kind = kind;
+        _metricName = [metricName copy];
+        _threshold = threshold;
+        _preTriggerInterval = 30;
+        _postTriggerInterval = 10;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (id)ruleWithMetric:(NSString *)metricName aboveValue:(double)threshold {
+    return [[self alloc] initWithKind:IAITriggerAboveThreshold metricName:metricName
+                            threshold:threshold];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (id)ruleWithMetric:(NSString *)metricName belowValue:(double)threshold {
+    return [[self alloc] initWithKind:IAITriggerBelowThreshold metricName:metricName
+                            threshold:threshold];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (id)ruleWithMetric:(NSString *)metricName changingFasterThan:(double)changePerSecond {
+    return [[self alloc] initWithKind:IAITriggerRateOfChange metricName:metricName
+                            threshold:fabs(changePerSecond)];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (id)ruleWithMetric: (NSString *)metricName
+    deviatingByStandardDeviations: (double)standardDeviations
+                        smoothing: (double)smoothing {
+    IAITriggerRule* rule = [[self alloc] initWithKind:IAITriggerDeviation metricName:metricName
+                                            threshold:standardDeviations];
+    rule->_smoothing = MAX(MIN(smoothing, 1), 0);
+    return rule;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (id)ruleWithEventType:(NSInteger)eventType {
+    IAITriggerRule* rule = [[self alloc] initWithKind:IAITriggerEvent metricName:nil threshold:0];
+    rule->_eventType = eventType;
+    return rule;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSString *)name {
+    if (nil != _name) {
+        return _name;
+    }
+    switch (_kind) {
+        case IAITriggerAboveThreshold:
+            return [NSString stringWithFormat:@"%@ > %g", _metricName, _threshold];
+        case IAITriggerBelowThreshold:
+            return [NSString stringWithFormat:@"%@ < %g", _metricName, _threshold];
+        case IAITriggerRateOfChange:
+            return [NSString stringWithFormat:@"|d%@/dt| > %g/s", _metricName, _threshold];
+        case IAITriggerDeviation:
+            return [NSString stringWithFormat:@"%@ off average by %g sd", _metricName, _threshold];
+        case IAITriggerEvent:
+            return [NSString stringWithFormat:@"event %ld", (long)_eventType];
+    }
+    return nil;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@ %@>", NSStringFromClass([self class]), self.name];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)isFiringForValue:(double)value atTime:(NSTimeInterval)time {
+    switch (_kind) {
+        case IAITriggerAboveThreshold:
+            return (value > _threshold && (0 == _numberOfValues || _lastValue <= _threshold));
+
+        case IAITriggerBelowThreshold:
+            return (value < _threshold && (0 == _numberOfValues || _lastValue >= _threshold));
+
+        case IAITriggerRateOfChange:
+            return (_numberOfValues > 0 && time > _lastTime
+                    && fabs(value - _lastValue) / (time - _lastTime) > _threshold);
+
+        case IAITriggerDeviation:
+            return (_numberOfValues >= kMinimumNumberOfValuesForDeviation
+                    && fabs(value - _mean) > _threshold * sqrt(_variance));
+
+        case IAITriggerEvent:
+            return YES;
+    }
+    return NO;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)shouldFireForValue:(double)value atTime:(NSTimeInterval)time {
+    BOOL fires = [self isFiringForValue:value atTime:time] && time >= _quietUntilTime;
+
+    if (IAITriggerDeviation == _kind) {
+        // The exponentially weighted mean and variance. See "Incremental calculation of weighted
+        // mean and variance", Tony Finch, 2009.
+        if (0 == _numberOfValues) {
+            _mean = value;
+            _variance = 0;
+
+        } else {
+            double difference = value - _mean;
+            double increment = _smoothing * difference;
+            _mean += increment;
+            _variance = (1 - _smoothing) * (_variance + difference * increment);
+        }
+    }
+    _lastValue = value;
+    _lastTime = time;
+    ++_numberOfValues;
+
+    if (fires) {
+        _quietUntilTime = time + _postTriggerInterval;
+    }
+    return fires;
+}
+
+
+@end
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+@implementation IAILogSnapshot
+
+@synthesize rule = _rule;
+@synthesize triggerDate = _triggerDate;
+@synthesize triggerValue = _triggerValue;
+@synthesize complete = _complete;
+@synthesize deviceLogs = _deviceLogs;
+@synthesize consoleLogs = _consoleLogs;
+@synthesize eventLogs = _eventLogs;
+@synthesize metricLogs = _metricLogs;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (id)initWithRule:(IAITriggerRule *)rule triggerDate:(NSDate *)date value:(double)value {
+    if ((self = [super init])) {
+        _rule = rule;
+        _triggerDate = date;
+        _triggerValue = value;
+    }
+    return self;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSDate *)fromDate {
+    return [_triggerDate dateByAddingTimeInterval:-_rule.preTriggerInterval];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSDate *)toDate {
+    return [_triggerDate dateByAddingTimeInterval:_rule.postTriggerInterval];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Exporting
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static int64_t IAITelemetryTimeOfDate(NSDate* date) {
+    return (int64_t)([date timeIntervalSince1970] * 1000000.0);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (NSData *)telemetryRepresentation {
+    NSMutableData* data = [[NSMutableData alloc] init];
+    uint8_t bytes[IAITelemetryMaxFrameLength];
+    IAITelemetryWriter writer;
+
+    IAITelemetryBeginFrame(&writer, bytes, sizeof(bytes), IAITelemetryFrameHello,
+                           IAITelemetryTimeOfDate(self.fromDate));
+    IAITelemetryWriteUInt32(&writer, IAITelemetryMagic);
+    IAITelemetryWriteUInt16(&writer, IAITelemetryVersion);
+    IAITelemetryWriteUInt16(&writer, 0);
+    IAITelemetryWriteUInt32(&writer, (uint32_t)getpid());
+    [data appendBytes:bytes length:IAITelemetryEndFrame(&writer)];
+
+    IAITelemetryBeginFrame(&writer, bytes, sizeof(bytes), IAITelemetryFrameTrigger,
+                           IAITelemetryTimeOfDate(_triggerDate));
+    IAITelemetryWriteDouble(&writer, _triggerValue);
+    const char* name = [_rule.name UTF8String];
+    IAITelemetryWriteText(&writer, name, (NULL != name) ? strlen(name) : 0);
+    [data appendBytes:bytes length:IAITelemetryEndFrame(&writer)];
+
+    NSMutableArray* entries = [[NSMutableArray alloc] init];
+    [entries addObjectsFromArray:_deviceLogs];
+    [entries addObjectsFromArray:_consoleLogs];
+    [entries addObjectsFromArray:_eventLogs];
+    [entries addObjectsFromArray:_metricLogs];
+    [entries sortWithOptions: NSSortStable
+             usingComparator: ^NSComparisonResult(IAILogEntry* entry1, IAILogEntry* entry2) {
+                 return [entry1.timestamp compare:entry2.timestamp];
+             }];
+
+    for (IAILogEntry* entry in entries) {
+        size_t length = 0;
+        if ([entry isKindOfClass:[IAIDeviceLogEntry class]]) {
+            length = IAITelemetryEncodeDeviceLog((IAIDeviceLogEntry *)entry, bytes, sizeof(bytes));
+
+        } else if ([entry isKindOfClass:[IAIConsoleLogEntry class]]) {
+            length = IAITelemetryEncodeConsoleLog((IAIConsoleLogEntry *)entry, bytes,
+                                                  sizeof(bytes));
+
+        } else if ([entry isKindOfClass:[IAIEventLogEntry class]]) {
+            length = IAITelemetryEncodeEventLog((IAIEventLogEntry *)entry, bytes, sizeof(bytes));
+
+        } else if ([entry isKindOfClass:[IAIMetricLogEntry class]]) {
+            length = IAITelemetryEncodeMetricLog((IAIMetricLogEntry *)entry, bytes, sizeof(bytes));
+        }
+        [data appendBytes:bytes length:length];
+    }
+    return data;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+- (BOOL)writeToFile:(NSString *)path error:(NSError **)error {
+    return [[self telemetryRepresentation] writeToFile: path
+                                               options: NSDataWritingAtomic
+                                                 error: error];
+}
+
+
+@end
@@ -12,6 +12,7 @@
 
 #import "IAIDeviceInfo.h"
 #import "IAIPageView.h"
+#import "IAIOverhead.h"
 
 #if !defined(__has_feature) || !__has_feature(objc_arc)
 #error "Nimbus requires ARC support."
@@ -182,9 +183,14 @@
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 - (void)updatePages {
+    IAIOverheadSection section;
+    IAIOverheadBeginSection(&section, IAIOverheadPageUpdates);
+    
     for (IAIPageView* pageView in _pageViews) {
         [pageView update];
     }
+    
+    IAIOverheadEndSection(&section);
 }
 
 
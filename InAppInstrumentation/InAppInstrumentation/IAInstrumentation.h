@@ -11,6 +11,17 @@
 
 @class IAIView;
 @class IAILogger;
+@class IAIConsoleLogThrottle;
+@class IAIAllocationMonitor;
+@class IAILockMonitor;
+@class IAIQueueMonitor;
+@class IAIProcessMonitor;
+@class IAIMemoryPressureMonitor;
+@class IAIInstanceTracker;
+@class IAIBudgetMonitor;
+@class IAIStorageMonitor;
+@class IAIOverheadMonitor;
+@class IAIProfiler;
 
 /**
  * The Overview state management class.
@@ -47,8 +58,10 @@
 /**
  * Call this immediately in application:didFinishLaunchingWithOptions:.
  *
- * Swizzles the necessary methods for adding the Overview to the view hierarchy and registers
- * notifications for device state changes.
+ * Hooks NSLog right away. The logger, the monitors, the notifications for device state changes
+ * and the heartbeat are set up once the app has drawn its first frame, so that the Overview
+ * doesn't slow the launch down. At that point the phases of the launch are added to the
+ * logger as events (see IAIEventType) and summarized in the console.
  */
 + (void)applicationDidFinishLaunching;
 
@@ -56,7 +69,8 @@
  * Adds the Overview to the given window.
  *
  * The Overview will always be fixed at the top of the device's screen directly
- * beneath the status bar (if it is visible).
+ * beneath the status bar (if it is visible). When this is called during the launch, the
+ * Overview is added once the first frame has been drawn.
  */
 + (void)addOverviewToWindow:(UIWindow *)window;
 
@@ -81,8 +95,77 @@
 /**
  * The Overview logger.
  *
- * This is the logger that all of the Overview pages use to present their information.
+ * This is the logger that all of the Overview pages use to present their information. nil
+ * until the app has drawn its first frame.
  */
 + (IAILogger *)logger;
 
+/**
+ * The throttle that decides which NSLog messages are captured.
+ *
+ * Use it to set rate limits for noisy logs or to stop repeated logs from being collapsed.
+ */
++ (IAIConsoleLogThrottle *)consoleLogThrottle;
+
+/**
+ * The monitor that measures what the Overview itself costs.
+ *
+ * Use it to set the CPU and memory budgets of the Overview.
+ */
++ (IAIOverheadMonitor *)overheadMonitor;
+
+/**
+ * The monitor of the app's heap allocations.
+ *
+ * Off until it is started, since it counts every allocation of every thread.
+ */
++ (IAIAllocationMonitor *)allocationMonitor;
+
+/**
+ * The monitor of the locks that measure themselves (see IAILockProfiler.h).
+ */
++ (IAILockMonitor *)lockMonitor;
+
+/**
+ * The monitor of the queues that work is submitted to with IAIDispatchAsync and its relatives
+ * (see IAIQueueMonitor.h).
+ */
++ (IAIQueueMonitor *)queueMonitor;
+
+/**
+ * The monitor of the page faults, context switches, open files and I/O of the app's process.
+ */
++ (IAIProcessMonitor *)processMonitor;
+
+/**
+ * The monitor that shrinks the logger's histories while the system is short of memory.
+ */
++ (IAIMemoryPressureMonitor *)memoryPressureMonitor;
+
+/**
+ * The tracker of the live instances of Objective-C classes and C++ types.
+ *
+ * The tracker snapshots the C++ types that count themselves from the start, but doesn't count
+ * Objective-C classes until it is started.
+ */
++ (IAIInstanceTracker *)instanceTracker;
+
+/**
+ * The monitor that logs the scopes that exceeded their budgets (see IAIBudget.h).
+ */
++ (IAIBudgetMonitor *)budgetMonitor;
+
+/**
+ * The monitor of the storage used by the app's Documents, Library/Caches and tmp directories.
+ */
++ (IAIStorageMonitor *)storageMonitor;
+
+/**
+ * The sampling profiler of the main thread.
+ *
+ * The profiler is created when the app finishes launching but doesn't sample until it is
+ * started.
+ */
++ (IAIProfiler *)profiler;
+
 @end
@@ -15,6 +15,21 @@
 #import "IAIView.h"
 #import "IAIPageView.h"
 #import "IAILogger.h"
+#import "IAIConsoleLogThrottle.h"
+#import "IAIAllocationMonitor.h"
+#import "IAILockMonitor.h"
+#import "IAIQueueMonitor.h"
+#import "IAIProcessMonitor.h"
+#import "IAIMemoryPressureMonitor.h"
+#import "IAIInstanceTracker.h"
+#import "IAIBudgetMonitor.h"
+#import "IAIStorageMonitor.h"
+#import "IAIOverhead.h"
+#import "IAIProfiler.h"
+#import "IAISamplingScheduler.h"
+
+#import <sys/sysctl.h>
+#import <unistd.h>
 
 #if !defined(__has_feature) || !__has_feature(objc_arc)
 #error "Nimbus requires ARC support."
@@ -25,9 +40,54 @@ static CGFloat  sOverviewHeight   = 150;
 static BOOL     sOverviewIsAwake  = NO;
 
 static NSTimer* sOverviewHeartbeatTimer = nil;
+static NSTimer* sSamplingTimer = nil;
 
 static IAIView* sOverviewView = nil;
 static IAILogger* sOverviewLogger = nil;
+static IAIConsoleLogThrottle* sConsoleLogThrottle = nil;
+static IAIOverheadMonitor* sOverheadMonitor = nil;
+static IAIProfiler* sProfiler = nil;
+static IAIAllocationMonitor* sAllocationMonitor = nil;
+static IAILockMonitor* sLockMonitor = nil;
+static IAIQueueMonitor* sQueueMonitor = nil;
+static IAIProcessMonitor* sProcessMonitor = nil;
+static IAIMemoryPressureMonitor* sMemoryPressureMonitor = nil;
+static IAIInstanceTracker* sInstanceTracker = nil;
+static IAIBudgetMonitor* sBudgetMonitor = nil;
+static IAIStorageMonitor* sStorageMonitor = nil;
+static IAISamplingScheduler* sSamplingScheduler = nil;
+static IAIDeviceLogEntry* sLastDeviceLog = nil;
+
+// Launch state. Everything but the console hook waits for the first frame.
+static CFAbsoluteTime sMainTime = 0;
+static CFAbsoluteTime sDidFinishLaunchingTime = 0;
+static CFAbsoluteTime sFirstFrameTime = 0;
+static NSMutableArray* sPendingConsoleLogs = nil;
+static UIWindow* sPendingOverviewWindow = nil;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Static initializers run just before main, so this is as close to main as the framework gets
+// without a call from the app.
+__attribute__((constructor))
+static void IAIRecordMainTime(void) {
+    sMainTime = CFAbsoluteTimeGetCurrent();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The time at which the kernel started the process, or 0 if it can't be read.
+static CFAbsoluteTime IAIProcessStartTime(void) {
+    struct kinfo_proc info;
+    size_t size = sizeof(info);
+    int name[] = { CTL_KERN, KERN_PROC, KERN_PROC_PID, getpid() };
+    if (0 != sysctl(name, sizeof(name) / sizeof(name[0]), &info, &size, NULL, 0)) {
+        return 0;
+    }
+    struct timeval startTime = info.kp_proc.p_starttime;
+    return ((CFAbsoluteTime)startTime.tv_sec + (CFAbsoluteTime)startTime.tv_usec / 1000000.0
+            - kCFAbsoluteTimeIntervalSince1970);
+}
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 CGFloat IAIStatusBarHeight(void) {
@@ -93,13 +153,8 @@ void IAILogMethod(const char* message, unsigned length, BOOL withSyslogBanner);
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-/**
- * Pipes NSLog messages to the Overview and stderr.
- *
- * This method is passed as an argument to _NSSetLogCStringFunction to pipe all NSLog
- * messages through here.
- */
-void IAILogMethod(const char* message, unsigned length, BOOL withSyslogBanner) {
+// Adds a console log to the Overview and writes it to stderr. Returns the new entry.
+static IAIConsoleLogEntry* IAIWriteConsoleLog(NSString* log) {
     static NSDateFormatter* formatter = nil;
     if (nil == formatter) {
         formatter = [[NSDateFormatter alloc] init];
@@ -107,23 +162,64 @@ void IAILogMethod(const char* message, unsigned length, BOOL withSyslogBanner) {
         [formatter setDateStyle:NSDateFormatterMediumStyle];
     }
     
-    // Don't autorelease here in an attempt to minimize autorelease thrashing in tight
-    // loops.
+    IAIConsoleLogEntry* entry = [[IAIConsoleLogEntry alloc] initWithLog:log];
     
-    NSString* formattedLogMessage = [[NSString alloc] initWithCString: message
-                                                             encoding: NSUTF8StringEncoding];
+    // Until the first frame there is no logger, so logs wait for it.
+    BOOL isPending = NO;
+    if (nil != sPendingConsoleLogs) {
+        @synchronized([IAInstrumentation class]) {
+            isPending = (nil != sPendingConsoleLogs);
+            [sPendingConsoleLogs addObject:entry];
+        }
+    }
+    if (!isPending) {
+        [[IAInstrumentation logger] addConsoleLog:entry];
+    }
     
-    IAIConsoleLogEntry* entry = [[IAIConsoleLogEntry alloc]
-                                        initWithLog:formattedLogMessage];
+    NSString* formattedLogMessage = [[NSString alloc] initWithFormat:
+                                     @"%@: %@\n", [formatter stringFromDate:entry.timestamp], log];
     
-    [[IAInstrumentation logger] addConsoleLog:entry];
+    fprintf(stderr, "%s", [formattedLogMessage UTF8String]);
     
-    formattedLogMessage = [[NSString alloc] initWithFormat:
-                           @"%@: %s\n", [formatter stringFromDate:[NSDate date]], message];
+    return entry;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Pipes NSLog messages to the Overview and stderr.
+ *
+ * This method is passed as an argument to _NSSetLogCStringFunction to pipe all NSLog
+ * messages through here.
+ *
+ * The console log throttle looks at each message before any work is done with it, so repeated
+ * messages and messages over their rate limit cost next to nothing.
+ */
+void IAILogMethod(const char* message, unsigned length, BOOL withSyslogBanner) {
+    IAIOverheadSection section;
+    IAIOverheadBeginSection(&section, IAIOverheadConsoleCapture);
     
-    fprintf(stderr, "%s", [formattedLogMessage UTF8String]);
+    NSArray* summaries = nil;
+    IAIConsoleLogCaptureAction action = [sConsoleLogThrottle actionForLog: message
+                                                                   length: length
+                                                                summaries: &summaries];
+    for (NSString* summary in summaries) {
+        IAIWriteConsoleLog(summary);
+    }
+    if (IAIConsoleLogCaptureWrite == action) {
+        // Don't autorelease here in an attempt to minimize autorelease thrashing in tight
+        // loops.
+        
+        NSString* formattedLogMessage = [[NSString alloc] initWithCString: message
+                                                                 encoding: NSUTF8StringEncoding];
+        
+        [sConsoleLogThrottle didWriteEntry:IAIWriteConsoleLog(formattedLogMessage)];
+    }
+    
+    IAIOverheadEndSection(&section);
 }
 
+
 #endif
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -212,28 +308,232 @@ void IAILogMethod(const char* message, unsigned length, BOOL withSyslogBanner) {
 + (void)didReceiveMemoryWarning {
     [sOverviewLogger addEventLog:
      [[IAIEventLogEntry alloc] initWithType:IAIEventDidReceiveMemoryWarning]];
+    
+    // After the event, so that the snapshot it triggers still has the entries that are shed.
+    [sMemoryPressureMonitor didReceiveMemoryWarning];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAIAddLaunchEvent(IAIEventType type, CFAbsoluteTime time) {
+    if (time > 0) {
+        IAIEventLogEntry* entry = [[IAIEventLogEntry alloc] initWithType:type];
+        entry.timestamp = [NSDate dateWithTimeIntervalSinceReferenceDate:time];
+        [sOverviewLogger addEventLog:entry];
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Sets up everything that applicationDidFinishLaunching put off, once the first frame is out.
++ (void)didDrawFirstFrame {
+    sOverviewLogger = [[IAILogger alloc] init];
+    
+    CFAbsoluteTime processStartTime = IAIProcessStartTime();
+    IAIAddLaunchEvent(IAIEventProcessDidStart, processStartTime);
+    IAIAddLaunchEvent(IAIEventDidReachMain, sMainTime);
+    IAIAddLaunchEvent(IAIEventDidFinishLaunching, sDidFinishLaunchingTime);
+    IAIAddLaunchEvent(IAIEventDidDrawFirstFrame, sFirstFrameTime);
+    
+    NSArray* pendingConsoleLogs = nil;
+    @synchronized(self) {
+        pendingConsoleLogs = sPendingConsoleLogs;
+        sPendingConsoleLogs = nil;
+    }
+    // Logs from other threads may have been queued slightly out of order.
+    pendingConsoleLogs = [pendingConsoleLogs sortedArrayUsingComparator:
+                          ^NSComparisonResult(IAIConsoleLogEntry* entry1,
+                                              IAIConsoleLogEntry* entry2) {
+                              return [entry1.timestamp compare:entry2.timestamp];
+                          }];
+    for (IAIConsoleLogEntry* entry in pendingConsoleLogs) {
+        [sOverviewLogger addConsoleLog:entry];
+    }
+    
+    sOverheadMonitor = [[IAIOverheadMonitor alloc] initWithLogger:sOverviewLogger];
+    
+    // Profiles the calling thread, which is the main thread.
+    sProfiler = [[IAIProfiler alloc] init];
+    sAllocationMonitor = [[IAIAllocationMonitor alloc] initWithLogger:sOverviewLogger];
+    sLockMonitor = [[IAILockMonitor alloc] initWithLogger:sOverviewLogger];
+    sQueueMonitor = [[IAIQueueMonitor alloc] initWithLogger:sOverviewLogger];
+    sProcessMonitor = [[IAIProcessMonitor alloc] initWithLogger:sOverviewLogger];
+    sMemoryPressureMonitor = [[IAIMemoryPressureMonitor alloc] initWithLogger:sOverviewLogger];
+    sInstanceTracker = [[IAIInstanceTracker alloc] initWithLogger:sOverviewLogger];
+    sBudgetMonitor = [[IAIBudgetMonitor alloc] initWithLogger:sOverviewLogger];
+    sStorageMonitor = [[IAIStorageMonitor alloc] initWithLogger:sOverviewLogger];
+    sSamplingScheduler = [[IAISamplingScheduler alloc] initWithLogger:sOverviewLogger];
+    
+    [[NSNotificationCenter defaultCenter] addObserver: self
+                                             selector: @selector(didChangeOrientation)
+                                                 name: UIDeviceOrientationDidChangeNotification
+                                               object: nil];
+    [[NSNotificationCenter defaultCenter] addObserver: self
+                                             selector: @selector(statusBarWillChangeFrame)
+                                                 name: UIApplicationWillChangeStatusBarFrameNotification
+                                               object: nil];
+    [[NSNotificationCenter defaultCenter] addObserver: self
+                                             selector: @selector(didReceiveMemoryWarning)
+                                                 name: UIApplicationDidReceiveMemoryWarningNotification
+                                               object: nil];
+    
+    [self scheduleHeartbeatWithInterval:sOverheadMonitor.heartbeatInterval];
+    [self sampleDevice];
+    
+    if (nil != sPendingOverviewWindow) {
+        [self addOverviewToWindow:sPendingOverviewWindow];
+        sPendingOverviewWindow = nil;
+    }
+    
+    if (processStartTime > 0) {
+        NSLog(@"Launched in %.3fs: %.3fs to main, %.3fs to didFinishLaunching, "
+              @"%.3fs to the first frame.",
+              sFirstFrameTime - processStartTime, sMainTime - processStartTime,
+              sDidFinishLaunchingTime - sMainTime, sFirstFrameTime - sDidFinishLaunchingTime);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Core Animation commits the frame in an observer of the same run loop activity with a lower
+// order, so by the time this runs the first frame has been handed to the render server.
+static void IAIFirstFrameObserverCallback(CFRunLoopObserverRef observer,
+                                          CFRunLoopActivity activity, void* info) {
+    sFirstFrameTime = CFAbsoluteTimeGetCurrent();
+    
+    // Leave the observer callout before doing the deferred work.
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [IAInstrumentation didDrawFirstFrame];
+    });
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (void)scheduleHeartbeatWithInterval:(NSTimeInterval)interval {
+    [sOverviewHeartbeatTimer invalidate];
+    sOverviewHeartbeatTimer = [NSTimer scheduledTimerWithTimeInterval: interval
+                                                               target: self
+                                                             selector: @selector(heartbeat)
+                                                             userInfo: nil
+                                                              repeats: YES];
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 + (void)heartbeat {
-    [IAIDeviceInfo beginCachedDeviceInfo];
-    IAIDeviceLogEntry* logEntry =
-    [[IAIDeviceLogEntry alloc] initWithTimestamp:[NSDate date]];
-    logEntry.bytesOfTotalDiskSpace = [IAIDeviceInfo bytesOfTotalDiskSpace];
-    logEntry.bytesOfFreeDiskSpace = [IAIDeviceInfo bytesOfFreeDiskSpace];
-    logEntry.bytesOfFreeMemory = [IAIDeviceInfo bytesOfFreeMemory];
-    logEntry.bytesOfTotalMemory = [IAIDeviceInfo bytesOfTotalMemory];
-    logEntry.batteryLevel = [IAIDeviceInfo batteryLevel];
-    logEntry.batteryState = [IAIDeviceInfo batteryState];
-    [IAIDeviceInfo endCachedDeviceInfo];
+    IAIOverheadSection section;
+    IAIOverheadBeginSection(&section, IAIOverheadHeartbeat);
     
-    [sOverviewLogger addDeviceLog:logEntry];
+    // Threads that stopped logging would otherwise keep their repeat counts and suppressed
+    // logs to themselves.
+    for (NSString* summary in [sConsoleLogThrottle takeStaleSummaries]) {
+        IAIWriteConsoleLog(summary);
+    }
+    
+    [sAllocationMonitor update];
+    [sLockMonitor update];
+    [sQueueMonitor update];
+    [sProcessMonitor update];
+    [sMemoryPressureMonitor update];
+    [sInstanceTracker update];
+    [sBudgetMonitor update];
+    [sStorageMonitor update];
+    
+    // Device samples may be minutes apart once the sampling has backed off.
+    [sOverviewLogger completeSnapshotsAtDate:[NSDate date]];
+    
+    // The monitor may slow the heartbeat down to keep the instrumentation within its budget, and
+    // the device sampling slows down with it.
+    [sOverheadMonitor update];
+    if (sOverheadMonitor.heartbeatInterval != [sOverviewHeartbeatTimer timeInterval]) {
+        [self scheduleHeartbeatWithInterval:sOverheadMonitor.heartbeatInterval];
+    }
+    sSamplingScheduler.throttleFactor = (sOverheadMonitor.heartbeatInterval
+                                         / sOverheadMonitor.minimumHeartbeatInterval);
+    
+    IAIOverheadEndSection(&section);
     
     [sOverviewView updatePages];
 }
 
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Reads the metrics that are due and carries the others forward from the last sample, marking
+// the entry with the metrics that were read.
++ (void)sampleDevice {
+    IAIOverheadSection section;
+    IAIOverheadBeginSection(&section, IAIOverheadHeartbeat);
+    
+    NSDate* date = [NSDate date];
+    NSTimeInterval now = [date timeIntervalSinceReferenceDate];
+    IAIDeviceLogEntry* logEntry = [[IAIDeviceLogEntry alloc] initWithTimestamp:date];
+    logEntry.bytesOfTotalDiskSpace = sLastDeviceLog.bytesOfTotalDiskSpace;
+    logEntry.bytesOfFreeDiskSpace = sLastDeviceLog.bytesOfFreeDiskSpace;
+    logEntry.bytesOfFreeMemory = sLastDeviceLog.bytesOfFreeMemory;
+    logEntry.bytesOfTotalMemory = sLastDeviceLog.bytesOfTotalMemory;
+    logEntry.batteryLevel = sLastDeviceLog.batteryLevel;
+    logEntry.batteryState = sLastDeviceLog.batteryState;
+    IAIDeviceMetrics sampledMetrics = 0;
+    
+    if ([sSamplingScheduler isMetricDue:IAIMetricBytesOfFreeMemory atTime:now]) {
+        sampledMetrics |= IAIDeviceMetricFreeMemory;
+        logEntry.bytesOfFreeMemory = [IAIDeviceInfo bytesOfFreeMemory];
+        [sSamplingScheduler didSampleMetric: IAIMetricBytesOfFreeMemory
+                                      value: (double)logEntry.bytesOfFreeMemory
+                                     atTime: now];
+    }
+    if ([sSamplingScheduler isMetricDue:IAIMetricBytesOfTotalMemory atTime:now]) {
+        sampledMetrics |= IAIDeviceMetricTotalMemory;
+        logEntry.bytesOfTotalMemory = [IAIDeviceInfo bytesOfTotalMemory];
+        [sSamplingScheduler didSampleMetric: IAIMetricBytesOfTotalMemory
+                                      value: (double)logEntry.bytesOfTotalMemory
+                                     atTime: now];
+    }
+    if ([sSamplingScheduler isMetricDue:IAIMetricBytesOfFreeDiskSpace atTime:now]) {
+        sampledMetrics |= IAIDeviceMetricFreeDiskSpace;
+        logEntry.bytesOfFreeDiskSpace = [IAIDeviceInfo bytesOfFreeDiskSpace];
+        [sSamplingScheduler didSampleMetric: IAIMetricBytesOfFreeDiskSpace
+                                      value: (double)logEntry.bytesOfFreeDiskSpace
+                                     atTime: now];
+    }
+    if ([sSamplingScheduler isMetricDue:IAIMetricBytesOfTotalDiskSpace atTime:now]) {
+        sampledMetrics |= IAIDeviceMetricTotalDiskSpace;
+        logEntry.bytesOfTotalDiskSpace = [IAIDeviceInfo bytesOfTotalDiskSpace];
+        [sSamplingScheduler didSampleMetric: IAIMetricBytesOfTotalDiskSpace
+                                      value: (double)logEntry.bytesOfTotalDiskSpace
+                                     atTime: now];
+    }
+    if ([sSamplingScheduler isMetricDue:IAIMetricBatteryLevel atTime:now]) {
+        sampledMetrics |= IAIDeviceMetricBattery;
+        logEntry.batteryLevel = [IAIDeviceInfo batteryLevel];
+        logEntry.batteryState = [IAIDeviceInfo batteryState];
+        
+        // A level of -1 means that battery monitoring is off.
+        sSamplingScheduler.lowPower = (logEntry.batteryState == UIDeviceBatteryStateUnplugged
+                                       && logEntry.batteryLevel >= 0
+                                       && logEntry.batteryLevel < 0.2);
+        [sSamplingScheduler didSampleMetric: IAIMetricBatteryLevel
+                                      value: logEntry.batteryLevel
+                                     atTime: now];
+    }
+    
+    logEntry.sampledMetrics = sampledMetrics;
+    [sOverviewLogger addDeviceLog:logEntry];
+    sLastDeviceLog = logEntry;
+    
+    // One-shot, so that every sample picks the time of the next one.
+    NSTimeInterval delay = MAX([sSamplingScheduler nextSampleTime] - now, 0.05);
+    [sSamplingTimer invalidate];
+    sSamplingTimer = [NSTimer scheduledTimerWithTimeInterval: delay
+                                                      target: self
+                                                    selector: @selector(sampleDevice)
+                                                    userInfo: nil
+                                                     repeats: NO];
+    
+    IAIOverheadEndSection(&section);
+}
+
+
 #endif
 
 
@@ -248,31 +548,20 @@ void IAILogMethod(const char* message, unsigned length, BOOL withSyslogBanner) {
 #ifdef DEBUG
     if (!sOverviewIsAwake) {
         sOverviewIsAwake = YES;
+        sDidFinishLaunchingTime = CFAbsoluteTimeGetCurrent();
         
-        // Set up the logger right away so that all calls to NSLog will be captured by the
-        // overview.
+        // Hook NSLog right away so that all calls to NSLog will be captured by the overview.
+        // They are kept aside until the logger exists.
+        sConsoleLogThrottle = [[IAIConsoleLogThrottle alloc] init];
+        sPendingConsoleLogs = [[NSMutableArray alloc] init];
         _NSSetLogCStringFunction(IAILogMethod);
         
-        sOverviewLogger = [[IAILogger alloc] init];
-        
-        [[NSNotificationCenter defaultCenter] addObserver: self
-                                                 selector: @selector(didChangeOrientation)
-                                                     name: UIDeviceOrientationDidChangeNotification
-                                                   object: nil];
-        [[NSNotificationCenter defaultCenter] addObserver: self
-                                                 selector: @selector(statusBarWillChangeFrame)
-                                                     name: UIApplicationWillChangeStatusBarFrameNotification
-                                                   object: nil];
-        [[NSNotificationCenter defaultCenter] addObserver: self
-                                                 selector: @selector(didReceiveMemoryWarning)
-                                                     name: UIApplicationDidReceiveMemoryWarningNotification
-                                                   object: nil];
-        
-        sOverviewHeartbeatTimer = [NSTimer scheduledTimerWithTimeInterval: 0.5
-                                                                   target: self
-                                                                 selector: @selector(heartbeat)
-                                                                 userInfo: nil
-                                                                  repeats: YES];
+        // Everything else waits for the first frame so that it doesn't slow the launch down.
+        CFRunLoopObserverRef observer =
+        CFRunLoopObserverCreate(NULL, kCFRunLoopBeforeWaiting, false, LONG_MAX,
+                                IAIFirstFrameObserverCallback, NULL);
+        CFRunLoopAddObserver(CFRunLoopGetMain(), observer, kCFRunLoopCommonModes);
+        CFRelease(observer);
     }
 #endif
 }
@@ -281,6 +570,12 @@ void IAILogMethod(const char* message, unsigned length, BOOL withSyslogBanner) {
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 + (void)addOverviewToWindow:(UIWindow *)window {
 #ifdef DEBUG
+    if (nil == sOverviewLogger && sOverviewIsAwake) {
+        // Build the pages once the first frame is out.
+        sPendingOverviewWindow = window;
+        return;
+    }
+    
     if (nil != sOverviewView) {
         // Remove the old overview in case this gets called multiple times (not sure why you would
         // though).
@@ -292,6 +587,14 @@ void IAILogMethod(const char* message, unsigned length, BOOL withSyslogBanner) {
     [sOverviewView addPageView:[IAIConsoleLogPageView page]];
     [sOverviewView addPageView:[IAIMemoryPageView page]];
     [sOverviewView addPageView:[IAIDiskPageView page]];
+    [sOverviewView addPageView:[IAIStoragePageView page]];
+    [sOverviewView addPageView:[IAIAllocationPageView page]];
+    [sOverviewView addPageView:[IAIQueuePageView page]];
+    [sOverviewView addPageView:[IAIProcessPageView page]];
+    [sOverviewView addPageView:[IAIInstancesPageView page]];
+    [sOverviewView addPageView:[IAIOverheadPageView page]];
+    [sOverviewView addPageView:[IAIProfilerPageView page]];
+    [sOverviewView addPageView:[IAILocksPageView page]];
     
     // Hide the view initially because the initial frame will be wrong when the device
     // starts the app in any orientation other than portrait. Don't worry, we'll fade the
@@ -315,6 +618,116 @@ void IAILogMethod(const char* message, unsigned length, BOOL withSyslogBanner) {
 }
 
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (IAIConsoleLogThrottle *)consoleLogThrottle {
+#ifdef DEBUG
+    return sConsoleLogThrottle;
+#else
+    return nil;
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (IAIOverheadMonitor *)overheadMonitor {
+#ifdef DEBUG
+    return sOverheadMonitor;
+#else
+    return nil;
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (IAIAllocationMonitor *)allocationMonitor {
+#ifdef DEBUG
+    return sAllocationMonitor;
+#else
+    return nil;
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (IAILockMonitor *)lockMonitor {
+#ifdef DEBUG
+    return sLockMonitor;
+#else
+    return nil;
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (IAIQueueMonitor *)queueMonitor {
+#ifdef DEBUG
+    return sQueueMonitor;
+#else
+    return nil;
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (IAIProcessMonitor *)processMonitor {
+#ifdef DEBUG
+    return sProcessMonitor;
+#else
+    return nil;
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (IAIMemoryPressureMonitor *)memoryPressureMonitor {
+#ifdef DEBUG
+    return sMemoryPressureMonitor;
+#else
+    return nil;
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (IAIInstanceTracker *)instanceTracker {
+#ifdef DEBUG
+    return sInstanceTracker;
+#else
+    return nil;
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (IAIBudgetMonitor *)budgetMonitor {
+#ifdef DEBUG
+    return sBudgetMonitor;
+#else
+    return nil;
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (IAIStorageMonitor *)storageMonitor {
+#ifdef DEBUG
+    return sStorageMonitor;
+#else
+    return nil;
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
++ (IAIProfiler *)profiler {
+#ifdef DEBUG
+    return sProfiler;
+#else
+    return nil;
+#endif
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 + (CGFloat)height {
 #ifdef DEBUG
@@ -0,0 +1,152 @@
+//
+//  IAIAllocationCountersTest.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+//  Checks the counters of the allocator of the platform they are built on, the malloc zone on
+//  OS X and the replacements of malloc and its relatives elsewhere: that a thread counts each of
+//  a known number of allocations exactly, that the totals have them once the thread exits, in
+//  the size class of their blocks, that realloc counts a free and an allocation, and that
+//  nothing is counted once the counters are uninstalled:
+//
+//      iai-allocation-counters-test
+//
+
+#include "IAIAllocationCounters.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define kNumberOfBlocks 1000
+
+// Much larger than anything the C library allocates on its own, so that the blocks are alone
+// in their size class.
+#define kBlockSize 20000
+
+static int sNumberOfFailures = 0;
+
+// The blocks escape, so that the compiler keeps their allocations.
+static void* sBlocks[kNumberOfBlocks];
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestExpect(int condition, const char* description) {
+    if (!condition) {
+        fprintf(stderr, "FAILED: %s\n", description);
+        ++sNumberOfFailures;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static unsigned IAITestSizeClassOfBlocks(void) {
+    unsigned sizeClass = 0;
+    while (IAIAllocationSizeClassLimit(sizeClass) < kBlockSize) {
+        ++sizeClass;
+    }
+    return sizeClass;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void* IAITestAllocateBlocks(void* context) {
+    int64_t* numberOfAllocations = context;
+    int64_t firstCount = IAIAllocationCountersCurrentThreadAllocations();
+    for (unsigned ix = 0; ix < kNumberOfBlocks; ++ix) {
+        sBlocks[ix] = (0 == ix % 2) ? malloc(kBlockSize) : calloc(1, kBlockSize);
+    }
+    *numberOfAllocations = IAIAllocationCountersCurrentThreadAllocations() - firstCount;
+    for (unsigned ix = 0; ix < kNumberOfBlocks; ++ix) {
+        free(sBlocks[ix]);
+        sBlocks[ix] = NULL;
+    }
+    return NULL;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The totals only have a thread's counts once it flushes them, which it does when it exits.
+static void IAITestCountsAllocations(void) {
+    unsigned sizeClass = IAITestSizeClassOfBlocks();
+    IAIAllocationCounts firstCounts;
+    IAIAllocationCountersRead(&firstCounts);
+
+    int64_t numberOfAllocations = 0;
+    pthread_t thread;
+    pthread_create(&thread, NULL, IAITestAllocateBlocks, &numberOfAllocations);
+    pthread_join(thread, NULL);
+    IAITestExpect(kNumberOfBlocks == numberOfAllocations,
+                  "the thread counts each of its allocations once");
+
+    IAIAllocationCounts counts;
+    IAIAllocationCountersRead(&counts);
+    IAITestExpect(kNumberOfBlocks == (counts.numberOfAllocationsBySizeClass[sizeClass]
+                                      - firstCounts.numberOfAllocationsBySizeClass[sizeClass]),
+                  "the totals have the allocations of the thread in the size class of the blocks");
+    IAITestExpect(counts.numberOfAllocations - firstCounts.numberOfAllocations
+                  >= kNumberOfBlocks,
+                  "the totals have every allocation of the thread");
+    IAITestExpect(counts.bytesAllocated - firstCounts.bytesAllocated
+                  >= (int64_t)kNumberOfBlocks * kBlockSize,
+                  "the totals have the bytes of the blocks");
+    IAITestExpect(counts.numberOfFrees - firstCounts.numberOfFrees >= kNumberOfBlocks
+                  && counts.bytesFreed - firstCounts.bytesFreed
+                  >= (int64_t)kNumberOfBlocks * kBlockSize,
+                  "the totals have the frees of the blocks");
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestCountsReallocations(void) {
+    int64_t firstCount = IAIAllocationCountersCurrentThreadAllocations();
+    sBlocks[0] = malloc(16);
+    sBlocks[0] = realloc(sBlocks[0], kBlockSize);
+    IAITestExpect(2 == IAIAllocationCountersCurrentThreadAllocations() - firstCount,
+                  "a reallocation is counted as an allocation");
+    free(sBlocks[0]);
+    sBlocks[0] = NULL;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestStopsCounting(void) {
+    IAIAllocationCountersUninstall();
+    IAITestExpect(!IAIAllocationCountersAreInstalled(), "the counters are uninstalled");
+    IAITestExpect(0 == IAIAllocationCountersCurrentThreadAllocations(),
+                  "a thread has no count while the counters are uninstalled");
+
+    IAIAllocationCounts firstCounts;
+    IAIAllocationCountersRead(&firstCounts);
+    int64_t numberOfAllocations = 0;
+    pthread_t thread;
+    pthread_create(&thread, NULL, IAITestAllocateBlocks, &numberOfAllocations);
+    pthread_join(thread, NULL);
+    IAIAllocationCounts counts;
+    IAIAllocationCountersRead(&counts);
+    unsigned sizeClass = IAITestSizeClassOfBlocks();
+    IAITestExpect(counts.numberOfAllocationsBySizeClass[sizeClass]
+                  == firstCounts.numberOfAllocationsBySizeClass[sizeClass],
+                  "nothing is counted once the counters are uninstalled");
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int main(void) {
+    if (!IAIAllocationCountersInstall()) {
+        fprintf(stderr, "the allocator can't be hooked\n");
+        return 1;
+    }
+    IAITestExpect(IAIAllocationCountersAreInstalled(), "the counters are installed");
+    IAITestCountsAllocations();
+    IAITestCountsReallocations();
+    IAITestStopsCounting();
+    if (sNumberOfFailures > 0) {
+        fprintf(stderr, "%d failed\n", sNumberOfFailures);
+        return 1;
+    }
+    printf("passed\n");
+    return 0;
+}
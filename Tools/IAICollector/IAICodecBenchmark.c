@@ -0,0 +1,165 @@
+//
+//  IAICodecBenchmark.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+//  Measures the size and speed of the sample codec that IAISampleBlockStore keeps device logs
+//  in, and checks that every sample decodes to what was encoded.
+//
+//  The samples are synthetic heartbeats: timestamps 500 ms apart with a few milliseconds of
+//  jitter, free memory that churns by whole pages, disk space that changes rarely and a
+//  battery that drains slowly. They are encoded in blocks of 120, as the store seals them.
+//
+//      iai-codec-bench [number of samples]
+//
+
+#include "IAISampleCodec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define kDefaultNumberOfSamples 240000
+#define kSamplesPerBlock 120
+#define kNumberOfColumns 6
+#define kPageSize 4096
+
+// What a sample costs without the codec: a timestamp and the columns, packed.
+#define kPackedSampleLength (sizeof(int64_t) + kNumberOfColumns * sizeof(uint64_t))
+
+typedef struct {
+    int64_t time;
+    uint64_t values[kNumberOfColumns];
+} IAIBenchmarkSample;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static uint32_t IAIBenchmarkRandom(uint32_t* state) {
+    // xorshift32
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static double IAIBenchmarkNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAIBenchmarkGenerate(IAIBenchmarkSample* samples, size_t count) {
+    uint32_t state = 2012;
+    int64_t time = 1350400000000ll;
+    uint64_t freeMemory = 180ull * 1024 * 1024;
+    uint64_t freeDiskSpace = 9ull * 1024 * 1024 * 1024;
+    double batteryLevel = 1.0;
+    for (size_t ix = 0; ix < count; ++ix) {
+        time += 500 + (int64_t)(IAIBenchmarkRandom(&state) % 7) - 3;
+        freeMemory += ((int64_t)(IAIBenchmarkRandom(&state) % 65) - 32) * kPageSize;
+        if (0 == IAIBenchmarkRandom(&state) % 50) {
+            freeDiskSpace -= (IAIBenchmarkRandom(&state) % 256) * kPageSize;
+        }
+        if (0 == ix % 600) {
+            batteryLevel = (batteryLevel > 0.05) ? batteryLevel - 0.01 : 1.0;
+        }
+        samples[ix].time = time;
+        samples[ix].values[0] = freeMemory;
+        samples[ix].values[1] = 512ull * 1024 * 1024;
+        samples[ix].values[2] = freeDiskSpace;
+        samples[ix].values[3] = 16ull * 1024 * 1024 * 1024;
+        samples[ix].values[4] = IAISampleCodecBitsFromDouble(batteryLevel);
+        samples[ix].values[5] = 1;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[]) {
+    size_t count = (argc > 1) ? (size_t)strtoul(argv[1], NULL, 10) : kDefaultNumberOfSamples;
+    size_t numberOfBlocks = (count + kSamplesPerBlock - 1) / kSamplesPerBlock;
+    if (0 == count) {
+        fprintf(stderr, "usage: %s [number of samples]\n", argv[0]);
+        return 2;
+    }
+
+    IAIBenchmarkSample* samples = malloc(count * sizeof(IAIBenchmarkSample));
+    uint8_t** blocks = calloc(numberOfBlocks, sizeof(uint8_t *));
+    size_t* blockLengths = calloc(numberOfBlocks, sizeof(size_t));
+    if (NULL == samples || NULL == blocks || NULL == blockLengths) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    IAIBenchmarkGenerate(samples, count);
+
+    IAISampleEncoder encoder;
+    memset(&encoder, 0, sizeof(encoder));
+    size_t encodedLength = 0;
+    double encodeStart = IAIBenchmarkNow();
+    for (size_t block = 0; block < numberOfBlocks; ++block) {
+        IAISampleEncoderReset(&encoder, kNumberOfColumns);
+        size_t end = (block + 1) * kSamplesPerBlock;
+        for (size_t ix = block * kSamplesPerBlock; ix < end && ix < count; ++ix) {
+            if (!IAISampleEncoderAppend(&encoder, samples[ix].time, samples[ix].values)) {
+                fprintf(stderr, "out of memory\n");
+                return 1;
+            }
+        }
+        blockLengths[block] = IAISampleEncoderByteLength(&encoder);
+        blocks[block] = malloc(blockLengths[block]);
+        if (NULL == blocks[block]) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        memcpy(blocks[block], encoder.buffer, blockLengths[block]);
+        encodedLength += blockLengths[block];
+    }
+    double encodeTime = IAIBenchmarkNow() - encodeStart;
+    IAISampleEncoderDestroy(&encoder);
+
+    size_t numberOfMismatches = 0;
+    double decodeStart = IAIBenchmarkNow();
+    for (size_t block = 0; block < numberOfBlocks; ++block) {
+        size_t first = block * kSamplesPerBlock;
+        size_t blockCount = (count - first < kSamplesPerBlock) ? count - first : kSamplesPerBlock;
+        IAISampleDecoder decoder;
+        IAISampleDecoderInit(&decoder, blocks[block], blockLengths[block], blockCount,
+                             kNumberOfColumns);
+        int64_t time;
+        uint64_t values[IAISampleCodecMaxColumns];
+        for (size_t ix = first; IAISampleDecoderNext(&decoder, &time, values); ++ix) {
+            if (ix >= count || time != samples[ix].time
+                || 0 != memcmp(values, samples[ix].values, sizeof(samples[ix].values))) {
+                ++numberOfMismatches;
+            }
+        }
+    }
+    double decodeTime = IAIBenchmarkNow() - decodeStart;
+
+    double bytesPerSample = (double)encodedLength / (double)count;
+    printf("samples           %zu in %zu blocks of %d\n", count, numberOfBlocks,
+           kSamplesPerBlock);
+    printf("encoded bytes     %zu (%.2f bytes/sample)\n", encodedLength, bytesPerSample);
+    printf("packed bytes      %zu (%.1fx larger)\n", count * kPackedSampleLength,
+           (double)kPackedSampleLength / bytesPerSample);
+    printf("encode            %.2f M samples/s\n", (double)count / encodeTime / 1e6);
+    printf("decode            %.2f M samples/s\n", (double)count / decodeTime / 1e6);
+    printf("round trip        %s\n", (0 == numberOfMismatches) ? "lossless" : "MISMATCHED");
+
+    for (size_t block = 0; block < numberOfBlocks; ++block) {
+        free(blocks[block]);
+    }
+    free(blockLengths);
+    free(blocks);
+    free(samples);
+    return (0 == numberOfMismatches) ? 0 : 1;
+}
@@ -0,0 +1,271 @@
+//
+//  IAICollector.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+//  A reference collector for the telemetry stream of IAITelemetryExporter.
+//
+//  The collector listens on a UNIX domain socket or a loopback TCP port, accepts one app at a
+//  time, and appends every frame it receives to a recording file unchanged. A recording is
+//  itself a valid stream, so it can be printed later with -r.
+//
+//      iai-collector -u /tmp/overview.sock -o session.iait
+//      iai-collector -p 7000 -o session.iait -v
+//      iai-collector -r session.iait
+//
+
+#include "IAITelemetryFrame.h"
+#include "IAITelemetryPrint.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define kReadBufferLength (64 * 1024)
+
+static volatile sig_atomic_t sShouldStop = 0;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAICollectorHandleSignal(int signal) {
+    (void)signal;
+    sShouldStop = 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAICollectorUsage(void) {
+    fprintf(stderr,
+            "usage: iai-collector (-u socket-path | -p port) [-o recording] [-v]\n"
+            "       iai-collector -r recording\n"
+            "\n"
+            "  -u  listen on a UNIX domain socket\n"
+            "  -p  listen on a TCP port of 127.0.0.1\n"
+            "  -o  append the received frames to a recording file\n"
+            "  -v  print each frame as it is received\n"
+            "  -r  print the frames of a recording\n");
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Handles every whole frame at the start of the buffer. Returns the number of bytes consumed,
+// or -1 if the stream is corrupt.
+static long IAICollectorConsumeFrames(const uint8_t* bytes, size_t length,
+                                      FILE* recording, int verbose) {
+    size_t offset = 0;
+    for (;;) {
+        IAITelemetryFrameHeader header;
+        IAITelemetryReader payload;
+        long frameLength = IAITelemetryParseFrame(bytes + offset, length - offset,
+                                                  &header, &payload);
+        if (frameLength < 0) {
+            return -1;
+        }
+        if (0 == frameLength) {
+            return (long)offset;
+        }
+
+        if (NULL != recording) {
+            fwrite(bytes + offset, 1, (size_t)frameLength, recording);
+        }
+        if (verbose) {
+            IAITelemetryPrintFrame(stdout, &header, &payload);
+
+        } else if (IAITelemetryFrameDrops == header.type) {
+            IAITelemetryPrintFrame(stderr, &header, &payload);
+        }
+        offset += (size_t)frameLength;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Reads frames from a file descriptor until it is closed.
+static int IAICollectorReadStream(int fd, FILE* recording, int verbose) {
+    uint8_t* buffer = malloc(kReadBufferLength);
+    size_t length = 0;
+    int status = 0;
+    if (NULL == buffer) {
+        return -1;
+    }
+
+    while (!sShouldStop) {
+        ssize_t count = read(fd, buffer + length, kReadBufferLength - length);
+        if (count < 0 && EINTR == errno) {
+            continue;
+        }
+        if (count <= 0) {
+            status = (0 == count) ? 0 : -1;
+            break;
+        }
+        length += (size_t)count;
+
+        long consumed = IAICollectorConsumeFrames(buffer, length, recording, verbose);
+        if (consumed < 0) {
+            fprintf(stderr, "iai-collector: the stream is corrupt\n");
+            status = -1;
+            break;
+        }
+        memmove(buffer, buffer + consumed, length - (size_t)consumed);
+        length -= (size_t)consumed;
+        if (NULL != recording) {
+            fflush(recording);
+        }
+    }
+    if (length > 0 && 0 == status) {
+        fprintf(stderr, "iai-collector: the stream ended in the middle of a frame\n");
+    }
+    free(buffer);
+    return status;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+#pragma mark Listening
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static int IAICollectorListen(const char* socketPath, int port) {
+    int fd = -1;
+    if (NULL != socketPath) {
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (strlen(socketPath) >= sizeof(address.sun_path)) {
+            fprintf(stderr, "iai-collector: the socket path is too long\n");
+            return -1;
+        }
+        strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+        unlink(socketPath);
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+            perror("iai-collector: bind");
+            return -1;
+        }
+
+    } else {
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons((uint16_t)port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        int reuse = 1;
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd >= 0) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        }
+        if (fd < 0 || bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+            perror("iai-collector: bind");
+            return -1;
+        }
+    }
+
+    if (listen(fd, 1) != 0) {
+        perror("iai-collector: listen");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static int IAICollectorPrintRecording(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (NULL == file) {
+        perror("iai-collector: open");
+        return 1;
+    }
+    int status = IAICollectorReadStream(fileno(file), NULL, 1);
+    fclose(file);
+    return (0 == status) ? 0 : 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[]) {
+    const char* socketPath = NULL;
+    const char* recordingPath = NULL;
+    const char* replayPath = NULL;
+    int port = 0;
+    int verbose = 0;
+
+    int option;
+    while ((option = getopt(argc, argv, "u:p:o:r:vh")) != -1) {
+        switch (option) {
+            case 'u': socketPath = optarg; break;
+            case 'p': port = atoi(optarg); break;
+            case 'o': recordingPath = optarg; break;
+            case 'r': replayPath = optarg; break;
+            case 'v': verbose = 1; break;
+            default: IAICollectorUsage(); return 2;
+        }
+    }
+
+    if (NULL != replayPath) {
+        return IAICollectorPrintRecording(replayPath);
+    }
+    if ((NULL == socketPath) == (0 == port) || port < 0 || port > 65535) {
+        IAICollectorUsage();
+        return 2;
+    }
+
+    FILE* recording = NULL;
+    if (NULL != recordingPath) {
+        recording = fopen(recordingPath, "ab");
+        if (NULL == recording) {
+            perror("iai-collector: open");
+            return 1;
+        }
+    }
+
+    // Let accept and read return so that the recording is closed cleanly.
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = IAICollectorHandleSignal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    int listener = IAICollectorListen(socketPath, port);
+    if (listener < 0) {
+        return 1;
+    }
+
+    while (!sShouldStop) {
+        int connection = accept(listener, NULL, NULL);
+        if (connection < 0) {
+            if (EINTR != errno) {
+                perror("iai-collector: accept");
+                break;
+            }
+            continue;
+        }
+        fprintf(stderr, "iai-collector: app connected\n");
+        IAICollectorReadStream(connection, recording, verbose);
+        close(connection);
+        fprintf(stderr, "iai-collector: app disconnected\n");
+    }
+
+    close(listener);
+    if (NULL != socketPath) {
+        unlink(socketPath);
+    }
+    if (NULL != recording) {
+        fclose(recording);
+    }
+    return 0;
+}
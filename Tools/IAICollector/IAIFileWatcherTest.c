@@ -0,0 +1,227 @@
+//
+//  IAIFileWatcherTest.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+//  Checks the watcher of the platform it is built on, kqueue on OS X and inotify on Linux, in a
+//  temporary directory: that entries added to a watched directory are reported with its watch,
+//  that files written in place are reported by their own watch and, where the platform does so,
+//  by their directory's, that subdirectories and removed watches report nothing, and that a
+//  watched directory that is removed is reported:
+//
+//      iai-file-watcher-test
+//
+
+#include "IAIFileWatcher.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define kMaximumNumberOfChanges 64
+
+typedef struct {
+    int watches[kMaximumNumberOfChanges];
+    int count;
+} IAITestChanges;
+
+static int sNumberOfFailures = 0;
+// Leaves room in a path for the names of the test's files.
+static char sDirectory[PATH_MAX / 2];
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestExpect(int condition, const char* description) {
+    if (!condition) {
+        fprintf(stderr, "FAILED: %s\n", description);
+        ++sNumberOfFailures;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestPath(char* path, const char* name) {
+    snprintf(path, PATH_MAX, "%s/%s", sDirectory, name);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestAppend(const char* path, const char* text) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd >= 0) {
+        if (write(fd, text, strlen(text)) < 0) {
+            perror(path);
+        }
+        close(fd);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestAddChange(int watch, void* context) {
+    IAITestChanges* changes = context;
+    if (changes->count < kMaximumNumberOfChanges) {
+        changes->watches[changes->count] = watch;
+    }
+    ++changes->count;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Returns the number of changes and whether any was reported with the watch.
+static int IAITestReadChanges(IAIFileWatcher* watcher, int watch, int* didReportWatch) {
+    IAITestChanges changes = { { 0 }, 0 };
+    int result = IAIFileWatcherReadChanges(watcher, IAITestAddChange, &changes);
+    *didReportWatch = 0;
+    for (int ix = 0; ix < changes.count && ix < kMaximumNumberOfChanges; ++ix) {
+        if (changes.watches[ix] == watch) {
+            *didReportWatch = 1;
+        }
+    }
+    IAITestExpect(result == changes.count || IAIFileWatcherOverflow == result,
+                  "the number of changes is the number of calls");
+    return result;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestReportsAddedEntries(IAIFileWatcher* watcher) {
+    int didReport;
+    int watch = IAIFileWatcherAddDirectory(watcher, sDirectory);
+    IAITestExpect(watch >= 0, "the directory is watched");
+    IAITestExpect(0 == IAITestReadChanges(watcher, watch, &didReport),
+                  "nothing is reported before anything changes");
+
+    char path[PATH_MAX];
+    IAITestPath(path, "added");
+    IAITestAppend(path, "added");
+    IAITestExpect(IAITestReadChanges(watcher, watch, &didReport) > 0 && didReport,
+                  "an added file is reported with the directory's watch");
+    IAITestExpect(0 == IAITestReadChanges(watcher, watch, &didReport),
+                  "a change is reported once");
+
+    unlink(path);
+    IAITestExpect(IAITestReadChanges(watcher, watch, &didReport) > 0 && didReport,
+                  "a removed file is reported with the directory's watch");
+    IAIFileWatcherRemoveWatch(watcher, watch);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The storage monitor watches the files that grow where their directory's watch misses them.
+static void IAITestReportsWrittenFiles(IAIFileWatcher* watcher) {
+    int didReport;
+    char path[PATH_MAX];
+    IAITestPath(path, "written");
+    IAITestAppend(path, "first");
+    int watch = IAIFileWatcherAddDirectory(watcher, sDirectory);
+    IAITestReadChanges(watcher, watch, &didReport);
+
+    IAITestAppend(path, "second");
+    IAITestReadChanges(watcher, watch, &didReport);
+    IAITestExpect(didReport == IAIFileWatcherReportsFileWrites,
+                  "a file written in place is reported by its directory as the platform says");
+
+    int fileWatch = IAIFileWatcherAddFile(watcher, path);
+    IAITestExpect(fileWatch >= 0, "the file is watched");
+    IAITestAppend(path, "third");
+    IAITestReadChanges(watcher, fileWatch, &didReport);
+    IAITestExpect(didReport, "a file written in place is reported with its own watch");
+
+    IAIFileWatcherRemoveWatch(watcher, fileWatch);
+    IAIFileWatcherRemoveWatch(watcher, watch);
+    IAITestReadChanges(watcher, watch, &didReport);
+    unlink(path);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestIgnoresSubdirectories(IAIFileWatcher* watcher) {
+    int didReport;
+    char subdirectoryPath[PATH_MAX];
+    IAITestPath(subdirectoryPath, "subdirectory");
+    mkdir(subdirectoryPath, 0755);
+    int watch = IAIFileWatcherAddDirectory(watcher, sDirectory);
+
+    char path[PATH_MAX];
+    IAITestPath(path, "subdirectory/file");
+    IAITestAppend(path, "file");
+    IAITestExpect(0 == IAITestReadChanges(watcher, watch, &didReport),
+                  "a file added to a subdirectory isn't reported");
+
+    unlink(path);
+    IAIFileWatcherRemoveWatch(watcher, watch);
+    rmdir(subdirectoryPath);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestIgnoresRemovedWatches(IAIFileWatcher* watcher) {
+    int didReport;
+    int watch = IAIFileWatcherAddDirectory(watcher, sDirectory);
+    IAIFileWatcherRemoveWatch(watcher, watch);
+
+    char path[PATH_MAX];
+    IAITestPath(path, "unwatched");
+    IAITestAppend(path, "unwatched");
+    IAITestExpect(0 == IAITestReadChanges(watcher, watch, &didReport),
+                  "a directory whose watch was removed reports nothing");
+    unlink(path);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestReportsRemovedDirectories(IAIFileWatcher* watcher) {
+    int didReport;
+    char path[PATH_MAX];
+    IAITestPath(path, "removed");
+    mkdir(path, 0755);
+    int watch = IAIFileWatcherAddDirectory(watcher, path);
+    IAITestExpect(watch >= 0, "the directory is watched");
+
+    rmdir(path);
+    IAITestReadChanges(watcher, watch, &didReport);
+    IAITestExpect(didReport, "a removed directory is reported with its watch");
+    // The watch may already be gone.
+    IAIFileWatcherRemoveWatch(watcher, watch);
+    IAITestReadChanges(watcher, watch, &didReport);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int main(void) {
+    const char* temporaryDirectory = getenv("TMPDIR");
+    snprintf(sDirectory, sizeof(sDirectory), "%s/iai-file-watcher-XXXXXX",
+             (NULL != temporaryDirectory) ? temporaryDirectory : "/tmp");
+    if (NULL == mkdtemp(sDirectory)) {
+        perror(sDirectory);
+        return 1;
+    }
+    IAIFileWatcher* watcher = IAIFileWatcherCreate();
+    if (NULL == watcher) {
+        fprintf(stderr, "no watcher\n");
+        rmdir(sDirectory);
+        return 1;
+    }
+
+    IAITestReportsAddedEntries(watcher);
+    IAITestReportsWrittenFiles(watcher);
+    IAITestIgnoresSubdirectories(watcher);
+    IAITestIgnoresRemovedWatches(watcher);
+    IAITestReportsRemovedDirectories(watcher);
+
+    IAIFileWatcherDestroy(watcher);
+    rmdir(sDirectory);
+    if (sNumberOfFailures > 0) {
+        fprintf(stderr, "%d failed\n", sNumberOfFailures);
+        return 1;
+    }
+    printf("passed\n");
+    return 0;
+}
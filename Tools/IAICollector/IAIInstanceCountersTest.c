@@ -0,0 +1,233 @@
+//
+//  IAIInstanceCountersTest.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+//  Checks that IAIInstanceCountObjectDeallocation charges each object to the type it was
+//  allocated as, the way IAIInstanceTracker counts Objective-C objects: an object whose class
+//  changes while it lives, as key-value observing does, is uncounted from its first type, and
+//  the deallocation of an object that was allocated before counting started is ignored. Also
+//  checks that addresses can be reused, that the table holds many objects from many threads, and
+//  that forgetting the objects, as the tracker does when it stops, uncounts them:
+//
+//      iai-instance-counters-test
+//
+
+#include "IAIInstanceCounters.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define kNumberOfObjects 100000
+#define kNumberOfThreads 8
+#define kNumberOfObjectsPerThread 20000
+
+static int sNumberOfFailures = 0;
+
+static IAIInstanceType sModelType = IAIInstanceTypeMake("Model");
+static IAIInstanceType sObservedModelType = IAIInstanceTypeMake("NSKVONotifying_Model");
+static IAIInstanceType sTileType = IAIInstanceTypeMake("Tile");
+static IAIInstanceType sThreadType = IAIInstanceTypeMake("Thread");
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestExpect(int condition, const char* description) {
+    if (!condition) {
+        fprintf(stderr, "FAILED: %s\n", description);
+        ++sNumberOfFailures;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The live count of a type, or -1 if the type hasn't been counted.
+static int64_t IAITestNumberOfLiveInstances(const IAIInstanceType* type) {
+    if (type->index < 0) {
+        return -1;
+    }
+    IAIInstanceCounts counts;
+    if (!IAIInstanceCountersReadType((unsigned)type->index, &counts)) {
+        return -1;
+    }
+    return counts.numberOfAllocations - counts.numberOfDeallocations;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The tracker looks a type up by the object's class when it is allocated. Key-value observing
+// then swaps the class for a subclass, which the tracker may well be tracking too, but the
+// deallocation must still be charged to the class the object was allocated as.
+static void IAITestChargesTheAllocatedType(void) {
+    void* object = calloc(1, 16);
+    IAITestExpect(IAIInstanceCountObjectAllocation(&sModelType, object),
+                  "the allocation of a model is counted");
+    IAIInstanceCountAllocation(&sObservedModelType);
+    IAIInstanceCountDeallocation(&sObservedModelType);
+
+    IAITestExpect(IAIInstanceCountObjectDeallocation(object),
+                  "the deallocation of an observed model is counted");
+    free(object);
+    IAITestExpect(0 == IAITestNumberOfLiveInstances(&sModelType),
+                  "the observed model is uncounted from the type it was allocated as");
+    IAITestExpect(0 == IAITestNumberOfLiveInstances(&sObservedModelType),
+                  "the observing subclass isn't charged for the model");
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Objects that were allocated before the tracker started die like any other.
+static void IAITestIgnoresUncountedObjects(void) {
+    void* counted = calloc(1, 16);
+    void* uncounted = calloc(1, 16);
+    IAIInstanceCountObjectAllocation(&sModelType, counted);
+
+    IAITestExpect(!IAIInstanceCountObjectDeallocation(uncounted),
+                  "the deallocation of an object allocated before counting isn't counted");
+    IAITestExpect(1 == IAITestNumberOfLiveInstances(&sModelType),
+                  "an uncounted deallocation leaves the live count alone");
+    IAITestExpect(IAIInstanceCountObjectDeallocation(counted),
+                  "the deallocation of a counted object is counted");
+    IAITestExpect(!IAIInstanceCountObjectDeallocation(counted),
+                  "an object is uncounted only once");
+    IAITestExpect(0 == IAITestNumberOfLiveInstances(&sModelType),
+                  "the live count never goes negative");
+    free(counted);
+    free(uncounted);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// An object that was freed without its deallocation being counted leaves its address behind.
+static void IAITestReusesAddresses(void) {
+    void* object = calloc(1, 16);
+    IAIInstanceCountObjectAllocation(&sModelType, object);
+    IAIInstanceCountObjectAllocation(&sTileType, object);
+    IAITestExpect(0 == IAITestNumberOfLiveInstances(&sModelType),
+                  "a reused address uncounts the object that was freed there");
+    IAITestExpect(1 == IAITestNumberOfLiveInstances(&sTileType),
+                  "a reused address counts the new object");
+    IAIInstanceCountObjectDeallocation(object);
+    IAITestExpect(0 == IAITestNumberOfLiveInstances(&sTileType),
+                  "the new object is uncounted from its own type");
+    free(object);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestHoldsManyObjects(void) {
+    void** objects = malloc(kNumberOfObjects * sizeof(void *));
+    unsigned numberOfCounted = 0;
+    for (unsigned ix = 0; ix < kNumberOfObjects; ++ix) {
+        objects[ix] = calloc(1, 16);
+        numberOfCounted += (unsigned)IAIInstanceCountObjectAllocation(&sTileType, objects[ix]);
+    }
+    IAITestExpect(kNumberOfObjects == numberOfCounted, "the table grows for every object");
+    IAITestExpect(kNumberOfObjects == IAITestNumberOfLiveInstances(&sTileType),
+                  "every live object is counted");
+
+    // Every other object first, so that the removals leave gaps in the probe sequences.
+    unsigned numberOfUncounted = 0;
+    for (unsigned ix = 0; ix < kNumberOfObjects; ix += 2) {
+        numberOfUncounted += (unsigned)IAIInstanceCountObjectDeallocation(objects[ix]);
+    }
+    for (unsigned ix = 1; ix < kNumberOfObjects; ix += 2) {
+        numberOfUncounted += (unsigned)IAIInstanceCountObjectDeallocation(objects[ix]);
+    }
+    IAITestExpect(kNumberOfObjects == numberOfUncounted, "every object is found again");
+    IAITestExpect(0 == IAITestNumberOfLiveInstances(&sTileType), "every object is uncounted");
+
+    for (unsigned ix = 0; ix < kNumberOfObjects; ++ix) {
+        free(objects[ix]);
+    }
+    free(objects);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Each thread keeps a window of live objects, so that its allocations and deallocations
+// interleave with those of the other threads on the same stripes.
+static void* IAITestThreadMain(void* context) {
+    unsigned* numberOfMissed = context;
+    void* objects[64];
+    memset(objects, 0, sizeof(objects));
+    for (unsigned ix = 0; ix < kNumberOfObjectsPerThread; ++ix) {
+        void** slot = &objects[ix % 64];
+        if (NULL != *slot) {
+            *numberOfMissed += (unsigned)!IAIInstanceCountObjectDeallocation(*slot);
+            free(*slot);
+        }
+        *slot = calloc(1, 16);
+        *numberOfMissed += (unsigned)!IAIInstanceCountObjectAllocation(&sThreadType, *slot);
+    }
+    for (unsigned ix = 0; ix < 64; ++ix) {
+        *numberOfMissed += (unsigned)!IAIInstanceCountObjectDeallocation(objects[ix]);
+        free(objects[ix]);
+    }
+    return NULL;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestCountsFromManyThreads(void) {
+    pthread_t threads[kNumberOfThreads];
+    unsigned numberOfMissed[kNumberOfThreads];
+    unsigned numberOfStarted = 0;
+    for (unsigned ix = 0; ix < kNumberOfThreads; ++ix) {
+        numberOfMissed[ix] = 0;
+        if (0 == pthread_create(&threads[ix], NULL, IAITestThreadMain, &numberOfMissed[ix])) {
+            ++numberOfStarted;
+        }
+    }
+    IAITestExpect(kNumberOfThreads == numberOfStarted, "every thread starts");
+
+    unsigned totalMissed = 0;
+    for (unsigned ix = 0; ix < numberOfStarted; ++ix) {
+        pthread_join(threads[ix], NULL);
+        totalMissed += numberOfMissed[ix];
+    }
+    IAITestExpect(0 == totalMissed, "no object is lost between threads");
+    IAITestExpect(0 == IAITestNumberOfLiveInstances(&sThreadType),
+                  "every object of every thread is uncounted");
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestForgetsObjects(void) {
+    void* objects[3];
+    for (unsigned ix = 0; ix < 3; ++ix) {
+        objects[ix] = calloc(1, 16);
+        IAIInstanceCountObjectAllocation((0 == ix) ? &sModelType : &sTileType, objects[ix]);
+    }
+    IAIInstanceForgetObjects();
+    IAITestExpect(0 == IAITestNumberOfLiveInstances(&sModelType)
+                  && 0 == IAITestNumberOfLiveInstances(&sTileType),
+                  "forgotten objects are uncounted from their types");
+    IAITestExpect(!IAIInstanceCountObjectDeallocation(objects[0]),
+                  "the deallocation of a forgotten object isn't counted");
+    IAITestExpect(0 == IAITestNumberOfLiveInstances(&sModelType),
+                  "a forgotten object is uncounted only once");
+    for (unsigned ix = 0; ix < 3; ++ix) {
+        free(objects[ix]);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int main(void) {
+    IAITestChargesTheAllocatedType();
+    IAITestIgnoresUncountedObjects();
+    IAITestReusesAddresses();
+    IAITestHoldsManyObjects();
+    IAITestCountsFromManyThreads();
+    IAITestForgetsObjects();
+    if (sNumberOfFailures > 0) {
+        fprintf(stderr, "%d failed\n", sNumberOfFailures);
+        return 1;
+    }
+    printf("passed\n");
+    return 0;
+}
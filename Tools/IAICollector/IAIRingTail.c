@@ -0,0 +1,253 @@
+//
+//  IAIRingTail.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+//  Prints the records of a region written by IAISharedMemoryExporter.
+//
+//  The region is mapped read-only and every record is read in place. Each record is formatted
+//  straight from the mapping and only printed if its slot was not overwritten in the meantime.
+//
+//      iai-ring-tail ~/Library/Developer/CoreSimulator/.../tmp/overview.iais
+//      iai-ring-tail -f overview.iais
+//
+
+#include "IAISharedRing.h"
+#include "IAITelemetryFrame.h"
+#include "IAITelemetryPrint.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define kPollInterval 100000  // Microseconds.
+#define kLineLength 1024
+
+// A record that is claimed but never finished, because its writer was killed, is skipped
+// after this many polls.
+#define kMaximumPollsForUnfinishedRecord 10
+
+typedef struct {
+    int64_t time;
+    char text[kLineLength];
+} IAIRingTailLine;
+
+typedef struct {
+    const void* region;
+    size_t length;
+    ino_t inode;
+    uint64_t nextSequence[IAISharedRegionMaxRings];
+    unsigned pollsWaiting[IAISharedRegionMaxRings];
+} IAIRingTail;
+
+static volatile sig_atomic_t sShouldStop = 0;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAIRingTailHandleSignal(int signal) {
+    (void)signal;
+    sShouldStop = 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static int IAIRingTailCompareLines(const void* a, const void* b) {
+    int64_t timeA = ((const IAIRingTailLine *)a)->time;
+    int64_t timeB = ((const IAIRingTailLine *)b)->time;
+    return (timeA > timeB) - (timeA < timeB);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static int IAIRingTailMap(IAIRingTail* tail, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < IAISharedRegionHeaderLength) {
+        close(fd);
+        return 0;
+    }
+    void* region = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == region) {
+        return 0;
+    }
+    if (!IAISharedRegionIsValid(region, (size_t)info.st_size)) {
+        munmap(region, (size_t)info.st_size);
+        return 0;
+    }
+
+    memset(tail, 0, sizeof(*tail));
+    tail->region = region;
+    tail->length = (size_t)info.st_size;
+    tail->inode = info.st_ino;
+
+    // Start with the oldest record that is still in each ring.
+    const IAISharedRegionHeader* header = region;
+    for (unsigned ix = 0; ix < header->ringCount; ++ix) {
+        uint64_t head = header->rings[ix].head;
+        uint64_t slotCount = header->rings[ix].slotCount;
+        tail->nextSequence[ix] = (head > slotCount) ? head - slotCount : 0;
+    }
+    return 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAIRingTailUnmap(IAIRingTail* tail) {
+    if (NULL != tail->region) {
+        munmap((void *)tail->region, tail->length);
+        tail->region = NULL;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Formats a record in place. Returns 0 if the record is not there or was overwritten.
+static int IAIRingTailFormatRecord(const IAIRingTail* tail, unsigned ringIndex,
+                                   uint64_t sequence, IAIRingTailLine* line) {
+    size_t length = 0;
+    const uint8_t* frame = IAISharedRingRecord(tail->region, ringIndex, sequence, &length);
+    if (NULL == frame) {
+        return 0;
+    }
+
+    IAITelemetryFrameHeader header;
+    IAITelemetryReader payload;
+    line->text[0] = '\0';
+    if (length > 0 && IAITelemetryParseFrame(frame, length, &header, &payload) > 0) {
+        FILE* file = fmemopen(line->text, sizeof(line->text), "w");
+        if (NULL != file) {
+            IAITelemetryPrintFrame(file, &header, &payload);
+            fclose(file);
+        }
+        line->time = header.time;
+    }
+    return IAISharedRingRecordIsIntact(tail->region, ringIndex, sequence);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Prints the records that were added since the last poll, in chronological order within the
+// poll.
+static void IAIRingTailPoll(IAIRingTail* tail) {
+    const IAISharedRegionHeader* header = tail->region;
+    size_t capacity = 0;
+    for (unsigned ix = 0; ix < header->ringCount; ++ix) {
+        capacity += header->rings[ix].slotCount;
+    }
+    IAIRingTailLine* lines = malloc(capacity * sizeof(IAIRingTailLine));
+    size_t count = 0;
+    if (NULL == lines) {
+        return;
+    }
+
+    for (unsigned ix = 0; ix < header->ringCount; ++ix) {
+        const IAISharedRingHeader* ring = &header->rings[ix];
+        uint64_t head = ring->head;
+        uint64_t sequence = tail->nextSequence[ix];
+        if (head - sequence > ring->slotCount) {
+            fprintf(stderr, "iai-ring-tail: lost %llu records of ring %u\n",
+                    (unsigned long long)(head - sequence - ring->slotCount), ix);
+            sequence = head - ring->slotCount;
+        }
+
+        for (; sequence < head; ++sequence) {
+            IAIRingTailLine* line = &lines[count];
+            if (IAIRingTailFormatRecord(tail, ix, sequence, line)) {
+                tail->pollsWaiting[ix] = 0;
+                if ('\0' != line->text[0]) {
+                    ++count;
+                }
+                continue;
+            }
+            if (ring->head - sequence > ring->slotCount) {
+                // Overwritten while we were reading; the next poll reports the loss.
+                break;
+            }
+            if (++tail->pollsWaiting[ix] < kMaximumPollsForUnfinishedRecord) {
+                // Still being written. Try again on the next poll.
+                break;
+            }
+            tail->pollsWaiting[ix] = 0;
+        }
+        tail->nextSequence[ix] = sequence;
+    }
+
+    qsort(lines, count, sizeof(IAIRingTailLine), IAIRingTailCompareLines);
+    for (size_t ix = 0; ix < count; ++ix) {
+        fputs(lines[ix].text, stdout);
+    }
+    fflush(stdout);
+    free(lines);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Whether the app has replaced the file with a new region.
+static int IAIRingTailFileWasReplaced(const IAIRingTail* tail, const char* path) {
+    struct stat info;
+    return (0 == stat(path, &info) && info.st_ino != tail->inode);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[]) {
+    int follow = 0;
+    int option;
+    while ((option = getopt(argc, argv, "fh")) != -1) {
+        switch (option) {
+            case 'f': follow = 1; break;
+            default:
+                fprintf(stderr, "usage: iai-ring-tail [-f] region-file\n"
+                        "\n"
+                        "  -f  keep printing records as they are added\n");
+                return 2;
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "usage: iai-ring-tail [-f] region-file\n");
+        return 2;
+    }
+    const char* path = argv[optind];
+
+    IAIRingTail tail;
+    if (!IAIRingTailMap(&tail, path)) {
+        fprintf(stderr, "iai-ring-tail: %s is not a region of version %d\n",
+                path, IAISharedRegionVersion);
+        return 1;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = IAIRingTailHandleSignal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    IAIRingTailPoll(&tail);
+    while (follow && !sShouldStop) {
+        usleep(kPollInterval);
+        if (IAIRingTailFileWasReplaced(&tail, path)) {
+            IAIRingTailUnmap(&tail);
+            if (!IAIRingTailMap(&tail, path)) {
+                continue;
+            }
+            fprintf(stderr, "iai-ring-tail: the app restarted\n");
+        }
+        if (NULL != tail.region) {
+            IAIRingTailPoll(&tail);
+        }
+    }
+
+    IAIRingTailUnmap(&tail);
+    return 0;
+}
@@ -0,0 +1,188 @@
+//
+//  IAISharedRingTest.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+//  Checks that the writers of a shared ring never publish a torn record: a writer that finds its
+//  slot still being written by a writer of an earlier lap, or already holding a later record,
+//  gives its record up, and the record of the earlier lap is still published intact. Then lets
+//  several threads lap a small ring while a reader checks every record that it finds intact:
+//
+//      iai-shared-ring-test
+//
+
+#include "IAISharedRing.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define kNumberOfSlots 4
+#define kFrameLength 64
+#define kNumberOfThreads 4
+#define kNumberOfRecordsPerThread 200000
+
+static int sNumberOfFailures = 0;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestExpect(int condition, const char* description) {
+    if (!condition) {
+        fprintf(stderr, "FAILED: %s\n", description);
+        ++sNumberOfFailures;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void* IAITestCreateRegion(void) {
+    IAISharedRingConfig config = { 1, kFrameLength, kNumberOfSlots };
+    void* region = calloc(1, IAISharedRegionLength(&config, 1));
+    if (NULL != region) {
+        IAISharedRegionInit(region, &config, 1, 1, 0);
+    }
+    return region;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Every byte of the frame of record n is n % 256.
+static void IAITestFillFrame(uint8_t* frame, uint64_t sequence) {
+    memset(frame, (int)(sequence & 0xff), kFrameLength);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// 1 if the record is intact and whole, 0 if it isn't there, -1 if it was published torn.
+static int IAITestReadRecord(const void* region, uint64_t sequence) {
+    size_t length = 0;
+    const uint8_t* frame = IAISharedRingRecord(region, 0, sequence, &length);
+    if (NULL == frame) {
+        return 0;
+    }
+    uint8_t bytes[kFrameLength];
+    size_t copiedLength = (length < kFrameLength) ? length : kFrameLength;
+    memcpy(bytes, frame, copiedLength);
+    if (!IAISharedRingRecordIsIntact(region, 0, sequence)) {
+        return 0;
+    }
+    if (kFrameLength != length) {
+        return -1;
+    }
+    for (size_t ix = 0; ix < kFrameLength; ++ix) {
+        if (bytes[ix] != (uint8_t)(sequence & 0xff)) {
+            return -1;
+        }
+    }
+    return 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static int IAITestWriteRecord(void* region, uint64_t* sequence) {
+    uint8_t* frame = IAISharedRingBeginWrite(region, 0, sequence);
+    if (NULL == frame) {
+        return 0;
+    }
+    IAITestFillFrame(frame, *sequence);
+    return IAISharedRingEndWrite(region, 0, *sequence, kFrameLength);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestGivesUpLappedRecords(void) {
+    void* region = IAITestCreateRegion();
+    IAISharedRingHeader* ring = &((IAISharedRegionHeader *)region)->rings[0];
+    uint64_t sequence;
+
+    // A writer of record 0 stalls while the other writers lap it.
+    uint64_t stalledSequence;
+    uint8_t* stalledFrame = IAISharedRingBeginWrite(region, 0, &stalledSequence);
+    IAITestExpect(NULL != stalledFrame && 0 == stalledSequence, "record 0 is claimed");
+    for (unsigned ix = 1; ix < kNumberOfSlots; ++ix) {
+        IAITestExpect(IAITestWriteRecord(region, &sequence), "the records of the lap are written");
+    }
+    IAITestExpect(NULL == IAISharedRingBeginWrite(region, 0, &sequence),
+                  "a record whose slot is still being written is given up");
+
+    IAITestFillFrame(stalledFrame, stalledSequence);
+    IAITestExpect(IAISharedRingEndWrite(region, 0, stalledSequence, kFrameLength),
+                  "the stalled record is published");
+    IAITestExpect(1 == IAITestReadRecord(region, stalledSequence),
+                  "the stalled record is intact");
+    IAITestExpect(0 == IAITestReadRecord(region, kNumberOfSlots),
+                  "the record that was given up is never finished");
+
+    // A writer that claimed a record and was lapped before it marked the slot finds the record
+    // of the next lap there.
+    uint64_t head = ring->head;
+    ring->head = head + kNumberOfSlots;
+    IAITestExpect(IAITestWriteRecord(region, &sequence), "the record of the next lap is written");
+    ring->head = head;
+    IAITestExpect(NULL == IAISharedRingBeginWrite(region, 0, &sequence),
+                  "a record whose slot holds a later record is given up");
+    IAITestExpect(1 == IAITestReadRecord(region, head + kNumberOfSlots),
+                  "the later record is left intact");
+    free(region);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void* IAITestWriteRecords(void* region) {
+    uint64_t sequence;
+    for (unsigned ix = 0; ix < kNumberOfRecordsPerThread; ++ix) {
+        IAITestWriteRecord(region, &sequence);
+    }
+    return NULL;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestNeverPublishesTornRecords(void) {
+    void* region = IAITestCreateRegion();
+    IAISharedRingHeader* ring = &((IAISharedRegionHeader *)region)->rings[0];
+    pthread_t threads[kNumberOfThreads];
+    for (unsigned ix = 0; ix < kNumberOfThreads; ++ix) {
+        pthread_create(&threads[ix], NULL, IAITestWriteRecords, region);
+    }
+
+    unsigned long long numberOfIntactRecords = 0;
+    unsigned long long numberOfTornRecords = 0;
+    while (ring->head < (uint64_t)kNumberOfThreads * kNumberOfRecordsPerThread) {
+        uint64_t head = ring->head;
+        uint64_t first = (head > kNumberOfSlots) ? head - kNumberOfSlots : 0;
+        for (uint64_t sequence = first; sequence < head; ++sequence) {
+            int result = IAITestReadRecord(region, sequence);
+            numberOfIntactRecords += (result > 0);
+            numberOfTornRecords += (result < 0);
+        }
+    }
+    for (unsigned ix = 0; ix < kNumberOfThreads; ++ix) {
+        pthread_join(threads[ix], NULL);
+    }
+
+    uint64_t head = ring->head;
+    for (uint64_t sequence = head - kNumberOfSlots; sequence < head; ++sequence) {
+        numberOfTornRecords += (IAITestReadRecord(region, sequence) < 0);
+    }
+    IAITestExpect(0 == numberOfTornRecords, "no torn record is published");
+    printf("read %llu intact records while %d threads wrote %d each\n",
+           numberOfIntactRecords, kNumberOfThreads, kNumberOfRecordsPerThread);
+    free(region);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int main(void) {
+    IAITestGivesUpLappedRecords();
+    IAITestNeverPublishesTornRecords();
+    if (sNumberOfFailures > 0) {
+        fprintf(stderr, "%d failed\n", sNumberOfFailures);
+        return 1;
+    }
+    printf("passed\n");
+    return 0;
+}
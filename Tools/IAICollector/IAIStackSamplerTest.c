@@ -0,0 +1,226 @@
+//
+//  IAIStackSamplerTest.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+//  Checks that IAIStackSampler captures the stack of another thread, and that the call tree
+//  aggregates the captured stacks. Elsewhere than on Apple platforms it also checks that a
+//  capture gives up on a thread that blocks SIGPROF.
+//
+//  The sampled thread spins in IAITestSpinInner, called from IAITestSpinOuter. Both are
+//  exported, so that the captured frames can be named with dladdr; build with -rdynamic and
+//  -fno-omit-frame-pointer:
+//
+//      iai-stack-sampler-test
+//
+
+#if !defined(__APPLE__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "IAICallTree.h"
+#include "IAIStackSampler.h"
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define kNumberOfCaptures 200
+#define kMaxDepth 64
+
+typedef struct {
+    IAIStackSampler* volatile sampler;
+    volatile int shouldStop;
+    int blocksSignal;
+} IAITestThread;
+
+static int sNumberOfFailures = 0;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestExpect(int condition, const char* description) {
+    if (!condition) {
+        fprintf(stderr, "FAILED: %s\n", description);
+        ++sNumberOfFailures;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// The counter keeps a frame on the stack, since a leaf function without one would hide its
+// caller from the walk.
+__attribute__((noinline)) void IAITestSpinInner(IAITestThread* thread) {
+    volatile unsigned long numberOfSpins = 0;
+    while (!thread->shouldStop) {
+        ++numberOfSpins;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+__attribute__((noinline)) void IAITestSpinOuter(IAITestThread* thread) {
+    IAITestSpinInner(thread);
+    __asm__ __volatile__("" ::: "memory");
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void* IAITestThreadMain(void* context) {
+    IAITestThread* thread = context;
+    if (thread->blocksSignal) {
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGPROF);
+        pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    }
+    IAIStackSampler* sampler = IAIStackSamplerCreateForCurrentThread();
+    __sync_synchronize();
+    thread->sampler = sampler;
+    if (NULL != sampler) {
+        IAITestSpinOuter(thread);
+    }
+    return NULL;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static IAIStackSampler* IAITestStartThread(IAITestThread* thread, pthread_t* pthread) {
+    if (0 != pthread_create(pthread, NULL, IAITestThreadMain, thread)) {
+        return NULL;
+    }
+    while (NULL == thread->sampler) {
+        sched_yield();
+    }
+    return thread->sampler;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestStopThread(IAITestThread* thread, pthread_t pthread) {
+    thread->shouldStop = 1;
+    pthread_join(pthread, NULL);
+    IAIStackSamplerDestroy(thread->sampler);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static int IAITestFrameIsIn(uintptr_t frame, const char* functionName) {
+    Dl_info info;
+    return (0 != dladdr((const void *)frame, &info) && NULL != info.dli_sname
+            && 0 == strcmp(info.dli_sname, functionName));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Counts the stacks that pass through IAITestSpinOuter into IAITestSpinInner.
+static void IAITestCountSpinningStacks(const uintptr_t* frames, unsigned depth, uint32_t count,
+                                       void* context) {
+    for (unsigned ix = 0; ix + 1 < depth; ++ix) {
+        if (IAITestFrameIsIn(frames[ix], "IAITestSpinOuter")
+            && IAITestFrameIsIn(frames[ix + 1], "IAITestSpinInner")) {
+            *(uint64_t *)context += count;
+            return;
+        }
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestCapturesAnotherThread(void) {
+    IAITestThread thread;
+    memset(&thread, 0, sizeof(thread));
+    pthread_t pthread;
+    IAIStackSampler* sampler = IAITestStartThread(&thread, &pthread);
+    IAITestExpect(NULL != sampler, "a sampler is created for a new thread");
+    if (NULL == sampler) {
+        return;
+    }
+
+    IAICallTree tree;
+    IAITestExpect(IAICallTreeInit(&tree, 4096), "the call tree is allocated");
+
+    unsigned numberOfCaptures = 0;
+    unsigned numberOfSpinningCaptures = 0;
+    for (unsigned ix = 0; ix < kNumberOfCaptures; ++ix) {
+        uintptr_t frames[kMaxDepth];
+        unsigned depth = IAIStackSamplerCapture(sampler, frames, kMaxDepth);
+        if (depth > 0) {
+            ++numberOfCaptures;
+            IAICallTreeAddStack(&tree, frames, depth);
+        }
+        if (depth >= 2 && IAITestFrameIsIn(frames[0], "IAITestSpinInner")
+            && IAITestFrameIsIn(frames[1], "IAITestSpinOuter")) {
+            ++numberOfSpinningCaptures;
+        }
+    }
+    IAITestStopThread(&thread, pthread);
+
+    IAITestExpect(kNumberOfCaptures == numberOfCaptures, "every capture returns a stack");
+    IAITestExpect(numberOfSpinningCaptures > kNumberOfCaptures / 2,
+                  "most captures stop the thread in IAITestSpinInner called by IAITestSpinOuter");
+    IAITestExpect(tree.numberOfSamples == numberOfCaptures, "the tree counts every capture");
+    IAITestExpect(0 == tree.numberOfTruncatedSamples, "no sample is truncated");
+
+    uint64_t numberOfSpinningSamples = 0;
+    IAICallTreeEnumerateStacks(&tree, IAITestCountSpinningStacks, &numberOfSpinningSamples);
+    IAITestExpect(numberOfSpinningSamples >= numberOfSpinningCaptures,
+                  "the tree's stacks run root first through IAITestSpinOuter");
+    IAICallTreeDestroy(&tree);
+
+    printf("captured %u stacks, %u in IAITestSpinInner\n", numberOfCaptures,
+           numberOfSpinningCaptures);
+}
+
+
+#if !defined(__APPLE__)
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static void IAITestGivesUpOnABlockedThread(void) {
+    IAITestThread thread;
+    memset(&thread, 0, sizeof(thread));
+    thread.blocksSignal = 1;
+    pthread_t pthread;
+    IAIStackSampler* sampler = IAITestStartThread(&thread, &pthread);
+    IAITestExpect(NULL != sampler, "a sampler is created for a thread that blocks SIGPROF");
+    if (NULL == sampler) {
+        return;
+    }
+
+    struct timespec start;
+    struct timespec end;
+    uintptr_t frames[kMaxDepth];
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    unsigned depth = IAIStackSamplerCapture(sampler, frames, kMaxDepth);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (double)(end.tv_sec - start.tv_sec)
+                     + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    IAITestExpect(0 == depth, "a thread that blocks SIGPROF isn't captured");
+    IAITestExpect(seconds < 1, "the capture of a blocked thread times out");
+
+    // The signal is still pending when the thread exits, and is discarded with it.
+    IAITestStopThread(&thread, pthread);
+    printf("gave up on a blocked thread after %.0f ms\n", seconds * 1000);
+}
+
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+int main(void) {
+    IAITestCapturesAnotherThread();
+#if !defined(__APPLE__)
+    IAITestGivesUpOnABlockedThread();
+    IAITestCapturesAnotherThread();
+#endif
+    if (sNumberOfFailures > 0) {
+        fprintf(stderr, "%d failed\n", sNumberOfFailures);
+        return 1;
+    }
+    printf("passed\n");
+    return 0;
+}
@@ -0,0 +1,109 @@
+//
+//  IAITelemetryPrint.c
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#include "IAITelemetryPrint.h"
+
+static const char* kFrameTypeNames[IAITelemetryNumberOfFrameTypes] = {
+    "unknown", "hello", "device", "console", "event", "metric", "drops", "trigger",
+};
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void IAITelemetryPrintFrame(FILE* file, const IAITelemetryFrameHeader* header,
+                            IAITelemetryReader* payload) {
+    const char* typeName = (header->type < IAITelemetryNumberOfFrameTypes
+                            ? kFrameTypeNames[header->type]
+                            : kFrameTypeNames[0]);
+    fprintf(file, "%lld.%06lld %-7s ",
+            (long long)(header->time / 1000000), (long long)(header->time % 1000000), typeName);
+
+    switch (header->type) {
+        case IAITelemetryFrameHello: {
+            uint32_t magic = 0, processId = 0;
+            uint16_t version = 0, reserved = 0;
+            IAITelemetryReadUInt32(payload, &magic);
+            IAITelemetryReadUInt16(payload, &version);
+            IAITelemetryReadUInt16(payload, &reserved);
+            IAITelemetryReadUInt32(payload, &processId);
+            fprintf(file, "version=%u pid=%u%s", version, processId,
+                    (IAITelemetryMagic == magic) ? "" : " (bad magic)");
+            break;
+        }
+        case IAITelemetryFrameDeviceSample: {
+            uint64_t freeMemory = 0, totalMemory = 0, freeDisk = 0, totalDisk = 0;
+            double batteryLevel = 0;
+            uint8_t batteryState = 0;
+            IAITelemetryReadUInt64(payload, &freeMemory);
+            IAITelemetryReadUInt64(payload, &totalMemory);
+            IAITelemetryReadUInt64(payload, &freeDisk);
+            IAITelemetryReadUInt64(payload, &totalDisk);
+            IAITelemetryReadDouble(payload, &batteryLevel);
+            IAITelemetryReadUInt8(payload, &batteryState);
+            fprintf(file, "memory=%llu/%llu disk=%llu/%llu battery=%.2f state=%u",
+                    (unsigned long long)freeMemory, (unsigned long long)totalMemory,
+                    (unsigned long long)freeDisk, (unsigned long long)totalDisk,
+                    batteryLevel, batteryState);
+            uint8_t sampledMetrics = 0;
+            if (IAITelemetryReadUInt8(payload, &sampledMetrics)) {
+                fprintf(file, " sampled=0x%02x", sampledMetrics);
+            }
+            break;
+        }
+        case IAITelemetryFrameConsoleLog: {
+            uint8_t level = 0;
+            size_t length = 0;
+            IAITelemetryReadUInt8(payload, &level);
+            const char* text = IAITelemetryReadText(payload, &length);
+            fprintf(file, "level=%u %.*s", level, (int)length, text);
+            break;
+        }
+        case IAITelemetryFrameEvent: {
+            uint32_t type = 0;
+            double value = 0;
+            IAITelemetryReadUInt32(payload, &type);
+            fprintf(file, "type=%d", (int32_t)type);
+            // Streams from before events had values end after the type.
+            if (IAITelemetryReadDouble(payload, &value)) {
+                fprintf(file, " value=%g", value);
+            }
+            break;
+        }
+        case IAITelemetryFrameMetric: {
+            double value = 0;
+            size_t length = 0;
+            IAITelemetryReadDouble(payload, &value);
+            const char* name = IAITelemetryReadText(payload, &length);
+            fprintf(file, "%.*s=%g", (int)length, name, value);
+            break;
+        }
+        case IAITelemetryFrameDrops: {
+            for (int type = IAITelemetryFrameDeviceSample; type <= IAITelemetryFrameMetric;
+                 ++type) {
+                uint64_t count = 0;
+                IAITelemetryReadUInt64(payload, &count);
+                fprintf(file, "%s=%llu ", kFrameTypeNames[type], (unsigned long long)count);
+            }
+            break;
+        }
+        case IAITelemetryFrameTrigger: {
+            double value = 0;
+            size_t length = 0;
+            IAITelemetryReadDouble(payload, &value);
+            const char* name = IAITelemetryReadText(payload, &length);
+            fprintf(file, "%.*s value=%g", (int)length, name, value);
+            break;
+        }
+        default:
+            fprintf(file, "(%u bytes)", (unsigned)payload->length);
+            break;
+    }
+    if (header->flags & IAITelemetryFrameFlagTruncated) {
+        fprintf(file, " (truncated)");
+    }
+    fputc('\n', file);
+}
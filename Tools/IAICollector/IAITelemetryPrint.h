@@ -0,0 +1,22 @@
+//
+//  IAITelemetryPrint.h
+//  InAppInstrumentation
+//
+//  Created by Santthosh on 10/16/12.
+//  Copyright (c) 2012 Santthosh. All rights reserved.
+//
+
+#ifndef InAppInstrumentation_IAITelemetryPrint_h
+#define InAppInstrumentation_IAITelemetryPrint_h
+
+#include <stdio.h>
+
+#include "IAITelemetryFrame.h"
+
+/**
+ * Prints a frame as a single line of text: its time, its type and its fields.
+ */
+void IAITelemetryPrintFrame(FILE* file, const IAITelemetryFrameHeader* header,
+                            IAITelemetryReader* payload);
+
+#endif